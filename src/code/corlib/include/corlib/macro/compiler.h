@@ -142,4 +142,34 @@
 #   define XR_COMPILER_ALLOCATOR_HINT
 #endif // XR_MSVC_COMPILER_FAMILY
 
-//-----------------------------------------------------------------------------------------------------------
\ No newline at end of file
+//-----------------------------------------------------------------------------------------------------------
+// XR_RETURN_ADDRESS macro
+#if defined(XR_RETURN_ADDRESS)
+#   error please do not define XR_RETURN_ADDRESS macros
+#endif // #if defined(XR_RETURN_ADDRESS)
+
+#if XR_MSVC_COMPILER_FAMILY
+extern "C" void* _ReturnAddress();
+#   pragma intrinsic(_ReturnAddress)
+#   define XR_RETURN_ADDRESS() _ReturnAddress()
+#elif XR_GCC_COMPILER_FAMILY
+#   define XR_RETURN_ADDRESS() __builtin_return_address(0)
+#else
+#   define XR_RETURN_ADDRESS() nullptr
+#endif // XR_MSVC_COMPILER_FAMILY
+
+//-----------------------------------------------------------------------------------------------------------
+// XR_TARGET_ISA macro
+#if defined(XR_TARGET_ISA)
+#   error please do not define XR_TARGET_ISA macros
+#endif // #if defined(XR_TARGET_ISA)
+
+// Lets one function use instructions the rest of the module is not built for, e.g. "avx2".
+// Call it only after checking cpu features. MSVC emits any intrinsic without it.
+#if XR_GCC_COMPILER_FAMILY
+#   define XR_TARGET_ISA(isa) __attribute__((target(isa)))
+#else
+#   define XR_TARGET_ISA(isa)
+#endif // XR_GCC_COMPILER_FAMILY
+
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,163 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "corlib/memory/memory_allocator_base.h"
+#include "corlib/memory/profiler_event_listener.h"
+#include "corlib/sys/tls.h"
+#include "corlib/threading/atomic_types.h"
+#include "corlib/threading/spin_wait.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, memory)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace details
+{
+
+struct profiler_event;
+struct profiler_thread_buffer;
+struct profiler_site;
+struct profiler_live_block;
+struct profiler_pending_free;
+
+} // namespace details
+//-----------------------------------------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------------------------------------
+// Statistics of one call site. Function, file and line are known in debug builds only, in release
+// builds sites differ by return address of malloc_impl.
+struct allocation_site_report
+{
+    utils::string_view description;
+    pcstr function;
+    pcstr file;
+    uint32_t line;
+    pcvoid call_site;
+
+    uint64_t allocations_count;
+    uint64_t frees_count;
+    uint64_t allocated_bytes;
+    size_t live_bytes;
+    size_t peak_live_bytes;
+    uint64_t live_blocks_count;
+
+    //! changes since previous snapshot
+    uint64_t period_allocations_count;
+    uint64_t period_allocated_bytes;
+    int64_t period_live_bytes;
+}; // struct allocation_site_report
+
+//-----------------------------------------------------------------------------------------------------------
+struct allocation_profiler_totals
+{
+    uint64_t allocations_count;
+    uint64_t frees_count;
+    uint64_t allocated_bytes;
+    size_t live_bytes;
+    size_t peak_live_bytes;
+    uint64_t live_blocks_count;
+    //! frees of blocks allocated before profiler was attached
+    uint64_t unknown_frees_count;
+    //! allocations that didn't fit into sites table and were counted in the last site
+    uint64_t untracked_sites_count;
+}; // struct allocation_profiler_totals
+
+//-----------------------------------------------------------------------------------------------------------
+typedef void (*allocation_site_report_function)(const allocation_site_report& report, pvoid user_data);
+
+//-----------------------------------------------------------------------------------------------------------
+// Event listener that aggregates allocations of one allocator by call site. Every thread writes events
+// into its own ring without locks, rings are drained in timestamp order when one of them fills up or
+// when statistics are requested, so the cost on allocation is one hash lookup and one store.
+//
+// Threads get rings on first use like lanes in frame_allocator, threads beyond max_thread_buffers
+// share one locked ring. Profiler memory comes from backing allocator, which must not be profiled
+// by the same profiler.
+class allocation_profiler final : public base_profiler_event_listener
+{
+public:
+    static constexpr uint32_t max_thread_buffers = 64;
+    static constexpr uint32_t events_per_buffer = 1024;
+    static constexpr uint32_t max_sites = 4096;
+
+    allocation_profiler() = default;
+    virtual ~allocation_profiler();
+
+    XR_DECLARE_DELETE_COPY_ASSIGNMENT(allocation_profiler);
+    XR_DECLARE_DELETE_MOVE_ASSIGNMENT(allocation_profiler);
+
+    void initialize(base_allocator& backing);
+
+    // Applies events buffered by all threads
+    void flush();
+
+    allocation_profiler_totals get_totals();
+
+    // Calls function for every site, period counters go back to previous take_snapshot
+    void report_sites(allocation_site_report_function function, pvoid user_data);
+
+    // Starts next period of site reports, e.g. at the end of frame
+    void take_snapshot();
+
+    virtual void on_malloc_done(pvoid buffer, size_t buffer_size, size_t previous_size,
+        utils::string_view description, pcvoid call_site XR_DEBUG_PARAMETERS_DECLARATION) override;
+
+    virtual void on_free_done(pvoid& buffer XR_DEBUG_PARAMETERS_DECLARATION) override;
+
+private:
+    void finalize();
+
+    details::profiler_thread_buffer* get_thread_buffer();
+    bool is_shared_buffer(const details::profiler_thread_buffer* buffer) const;
+    void push_event(details::profiler_thread_buffer& buffer, details::profiler_event& event);
+
+    uint32_t find_site(details::profiler_thread_buffer& buffer, utils::string_view description,
+        pcstr function, pcstr file, uint32_t line, pcvoid call_site);
+
+    void flush_locked();
+    void apply_malloc(const details::profiler_event& event);
+    void apply_free(const details::profiler_event& event);
+    void drop_pending_frees();
+
+    details::profiler_live_block* find_live_block(pvoid pointer);
+    bool insert_live_block(pvoid pointer, size_t size, uint32_t site);
+    void remove_live_block(details::profiler_live_block* block);
+    void release_live_block(details::profiler_live_block* block);
+    bool grow_live_blocks();
+
+    static constexpr uint32_t max_pending_frees = 256;
+
+    base_allocator* m_backing { nullptr };
+    sys::tls_handle m_tls { sys::invalid_thread_local_storage };
+
+    //! max_thread_buffers private rings allocated on first use and a shared one
+    details::profiler_thread_buffer* volatile m_buffers[max_thread_buffers + 1] {};
+    threading::atomic_uint32 m_buffers_count { 0 };
+    threading::spin_wait_fairness m_shared_buffer_lock;
+
+    //! sites are only appended, their index never changes
+    threading::spin_wait_fairness m_sites_lock;
+    details::profiler_site* m_sites { nullptr };
+    //! open addressing index of sites, slot keeps site index plus one
+    uint32_t* m_site_slots { nullptr };
+    threading::atomic_uint32 m_sites_count { 0 };
+
+    //! everything below is touched under drain lock only
+    threading::spin_wait_fairness m_drain_lock;
+
+    //! open addressing table of blocks in use
+    details::profiler_live_block* m_live_blocks { nullptr };
+    size_t m_live_blocks_capacity { 0 };
+
+    //! frees that came before allocation of the same block, they are matched on next drain
+    details::profiler_pending_free* m_pending_frees { nullptr };
+    uint32_t m_pending_frees_count { 0 };
+    uint64_t m_drains_count { 0 };
+
+    allocation_profiler_totals m_totals {};
+}; // class allocation_profiler
+
+XR_NAMESPACE_END(xr, memory)
+//-----------------------------------------------------------------------------------------------------------
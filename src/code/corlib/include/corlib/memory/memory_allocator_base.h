@@ -54,7 +54,7 @@ protected:
     virtual void call_free(pvoid pointer 
         XR_DEBUG_PARAMETERS_DECLARATION) = 0;
 
-    void on_malloc(pvoid buffer, size_t buffer_size, size_t previous_size 
+    void on_malloc(pvoid buffer, size_t buffer_size, size_t previous_size, pcvoid call_site
         XR_DEBUG_PARAMETERS_DESCRIPTION_DECLARATION XR_DEBUG_PARAMETERS_DECLARATION) const;
 
     void on_free(pvoid& buffer XR_DEBUG_PARAMETERS_DECLARATION) const;
@@ -0,0 +1,139 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "corlib/memory/memory_allocator_base.h"
+#include "corlib/sys/tls.h"
+#include "corlib/threading/atomic_types.h"
+#include "corlib/threading/spin_wait.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, memory)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace details
+{
+
+struct frame_page;
+struct frame_lane;
+
+} // namespace details
+//-----------------------------------------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------------------------------------
+// Made at the end of frame that used more memory than its budget
+struct frame_allocator_report
+{
+    uint64_t frame_index;
+    size_t budget;
+    //! bytes handed out during frame
+    size_t used_size;
+    uint32_t allocations_count;
+    //! blocks that were not given back with free, usually the ones that outgrew the budget
+    uint32_t live_blocks_count;
+    //! thread that allocated the most
+    uint32_t largest_lane_index;
+    size_t largest_lane_used_size;
+}; // struct frame_allocator_report
+
+//-----------------------------------------------------------------------------------------------------------
+typedef void (*frame_report_function)(const frame_allocator_report& report, pvoid user_data);
+
+//-----------------------------------------------------------------------------------------------------------
+// Linear allocator for transient data. Every thread bumps a pointer in its own 64Kb pages, free
+// only counts blocks. Memory allocated during a frame stays valid until buffered_frames frames
+// later, when pages of that frame are taken back as a whole.
+//
+// Threads get lanes on first use like in thread_caching_allocator, threads beyond
+// max_thread_lanes share one locked lane.
+class frame_allocator final : public base_allocator
+{
+public:
+    static constexpr uint32_t max_buffered_frames = 3;
+    static constexpr uint32_t max_thread_lanes = 64;
+    static constexpr size_t page_size = XR_KILOBYTES_TO_BYTES(64);
+
+    frame_allocator() = default;
+    virtual ~frame_allocator();
+
+    // Backing allocator must outlive this allocator, buffered_frames is 2 for double buffering
+    // and 3 for triple buffering
+    void initialize(base_allocator& backing, uint32_t buffered_frames, size_t frame_budget);
+
+    // Finishes current frame and recycles memory of the frame started buffered_frames ago.
+    // Must be called when no other thread uses the allocator, for example after wait_all.
+    void next_frame();
+
+    uint64_t get_frame_index() const;
+    size_t get_frame_budget() const;
+    // How many frames went over budget
+    uint64_t get_overflow_count() const;
+
+    // Called from next_frame for frames over budget
+    void set_report_function(frame_report_function function, pvoid user_data);
+
+    virtual bool can_allocate_block(size_t const size) const XR_NOEXCEPT override;
+    // bytes taken from backing allocator
+    virtual size_t total_size() const XR_NOEXCEPT override;
+    // bytes handed out during buffered frames
+    virtual size_t allocated_size() const XR_NOEXCEPT override;
+
+private:
+    pvoid call_malloc(size_t size
+        XR_DEBUG_PARAMETERS_DESCRIPTION_DECLARATION
+        XR_DEBUG_PARAMETERS_DECLARATION) override;
+
+    pvoid call_realloc(pvoid pointer, size_t new_size
+        XR_DEBUG_PARAMETERS_DESCRIPTION_DECLARATION
+        XR_DEBUG_PARAMETERS_DECLARATION) override;
+
+    void call_free(pvoid pointer
+        XR_DEBUG_PARAMETERS_DECLARATION) override;
+
+    void finalize();
+
+    details::frame_lane* get_lane();
+    bool is_shared_lane(const details::frame_lane* lane) const;
+
+    pvoid allocate(details::frame_lane& lane, size_t size);
+    pvoid reallocate(details::frame_lane& lane, pvoid pointer, size_t new_size);
+    void release(details::frame_lane& lane, pvoid pointer);
+    pvoid allocate_from_new_page(details::frame_lane& lane, size_t size);
+
+    details::frame_page* acquire_page(size_t size);
+    void recycle_pages(details::frame_page* pages);
+    bool refill_pages();
+
+    void report_frame(uint32_t buffer);
+
+    static constexpr uint32_t max_chunks_count = 1024;
+
+    base_allocator* m_backing { nullptr };
+    sys::tls_handle m_tls { sys::invalid_thread_local_storage };
+
+    //! max_thread_lanes private lanes and a shared one
+    details::frame_lane* m_lanes { nullptr };
+    threading::atomic_uint32 m_lanes_count { 0 };
+    threading::spin_wait_fairness m_shared_lane_lock;
+
+    //! pages ready for reuse and chunks they were carved from
+    threading::spin_wait_fairness m_pages_lock;
+    details::frame_page* m_free_pages { nullptr };
+    pvoid m_chunks[max_chunks_count] {};
+    uint32_t m_chunks_count { 0 };
+
+    uint64_t m_frame_index { 0 };
+    uint32_t m_buffered_frames { 0 };
+    //! frame_index % buffered_frames, counters and pages of current frame are kept there
+    uint32_t m_current_buffer { 0 };
+    size_t m_frame_budget { 0 };
+    threading::atomic_uint64 m_overflow_count { 0 };
+    threading::atomic_size_t m_backing_size { 0 };
+
+    frame_report_function m_report_function { nullptr };
+    pvoid m_report_user_data { nullptr };
+}; // class frame_allocator
+
+XR_NAMESPACE_END(xr, memory)
+//-----------------------------------------------------------------------------------------------------------
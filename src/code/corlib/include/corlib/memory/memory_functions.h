@@ -8,14 +8,51 @@
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, memory)
 
+//-----------------------------------------------------------------------------------------------------------
+// Widest vector instructions used by copy, zero and fill. The best one supported by cpu is chosen
+// on first call.
+enum class vector_isa : uint32_t
+{
+    sse2,
+    avx2,
+    avx512
+}; // enum class vector_isa
+
 //-----------------------------------------------------------------------------------------------------------
 /**
 */
-void copy(void* destination, size_t const destination_size, void const* source, size_t const source_size);
+vector_isa get_vector_isa();
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Switches copy, zero and fill to given instructions, for tests and benchmarks.
+ *  Returns false and keeps current set if cpu doesn't support it.
+ */
+bool set_vector_isa(vector_isa isa);
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Blocks of this size and larger are written with non-temporal stores, which bypass cache.
+ *  By default it's a half of last level cache: smaller blocks are likely to be read soon
+ *  and larger ones would evict everything else anyway.
+ */
+size_t get_non_temporal_threshold();
 
 //-----------------------------------------------------------------------------------------------------------
 /**
 */
+void set_non_temporal_threshold(size_t const size);
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Blocks must not overlap.
+ */
+void copy(void* destination, size_t const destination_size, void const* source, size_t const source_size);
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Same as copy, asserts that both blocks are 16 bytes aligned.
+ */
 void copy_align_16(void* destination, size_t const destination_size, void const* source, size_t const source_size);
 
 //-----------------------------------------------------------------------------------------------------------
@@ -23,6 +60,11 @@ void copy_align_16(void* destination, size_t const destination_size, void const*
 */
 void zero(void* destination, size_t const size_in_bytes);
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+void fill(void* destination, size_t const size_in_bytes, uint8_t const value);
+
 //-----------------------------------------------------------------------------------------------------------
 /**
 */
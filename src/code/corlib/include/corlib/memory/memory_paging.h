@@ -8,10 +8,60 @@
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, memory)
 
+//-----------------------------------------------------------------------------------------------------------
+// Pages backing a reservation. Large pages (2Mb on x86-64) need fewer TLB entries, but they are
+// committed and decommitted as a whole.
+enum class page_kind : uint32_t
+{
+    normal,
+    //! large pages where system provides them, normal pages otherwise
+    large
+}; // enum class page_kind
+
 //-----------------------------------------------------------------------------------------------------------
 /**
 */
 size_t system_page_size();
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Size of large pages, 0 if system has none.
+ */
+size_t large_page_size();
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Reserves address space without backing memory, returns nullptr on failure. Large reservation
+ *  is aligned to large_page_size, its size and every committed range must be multiples of it.
+ *  If large pages can't be used, normal ones are reserved. Explicit huge pages are set aside for the
+ *  whole large reservation, so it should not be bigger than what can be committed.
+ */
+pvoid reserve_pages(size_t size, page_kind kind);
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Makes reserved pages readable and writable, they are zeroed on first touch.
+ */
+bool commit_pages(pvoid address, size_t size);
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Returns physical memory of committed pages to system, address space stays reserved.
+ */
+void decommit_pages(pvoid address, size_t size);
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Releases whole reservation, size must be the one passed to reserve_pages.
+ */
+void release_pages(pvoid address, size_t size);
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Bytes of committed range that are actually backed by large pages right now. System may give
+ *  large pages later or take them back, so the result is a snapshot.
+ */
+size_t query_large_page_size(pvoid address, size_t size);
+
 XR_NAMESPACE_END(xr, memory)
 //-----------------------------------------------------------------------------------------------------------
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "corlib/memory/memory_allocator_base.h"
+#include "corlib/memory/memory_paging.h"
 #include "corlib/sys/thread.h"
 
 //-----------------------------------------------------------------------------------------------------------
@@ -16,12 +17,17 @@ public:
     st_arena_allocator();
     virtual ~st_arena_allocator();
 
-    void initialize(size_t size, size_t initial, uint32_t const user_thread_id);
+    // Large pages cut TLB misses of big arenas, both sizes are rounded up to whole large pages then
+    void initialize(size_t size, size_t initial, uint32_t const user_thread_id,
+        page_kind pages = page_kind::normal);
 
     virtual bool can_allocate_block(size_t const size) const XR_NOEXCEPT;
     virtual size_t total_size() const XR_NOEXCEPT override;
     virtual size_t allocated_size() const XR_NOEXCEPT override;
 
+    // Committed bytes that actually got large pages
+    size_t query_large_page_size() const;
+
 private:
     virtual pvoid call_malloc(size_t size
         XR_DEBUG_PARAMETERS_DESCRIPTION_DECLARATION 
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "corlib/threading/interlocked.h"
+#include "corlib/macro/aligning.h"
 #include "corlib/memory/memory_functions.h"
 #include "corlib/memory/memory_allocator_base.h"
 
@@ -13,12 +14,14 @@
 XR_NAMESPACE_BEGIN(xr, memory)
 
 //-----------------------------------------------------------------------------------------------------------
+// Pool of MaxCount blocks of Size bytes. Free blocks are kept in a lock-free list, its head is a pointer
+// with a pointer-wide tag swapped by double-width compare-exchange, so the list is safe from ABA.
 template<size_t Size, size_t MaxCount>
 class static_allocator : public base_allocator
 {
 public:
     static_allocator();
-    virtual ~static_allocator() = default;
+    virtual ~static_allocator();
 
     XR_DECLARE_DELETE_COPY_ASSIGNMENT(static_allocator);
     XR_DECLARE_DELETE_MOVE_ASSIGNMENT(static_allocator);
@@ -67,33 +70,17 @@ private:
 
     node_prefix* from_node(pvoid n)
     {
-        return reinterpret_cast<node_prefix*>(reinterpret_cast<pstr>(n) - node_size);
+        return reinterpret_cast<node_prefix*>(n) - 1;
+    }
+
+    node_prefix* node_at(size_t index)
+    {
+        return reinterpret_cast<node_prefix*>(m_buffer + (index * granularity));
     }
 
     XR_ALIGNAS(XR_MAX_CACHE_LINE_SIZE) uint8_t m_buffer[max_count * granularity];
 
-    union pointer_and_counter
-    {
-        volatile int64_t whole;
-
-#if XRAY_PLATFORM_32BIT
-        struct
-        {
-            uintptr_t pointer;
-            uint32_t counter;
-        };
-#elif XRAY_PLATFORM_64BIT
-        struct
-        {
-            uintptr_t pointer : 48;
-            uint64_t counter : 16;
-        };
-#else
-#   error "Unknown platform"
-#endif // XRAY_PLATFORM_WIN32
-    };
-
-    pointer_and_counter m_free_list;
+    threading::atomic_tagged_pointer m_free_list;
     uintptr_t m_allocator_stamp;
     threading::atomic_size_t m_total_size;
     threading::atomic_size_t m_allocated_size;
@@ -107,10 +94,10 @@ private:
 template<size_t Size, size_t MaxCount>
 static_allocator<Size, MaxCount>::static_allocator()
     : m_buffer {}
+    , m_free_list { nullptr, 0 }
     , m_allocator_stamp { 0 }
     , m_total_size { 0 }
     , m_allocated_size { 0 }
-    , m_free_list { 0 }
     , m_is_valid { false }
 {}
 
@@ -120,7 +107,7 @@ static_allocator<Size, MaxCount>::static_allocator()
 template<size_t Size, size_t MaxCount>
 static_allocator<Size, MaxCount>::~static_allocator()
 {
-    XR_DEBUG_ASSERTION_MSG(check_all_free(), "some object references are still in use");
+    XR_DEBUG_ASSERTION_MSG(!m_is_valid || check_all_free(), "some object references are still in use");
     m_is_valid = false;
 }
 
@@ -131,19 +118,18 @@ template<size_t Size, size_t MaxCount>
 inline void
 static_allocator<Size, MaxCount>::initialize(uintptr_t allocator_stamp)
 {
-    m_allocated_size = allocator_stamp;
+    m_allocator_stamp = allocator_stamp;
     for(size_t i = 0; i < max_count; ++i)
     {
-        node_prefix* current_node = reinterpret_cast<node_prefix*>(
-            reinterpret_cast<pbyte>(m_buffer) + (i * max_size));
-        node_prefix* next_node = reinterpret_cast<node_prefix*>(
-            reinterpret_cast<pbyte>(m_buffer) + ((i + 1U) * max_size));
-
+        node_prefix* current_node = node_at(i);
         current_node->allocator_stamp = m_allocator_stamp;
-        current_node->next = (i == max_count - 1) ? nullptr : next_node;
+        current_node->next = (i == max_count - 1) ? nullptr : node_at(i + 1U);
     }
 
-    m_free_list.pointer = reinterpret_cast<uintptr_t>(m_buffer);
+    m_free_list.pointer = node_at(0);
+    m_free_list.tag = 0;
+    threading::atomic_store_rel(m_total_size, max_count * node_size);
+    threading::atomic_store_rel(m_allocated_size, size_t { 0 });
     m_is_valid = true;
 }
 
@@ -156,8 +142,8 @@ bool static_allocator<Size, MaxCount>::check_all_free()
     XR_DEBUG_ASSERTION_MSG(m_is_valid, "allocator is not initialized");
 
     size_t free_count = 0U;
-    node_prefix const* current_node =
-        reinterpret_cast<node_prefix*>(m_free_list.pointer);
+    node_prefix const* current_node = reinterpret_cast<node_prefix*>(
+        threading::atomic_fetch_tagged_acq(m_free_list).pointer);
 
     while(current_node)
     {
@@ -180,21 +166,22 @@ static_allocator<Size, MaxCount>::call_malloc(size_t size
     XR_DEBUG_ASSERTION_MSG(m_is_valid, "allocator is not initialized");
     XR_DEBUG_ASSERTION_MSG(can_allocate_block(size), "Could not fit object into pool");
 
-    pointer_and_counter allocated_task;
-    pointer_and_counter new_head;
+    threading::atomic_tagged_pointer head;
+    threading::atomic_tagged_pointer new_head;
 
     do
     {
-        allocated_task = m_free_list;
-        if(!allocated_task.pointer)
+        head = threading::atomic_fetch_tagged_acq(m_free_list);
+        if(!head.pointer)
             return nullptr;
 
-        new_head.pointer = reinterpret_cast<uintptr_t>(
-            reinterpret_cast<node_prefix*>(allocated_task.pointer)->next);
-        new_head.counter = allocated_task.counter + 1U;
-    } while(!threading::atomic_bcas_seq(m_free_list.whole, new_head.whole, allocated_task.whole));
+        // node may be taken and given back by other threads meanwhile, tag makes such head stale
+        new_head.pointer = reinterpret_cast<node_prefix*>(head.pointer)->next;
+        new_head.tag = head.tag + 1U;
+    } while(!threading::atomic_bcas_tagged_seq(m_free_list, new_head, head));
 
-    return to_node(reinterpret_cast<node_prefix*>(allocated_task.pointer));
+    threading::atomic_fetch_add_seq(m_allocated_size, node_size);
+    return to_node(reinterpret_cast<node_prefix*>(head.pointer));
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -227,24 +214,25 @@ void static_allocator<Size, MaxCount>::call_free(pvoid pointer
 {
     XR_DEBUG_ASSERTION_MSG(m_is_valid, "allocator is not initialized");
 
-    pointer_and_counter head;
-    pointer_and_counter new_head;
+    if(!pointer)
+        return;
 
     node_prefix* n = from_node(pointer);
     XR_DEBUG_ASSERTION_MSG(n->allocator_stamp == m_allocator_stamp,
         "invalid allocator for memory block");
 
-    new_head.pointer = reinterpret_cast<uintptr_t>(n);
+    threading::atomic_tagged_pointer head;
+    threading::atomic_tagged_pointer new_head;
+    new_head.pointer = n;
 
     do
     {
-        head = m_free_list;
-
-        reinterpret_cast<node_prefix*>(new_head.pointer)->next =
-            reinterpret_cast<node_prefix*>(head.pointer);
+        head = threading::atomic_fetch_tagged_acq(m_free_list);
+        n->next = reinterpret_cast<node_prefix*>(head.pointer);
+        new_head.tag = head.tag + 1U;
+    } while(!threading::atomic_bcas_tagged_seq(m_free_list, new_head, head));
 
-        new_head.counter = head.counter;
-    } while(!threading::atomic_bcas_seq(m_free_list.whole, new_head.whole, head.whole));
+    threading::atomic_fetch_sub_seq(m_allocated_size, node_size);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -277,5 +265,5 @@ static_allocator<Size, MaxCount>::allocated_size() const XR_NOEXCEPT
     return threading::atomic_fetch_acq(m_allocated_size);
 }
 
-} // namespace az::tasks
+XR_NAMESPACE_END(xr, memory)
 //-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,103 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "corlib/memory/memory_allocator_base.h"
+#include "corlib/sys/tls.h"
+#include "corlib/threading/atomic_types.h"
+#include "corlib/threading/spin_wait.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, memory)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace details
+{
+
+struct slab_header;
+struct thread_cache;
+
+} // namespace details
+//-----------------------------------------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------------------------------------
+// Small-object allocator with per-thread caches. Blocks up to max_small_size are rounded to a size
+// class and taken from 64Kb slabs owned by the calling thread without any locking. Blocks freed by
+// other threads (for example by a task resumed on another worker) go to the lock-free remote list of
+// their slab and are collected by the owner. Slabs are taken from the backing allocator in chunks,
+// larger blocks go to the backing allocator directly.
+//
+// A thread gets its cache on first use and keeps it until the allocator is finalized, so the allocator
+// fits long-living threads like task workers. Threads beyond max_thread_caches share one locked cache.
+class thread_caching_allocator final : public base_allocator
+{
+public:
+    static constexpr size_t max_small_size = 4096;
+    static constexpr uint32_t max_thread_caches = 128;
+
+    thread_caching_allocator() = default;
+    virtual ~thread_caching_allocator();
+
+    // Backing allocator must outlive this allocator
+    void initialize(base_allocator& backing);
+
+    virtual bool can_allocate_block(size_t const size) const XR_NOEXCEPT override;
+    // bytes taken from backing allocator
+    virtual size_t total_size() const XR_NOEXCEPT override;
+    // bytes handed out, small blocks are counted with their size class
+    virtual size_t allocated_size() const XR_NOEXCEPT override;
+
+private:
+    pvoid call_malloc(size_t size
+        XR_DEBUG_PARAMETERS_DESCRIPTION_DECLARATION
+        XR_DEBUG_PARAMETERS_DECLARATION) override;
+
+    pvoid call_realloc(pvoid pointer, size_t new_size
+        XR_DEBUG_PARAMETERS_DESCRIPTION_DECLARATION
+        XR_DEBUG_PARAMETERS_DECLARATION) override;
+
+    void call_free(pvoid pointer
+        XR_DEBUG_PARAMETERS_DECLARATION) override;
+
+    void finalize();
+
+    details::thread_cache* get_thread_cache();
+    bool is_small_block(pvoid pointer) const;
+
+    pvoid allocate_small(details::thread_cache& cache, uint32_t size_class);
+    void free_small(details::thread_cache& cache, details::slab_header* slab, pvoid pointer);
+
+    pvoid allocate_large(size_t size);
+    pvoid reallocate_large(pvoid pointer, size_t new_size);
+    void free_large(pvoid pointer);
+
+    details::slab_header* acquire_slab(details::thread_cache& cache, uint32_t size_class);
+    void release_slab(details::slab_header* slab);
+    bool refill_slabs();
+
+    static constexpr uint32_t max_chunks_count = 4096;
+
+    base_allocator* m_backing { nullptr };
+    sys::tls_handle m_tls { sys::invalid_thread_local_storage };
+
+    //! max_thread_caches private caches and a shared one
+    details::thread_cache* m_caches { nullptr };
+    threading::atomic_uint32 m_caches_count { 0 };
+    threading::spin_wait_fairness m_shared_cache_lock;
+
+    //! empty slabs and chunks they were carved from
+    threading::spin_wait_fairness m_slabs_lock;
+    details::slab_header* m_free_slabs { nullptr };
+    pvoid m_chunks[max_chunks_count] {};
+    uint32_t m_chunks_count { 0 };
+
+    //! bit per 64Kb of address space that is a slab, leaves are created when chunk is registered
+    uint64_t* volatile* m_slab_map { nullptr };
+
+    threading::atomic_size_t m_backing_size { 0 };
+    threading::atomic_size_t m_large_allocated_size { 0 };
+}; // class thread_caching_allocator
+
+XR_NAMESPACE_END(xr, memory)
+//-----------------------------------------------------------------------------------------------------------
@@ -15,11 +15,12 @@ public:
     virtual ~base_profiler_event_listener()
     {};
 
-    // Called from memory allocator on allocation/reallocation
+    // Called from memory allocator on allocation/reallocation, call_site is return address of
+    // malloc_impl/realloc_impl. Description is empty in release builds.
     virtual void on_malloc_done(pvoid buffer, size_t buffer_size, size_t previous_size,
-        utils::string_view description XR_DEBUG_PARAMETERS_DECLARATION) = 0;
+        utils::string_view description, pcvoid call_site XR_DEBUG_PARAMETERS_DECLARATION) = 0;
 
-    // Called from memory allocator on free
+    // Called from memory allocator before free, and before reallocation for the old block
     virtual void on_free_done(pvoid& buffer XR_DEBUG_PARAMETERS_DECLARATION) = 0;
 }; // class base_profiler_event_listener
 
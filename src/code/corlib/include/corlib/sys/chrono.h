@@ -5,6 +5,12 @@
 
 #include "corlib/types.h"
 
+#if defined(XRAY_PLATFORM_WINDOWS)
+#   include <intrin.h>
+#else
+#   include <x86intrin.h>
+#endif // defined(XRAY_PLATFORM_WINDOWS)
+
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, sys)
 
@@ -24,10 +30,21 @@ tick now_milliseconds();
 
 //-----------------------------------------------------------------------------------------------------------
 /**
- *  Current milliseconds count.
+ *  Current microseconds count. Monotonic, use it for deadlines.
  */
 tick now_microseconds();
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Raw cpu time stamp counter. Much cheaper than now_microseconds, but its frequency is unknown,
+ *  calibrate it against now_microseconds when timestamps have to be converted.
+ */
+inline uint64_t
+cpu_timestamp()
+{
+    return __rdtsc();
+}
+
 //-----------------------------------------------------------------------------------------------------------
 /**
  *  Convert ticks to seconds.
@@ -0,0 +1,38 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "corlib/types.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, sys)
+
+//-----------------------------------------------------------------------------------------------------------
+// Instruction set extensions usable by this process. Vector extensions are reported only when
+// operating system saves their registers, so code may call them right away.
+struct cpu_features
+{
+    bool sse2;
+    bool sse41;
+    bool avx;
+    bool avx2;
+    bool avx512f;
+    bool avx512bw;
+    //! rep movsb/stosb are fast for large blocks
+    bool erms;
+    //! rep movsb is fast for small blocks as well
+    bool fsrm;
+
+    //! bytes of last level cache, 0 if cpu doesn't report it
+    size_t llc_size;
+}; // struct cpu_features
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Features are read with cpuid on first call, later calls return the same structure.
+ */
+const cpu_features& query_cpu_features();
+
+XR_NAMESPACE_END(xr, sys)
+//-----------------------------------------------------------------------------------------------------------
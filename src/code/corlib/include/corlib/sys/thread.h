@@ -30,6 +30,16 @@ XR_CONSTEXPR_CPP14_OR_CONST thread_handle unknown_thread_handle = nullptr;
 // See http://blogs.msdn.com/b/oldnewthing/archive/2004/02/23/78395.aspx
 XR_CONSTEXPR_CPP14_OR_CONST thread_id invalid_thread_id = 0;
 
+#elif defined(XRAY_PLATFORM_LINUX)
+// pthread and what its start routine needs, owned by handle and by running thread
+struct posix_thread;
+typedef posix_thread* thread_handle;
+typedef uint32_t thread_id;
+typedef uint32_t(*thread_function)(pvoid);
+XR_CONSTEXPR_CPP14_OR_CONST thread_handle unknown_thread_handle = nullptr;
+// kernel thread ids start from 1
+XR_CONSTEXPR_CPP14_OR_CONST thread_id invalid_thread_id = 0;
+
 #else
 #error "Thread handle is not defined for this platform!"
 
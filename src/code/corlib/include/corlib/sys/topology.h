@@ -0,0 +1,63 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "corlib/types.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, sys)
+
+//-----------------------------------------------------------------------------------------------------------
+XR_CONSTEXPR_CPP14_OR_CONST uint32_t max_logical_processors = 256;
+
+//-----------------------------------------------------------------------------------------------------------
+// Location of logical processor. All ids are dense: 0 .. (count - 1) of corresponding level.
+struct logical_processor_info
+{
+    //! index usable as spawn_thread hardware_thread
+    uint32_t hardware_thread;
+    //! physical core, SMT siblings share it
+    uint32_t core_id;
+    //! group of cores sharing last level cache
+    uint32_t llc_id;
+    //! NUMA node
+    uint32_t node_id;
+    //! physical package (socket)
+    uint32_t package_id;
+}; // struct logical_processor_info
+
+//-----------------------------------------------------------------------------------------------------------
+struct cpu_topology
+{
+    uint32_t processors_count;
+    uint32_t cores_count;
+    uint32_t llc_count;
+    uint32_t nodes_count;
+    uint32_t packages_count;
+
+    //! sorted by node, package, last level cache, core and hardware thread
+    logical_processor_info processors[max_logical_processors];
+}; // struct cpu_topology
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Fills topology of online processors. If platform can't report it, every processor is described
+ *  as a separate core of single cache, node and package, and false is returned.
+ */
+bool query_cpu_topology(cpu_topology& topology);
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Topology with every processor being a separate core of single cache, node and package.
+ */
+void make_flat_cpu_topology(cpu_topology& topology, uint32_t processors_count);
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Makes ids dense and sorts processors, used by platform backends after raw ids are filled.
+ */
+void normalize_cpu_topology(cpu_topology& topology);
+
+XR_NAMESPACE_END(xr, sys)
+//-----------------------------------------------------------------------------------------------------------
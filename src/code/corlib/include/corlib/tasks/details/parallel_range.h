@@ -0,0 +1,279 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "corlib/tasks/task_system.h"
+#include "EASTL/algorithm.h"
+#include "EASTL/type_traits.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks, details)
+
+//! upper bound for workers count taken into account while splitting
+constexpr size_t parallel_max_concurrency = 256;
+//! leaves per worker, a few more than one to balance uneven iterations
+constexpr size_t parallel_leaves_per_worker = 4;
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Grain is increased so the range produces about parallel_leaves_per_worker leaves per worker.
+ */
+inline size_t
+parallel_effective_grain(size_t count, size_t grain, size_t concurrency)
+{
+    size_t leaves_count = eastl::max<size_t>(concurrency, 1) * parallel_leaves_per_worker;
+    size_t min_grain = (count + leaves_count - 1) / leaves_count;
+    return eastl::max<size_t>(eastl::max(grain, min_grain), 1);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+template<typename TFunc>
+struct parallel_for_body
+{
+    typedef bool result_type;
+
+    result_type run(parallel_range range) const
+    {
+        (*func)(range);
+        return true;
+    }
+
+    result_type combine(result_type, result_type) const
+    {
+        return true;
+    }
+
+    TFunc* func;
+    result_type identity;
+    size_t grain;
+}; // struct parallel_for_body
+
+//-----------------------------------------------------------------------------------------------------------
+template<typename T, typename TFunc, typename TCombine>
+struct parallel_reduce_body
+{
+    typedef T result_type;
+
+    result_type run(parallel_range range) const
+    {
+        return (*func)(range);
+    }
+
+    result_type combine(const result_type& left, const result_type& right) const
+    {
+        return (*combine_func)(left, right);
+    }
+
+    TFunc* func;
+    TCombine* combine_func;
+    result_type identity;
+    size_t grain;
+}; // struct parallel_reduce_body
+
+//-----------------------------------------------------------------------------------------------------------
+// Node of recursive range split. Node bigger than grain forks two halves and waits for them,
+// so node objects live on the stack of waiting fiber and descriptions go to the per-thread
+// desc_buffer. Halves not bigger than grain are leaves, they run to completion on the
+// scheduler fiber without a fiber of their own.
+template<typename TBody, task_stack_request StackRequest>
+class parallel_range_task
+{
+public:
+    XR_DECLARE_TASK(parallel_range_task, StackRequest,
+        task_priority::default_prority, math::color_table::dark_orange);
+
+    typedef typename TBody::result_type result_type;
+
+    parallel_range_task(const TBody* body, parallel_range range);
+
+    void operator()(execution_context& context);
+
+    const result_type& get_result() const;
+
+private:
+    template<typename TChild>
+    void fork(execution_context& context, parallel_range left, parallel_range right);
+
+    const TBody* m_body;
+    parallel_range m_range;
+    result_type m_result;
+}; // class parallel_range_task
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename TBody, task_stack_request StackRequest>
+inline parallel_range_task<TBody, StackRequest>::parallel_range_task(const TBody* body, parallel_range range)
+    : m_body { body }
+    , m_range { range }
+    , m_result { body->identity }
+{}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename TBody, task_stack_request StackRequest>
+inline void
+parallel_range_task<TBody, StackRequest>::operator()(execution_context& context)
+{
+    size_t count = m_range.size();
+    if(count <= m_body->grain)
+    {
+        m_result = m_body->run(m_range);
+        return;
+    }
+
+    XR_DEBUG_ASSERTION_MSG(StackRequest != task_stack_request::run_to_completion,
+        "Leaf range is bigger than grain");
+
+    size_t middle = m_range.begin + count / 2;
+    parallel_range left { m_range.begin, middle };
+    parallel_range right { middle, m_range.end };
+
+    // right half is never smaller than left one
+    if(right.size() <= m_body->grain)
+        fork<parallel_range_task<TBody, task_stack_request::run_to_completion>>(context, left, right);
+    else
+        fork<parallel_range_task<TBody, task_stack_request::small_stack>>(context, left, right);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename TBody, task_stack_request StackRequest>
+template<typename TChild>
+inline void
+parallel_range_task<TBody, StackRequest>::fork(execution_context& context,
+    parallel_range left, parallel_range right)
+{
+    TChild children[2] = { TChild { m_body, left }, TChild { m_body, right } };
+    context.run_subtasks_and_yield(task_group::get_default_group(), children);
+    m_result = m_body->combine(children[0].get_result(), children[1].get_result());
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename TBody, task_stack_request StackRequest>
+inline const typename parallel_range_task<TBody, StackRequest>::result_type&
+parallel_range_task<TBody, StackRequest>::get_result() const
+{
+    return m_result;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Splits range on the calling fiber, the root node is not a separate task.
+ */
+template<typename TBody>
+inline typename TBody::result_type
+parallel_execute(execution_context& context, const TBody& body, parallel_range range)
+{
+    parallel_range_task<TBody, task_stack_request::small_stack> root { &body, range };
+    root(context);
+    return root.get_result();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Runs root node as a task of its own group and waits for it from the calling thread.
+ */
+template<typename TBody>
+inline typename TBody::result_type
+parallel_execute(scheduler& sched, const TBody& body, parallel_range range)
+{
+    parallel_range_task<TBody, task_stack_request::small_stack> root { &body, range };
+
+    task_group group = sched.create_group();
+    XR_DEBUG_ASSERTION_MSG(group.is_valid(), "Can't create group for parallel range");
+
+    sched.run_async(group, &root, 1);
+    bool finished = sched.wait_group(group, infinite_wait_time);
+    XR_UNREFERENCED_PARAMETER(finished);
+    XR_DEBUG_ASSERTION_MSG(finished, "Parallel range wait failed");
+
+    sched.release_group(group);
+    return root.get_result();
+}
+
+XR_NAMESPACE_END(xr, tasks, details)
+//-----------------------------------------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks)
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename TFunc>
+inline void
+execution_context::parallel_for(parallel_range range, size_t grain, TFunc&& func)
+{
+    if(range.is_empty())
+        return;
+
+    size_t concurrency = effective_coroutine_buckets(details::parallel_max_concurrency);
+    details::parallel_for_body<typename eastl::remove_reference<TFunc>::type> body {
+        &func, true, details::parallel_effective_grain(range.size(), grain, concurrency) };
+
+    details::parallel_execute(*this, body, range);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, typename TFunc, typename TCombine>
+inline T
+execution_context::parallel_reduce(parallel_range range, size_t grain, const T& identity,
+    TFunc&& func, TCombine&& combine)
+{
+    if(range.is_empty())
+        return identity;
+
+    size_t concurrency = effective_coroutine_buckets(details::parallel_max_concurrency);
+    details::parallel_reduce_body<T, typename eastl::remove_reference<TFunc>::type,
+        typename eastl::remove_reference<TCombine>::type> body {
+            &func, &combine, identity, details::parallel_effective_grain(range.size(), grain, concurrency) };
+
+    return details::parallel_execute(*this, body, range);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename TFunc>
+inline void
+scheduler::parallel_for(parallel_range range, size_t grain, TFunc&& func)
+{
+    if(range.is_empty())
+        return;
+
+    size_t concurrency = effective_master_buckets(details::parallel_max_concurrency);
+    details::parallel_for_body<typename eastl::remove_reference<TFunc>::type> body {
+        &func, true, details::parallel_effective_grain(range.size(), grain, concurrency) };
+
+    details::parallel_execute(*this, body, range);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, typename TFunc, typename TCombine>
+inline T
+scheduler::parallel_reduce(parallel_range range, size_t grain, const T& identity,
+    TFunc&& func, TCombine&& combine)
+{
+    if(range.is_empty())
+        return identity;
+
+    size_t concurrency = effective_master_buckets(details::parallel_max_concurrency);
+    details::parallel_reduce_body<T, typename eastl::remove_reference<TFunc>::type,
+        typename eastl::remove_reference<TCombine>::type> body {
+            &func, &combine, identity, details::parallel_effective_grain(range.size(), grain, concurrency) };
+
+    return details::parallel_execute(*this, body, range);
+}
+
+XR_NAMESPACE_END(xr, tasks)
+//-----------------------------------------------------------------------------------------------------------
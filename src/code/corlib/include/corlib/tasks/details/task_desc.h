@@ -4,6 +4,7 @@
 #pragma once
 
 #include "corlib/types.h"
+#include "corlib/math/color_table.h"
 
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, tasks)
@@ -12,11 +13,22 @@ XR_NAMESPACE_BEGIN(xr, tasks)
 class execution_context;
 
 //-----------------------------------------------------------------------------------------------------------
+// Lower value is served first. Workers always drain higher levels before lower ones,
+// background tasks are protected from starvation by aging in the worker queues.
 struct task_priority_enum
 {
     enum list : uint8_t
     {
-        default_prority
+        //! latency-critical frame work
+        high,
+        //! regular work
+        normal,
+        //! bulk work like streaming or shader warmup
+        background,
+        //! number of priority levels
+        count,
+
+        default_prority = normal
     };
 }; // struct task_priority_enum
 typedef task_priority_enum::list task_priority;
@@ -28,7 +40,10 @@ struct task_stack_request_enum
     {
         unknown,
         small_stack,
-        huge_stack
+        huge_stack,
+        //! leaf task that never calls yield or run_subtasks_and_yield, it runs directly
+        //! on the scheduler fiber without acquiring a fiber and switching to it
+        run_to_completion
     };
 }; // struct task_stack_request_enum
 typedef task_stack_request_enum::list task_stack_request;
@@ -62,9 +77,11 @@ struct task_desc
     //! priority for task
     task_priority priority;
 
-#ifdef MT_INSTRUMENTED_BUILD
-    pstr debug_id { nullptr };
-    math::color_table debug_color { math::color_table::blue };
+    //! task type name, shown by scheduler telemetry
+    pcstr debug_id;
+
+#ifdef XR_INSTRUMENTED_BUILD
+    math::color_table debug_color;
 #endif
 }; // struct task_desc
 
@@ -76,9 +93,9 @@ XR_CONSTEXPR_CPP14_OR_INLINE task_desc::task_desc() XR_NOEXCEPT
     , user_data(nullptr)
     , required_stack(task_stack_request_enum::unknown)
     , priority(task_priority_enum::default_prority)
-#ifdef MT_INSTRUMENTED_BUILD
     , debug_id(nullptr)
-    , debug_color(Color::Blue)
+#ifdef XR_INSTRUMENTED_BUILD
+    , debug_color(math::color_table::blue)
 #endif
 {}
 
@@ -91,9 +108,9 @@ XR_CONSTEXPR_CPP14_OR_INLINE task_desc::task_desc(task_entry_function func, pvoi
     , user_data(ptr)
     , required_stack(stack_req)
     , priority(priority)
-#ifdef MT_INSTRUMENTED_BUILD
     , debug_id(nullptr)
-    , debug_color(Color::Blue)
+#ifdef XR_INSTRUMENTED_BUILD
+    , debug_color(math::color_table::blue)
 #endif
 {}
 
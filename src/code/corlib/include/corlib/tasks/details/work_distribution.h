@@ -18,9 +18,9 @@ struct grouped_task_selector
     {
         task_desc desc(TTask::task_entry_pfn, (pvoid)src,
             TTask::stack_requirements, TTask::task_priority);
+        desc.debug_id = TTask::debug_id;
 
 #ifdef XR_INSTRUMENTED_BUILD
-        desc.debug_id = TTask::debug_id;
         desc.debug_color = TTask::debug_color;
 #endif // XR_INSTRUMENTED_BUILD
 
@@ -4,12 +4,22 @@
 #pragma once
 
 #include "corlib/types.h"
+#include "corlib/math/color_table.h"
 
 #ifdef XR_INSTRUMENTED_BUILD
 
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, tasks)
 
+//-----------------------------------------------------------------------------------------------------------
+enum class task_execute_state
+{
+    start,
+    stop,
+    resume,
+    suspend
+}; // enum class task_execute_state
+
 //-----------------------------------------------------------------------------------------------------------
 class XR_NON_VIRTUAL base_profiler_event_listener
 {
@@ -19,25 +29,25 @@ public:
     {};
 
     // Called from main scheduler thread when all fibers has created (notify about fibers count)
-    virtual void on_fibers_created(uint32 fibers_count) = 0;
+    virtual void on_fibers_created(uint32_t fibers_count) = 0;
 
     // Called from main scheduler thread when all threads has created (notify about threads count)
-    virtual void on_threads_created(uint32 threads_count) = 0;
+    virtual void on_threads_created(uint32_t threads_count) = 0;
 
     // Called from worker thread context when worker thread created 
-    virtual void on_thread_created(uint32 worker_index) = 0;
+    virtual void on_thread_created(uint32_t worker_index) = 0;
 
     // Called from worker thread context when worker thread started
-    virtual void on_thread_started(uint32 worker_index) = 0;
+    virtual void on_thread_started(uint32_t worker_index) = 0;
 
     // Called from worker thread context when worker thread stopped
-    virtual void on_thread_stoped(uint32 worker_index) = 0;
+    virtual void on_thread_stoped(uint32_t worker_index) = 0;
 
     // Called from worker thread context when worker thread start to idle
-    virtual void on_thread_idle_started(uint32 worker_index) = 0;
+    virtual void on_thread_idle_started(uint32_t worker_index) = 0;
 
     // Called from worker thread context when worker thread return to work from idle
-    virtual void on_thread_idle_finished(uint32 worker_index) = 0;
+    virtual void on_thread_idle_finished(uint32_t worker_index) = 0;
 
     // Called from thread when thread is waiting for group
     virtual void on_thread_wait_started() = 0;
@@ -52,9 +62,9 @@ public:
     virtual void on_temporary_worker_thread_leave() = 0;
 
     // Called from the worker thread that has change the task execution state
-    virtual void on_task_execute_state_changed(math::color_table debug_color, pcstr debug_id, task_execute_state type, uint32 fiber_index) = 0;
+    virtual void on_task_execute_state_changed(math::color_table debug_color, pcstr debug_id, task_execute_state type, uint32_t fiber_index) = 0;
 };
 
 XR_NAMESPACE_END(xr, tasks)
 
-#endif
+#endif // XR_INSTRUMENTED_BUILD
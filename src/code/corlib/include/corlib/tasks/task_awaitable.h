@@ -0,0 +1,94 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "corlib/threading/atomic_types.h"
+#include "corlib/threading/interlocked.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks)
+
+// forward declarations
+class fiber_context;
+class task_scheduler;
+
+//-----------------------------------------------------------------------------------------------------------
+// Operation finished outside of the task system, like asynchronous I/O. Task waiting for it with
+// execution_context::wait is suspended, its worker runs other tasks until complete() resumes it.
+class awaitable
+{
+public:
+    awaitable();
+    ~awaitable();
+
+    XR_DECLARE_DELETE_COPY_ASSIGNMENT(awaitable);
+
+    bool is_ready() const;
+
+    // Called once per operation from any thread, waiting task is queued back to the scheduler
+    void complete();
+
+    // Makes ready awaitable usable for the next operation
+    void reset();
+
+private:
+    friend class fiber_context;
+    friend class task_scheduler;
+
+    enum state : uint32_t
+    {
+        pending,
+        //! fiber is suspended, or is being suspended, until completion
+        waiting,
+        ready
+    };
+
+    bool try_suspend(fiber_context* waiter, task_scheduler* scheduler);
+
+    threading::atomic_uint32 m_state;
+    //! valid while state is waiting
+    fiber_context* m_waiter;
+    task_scheduler* m_scheduler;
+}; // class awaitable
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline awaitable::awaitable()
+    : m_state { pending }
+    , m_waiter { nullptr }
+    , m_scheduler { nullptr }
+{}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline awaitable::~awaitable()
+{
+    XR_DEBUG_ASSERTION_MSG(threading::atomic_fetch_acq(m_state) != waiting,
+        "awaitable destroyed while task is waiting for it");
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline bool awaitable::is_ready() const
+{
+    return threading::atomic_fetch_acq(m_state) == ready;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void awaitable::reset()
+{
+    XR_DEBUG_ASSERTION_MSG(threading::atomic_fetch_acq(m_state) != waiting,
+        "awaitable is reset while task is waiting for it");
+    threading::atomic_store_rel(m_state, static_cast<uint32_t>(pending));
+    m_waiter = nullptr;
+    m_scheduler = nullptr;
+}
+
+XR_NAMESPACE_END(xr, tasks)
+//-----------------------------------------------------------------------------------------------------------
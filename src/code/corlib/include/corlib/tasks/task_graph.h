@@ -0,0 +1,170 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "corlib/tasks/task_system.h"
+#include "corlib/threading/interlocked.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks)
+
+// forward declarations
+class task_graph;
+
+//-----------------------------------------------------------------------------------------------------------
+// Graph node, holds description of user task and counters for its predecessors
+class task_graph_node
+{
+public:
+    static void node_entry(execution_context& context, pvoid user_data);
+
+    //! user task
+    details::task_desc desc;
+    //! owning graph
+    task_graph* graph { nullptr };
+    //! predecessors count set while building graph
+    uint32_t predecessors_count { 0 };
+    //! predecessors not finished in current execution
+    threading::atomic_uint32 pending_predecessors { 0 };
+    //! successors are stored in task_graph::m_successors[first_successor, first_successor + successors_count)
+    uint32_t first_successor { 0 };
+    uint32_t successors_count { 0 };
+}; // class task_graph_node
+
+//-----------------------------------------------------------------------------------------------------------
+// Graph of tasks with dependencies. Nodes and edges are stored in arrays preallocated on
+// construction, so graph can be rebuilt every frame (clear + add_node + add_dependency + compile)
+// or built once and executed many times without allocations.
+//
+// Node is scheduled as soon as its last predecessor finishes. One of successors that became ready
+// is continued on the same fiber, the rest are submitted to scheduler.
+//
+//   task_graph graph { alloc, 16, 32 };
+//   auto anim = graph.add_node(anim_task);
+//   auto physics = graph.add_node(physics_task);
+//   graph.add_dependency(anim, physics);
+//   graph.compile();
+//   graph.execute(scheduler); // each frame
+class task_graph
+{
+public:
+    typedef uint32_t node_id;
+    static constexpr node_id invalid_node = UINT32_MAX;
+
+    task_graph(memory::base_allocator& alloc, uint32_t max_nodes, uint32_t max_edges);
+    ~task_graph();
+
+    XR_DECLARE_DELETE_COPY_ASSIGNMENT(task_graph);
+    XR_DECLARE_DELETE_MOVE_ASSIGNMENT(task_graph);
+
+    // Task object must stay alive while graph is used
+    template<typename TTask>
+    node_id add_node(const TTask& task);
+
+    // Node "after" is started only when node "before" is finished
+    void add_dependency(node_id before, node_id after);
+
+    // Builds successor lists, must be called after last change of graph. Returns false if
+    // dependencies form a cycle, such graph is not executed.
+    bool compile();
+    void clear();
+
+    // Blocks calling thread until all nodes are finished
+    void execute(scheduler& sched);
+
+    // Suspends calling task until the last node is finished
+    void execute(execution_context& context);
+
+    uint32_t get_nodes_count() const;
+    bool is_finished() const;
+
+private:
+    friend class task_graph_node;
+    struct edge
+    {
+        node_id before;
+        node_id after;
+    }; // struct edge
+
+    node_id add_node_desc(const details::task_desc& desc);
+    void start_execution(task_group group);
+    void submit_node(execution_context& context, task_graph_node& node);
+    task_graph_node* complete_node(execution_context& context, task_graph_node& node,
+        task_stack_request running_stack);
+
+    memory::base_allocator& m_allocator;
+    task_graph_node* m_nodes;
+    edge* m_edges;
+    node_id* m_successors;
+    node_id* m_roots;
+    uint32_t m_max_nodes;
+    uint32_t m_max_edges;
+    uint32_t m_nodes_count;
+    uint32_t m_edges_count;
+    uint32_t m_roots_count;
+    bool m_compiled;
+    //! group of current execution
+    task_group m_group;
+    //! nodes not finished in current execution
+    threading::atomic_uint32 m_pending_nodes;
+    //! completed by the last node of current execution
+    awaitable m_finished;
+}; // class task_graph
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename TTask>
+inline task_graph::node_id
+task_graph::add_node(const TTask& task)
+{
+    details::grouped_task_selector<TTask> helper {};
+    return add_node_desc(helper.get_grouped_task(task_group::get_default_group(), &task).desc);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline uint32_t
+task_graph::get_nodes_count() const
+{
+    return m_nodes_count;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline bool
+task_graph::is_finished() const
+{
+    return threading::atomic_fetch_acq(m_pending_nodes) == 0;
+}
+
+XR_NAMESPACE_END(xr, tasks)
+//-----------------------------------------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks, details)
+
+//-----------------------------------------------------------------------------------------------------------
+// Graph nodes are scheduled with stack requirements and priority of user task
+template<>
+struct grouped_task_selector<task_graph_node>
+{
+    inline grouped_task get_grouped_task(task_group group, const task_graph_node* src)
+    {
+        task_desc desc(&task_graph_node::node_entry, (pvoid)src,
+            src->desc.required_stack, src->desc.priority);
+        desc.debug_id = src->desc.debug_id;
+
+#ifdef XR_INSTRUMENTED_BUILD
+        desc.debug_color = src->desc.debug_color;
+#endif // XR_INSTRUMENTED_BUILD
+
+        return grouped_task(desc, group);
+    }
+}; // struct grouped_task_selector<task_graph_node>
+
+XR_NAMESPACE_END(xr, tasks, details)
+//-----------------------------------------------------------------------------------------------------------
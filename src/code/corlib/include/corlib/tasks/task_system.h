@@ -8,7 +8,10 @@
 #include "corlib/tasks/details/task_desc.h"
 #include "corlib/tasks/details/task_group.h"
 #include "corlib/tasks/details/work_distribution.h"
+#include "corlib/tasks/task_awaitable.h"
 #include "corlib/memory/memory_allocator_base.h"
+#include "corlib/memory/memory_frame_allocator.h"
+#include "corlib/memory/memory_paging.h"
 #include "corlib/utils/static_vector.h"
 #include "corlib/memory/allocator_macro.h"
 
@@ -29,12 +32,13 @@
 
 #ifdef XR_INSTRUMENTED_BUILD
 #   define XR_DECLARE_TASK(TYPE, STACK_REQUIREMENTS, TASK_PRIORITY, DEBUG_COLOR) \
-        static pcstr debug_id = #TYPE; \
-        static xr::math::color_table debug_color = DEBUG_COLOR; \
+        static constexpr xr::pcstr debug_id = #TYPE; \
+        static constexpr xr::math::color_table debug_color = static_cast<xr::math::color_table>(DEBUG_COLOR); \
         XR_DECLARE_TASK_IMPL(TYPE, STACK_REQUIREMENTS, TASK_PRIORITY, DEBUG_COLOR)
 
 #else
 #   define XR_DECLARE_TASK(TYPE, STACK_REQUIREMENTS, TASK_PRIORITY, DEBUG_COLOR) \
+        static constexpr xr::pcstr debug_id = #TYPE; \
         XR_DECLARE_TASK_IMPL(TYPE, STACK_REQUIREMENTS, TASK_PRIORITY, DEBUG_COLOR)
 
 #endif // XR_INSTRUMENTED_BUILD
@@ -42,6 +46,25 @@
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, tasks)
 
+//! timeout for wait_group and wait_all that never expires
+XR_CONSTEXPR_CPP14_OR_CONST uint32_t infinite_wait_time = UINT32_MAX;
+
+//-----------------------------------------------------------------------------------------------------------
+// Half-open index range [begin, end) used by parallel_for and parallel_reduce
+struct parallel_range
+{
+    size_t begin;
+    size_t end;
+
+    size_t size() const { return end - begin; }
+    bool is_empty() const { return end <= begin; }
+}; // struct parallel_range
+
+//-----------------------------------------------------------------------------------------------------------
+// Finishes external operations whose completion resumes waiting tasks, returns their count.
+// Must not block, it runs on workers between tasks.
+typedef uint32_t (*completion_poller_function)(pvoid user_data);
+
 //-----------------------------------------------------------------------------------------------------------
 class XR_NON_VIRTUAL execution_context
 {
@@ -66,8 +89,23 @@ public:
     template<typename TTask, size_t N>
     void run_subtasks_and_yield(task_group group, utils::static_vector<TTask, N>& tasks);
 
+    // Calls func(parallel_range) for subranges not smaller than grain and waits for all of them.
+    // Grain is increased to give each worker a few subranges.
+    template<typename TFunc>
+    void parallel_for(parallel_range range, size_t grain, TFunc&& func);
+
+    // Same as parallel_for, partial results of func(parallel_range) are merged with combine(left, right)
+    template<typename T, typename TFunc, typename TCombine>
+    T parallel_reduce(parallel_range range, size_t grain, const T& identity, TFunc&& func, TCombine&& combine);
+
     virtual void yield() = 0;
 
+    // Suspends task until operation is completed, worker runs other tasks meanwhile
+    virtual void wait(awaitable& operation) = 0;
+
+    // Transient memory of current frame, nullptr if scheduler has no frame allocator
+    virtual memory::frame_allocator* get_frame_allocator() = 0;
+
 protected:
     virtual void assert_subtasks_valid(size_t task_count, bool fire_forget) = 0;
     virtual size_t effective_coroutine_buckets(size_t task_count) = 0;
@@ -94,12 +132,27 @@ public:
     template<typename TTask, size_t N>
     void run_async(task_group group, utils::static_vector<TTask, N>& tasks);
 
+    // Blocks calling thread until whole range is processed, see execution_context::parallel_for
+    template<typename TFunc>
+    void parallel_for(parallel_range range, size_t grain, TFunc&& func);
+
+    template<typename T, typename TFunc, typename TCombine>
+    T parallel_reduce(parallel_range range, size_t grain, const T& identity, TFunc&& func, TCombine&& combine);
+
     virtual task_group create_group() = 0;
     virtual void release_group(task_group group) = 0;
 
     virtual signalling_bool wait_all(uint32_t milliseconds) = 0;
     virtual signalling_bool wait_group(task_group group, uint32_t milliseconds) = 0;
 
+    // Frame allocator tasks get from execution_context, must outlive the scheduler
+    virtual void set_frame_allocator(memory::frame_allocator* allocator) = 0;
+
+    // Workers call pollers while some task waits for an awaitable, so no thread is dedicated to
+    // completions. Poller is not called anymore when remove returns.
+    virtual void add_completion_poller(completion_poller_function function, pvoid user_data) = 0;
+    virtual void remove_completion_poller(completion_poller_function function, pvoid user_data) = 0;
+
 protected:
     virtual size_t effective_master_buckets(size_t tasks) = 0;
     virtual void run_subtasks_on_scheduler(
@@ -109,8 +162,10 @@ protected:
 
 //-----------------------------------------------------------------------------------------------------------
 /**
+ *  Large fiber stack pages are opt-in, they remove guard pages between stacks.
  */
-void initialize_tasks(memory::base_allocator& alloc);
+void initialize_tasks(memory::base_allocator& alloc,
+    memory::page_kind fiber_stack_pages = memory::page_kind::normal);
 
 //-----------------------------------------------------------------------------------------------------------
 /**
@@ -244,3 +299,5 @@ scheduler::run_async(task_group group, utils::static_vector<TTask, N>& tasks)
 
 XR_NAMESPACE_END(xr, tasks)
 //-----------------------------------------------------------------------------------------------------------
+
+#include "corlib/tasks/details/parallel_range.h"
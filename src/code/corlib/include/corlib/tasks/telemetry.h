@@ -0,0 +1,89 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "corlib/tasks/details/task_desc.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks)
+
+//-----------------------------------------------------------------------------------------------------------
+enum class telemetry_event_type : uint8_t
+{
+    //! task started or resumed on worker
+    task_start,
+    //! task finished
+    task_stop,
+    //! task suspended itself (yield or waiting for subtasks)
+    task_yield,
+    //! task was taken from another worker
+    steal,
+    //! worker found no work and went to sleep
+    idle_start,
+    //! worker woke up
+    idle_stop
+}; // enum class telemetry_event_type
+
+//-----------------------------------------------------------------------------------------------------------
+struct telemetry_event
+{
+    //! sys::cpu_timestamp value
+    uint64_t timestamp;
+    //! task type name for task events, nullptr otherwise
+    pcstr name;
+    telemetry_event_type type;
+}; // struct telemetry_event
+
+//-----------------------------------------------------------------------------------------------------------
+// Counters are gathered always, events only while telemetry is enabled
+struct worker_telemetry_counters
+{
+    uint64_t executed_tasks;
+    uint64_t yields;
+    uint64_t steals;
+    uint64_t failed_steals;
+    //! time spent sleeping, in sys::cpu_timestamp units
+    uint64_t idle_ticks;
+}; // struct worker_telemetry_counters
+
+//-----------------------------------------------------------------------------------------------------------
+struct scheduler_telemetry_counters
+{
+    //! sum over all workers
+    worker_telemetry_counters total;
+    uint32_t standard_fibers_in_use;
+    uint32_t standard_fibers_high_water_mark;
+    uint32_t extended_fibers_in_use;
+    uint32_t extended_fibers_high_water_mark;
+    uint64_t overflow_count;
+}; // struct scheduler_telemetry_counters
+
+//-----------------------------------------------------------------------------------------------------------
+// Receives exported text piece by piece
+typedef void (*telemetry_write_function)(pcstr data, size_t size, pvoid user_data);
+
+//-----------------------------------------------------------------------------------------------------------
+// Deepest stack use of one task type while stack usage tracking was enabled
+struct fiber_stack_usage_report
+{
+    //! task type name
+    pcstr name;
+    task_stack_request stack_request;
+    //! stack size of fibers the task ran on
+    size_t stack_size;
+    //! deepest use including fiber entry frames
+    size_t high_water_bytes;
+    //! tasks measured
+    uint64_t samples_count;
+    //! high water mark with a quarter of headroom, rounded up to power of two
+    size_t suggested_stack_size;
+    //! suggested size fits standard fibers, huge_stack tasks with this flag can move to small_stack
+    bool fits_small_stack;
+}; // struct fiber_stack_usage_report
+
+//-----------------------------------------------------------------------------------------------------------
+typedef void (*fiber_stack_usage_function)(const fiber_stack_usage_report& report, pvoid user_data);
+
+XR_NAMESPACE_END(xr, tasks)
+//-----------------------------------------------------------------------------------------------------------
@@ -22,9 +22,9 @@ extern "C" void __faststorefence();
 #define XR_MEMORY_FULLCONSISTENCY_BARRIER __faststorefence()
 
 #else
-#define XR_MEMORY_READWRITE_BARRIER
-#define XR_MEMORY_WRITE_BARRIER
-#define XR_MEMORY_FULLCONSISTENCY_BARRIER
+#define XR_MEMORY_READWRITE_BARRIER __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#define XR_MEMORY_WRITE_BARRIER __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#define XR_MEMORY_FULLCONSISTENCY_BARRIER __atomic_thread_fence(__ATOMIC_SEQ_CST)
 
 #endif
 
@@ -49,6 +49,11 @@ int16_t __atomic_compare_exchange(volatile int16_t* ptr, int16_t value, int16_t
 int32_t __atomic_compare_exchange(volatile int32_t* ptr, int32_t value, int32_t comparand) XR_NOEXCEPT;
 int64_t __atomic_compare_exchange(volatile int64_t* ptr, int64_t value, int64_t comparand) XR_NOEXCEPT;
 void* __atomic_compare_exchange(void* volatile* ptr, void* value, void* comparand) XR_NOEXCEPT;
+#if defined(XRAY_PLATFORM_64BIT)
+// Swaps 16 bytes at 16-byte aligned ptr, comparand receives current value on failure
+bool __atomic_compare_exchange128(volatile int64_t* ptr, int64_t value_high,
+    int64_t value_low, int64_t* comparand) XR_NOEXCEPT;
+#endif // defined(XRAY_PLATFORM_64BIT)
 int8_t __atomic_or_operation(volatile int8_t* ptr, int8_t value) XR_NOEXCEPT;
 int16_t __atomic_or_operation(volatile int16_t* ptr, int16_t value) XR_NOEXCEPT;
 int32_t __atomic_or_operation(volatile int32_t* ptr, int32_t value) XR_NOEXCEPT;
@@ -71,6 +76,43 @@ enum class memory_order
     sequential //!< Sequential consistency, safe total order but least performance
 }; // enum class memory_order
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Orders plain loads and stores around it, including on weakly ordered targets. Only sequential fence
+ *  orders a store before a later load.
+ */
+template< memory_order Order >
+void atomic_thread_fence() XR_NOEXCEPT
+{
+#if defined(XRAY_PLATFORM_WINDOWS)
+    if constexpr(Order == memory_order::sequential)
+    {
+        XR_MEMORY_FULLCONSISTENCY_BARRIER;
+    }
+    else if constexpr(Order != memory_order::relaxed)
+    {
+        XR_MEMORY_READWRITE_BARRIER;
+    }
+#else
+    if constexpr(Order == memory_order::sequential)
+    {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+    else if constexpr(Order == memory_order::acquire)
+    {
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+    else if constexpr(Order == memory_order::release)
+    {
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+    }
+    else if constexpr(Order == memory_order::acquire_release)
+    {
+        __atomic_thread_fence(__ATOMIC_ACQ_REL);
+    }
+#endif // defined(XRAY_PLATFORM_WINDOWS)
+}
+
 // forward declarations
 template< typename T, size_t size > struct interlocked_align;
 
@@ -518,6 +560,43 @@ auto atomic_fetch_inc_seq(volatile T& address) XR_NOEXCEPT
     return atomic_fetch_inc<memory_order::sequential, T>(address);
 }
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Unlike atomic_fetch_inc returns value before increment, like the other fetch_* operations.
+ */
+template<threading::memory_order order, typename T>
+auto atomic_fetch_then_inc(volatile T& address) XR_NOEXCEPT
+{
+    return atomic_fetch_add<order, T>(address, 1);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+template<typename T>
+auto atomic_fetch_then_inc_relax(volatile T& address) XR_NOEXCEPT
+{
+    return atomic_fetch_then_inc<memory_order::relaxed, T>(address);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+template<typename T>
+auto atomic_fetch_then_inc_acqrel(volatile T& address) XR_NOEXCEPT
+{
+    return atomic_fetch_then_inc<memory_order::acquire_release, T>(address);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+template<typename T>
+auto atomic_fetch_then_inc_seq(volatile T& address) XR_NOEXCEPT
+{
+    return atomic_fetch_then_inc<memory_order::sequential, T>(address);
+}
+
 
 //-----------------------------------------------------------------------------------------------------------
 /**
@@ -931,6 +1010,59 @@ auto atomic_bcas_seq(volatile T& address, T value, T comparand) XR_NOEXCEPT
         address, value, comparand);
 }
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+// Pointer with a modification tag that is swapped together with it. Tag is as wide as a pointer, so
+// it can't wrap around while some thread still holds an old copy, and the pointer itself is stored as
+// is without assumptions about width of address space.
+struct alignas(sizeof(uintptr_t) * 2) atomic_tagged_pointer
+{
+    pvoid pointer;
+    uintptr_t tag;
+}; // struct atomic_tagged_pointer
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+inline atomic_tagged_pointer
+atomic_fetch_tagged_acq(volatile atomic_tagged_pointer& address) XR_NOEXCEPT
+{
+    // torn read is fine here, it is followed by compare-exchange of both parts
+    atomic_tagged_pointer result;
+    result.tag = address.tag;
+    XR_MEMORY_READWRITE_BARRIER;
+    result.pointer = address.pointer;
+    return result;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+inline signalling_bool
+atomic_bcas_tagged_seq(volatile atomic_tagged_pointer& address,
+    atomic_tagged_pointer value, atomic_tagged_pointer comparand) XR_NOEXCEPT
+{
+#if defined(XRAY_PLATFORM_64BIT)
+    int64_t expected[2] = {
+        reinterpret_cast<int64_t>(comparand.pointer),
+        static_cast<int64_t>(comparand.tag)
+    };
+
+    return details::__atomic_compare_exchange128(
+        reinterpret_cast<volatile int64_t*>(&address),
+        static_cast<int64_t>(value.tag),
+        reinterpret_cast<int64_t>(value.pointer),
+        expected);
+#else
+    static_assert(sizeof(atomic_tagged_pointer) == sizeof(int64_t));
+    return atomic_bcas_seq(
+        reinterpret_cast<volatile int64_t&>(address),
+        utils::unsafe_type_cast<int64_t>(value),
+        utils::unsafe_type_cast<int64_t>(comparand));
+#endif // defined(XRAY_PLATFORM_64BIT)
+}
+
 //-----------------------------------------------------------------------------------------------------------
 /**
 */
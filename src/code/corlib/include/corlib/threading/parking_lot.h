@@ -0,0 +1,115 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "corlib/threading/interlocked.h"
+#include "corlib/macro/aligning.h"
+#include "corlib/sys/chrono.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, threading)
+
+//-----------------------------------------------------------------------------------------------------------
+enum class park_result
+{
+    //! unparked by producer
+    unparked,
+    //! woken up without unpark call
+    spurious,
+    //! timeout elapsed
+    timed_out
+};
+
+//-----------------------------------------------------------------------------------------------------------
+struct parking_lot_stats
+{
+    //! threads woken by unpark calls
+    uint64_t wakeups;
+    //! threads woken without unpark call
+    uint64_t spurious_wakeups;
+    //! unpark calls that had to enter the kernel
+    uint64_t wake_syscalls;
+    //! microseconds spent parked
+    uint64_t idle_microseconds;
+}; // struct parking_lot_stats
+
+//-----------------------------------------------------------------------------------------------------------
+// Idle thread parking lot built on top of futex (Linux) or WaitOnAddress (Windows).
+// Producers never enter the kernel while nobody is parked. Parking is done in two
+// steps to avoid lost wakeups:
+//
+//   uint32_t ticket = lot.prepare_park();
+//   if(work_available()) lot.cancel_park(); else lot.commit_park(ticket, timeout);
+//
+// Producer must publish its work before calling unpark.
+class parking_lot
+{
+public:
+    parking_lot() XR_NOEXCEPT;
+    ~parking_lot();
+
+    XR_DECLARE_DELETE_COPY_ASSIGNMENT(parking_lot);
+    XR_DECLARE_DELETE_MOVE_ASSIGNMENT(parking_lot);
+
+    uint32_t prepare_park() XR_NOEXCEPT;
+    void cancel_park() XR_NOEXCEPT;
+    park_result commit_park(uint32_t ticket, sys::tick timeout_ms) XR_NOEXCEPT;
+
+    // Wake at most count parked threads
+    void unpark(uint32_t count) XR_NOEXCEPT;
+    void unpark_one() XR_NOEXCEPT;
+    void unpark_all() XR_NOEXCEPT;
+
+    uint32_t parked_count() const XR_NOEXCEPT;
+
+    // Called by a thread that has been unparked and didn't find anything to do
+    void report_spurious_wakeup() XR_NOEXCEPT;
+
+    parking_lot_stats get_stats() const XR_NOEXCEPT;
+
+private:
+    // platform specific, see parking_lot_*.cpp
+    bool wait_on_epoch(uint32_t expected, sys::tick timeout_ms) XR_NOEXCEPT;
+    void wake_on_epoch(uint32_t count) XR_NOEXCEPT;
+
+    //! changed on every unpark that found parked threads
+    XR_ALIGNAS(XR_MAX_CACHE_LINE_SIZE) atomic_uint32 m_epoch;
+    //! threads between prepare_park and end of park
+    XR_ALIGNAS(XR_MAX_CACHE_LINE_SIZE) atomic_uint32 m_parked;
+
+    XR_ALIGNAS(XR_MAX_CACHE_LINE_SIZE) atomic_uint64 m_wakeups;
+    atomic_uint64 m_spurious_wakeups;
+    atomic_uint64 m_wake_syscalls;
+    atomic_uint64 m_idle_microseconds;
+}; // class parking_lot
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+parking_lot::unpark_one() XR_NOEXCEPT
+{
+    unpark(1);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+parking_lot::unpark_all() XR_NOEXCEPT
+{
+    unpark(UINT32_MAX);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline uint32_t
+parking_lot::parked_count() const XR_NOEXCEPT
+{
+    return atomic_fetch_acq(m_parked);
+}
+
+XR_NAMESPACE_END(xr, threading)
+//-----------------------------------------------------------------------------------------------------------
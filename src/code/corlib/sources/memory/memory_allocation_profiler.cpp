@@ -0,0 +1,759 @@
+// This file is a part of xray-ng engine
+//
+
+#include "corlib/memory/memory_allocation_profiler.h"
+#include "corlib/memory/allocator_macro.h"
+#include "corlib/sys/chrono.h"
+#include "corlib/threading/interlocked.h"
+#include "corlib/threading/scoped_lock.h"
+#include "EASTL/algorithm.h"
+#include <string.h> // for memset, memcpy
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, memory)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace details
+{
+
+//! per-thread cache of sites, direct mapped
+constexpr uint32_t profiler_site_cache_size = 256;
+constexpr uint32_t profiler_site_slots_count = allocation_profiler::max_sites * 2;
+//! last site collects allocations of sites that didn't fit
+constexpr uint32_t profiler_overflow_site = allocation_profiler::max_sites - 1;
+constexpr size_t profiler_initial_live_blocks = 4096;
+
+enum profiler_event_kind : uint32_t
+{
+    profiler_event_malloc,
+    profiler_event_free
+}; // enum profiler_event_kind
+
+//-----------------------------------------------------------------------------------------------------------
+struct profiler_event
+{
+    uint64_t timestamp;
+    pvoid pointer;
+    size_t size;
+    uint32_t site;
+    uint32_t kind;
+}; // struct profiler_event
+
+//-----------------------------------------------------------------------------------------------------------
+struct profiler_site_cache_entry
+{
+    pcvoid call_site;
+    pcstr description;
+    pcstr function;
+    pcstr file;
+    uint32_t line;
+    //! zero for empty entry
+    uint32_t site_index_plus_one;
+}; // struct profiler_site_cache_entry
+
+//-----------------------------------------------------------------------------------------------------------
+// Ring with single producer, the owner thread, and single consumer, whoever holds drain lock
+struct profiler_thread_buffer
+{
+    threading::atomic_uint32 head;
+    uint8_t head_cacheline[60];
+    threading::atomic_uint32 tail;
+    uint8_t tail_cacheline[60];
+
+    profiler_site_cache_entry sites_cache[profiler_site_cache_size];
+    profiler_event events[allocation_profiler::events_per_buffer];
+}; // struct profiler_thread_buffer
+
+//-----------------------------------------------------------------------------------------------------------
+struct profiler_site
+{
+    utils::string_view description;
+    pcstr function;
+    pcstr file;
+    uint32_t line;
+    pcvoid call_site;
+
+    uint64_t allocations_count;
+    uint64_t frees_count;
+    uint64_t allocated_bytes;
+    size_t live_bytes;
+    size_t peak_live_bytes;
+    uint64_t live_blocks_count;
+
+    //! counters at the moment of take_snapshot
+    uint64_t snapshot_allocations_count;
+    uint64_t snapshot_allocated_bytes;
+    size_t snapshot_live_bytes;
+}; // struct profiler_site
+
+//-----------------------------------------------------------------------------------------------------------
+struct profiler_live_block
+{
+    //! nullptr for empty slot
+    pvoid pointer;
+    size_t size;
+    uint32_t site;
+}; // struct profiler_live_block
+
+//-----------------------------------------------------------------------------------------------------------
+struct profiler_pending_free
+{
+    pvoid pointer;
+    uint64_t timestamp;
+    //! drain that found it
+    uint64_t drain;
+}; // struct profiler_pending_free
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline size_t
+hash_pointer(pcvoid pointer)
+{
+    uint64_t value = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pointer));
+    value ^= value >> 29;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 32;
+    return static_cast<size_t>(value);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline size_t
+hash_site(pcvoid call_site, pcstr description, pcstr file, uint32_t line)
+{
+    return hash_pointer(call_site) ^ (hash_pointer(description) * 31) ^ (hash_pointer(file) * 17) ^ line;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+account_malloc(profiler_site& site, allocation_profiler_totals& totals, size_t size)
+{
+    ++site.allocations_count;
+    site.allocated_bytes += size;
+    site.live_bytes += size;
+    ++site.live_blocks_count;
+    site.peak_live_bytes = eastl::max(site.peak_live_bytes, site.live_bytes);
+
+    ++totals.allocations_count;
+    totals.allocated_bytes += size;
+    totals.live_bytes += size;
+    ++totals.live_blocks_count;
+    totals.peak_live_bytes = eastl::max(totals.peak_live_bytes, totals.live_bytes);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+account_free(profiler_site& site, allocation_profiler_totals& totals, size_t size)
+{
+    ++site.frees_count;
+    site.live_bytes -= size;
+    --site.live_blocks_count;
+
+    ++totals.frees_count;
+    totals.live_bytes -= size;
+    --totals.live_blocks_count;
+}
+
+} // namespace details
+//-----------------------------------------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+allocation_profiler::~allocation_profiler()
+{
+    finalize();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void allocation_profiler::initialize(base_allocator& backing)
+{
+    XR_DEBUG_ASSERTION_MSG(!m_backing, "profiler already initialized");
+    m_backing = &backing;
+
+    m_tls = sys::create_thread_local();
+    XR_DEBUG_ASSERTION_MSG(m_tls != sys::invalid_thread_local_storage, "out of thread-local storage");
+
+    auto shared = reinterpret_cast<details::profiler_thread_buffer*>(XR_ALLOCATE_MEMORY(backing,
+        sizeof(details::profiler_thread_buffer), "allocation profiler shared buffer"));
+    memset(shared, 0, sizeof(details::profiler_thread_buffer));
+    m_buffers[max_thread_buffers] = shared;
+
+    m_sites = reinterpret_cast<details::profiler_site*>(XR_ALLOCATE_MEMORY(backing,
+        sizeof(details::profiler_site) * max_sites, "allocation profiler sites"));
+    memset(m_sites, 0, sizeof(details::profiler_site) * max_sites);
+    m_sites[details::profiler_overflow_site].description = "other sites";
+
+    m_site_slots = reinterpret_cast<uint32_t*>(XR_ALLOCATE_MEMORY(backing,
+        sizeof(uint32_t) * details::profiler_site_slots_count, "allocation profiler site slots"));
+    memset(m_site_slots, 0, sizeof(uint32_t) * details::profiler_site_slots_count);
+
+    m_pending_frees = reinterpret_cast<details::profiler_pending_free*>(XR_ALLOCATE_MEMORY(backing,
+        sizeof(details::profiler_pending_free) * max_pending_frees, "allocation profiler pending frees"));
+
+    m_live_blocks_capacity = details::profiler_initial_live_blocks;
+    m_live_blocks = reinterpret_cast<details::profiler_live_block*>(XR_ALLOCATE_MEMORY(backing,
+        sizeof(details::profiler_live_block) * m_live_blocks_capacity, "allocation profiler live blocks"));
+    memset(m_live_blocks, 0, sizeof(details::profiler_live_block) * m_live_blocks_capacity);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void allocation_profiler::finalize()
+{
+    if(!m_backing)
+        return;
+
+    for(uint32_t i = 0; i <= max_thread_buffers; ++i)
+    {
+        if(m_buffers[i])
+            XR_DEALLOCATE_MEMORY(*m_backing, m_buffers[i]);
+
+        m_buffers[i] = nullptr;
+    }
+
+    XR_DEALLOCATE_MEMORY(*m_backing, m_sites);
+    XR_DEALLOCATE_MEMORY(*m_backing, m_site_slots);
+    XR_DEALLOCATE_MEMORY(*m_backing, m_pending_frees);
+    XR_DEALLOCATE_MEMORY(*m_backing, m_live_blocks);
+    sys::destroy_thread_local(m_tls);
+
+    m_sites = nullptr;
+    m_site_slots = nullptr;
+    m_pending_frees = nullptr;
+    m_live_blocks = nullptr;
+    m_live_blocks_capacity = 0;
+    m_tls = sys::invalid_thread_local_storage;
+    m_backing = nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void allocation_profiler::flush()
+{
+    XR_DEBUG_ASSERTION_MSG(m_backing, "profiler must be initialized");
+    threading::scoped_lock lock { m_drain_lock };
+    flush_locked();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+allocation_profiler_totals allocation_profiler::get_totals()
+{
+    XR_DEBUG_ASSERTION_MSG(m_backing, "profiler must be initialized");
+    threading::scoped_lock lock { m_drain_lock };
+    flush_locked();
+    return m_totals;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Function is called under drain lock, it must not allocate from the profiled allocator.
+ */
+void allocation_profiler::report_sites(allocation_site_report_function function, pvoid user_data)
+{
+    XR_DEBUG_ASSERTION_MSG(m_backing, "profiler must be initialized");
+    XR_DEBUG_ASSERTION_MSG(function, "invalid report function");
+
+    threading::scoped_lock lock { m_drain_lock };
+    flush_locked();
+
+    uint32_t const sites_count = threading::atomic_fetch_acq(m_sites_count);
+    for(uint32_t i = 0; i < max_sites; ++i)
+    {
+        if(i >= sites_count && i != details::profiler_overflow_site)
+            continue;
+
+        details::profiler_site const& site = m_sites[i];
+        if(!site.allocations_count)
+            continue;
+
+        allocation_site_report report {};
+        report.description = site.description;
+        report.function = site.function;
+        report.file = site.file;
+        report.line = site.line;
+        report.call_site = site.call_site;
+        report.allocations_count = site.allocations_count;
+        report.frees_count = site.frees_count;
+        report.allocated_bytes = site.allocated_bytes;
+        report.live_bytes = site.live_bytes;
+        report.peak_live_bytes = site.peak_live_bytes;
+        report.live_blocks_count = site.live_blocks_count;
+        report.period_allocations_count = site.allocations_count - site.snapshot_allocations_count;
+        report.period_allocated_bytes = site.allocated_bytes - site.snapshot_allocated_bytes;
+        report.period_live_bytes =
+            static_cast<int64_t>(site.live_bytes) - static_cast<int64_t>(site.snapshot_live_bytes);
+
+        function(report, user_data);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void allocation_profiler::take_snapshot()
+{
+    XR_DEBUG_ASSERTION_MSG(m_backing, "profiler must be initialized");
+    threading::scoped_lock lock { m_drain_lock };
+    flush_locked();
+
+    for(uint32_t i = 0; i < max_sites; ++i)
+    {
+        details::profiler_site& site = m_sites[i];
+        site.snapshot_allocations_count = site.allocations_count;
+        site.snapshot_allocated_bytes = site.allocated_bytes;
+        site.snapshot_live_bytes = site.live_bytes;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void allocation_profiler::on_malloc_done(pvoid buffer, size_t buffer_size, size_t previous_size,
+    utils::string_view description, pcvoid call_site XR_DEBUG_PARAMETERS_DECLARATION)
+{
+    XR_UNREFERENCED_PARAMETER(previous_size);
+    if(!buffer)
+        return;
+
+#if defined(XR_DEBUG)
+    pcstr const function_name = function;
+    pcstr const file_name = file;
+    uint32_t const line_number = line;
+#else
+    pcstr const function_name = nullptr;
+    pcstr const file_name = nullptr;
+    uint32_t const line_number = 0;
+#endif // defined(XR_DEBUG)
+
+    details::profiler_event event {};
+    event.pointer = buffer;
+    event.size = buffer_size;
+    event.kind = details::profiler_event_malloc;
+
+    details::profiler_thread_buffer* thread_buffer = get_thread_buffer();
+    if(is_shared_buffer(thread_buffer))
+    {
+        threading::scoped_lock lock { m_shared_buffer_lock };
+        event.site = find_site(*thread_buffer, description, function_name, file_name, line_number, call_site);
+        push_event(*thread_buffer, event);
+        return;
+    }
+
+    event.site = find_site(*thread_buffer, description, function_name, file_name, line_number, call_site);
+    push_event(*thread_buffer, event);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void allocation_profiler::on_free_done(pvoid& buffer XR_DEBUG_PARAMETERS_DECLARATION)
+{
+    XR_DEBUG_PARAMETERS_UNREFERENCED_GUARD;
+    if(!buffer)
+        return;
+
+    details::profiler_event event {};
+    event.pointer = buffer;
+    event.kind = details::profiler_event_free;
+
+    details::profiler_thread_buffer* thread_buffer = get_thread_buffer();
+    if(is_shared_buffer(thread_buffer))
+    {
+        threading::scoped_lock lock { m_shared_buffer_lock };
+        push_event(*thread_buffer, event);
+        return;
+    }
+
+    push_event(*thread_buffer, event);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+details::profiler_thread_buffer* allocation_profiler::get_thread_buffer()
+{
+    details::profiler_thread_buffer* buffer = sys::get_tls_typed_data<details::profiler_thread_buffer>(m_tls);
+    if(buffer)
+        return buffer;
+
+    uint32_t index = threading::atomic_fetch_then_inc_seq(m_buffers_count);
+    if(index < max_thread_buffers)
+    {
+        buffer = reinterpret_cast<details::profiler_thread_buffer*>(XR_ALLOCATE_MEMORY(*m_backing,
+            sizeof(details::profiler_thread_buffer), "allocation profiler thread buffer"));
+    }
+
+    if(buffer)
+    {
+        memset(buffer, 0, sizeof(details::profiler_thread_buffer));
+        threading::atomic_store_rel(m_buffers[index], buffer);
+    }
+    else
+    {
+        buffer = m_buffers[max_thread_buffers];
+    }
+
+    sys::set_tls_data(m_tls, buffer);
+    return buffer;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool allocation_profiler::is_shared_buffer(const details::profiler_thread_buffer* buffer) const
+{
+    return buffer == m_buffers[max_thread_buffers];
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Timestamp is taken here, on_malloc_done is called after the block is allocated and on_free_done
+ *  before it is freed, so events of one block are ordered right across threads.
+ */
+void allocation_profiler::push_event(details::profiler_thread_buffer& buffer, details::profiler_event& event)
+{
+    uint32_t const head = threading::atomic_fetch_relax(buffer.head);
+    if(head - threading::atomic_fetch_acq(buffer.tail) >= events_per_buffer)
+    {
+        threading::scoped_lock lock { m_drain_lock };
+        flush_locked();
+    }
+
+    event.timestamp = sys::cpu_timestamp();
+    buffer.events[head % events_per_buffer] = event;
+    threading::atomic_store_rel(buffer.head, head + 1);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+uint32_t allocation_profiler::find_site(details::profiler_thread_buffer& buffer, utils::string_view description,
+    pcstr function, pcstr file, uint32_t line, pcvoid call_site)
+{
+    size_t const hash = details::hash_site(call_site, description.data(), file, line);
+
+    details::profiler_site_cache_entry& entry =
+        buffer.sites_cache[hash & (details::profiler_site_cache_size - 1)];
+
+    if(entry.site_index_plus_one && entry.call_site == call_site && entry.description == description.data() &&
+        entry.function == function && entry.file == file && entry.line == line)
+    {
+        return entry.site_index_plus_one - 1;
+    }
+
+    uint32_t index = details::profiler_overflow_site;
+    {
+        threading::scoped_lock lock { m_sites_lock };
+
+        uint32_t const mask = details::profiler_site_slots_count - 1;
+        for(uint32_t slot = static_cast<uint32_t>(hash) & mask;; slot = (slot + 1) & mask)
+        {
+            uint32_t const existing = m_site_slots[slot];
+            if(!existing)
+            {
+                uint32_t const count = threading::atomic_fetch_relax(m_sites_count);
+                if(count >= details::profiler_overflow_site)
+                    break;
+
+                details::profiler_site& site = m_sites[count];
+                site.description = description;
+                site.function = function;
+                site.file = file;
+                site.line = line;
+                site.call_site = call_site;
+
+                m_site_slots[slot] = count + 1;
+                threading::atomic_store_rel(m_sites_count, count + 1);
+                index = count;
+                break;
+            }
+
+            details::profiler_site const& site = m_sites[existing - 1];
+            if(site.call_site == call_site && site.description.data() == description.data() &&
+                site.function == function && site.file == file && site.line == line)
+            {
+                index = existing - 1;
+                break;
+            }
+        }
+    }
+
+    entry.call_site = call_site;
+    entry.description = description.data();
+    entry.function = function;
+    entry.file = file;
+    entry.line = line;
+    entry.site_index_plus_one = index + 1;
+    return index;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Rings are merged by timestamp, so allocation and free of the same block done on different
+ *  threads are applied in the order they happened.
+ */
+void allocation_profiler::flush_locked()
+{
+    details::profiler_thread_buffer* buffers[max_thread_buffers + 1];
+    uint32_t tails[max_thread_buffers + 1];
+    uint32_t heads[max_thread_buffers + 1];
+    uint32_t buffers_count = 0;
+
+    for(uint32_t i = 0; i <= max_thread_buffers; ++i)
+    {
+        details::profiler_thread_buffer* buffer = threading::atomic_fetch_acq(m_buffers[i]);
+        if(!buffer)
+            continue;
+
+        uint32_t const tail = threading::atomic_fetch_relax(buffer->tail);
+        uint32_t const head = threading::atomic_fetch_acq(buffer->head);
+        if(head == tail)
+            continue;
+
+        buffers[buffers_count] = buffer;
+        tails[buffers_count] = tail;
+        heads[buffers_count] = head;
+        ++buffers_count;
+    }
+
+    while(buffers_count)
+    {
+        uint32_t oldest = 0;
+        uint64_t oldest_timestamp = UINT64_MAX;
+        for(uint32_t i = 0; i < buffers_count; ++i)
+        {
+            uint64_t const timestamp = buffers[i]->events[tails[i] % events_per_buffer].timestamp;
+            if(timestamp < oldest_timestamp)
+            {
+                oldest = i;
+                oldest_timestamp = timestamp;
+            }
+        }
+
+        details::profiler_thread_buffer* buffer = buffers[oldest];
+        details::profiler_event const& event = buffer->events[tails[oldest] % events_per_buffer];
+        if(event.kind == details::profiler_event_malloc)
+            apply_malloc(event);
+        else
+            apply_free(event);
+
+        if(++tails[oldest] == heads[oldest])
+        {
+            threading::atomic_store_rel(buffer->tail, tails[oldest]);
+
+            --buffers_count;
+            buffers[oldest] = buffers[buffers_count];
+            tails[oldest] = tails[buffers_count];
+            heads[oldest] = heads[buffers_count];
+        }
+    }
+
+    drop_pending_frees();
+    ++m_drains_count;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void allocation_profiler::apply_malloc(const details::profiler_event& event)
+{
+    details::profiler_site& site = m_sites[event.site];
+    if(event.site == details::profiler_overflow_site)
+        ++m_totals.untracked_sites_count;
+
+    // ring of the freeing thread may have been drained before this allocation was published
+    for(uint32_t i = 0; i < m_pending_frees_count; ++i)
+    {
+        details::profiler_pending_free const& pending = m_pending_frees[i];
+        if(pending.pointer != event.pointer || pending.timestamp < event.timestamp)
+            continue;
+
+        details::account_malloc(site, m_totals, event.size);
+        details::account_free(site, m_totals, event.size);
+        m_pending_frees[i] = m_pending_frees[--m_pending_frees_count];
+        return;
+    }
+
+    // free that was not reported, e.g. done with another listener
+    if(details::profiler_live_block* stale = find_live_block(event.pointer))
+        release_live_block(stale);
+
+    details::account_malloc(site, m_totals, event.size);
+    if(!insert_live_block(event.pointer, event.size, event.site))
+    {
+        // table is full and couldn't grow, block is forgotten
+        details::account_free(site, m_totals, event.size);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void allocation_profiler::apply_free(const details::profiler_event& event)
+{
+    if(details::profiler_live_block* block = find_live_block(event.pointer))
+    {
+        release_live_block(block);
+        return;
+    }
+
+    if(m_pending_frees_count == max_pending_frees)
+    {
+        ++m_totals.unknown_frees_count;
+        return;
+    }
+
+    details::profiler_pending_free& pending = m_pending_frees[m_pending_frees_count++];
+    pending.pointer = event.pointer;
+    pending.timestamp = event.timestamp;
+    pending.drain = m_drains_count;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Allocation of a pending block is published long before the next drain, so frees that survived a
+ *  whole drain belong to blocks allocated before profiling started.
+ */
+void allocation_profiler::drop_pending_frees()
+{
+    uint32_t i = 0;
+    while(i < m_pending_frees_count)
+    {
+        if(m_pending_frees[i].drain < m_drains_count)
+        {
+            ++m_totals.unknown_frees_count;
+            m_pending_frees[i] = m_pending_frees[--m_pending_frees_count];
+            continue;
+        }
+
+        ++i;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+details::profiler_live_block* allocation_profiler::find_live_block(pvoid pointer)
+{
+    size_t const mask = m_live_blocks_capacity - 1;
+    for(size_t slot = details::hash_pointer(pointer) & mask;; slot = (slot + 1) & mask)
+    {
+        details::profiler_live_block& block = m_live_blocks[slot];
+        if(!block.pointer)
+            return nullptr;
+
+        if(block.pointer == pointer)
+            return &block;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool allocation_profiler::insert_live_block(pvoid pointer, size_t size, uint32_t site)
+{
+    // new block is already counted. Load factor is kept at most a half, so probes stay short,
+    // and at least one slot stays empty, so they end.
+    if(m_totals.live_blocks_count * 2 > m_live_blocks_capacity && !grow_live_blocks())
+    {
+        if(m_totals.live_blocks_count >= m_live_blocks_capacity)
+            return false;
+    }
+
+    size_t const mask = m_live_blocks_capacity - 1;
+    size_t slot = details::hash_pointer(pointer) & mask;
+    while(m_live_blocks[slot].pointer)
+        slot = (slot + 1) & mask;
+
+    m_live_blocks[slot].pointer = pointer;
+    m_live_blocks[slot].size = size;
+    m_live_blocks[slot].site = site;
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Entries following removed one are shifted back, so lookups never need tombstones.
+ */
+void allocation_profiler::remove_live_block(details::profiler_live_block* block)
+{
+    size_t const mask = m_live_blocks_capacity - 1;
+    size_t hole = static_cast<size_t>(block - m_live_blocks);
+
+    for(size_t slot = (hole + 1) & mask; m_live_blocks[slot].pointer; slot = (slot + 1) & mask)
+    {
+        size_t const home = details::hash_pointer(m_live_blocks[slot].pointer) & mask;
+
+        // entry may move to the hole only if its home is not between the hole and itself
+        bool const movable = (hole <= slot) ?
+            (home <= hole || home > slot) :
+            (home <= hole && home > slot);
+
+        if(movable)
+        {
+            m_live_blocks[hole] = m_live_blocks[slot];
+            hole = slot;
+        }
+    }
+
+    m_live_blocks[hole].pointer = nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void allocation_profiler::release_live_block(details::profiler_live_block* block)
+{
+    details::account_free(m_sites[block->site], m_totals, block->size);
+    remove_live_block(block);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool allocation_profiler::grow_live_blocks()
+{
+    size_t const capacity = m_live_blocks_capacity * 2;
+    auto blocks = reinterpret_cast<details::profiler_live_block*>(XR_ALLOCATE_MEMORY(*m_backing,
+        sizeof(details::profiler_live_block) * capacity, "allocation profiler live blocks"));
+
+    if(!blocks)
+        return false;
+
+    memset(blocks, 0, sizeof(details::profiler_live_block) * capacity);
+
+    size_t const mask = capacity - 1;
+    for(size_t i = 0; i < m_live_blocks_capacity; ++i)
+    {
+        details::profiler_live_block const& block = m_live_blocks[i];
+        if(!block.pointer)
+            continue;
+
+        size_t slot = details::hash_pointer(block.pointer) & mask;
+        while(blocks[slot].pointer)
+            slot = (slot + 1) & mask;
+
+        blocks[slot] = block;
+    }
+
+    XR_DEALLOCATE_MEMORY(*m_backing, m_live_blocks);
+    m_live_blocks = blocks;
+    m_live_blocks_capacity = capacity;
+    return true;
+}
+
+XR_NAMESPACE_END(xr, memory)
+//-----------------------------------------------------------------------------------------------------------
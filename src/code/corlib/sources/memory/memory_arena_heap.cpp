@@ -0,0 +1,574 @@
+// This file is a part of xray-ng engine
+//
+
+#include "memory_arena_heap.h"
+#include "corlib/memory/memory_paging.h"
+#include "corlib/threading/interlocked.h"
+#include "corlib/utils/aligning.h"
+#include "EASTL/algorithm.h"
+#include <string.h> // for memcpy
+#include <new>
+
+#if !XR_GCC_COMPILER_FAMILY
+#   include <intrin.h>
+#endif // !XR_GCC_COMPILER_FAMILY
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, memory, details)
+
+//-----------------------------------------------------------------------------------------------------------
+struct arena_heap::block_header
+{
+    //! size of previous block in memory, zero for the first block
+    size_t prev_size;
+    //! size of this block with header, lowest bit is set while block is in use
+    size_t size;
+}; // struct arena_heap::block_header
+
+//-----------------------------------------------------------------------------------------------------------
+struct arena_heap::free_block : block_header
+{
+    free_block* next;
+    free_block* prev;
+}; // struct arena_heap::free_block
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+constexpr size_t block_alignment = 16;
+constexpr size_t block_used_bit = 1;
+constexpr size_t header_size = 16;
+constexpr size_t min_block_size = 32;
+constexpr size_t min_commit_granularity = XR_KILOBYTES_TO_BYTES(64);
+//! free bins are scanned for a fitting block only this far before taking one from a larger bin
+constexpr uint32_t max_bin_scan = 8;
+//! committed space above top that is kept when heap shrinks, in commit granularity units
+constexpr size_t decommit_threshold = 4;
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline uint32_t
+floor_log2(size_t value)
+{
+#if XR_GCC_COMPILER_FAMILY
+    return 63 - static_cast<uint32_t>(__builtin_clzll(static_cast<unsigned long long>(value)));
+#else
+    unsigned long index = 0;
+    _BitScanReverse64(&index, static_cast<unsigned __int64>(value));
+    return static_cast<uint32_t>(index);
+#endif // XR_GCC_COMPILER_FAMILY
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline uint32_t
+lowest_bit(uint64_t value)
+{
+#if XR_GCC_COMPILER_FAMILY
+    return static_cast<uint32_t>(__builtin_ctzll(static_cast<unsigned long long>(value)));
+#else
+    unsigned long index = 0;
+    _BitScanForward64(&index, static_cast<unsigned __int64>(value));
+    return static_cast<uint32_t>(index);
+#endif // XR_GCC_COMPILER_FAMILY
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T>
+inline size_t
+block_size(const T* block)
+{
+    return block->size & ~block_used_bit;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Size of block that can hold size bytes, zero if it can't exist.
+ */
+inline size_t
+block_size_for(size_t size)
+{
+    if(size > (SIZE_MAX >> 1))
+        return 0;
+
+    return eastl::max(utils::align_up(size + header_size, block_alignment), min_block_size);
+}
+
+} // anonymous namespace
+//-----------------------------------------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+arena_heap* arena_heap::create(size_t size, size_t initial, bool synchronized, page_kind pages)
+{
+    // with large pages every commit covers whole large pages, smaller ones would split them
+    size_t page_size = system_page_size();
+    if(pages == page_kind::large && large_page_size() > page_size)
+        page_size = large_page_size();
+
+    size_t const heap_size = utils::align_up(sizeof(arena_heap), block_alignment);
+    size_t const reserved_size = utils::align_up(heap_size + size, page_size);
+
+    uint8_t* base = reinterpret_cast<uint8_t*>(reserve_pages(reserved_size, pages));
+    if(!base)
+        return nullptr;
+
+    size_t const initial_size = eastl::min(utils::align_up(heap_size + initial, page_size), reserved_size);
+    if(!commit_pages(base, initial_size))
+    {
+        release_pages(base, reserved_size);
+        return nullptr;
+    }
+
+    arena_heap* heap = ::new(base) arena_heap();
+    heap->m_base = base;
+    heap->m_reserved_size = reserved_size;
+    heap->m_reserved_end = base + reserved_size;
+    heap->m_first = base + heap_size;
+    heap->m_top = heap->m_first;
+    heap->m_committed_end = base + initial_size;
+    heap->m_commit_granularity = utils::align_up(min_commit_granularity, page_size);
+    heap->m_synchronized = synchronized;
+    heap->m_committed_size = initial_size;
+    return heap;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t arena_heap::query_large_page_size()
+{
+    lock();
+    size_t result = memory::query_large_page_size(m_base, static_cast<size_t>(m_committed_end - m_base));
+    unlock();
+    return result;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void arena_heap::destroy(arena_heap* heap)
+{
+    if(!heap)
+        return;
+
+    uint8_t* base = heap->m_base;
+    size_t reserved_size = heap->m_reserved_size;
+    heap->~arena_heap();
+    release_pages(base, reserved_size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+pvoid arena_heap::allocate(size_t size)
+{
+    lock();
+    pvoid result = allocate_locked(size);
+    unlock();
+    return result;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+pvoid arena_heap::reallocate(pvoid pointer, size_t new_size)
+{
+    lock();
+    pvoid result = reallocate_locked(pointer, new_size);
+    unlock();
+    return result;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void arena_heap::free(pvoid pointer)
+{
+    if(!pointer)
+        return;
+
+    lock();
+    free_locked(pointer);
+    unlock();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool arena_heap::can_allocate(size_t size)
+{
+    size_t const needed = block_size_for(size);
+    if(!needed)
+        return false;
+
+    lock();
+    bool result = static_cast<size_t>(m_reserved_end - m_top) >= needed;
+    if(!result)
+    {
+        uint32_t const bin = floor_log2(needed);
+        result = (bin + 1 < bins_count) && (m_bins_mask & (~uint64_t(0) << (bin + 1)));
+
+        for(free_block* block = m_bins[bin]; block && !result; block = block->next)
+            result = block_size(block) >= needed;
+    }
+    unlock();
+    return result;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t arena_heap::committed_size() const
+{
+    return threading::atomic_fetch_relax(m_committed_size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t arena_heap::allocated_size() const
+{
+    return threading::atomic_fetch_relax(m_allocated_size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+pvoid arena_heap::allocate_locked(size_t size)
+{
+    size_t const needed = block_size_for(size);
+    if(!needed)
+        return nullptr;
+
+    block_header* block = take_free_block(needed);
+    if(block)
+    {
+        // tail of the block is freed, so block must be marked first to not merge with it
+        block->size |= block_used_bit;
+        split_block(block, needed);
+    }
+    else
+    {
+        block = take_top_block(needed);
+        if(!block)
+            return nullptr;
+
+        block->size |= block_used_bit;
+    }
+
+    add_allocated_size(block_size(block) - header_size);
+    return reinterpret_cast<uint8_t*>(block) + header_size;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Grows blocks in place into free neighbour or top when possible.
+ */
+pvoid arena_heap::reallocate_locked(pvoid pointer, size_t new_size)
+{
+    if(!pointer)
+        return allocate_locked(new_size);
+
+    size_t const needed = block_size_for(new_size);
+    if(!needed)
+        return nullptr;
+
+    block_header* block = reinterpret_cast<block_header*>(reinterpret_cast<uint8_t*>(pointer) - header_size);
+    size_t const old_size = block_size(block);
+    uint8_t* next = reinterpret_cast<uint8_t*>(block) + old_size;
+
+    if(needed <= old_size)
+    {
+        sub_allocated_size(old_size - header_size);
+        split_block(block, needed);
+        add_allocated_size(block_size(block) - header_size);
+        return pointer;
+    }
+
+    if(next == m_top)
+    {
+        uint8_t* new_top = reinterpret_cast<uint8_t*>(block) + needed;
+        if(new_top <= m_reserved_end && commit_to(new_top))
+        {
+            block->size = needed | block_used_bit;
+            m_top = new_top;
+            m_top_prev_size = needed;
+            add_allocated_size(needed - old_size);
+            return pointer;
+        }
+    }
+    else
+    {
+        free_block* next_block = reinterpret_cast<free_block*>(next);
+        if(!(next_block->size & block_used_bit) && old_size + block_size(next_block) >= needed)
+        {
+            sub_allocated_size(old_size - header_size);
+            remove_free_block(next_block);
+
+            size_t const merged_size = old_size + block_size(next_block);
+            block->size = merged_size | block_used_bit;
+            reinterpret_cast<block_header*>(reinterpret_cast<uint8_t*>(block) + merged_size)->prev_size = merged_size;
+            split_block(block, needed);
+
+            add_allocated_size(block_size(block) - header_size);
+            return pointer;
+        }
+    }
+
+    pvoid result = allocate_locked(new_size);
+    if(!result)
+        return nullptr;
+
+    memcpy(result, pointer, old_size - header_size);
+    free_locked(pointer);
+    return result;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void arena_heap::free_locked(pvoid pointer)
+{
+    block_header* block = reinterpret_cast<block_header*>(reinterpret_cast<uint8_t*>(pointer) - header_size);
+    XR_DEBUG_ASSERTION_MSG(block->size & block_used_bit, "block is already free");
+
+    sub_allocated_size(block_size(block) - header_size);
+    release_block(block);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Blocks in the bin of requested size may be too small, so only a few of them are checked.
+ *  Any block from larger bins fits.
+ */
+arena_heap::free_block* arena_heap::take_free_block(size_t size)
+{
+    uint32_t const bin = floor_log2(size);
+
+    uint32_t scanned = 0;
+    for(free_block* block = m_bins[bin]; block && scanned < max_bin_scan; block = block->next, ++scanned)
+    {
+        if(block_size(block) >= size)
+        {
+            remove_free_block(block);
+            return block;
+        }
+    }
+
+    uint64_t const mask = (bin + 1 < bins_count) ? (m_bins_mask & (~uint64_t(0) << (bin + 1))) : 0;
+    if(!mask)
+        return nullptr;
+
+    free_block* block = m_bins[lowest_bit(mask)];
+    remove_free_block(block);
+    return block;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+arena_heap::block_header* arena_heap::take_top_block(size_t size)
+{
+    if(static_cast<size_t>(m_reserved_end - m_top) < size)
+        return nullptr;
+
+    uint8_t* new_top = m_top + size;
+    if(!commit_to(new_top))
+        return nullptr;
+
+    block_header* block = reinterpret_cast<block_header*>(m_top);
+    block->prev_size = m_top_prev_size;
+    block->size = size;
+
+    m_top = new_top;
+    m_top_prev_size = size;
+    return block;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Cuts block to size and frees the tail if it is large enough to be a block.
+ */
+void arena_heap::split_block(block_header* block, size_t size)
+{
+    size_t const used_bit = block->size & block_used_bit;
+    size_t const total_size = block_size(block);
+    if(total_size - size < min_block_size)
+        return;
+
+    block->size = size | used_bit;
+
+    block_header* tail = reinterpret_cast<block_header*>(reinterpret_cast<uint8_t*>(block) + size);
+    tail->prev_size = size;
+    tail->size = total_size - size;
+
+    uint8_t* next = reinterpret_cast<uint8_t*>(tail) + block_size(tail);
+    if(next == m_top)
+        m_top_prev_size = block_size(tail);
+    else
+        reinterpret_cast<block_header*>(next)->prev_size = block_size(tail);
+
+    release_block(tail);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Merges block with free neighbours and puts it into bin, or gives it back to top.
+ */
+void arena_heap::release_block(block_header* block)
+{
+    size_t size = block_size(block);
+
+    if(block->prev_size)
+    {
+        free_block* prev = reinterpret_cast<free_block*>(reinterpret_cast<uint8_t*>(block) - block->prev_size);
+        if(!(prev->size & block_used_bit))
+        {
+            remove_free_block(prev);
+            size += block_size(prev);
+            block = prev;
+        }
+    }
+
+    uint8_t* next = reinterpret_cast<uint8_t*>(block) + size;
+    if(next == m_top)
+    {
+        m_top = reinterpret_cast<uint8_t*>(block);
+        m_top_prev_size = block->prev_size;
+        decommit_unused();
+        return;
+    }
+
+    free_block* next_block = reinterpret_cast<free_block*>(next);
+    if(!(next_block->size & block_used_bit))
+    {
+        remove_free_block(next_block);
+        size += block_size(next_block);
+        next = reinterpret_cast<uint8_t*>(block) + size;
+        XR_DEBUG_ASSERTION_MSG(next != m_top, "free block can't border top");
+    }
+
+    block->size = size;
+    reinterpret_cast<block_header*>(next)->prev_size = size;
+    insert_free_block(static_cast<free_block*>(block));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void arena_heap::insert_free_block(free_block* block)
+{
+    uint32_t const bin = floor_log2(block_size(block));
+    block->prev = nullptr;
+    block->next = m_bins[bin];
+    if(block->next)
+        block->next->prev = block;
+
+    m_bins[bin] = block;
+    m_bins_mask |= uint64_t(1) << bin;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void arena_heap::remove_free_block(free_block* block)
+{
+    uint32_t const bin = floor_log2(block_size(block));
+    if(block->prev)
+        block->prev->next = block->next;
+    else
+        m_bins[bin] = block->next;
+
+    if(block->next)
+        block->next->prev = block->prev;
+
+    if(!m_bins[bin])
+        m_bins_mask &= ~(uint64_t(1) << bin);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool arena_heap::commit_to(uint8_t* end)
+{
+    if(end <= m_committed_end)
+        return true;
+
+    uint8_t* new_end = utils::align_up(end, m_commit_granularity);
+    if(new_end > m_reserved_end)
+        new_end = m_reserved_end;
+
+    size_t const size = static_cast<size_t>(new_end - m_committed_end);
+    if(!commit_pages(m_committed_end, size))
+        return false;
+
+    m_committed_end = new_end;
+    threading::atomic_store_relax(m_committed_size, threading::atomic_fetch_relax(m_committed_size) + size);
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Some committed space is left above top, so heap that grows and shrinks around the same size
+ *  doesn't commit and decommit pages all the time.
+ */
+void arena_heap::decommit_unused()
+{
+    uint8_t* keep_end = utils::align_up(m_top, m_commit_granularity) + m_commit_granularity;
+    if(keep_end >= m_committed_end ||
+        static_cast<size_t>(m_committed_end - keep_end) < decommit_threshold * m_commit_granularity)
+    {
+        return;
+    }
+
+    size_t const size = static_cast<size_t>(m_committed_end - keep_end);
+    decommit_pages(keep_end, size);
+
+    m_committed_end = keep_end;
+    threading::atomic_store_relax(m_committed_size, threading::atomic_fetch_relax(m_committed_size) - size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Sizes are changed only under heap lock, readers just load them.
+ */
+void arena_heap::add_allocated_size(size_t size)
+{
+    threading::atomic_store_relax(m_allocated_size, threading::atomic_fetch_relax(m_allocated_size) + size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void arena_heap::sub_allocated_size(size_t size)
+{
+    threading::atomic_store_relax(m_allocated_size, threading::atomic_fetch_relax(m_allocated_size) - size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void arena_heap::lock()
+{
+    if(m_synchronized)
+        m_lock.lock();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void arena_heap::unlock()
+{
+    if(m_synchronized)
+        m_lock.unlock();
+}
+
+XR_NAMESPACE_END(xr, memory, details)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,97 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "corlib/memory/memory_paging.h"
+#include "corlib/threading/atomic_types.h"
+#include "corlib/threading/spin_wait.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, memory, details)
+
+//-----------------------------------------------------------------------------------------------------------
+// Heap in one reserved range of address space, used by arena allocators. Pages are committed when the
+// top of the heap grows and decommitted when it shrinks back far enough. Blocks carry boundary tags,
+// free blocks are kept in power-of-two bins and merged with free neighbours.
+//
+// Heap object itself lives at the beginning of its range. Allocated and committed sizes are kept
+// up-to-date on every operation, so reading them is O(1) from any thread.
+class arena_heap
+{
+public:
+    // Reserves size bytes plus space for the heap and commits initial bytes of them. With large pages
+    // both sizes are rounded up to whole large pages.
+    static arena_heap* create(size_t size, size_t initial, bool synchronized, page_kind pages);
+    static void destroy(arena_heap* heap);
+
+    XR_DECLARE_DELETE_COPY_ASSIGNMENT(arena_heap);
+    XR_DECLARE_DELETE_MOVE_ASSIGNMENT(arena_heap);
+
+    pvoid allocate(size_t size);
+    pvoid reallocate(pvoid pointer, size_t new_size);
+    void free(pvoid pointer);
+
+    bool can_allocate(size_t size);
+
+    size_t committed_size() const;
+    // usable bytes of blocks in use
+    size_t allocated_size() const;
+    // committed bytes that are backed by large pages
+    size_t query_large_page_size();
+
+private:
+    struct block_header;
+    struct free_block;
+
+    static constexpr uint32_t bins_count = 64;
+
+    arena_heap() = default;
+
+    pvoid allocate_locked(size_t size);
+    pvoid reallocate_locked(pvoid pointer, size_t new_size);
+    void free_locked(pvoid pointer);
+
+    free_block* take_free_block(size_t size);
+    block_header* take_top_block(size_t size);
+    void split_block(block_header* block, size_t size);
+    void release_block(block_header* block);
+
+    void insert_free_block(free_block* block);
+    void remove_free_block(free_block* block);
+
+    bool commit_to(uint8_t* end);
+    void decommit_unused();
+
+    void add_allocated_size(size_t size);
+    void sub_allocated_size(size_t size);
+
+    void lock();
+    void unlock();
+
+    //! reserved range, heap object is placed at its beginning
+    uint8_t* m_base { nullptr };
+    size_t m_reserved_size { 0 };
+    uint8_t* m_reserved_end { nullptr };
+
+    //! blocks go from the first one up to top, everything above top is unused
+    uint8_t* m_first { nullptr };
+    uint8_t* m_top { nullptr };
+    //! size of the block just below top, zero if there are no blocks
+    size_t m_top_prev_size { 0 };
+    uint8_t* m_committed_end { nullptr };
+    size_t m_commit_granularity { 0 };
+
+    //! bit per non-empty bin
+    uint64_t m_bins_mask { 0 };
+    free_block* m_bins[bins_count] {};
+
+    bool m_synchronized { false };
+    threading::spin_wait_fairness m_lock;
+
+    threading::atomic_size_t m_allocated_size { 0 };
+    threading::atomic_size_t m_committed_size { 0 };
+}; // class arena_heap
+
+XR_NAMESPACE_END(xr, memory, details)
+//-----------------------------------------------------------------------------------------------------------
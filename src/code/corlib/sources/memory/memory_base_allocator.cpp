@@ -11,16 +11,14 @@ XR_NAMESPACE_BEGIN(xr, memory)
 /**
 */
 void
-base_allocator::on_malloc(pvoid buffer, size_t buffer_size, size_t previous_size
+base_allocator::on_malloc(pvoid buffer, size_t buffer_size, size_t previous_size, pcvoid call_site
     XR_DEBUG_PARAMETERS_DESCRIPTION_DECLARATION XR_DEBUG_PARAMETERS_DECLARATION) const
 {
-#if defined(DEBUG)
     if(base_profiler_event_listener* event_listener = m_event_listener)
     {
-        event_listener->on_malloc_done(buffer, buffer_size, previous_size
-            XR_DEBUG_PARAMETERS_DESCRIPTION XR_DEBUG_PARAMETERS);
+        event_listener->on_malloc_done(buffer, buffer_size, previous_size,
+            XR_DEBUG_PARAMETERS_DESCRIPTION_PARAMETER, call_site XR_DEBUG_PARAMETERS);
     }
-#endif // defined(DEBUG)
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -29,12 +27,10 @@ base_allocator::on_malloc(pvoid buffer, size_t buffer_size, size_t previous_size
 void
 base_allocator::on_free(pvoid& buffer XR_DEBUG_PARAMETERS_DECLARATION) const
 {
-#if defined(DEBUG)
     if(base_profiler_event_listener* event_listener = m_event_listener)
     {
         event_listener->on_free_done(buffer XR_DEBUG_PARAMETERS);
     }
-#endif // defined(DEBUG)
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -44,7 +40,7 @@ XR_COMPILER_ALLOCATOR_HINT pvoid base_allocator::malloc_impl(size_t size
     XR_DEBUG_PARAMETERS_DESCRIPTION_DECLARATION XR_DEBUG_PARAMETERS_DECLARATION)
 {
     pvoid ptr = call_malloc(size XR_DEBUG_PARAMETERS_DESCRIPTION XR_DEBUG_PARAMETERS);
-    on_malloc(ptr, size, 0 XR_DEBUG_PARAMETERS_DESCRIPTION XR_DEBUG_PARAMETERS);
+    on_malloc(ptr, size, 0, XR_RETURN_ADDRESS() XR_DEBUG_PARAMETERS_DESCRIPTION XR_DEBUG_PARAMETERS);
     return ptr;
 }
 
@@ -55,7 +51,15 @@ XR_COMPILER_ALLOCATOR_HINT pvoid base_allocator::realloc_impl(pvoid pointer, siz
     XR_DEBUG_PARAMETERS_DESCRIPTION_DECLARATION XR_DEBUG_PARAMETERS_DECLARATION)
 {
     pvoid ptr = call_realloc(pointer, new_size XR_DEBUG_PARAMETERS_DESCRIPTION XR_DEBUG_PARAMETERS);
-    on_malloc(ptr, new_size, 0 XR_DEBUG_PARAMETERS_DESCRIPTION XR_DEBUG_PARAMETERS);
+
+    // failed realloc leaves old block allocated, so nothing is reported
+    if(!ptr && new_size)
+        return ptr;
+
+    if(pvoid old_pointer = pointer)
+        on_free(old_pointer XR_DEBUG_PARAMETERS);
+
+    on_malloc(ptr, new_size, 0, XR_RETURN_ADDRESS() XR_DEBUG_PARAMETERS_DESCRIPTION XR_DEBUG_PARAMETERS);
     return ptr;
 }
 
@@ -0,0 +1,57 @@
+// This file is a part of xray-ng engine
+//
+
+#if !defined(XRAY_PLATFORM_LINUX)
+#   error "This code is supported by Linux platform!"
+#endif // !defined(XRAY_PLATFORM_LINUX)
+
+#include "corlib/memory/memory_crt_allocator.h"
+#include <malloc.h>
+#include <stdlib.h>
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, memory)
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+crt_allocator::crt_allocator()
+    : m_malloc_ptr(malloc)
+    , m_free_ptr(free)
+    , m_realloc_ptr(realloc)
+{
+    XR_DEBUG_ASSERTION(this->m_malloc_ptr != nullptr);
+    XR_DEBUG_ASSERTION(this->m_free_ptr != nullptr);
+    XR_DEBUG_ASSERTION(this->m_realloc_ptr != nullptr);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+bool crt_allocator::can_allocate_block(size_t const size) const XR_NOEXCEPT
+{
+    XR_UNREFERENCED_PARAMETER(size);
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Heap of main arena and blocks mapped on their own, other arenas are not counted.
+ */
+size_t crt_allocator::total_size() const XR_NOEXCEPT
+{
+    struct mallinfo2 const info = mallinfo2();
+    return info.arena + info.hblkhd;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+size_t crt_allocator::allocated_size() const XR_NOEXCEPT
+{
+    struct mallinfo2 const info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+XR_NAMESPACE_END(xr, memory)
+//-----------------------------------------------------------------------------------------------------------
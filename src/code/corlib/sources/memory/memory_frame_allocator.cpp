@@ -0,0 +1,554 @@
+// This file is a part of xray-ng engine
+//
+
+#include "corlib/memory/memory_frame_allocator.h"
+#include "corlib/memory/allocator_macro.h"
+#include "corlib/threading/interlocked.h"
+#include "corlib/threading/scoped_lock.h"
+#include "corlib/utils/aligning.h"
+#include "EASTL/algorithm.h"
+#include <string.h> // for memset, memcpy
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, memory)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace details
+{
+
+constexpr size_t frame_block_alignment = 16;
+constexpr size_t frame_page_header_size = 64;
+constexpr size_t frame_page_payload = frame_allocator::page_size - frame_page_header_size;
+//! pages requested from backing allocator at once
+constexpr size_t frame_pages_per_chunk = 16;
+
+//-----------------------------------------------------------------------------------------------------------
+// Placed at the beginning of every page, which is aligned to page size, so page of block is found
+// by aligning block address down. Blocks larger than a page get a dedicated page of their size.
+struct frame_page
+{
+    frame_page* next;
+    //! backing allocation of dedicated page, nullptr for pooled pages
+    pvoid memory;
+    size_t memory_size;
+    uint8_t* end;
+    //! buffer of the frame page was taken in
+    uint32_t buffer;
+}; // struct frame_page
+
+static_assert(sizeof(frame_page) <= frame_page_header_size, "Page header doesn't fit");
+
+//-----------------------------------------------------------------------------------------------------------
+struct frame_lane
+{
+    //! bump pointer into current page
+    uint8_t* cursor;
+    uint8_t* end;
+    //! latest block from current page, it can be resized in place
+    uint8_t* last_block;
+
+    //! pages taken in every buffered frame
+    frame_page* pages[frame_allocator::max_buffered_frames];
+
+    //! counters are written by lane owner only
+    threading::atomic_size_t used_size[frame_allocator::max_buffered_frames];
+    threading::atomic_uint32 allocations_count[frame_allocator::max_buffered_frames];
+    //! frees done on this lane, blocks may come from any lane
+    threading::atomic_uint32 frees_count[frame_allocator::max_buffered_frames];
+
+    // prevent false cache sharing between threads
+    uint8_t cacheline[64];
+}; // struct frame_lane
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T>
+inline void
+add_lane_counter(volatile T& counter, T value)
+{
+    threading::atomic_store_relax(counter, threading::atomic_fetch_relax(counter) + value);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline frame_page*
+page_from_pointer(pvoid pointer)
+{
+    return reinterpret_cast<frame_page*>(utils::align_down(reinterpret_cast<uintptr_t>(pointer),
+        frame_allocator::page_size));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline uint8_t*
+first_block(frame_page* page)
+{
+    return reinterpret_cast<uint8_t*>(page) + frame_page_header_size;
+}
+
+} // namespace details
+//-----------------------------------------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+frame_allocator::~frame_allocator()
+{
+    finalize();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void frame_allocator::initialize(base_allocator& backing, uint32_t buffered_frames, size_t frame_budget)
+{
+    XR_DEBUG_ASSERTION_MSG(!m_backing, "allocator already initialized");
+    XR_DEBUG_ASSERTION_MSG(buffered_frames > 0 && buffered_frames <= max_buffered_frames,
+        "Invalid buffered frames count");
+
+    m_backing = &backing;
+    m_buffered_frames = buffered_frames;
+    m_frame_budget = frame_budget;
+    m_frame_index = 0;
+    m_current_buffer = 0;
+
+    m_tls = sys::create_thread_local();
+    XR_DEBUG_ASSERTION_MSG(m_tls != sys::invalid_thread_local_storage, "out of thread-local storage");
+
+    size_t lanes_size = sizeof(details::frame_lane) * (max_thread_lanes + 1);
+    m_lanes = reinterpret_cast<details::frame_lane*>(XR_ALLOCATE_MEMORY(backing, lanes_size, "frame lanes"));
+    memset(m_lanes, 0, lanes_size);
+    m_backing_size = lanes_size;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void frame_allocator::next_frame()
+{
+    XR_DEBUG_ASSERTION_MSG(m_backing, "allocator must be initialized");
+
+    report_frame(m_current_buffer);
+
+    ++m_frame_index;
+    m_current_buffer = static_cast<uint32_t>(m_frame_index % m_buffered_frames);
+
+    uint32_t const buffer = m_current_buffer;
+    for(uint32_t i = 0; i <= max_thread_lanes; ++i)
+    {
+        details::frame_lane& lane = m_lanes[i];
+        recycle_pages(lane.pages[buffer]);
+
+        lane.pages[buffer] = nullptr;
+        lane.used_size[buffer] = 0;
+        lane.allocations_count[buffer] = 0;
+        lane.frees_count[buffer] = 0;
+
+        // current page belongs to finished frame
+        lane.cursor = nullptr;
+        lane.end = nullptr;
+        lane.last_block = nullptr;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+uint64_t frame_allocator::get_frame_index() const
+{
+    return m_frame_index;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t frame_allocator::get_frame_budget() const
+{
+    return m_frame_budget;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+uint64_t frame_allocator::get_overflow_count() const
+{
+    return threading::atomic_fetch_relax(m_overflow_count);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void frame_allocator::set_report_function(frame_report_function function, pvoid user_data)
+{
+    m_report_function = function;
+    m_report_user_data = user_data;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool frame_allocator::can_allocate_block(size_t const size) const XR_NOEXCEPT
+{
+    if(!m_backing)
+        return false;
+
+    return (size <= details::frame_page_payload) ||
+        m_backing->can_allocate_block(size + details::frame_page_header_size + page_size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t frame_allocator::total_size() const XR_NOEXCEPT
+{
+    return threading::atomic_fetch_relax(m_backing_size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t frame_allocator::allocated_size() const XR_NOEXCEPT
+{
+    if(!m_lanes)
+        return 0;
+
+    size_t allocated = 0;
+    for(uint32_t i = 0; i <= max_thread_lanes; ++i)
+    {
+        for(uint32_t buffer = 0; buffer < m_buffered_frames; ++buffer)
+            allocated += threading::atomic_fetch_relax(m_lanes[i].used_size[buffer]);
+    }
+    return allocated;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+pvoid frame_allocator::call_malloc(size_t size
+    XR_DEBUG_PARAMETERS_DESCRIPTION_DECLARATION XR_DEBUG_PARAMETERS_DECLARATION)
+{
+    XR_DEBUG_PARAMETERS_UNREFERENCED_GUARD;
+    XR_DEBUG_ASSERTION_MSG(m_backing, "allocator must be initialized before malloc");
+
+    details::frame_lane* lane = get_lane();
+    if(!is_shared_lane(lane))
+        return allocate(*lane, size);
+
+    threading::scoped_lock lock { m_shared_lane_lock };
+    return allocate(*lane, size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+pvoid frame_allocator::call_realloc(pvoid pointer, size_t new_size
+    XR_DEBUG_PARAMETERS_DESCRIPTION_DECLARATION XR_DEBUG_PARAMETERS_DECLARATION)
+{
+    XR_DEBUG_PARAMETERS_UNREFERENCED_GUARD;
+    XR_DEBUG_ASSERTION_MSG(m_backing, "allocator must be initialized before reallocation");
+
+    details::frame_lane* lane = get_lane();
+    if(!is_shared_lane(lane))
+        return reallocate(*lane, pointer, new_size);
+
+    threading::scoped_lock lock { m_shared_lane_lock };
+    return reallocate(*lane, pointer, new_size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void frame_allocator::call_free(pvoid pointer XR_DEBUG_PARAMETERS_DECLARATION)
+{
+    XR_DEBUG_PARAMETERS_UNREFERENCED_GUARD;
+    XR_DEBUG_ASSERTION_MSG(m_backing, "allocator must be initialized before freeing");
+
+    if(!pointer)
+        return;
+
+    details::frame_lane* lane = get_lane();
+    if(!is_shared_lane(lane))
+    {
+        release(*lane, pointer);
+        return;
+    }
+
+    threading::scoped_lock lock { m_shared_lane_lock };
+    release(*lane, pointer);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void frame_allocator::finalize()
+{
+    if(!m_backing)
+        return;
+
+    for(uint32_t i = 0; i <= max_thread_lanes; ++i)
+    {
+        for(uint32_t buffer = 0; buffer < max_buffered_frames; ++buffer)
+            recycle_pages(m_lanes[i].pages[buffer]);
+    }
+
+    for(uint32_t i = 0; i < m_chunks_count; ++i)
+        XR_DEALLOCATE_MEMORY(*m_backing, m_chunks[i]);
+
+    XR_DEALLOCATE_MEMORY(*m_backing, m_lanes);
+    sys::destroy_thread_local(m_tls);
+
+    m_chunks_count = 0;
+    m_free_pages = nullptr;
+    m_lanes = nullptr;
+    m_tls = sys::invalid_thread_local_storage;
+    m_backing = nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+details::frame_lane* frame_allocator::get_lane()
+{
+    details::frame_lane* lane = sys::get_tls_typed_data<details::frame_lane>(m_tls);
+    if(lane)
+        return lane;
+
+    uint32_t index = threading::atomic_fetch_then_inc_seq(m_lanes_count);
+    lane = &m_lanes[eastl::min(index, max_thread_lanes)];
+    sys::set_tls_data(m_tls, lane);
+    return lane;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool frame_allocator::is_shared_lane(const details::frame_lane* lane) const
+{
+    return lane == &m_lanes[max_thread_lanes];
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+pvoid frame_allocator::allocate(details::frame_lane& lane, size_t size)
+{
+    uint8_t* block = utils::align_up(lane.cursor, details::frame_block_alignment);
+    if(!block || block > lane.end || size > static_cast<size_t>(lane.end - block))
+        return allocate_from_new_page(lane, size);
+
+    lane.cursor = block + size;
+    lane.last_block = block;
+
+    details::add_lane_counter<size_t>(lane.used_size[m_current_buffer], size);
+    details::add_lane_counter<uint32_t>(lane.allocations_count[m_current_buffer], 1);
+    return block;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Latest block of the lane is resized in place, other blocks are copied to a new one.
+ */
+pvoid frame_allocator::reallocate(details::frame_lane& lane, pvoid pointer, size_t new_size)
+{
+    if(!pointer)
+        return allocate(lane, new_size);
+
+    uint8_t* block = reinterpret_cast<uint8_t*>(pointer);
+    if(block == lane.last_block && new_size <= static_cast<size_t>(lane.end - block))
+    {
+        size_t const old_size = static_cast<size_t>(lane.cursor - block);
+        lane.cursor = block + new_size;
+        details::add_lane_counter<size_t>(lane.used_size[m_current_buffer], new_size - old_size);
+        return pointer;
+    }
+
+    // old size isn't stored, but block can't be larger than the rest of its page
+    details::frame_page* page = details::page_from_pointer(pointer);
+    size_t const max_old_size = static_cast<size_t>(page->end - block);
+
+    pvoid result = allocate(lane, new_size);
+    if(!result)
+        return nullptr;
+
+    memcpy(result, pointer, eastl::min(new_size, max_old_size));
+    release(lane, pointer);
+    return result;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void frame_allocator::release(details::frame_lane& lane, pvoid pointer)
+{
+    details::frame_page* page = details::page_from_pointer(pointer);
+    details::add_lane_counter<uint32_t>(lane.frees_count[page->buffer], 1);
+
+    if(lane.last_block == pointer)
+    {
+        // nothing was allocated after the block, so its memory is reused right away
+        details::add_lane_counter<size_t>(lane.used_size[m_current_buffer],
+            size_t(0) - static_cast<size_t>(lane.cursor - lane.last_block));
+        lane.cursor = lane.last_block;
+        lane.last_block = nullptr;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+pvoid frame_allocator::allocate_from_new_page(details::frame_lane& lane, size_t size)
+{
+    details::frame_page* page = acquire_page(size);
+    if(!page)
+        return nullptr;
+
+    page->buffer = m_current_buffer;
+    page->next = lane.pages[m_current_buffer];
+    lane.pages[m_current_buffer] = page;
+
+    uint8_t* block = details::first_block(page);
+
+    // dedicated page is full right away, small blocks keep going to current page
+    if(!page->memory)
+    {
+        lane.cursor = block + size;
+        lane.end = page->end;
+        lane.last_block = block;
+    }
+
+    details::add_lane_counter<size_t>(lane.used_size[m_current_buffer], size);
+    details::add_lane_counter<uint32_t>(lane.allocations_count[m_current_buffer], 1);
+    return block;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+details::frame_page* frame_allocator::acquire_page(size_t size)
+{
+    if(size > details::frame_page_payload)
+    {
+        size_t memory_size = details::frame_page_header_size + size + page_size;
+        pvoid memory = XR_ALLOCATE_MEMORY(*m_backing, memory_size, "frame dedicated page");
+        if(!memory)
+            return nullptr;
+
+        details::frame_page* page = reinterpret_cast<details::frame_page*>(
+            utils::align_up(reinterpret_cast<uintptr_t>(memory), page_size));
+        page->memory = memory;
+        page->memory_size = memory_size;
+        page->end = details::first_block(page) + size;
+        threading::atomic_fetch_add_seq(m_backing_size, memory_size);
+        return page;
+    }
+
+    details::frame_page* page = nullptr;
+    {
+        threading::scoped_lock lock { m_pages_lock };
+        if(!m_free_pages && !refill_pages())
+            return nullptr;
+
+        page = m_free_pages;
+        m_free_pages = page->next;
+    }
+
+    page->memory = nullptr;
+    page->memory_size = 0;
+    page->end = reinterpret_cast<uint8_t*>(page) + page_size;
+    return page;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void frame_allocator::recycle_pages(details::frame_page* pages)
+{
+    threading::scoped_lock lock { m_pages_lock };
+
+    while(pages)
+    {
+        details::frame_page* next = pages->next;
+        if(pages->memory)
+        {
+            threading::atomic_fetch_add_seq(m_backing_size, size_t(0) - pages->memory_size);
+            XR_DEALLOCATE_MEMORY(*m_backing, pages->memory);
+        }
+        else
+        {
+            pages->next = m_free_pages;
+            m_free_pages = pages;
+        }
+        pages = next;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Takes chunk of pages from backing allocator, called under pages lock.
+ */
+bool frame_allocator::refill_pages()
+{
+    if(m_chunks_count == max_chunks_count)
+        return false;
+
+    size_t chunk_size = details::frame_pages_per_chunk * page_size + page_size;
+    pvoid chunk = XR_ALLOCATE_MEMORY(*m_backing, chunk_size, "frame pages chunk");
+    if(!chunk)
+        return false;
+
+    m_chunks[m_chunks_count++] = chunk;
+    threading::atomic_fetch_add_seq(m_backing_size, chunk_size);
+
+    uint8_t* first_page = utils::align_up(reinterpret_cast<uint8_t*>(chunk), page_size);
+    for(size_t i = 0; i < details::frame_pages_per_chunk; ++i)
+    {
+        details::frame_page* page = reinterpret_cast<details::frame_page*>(first_page + i * page_size);
+        page->next = m_free_pages;
+        m_free_pages = page;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void frame_allocator::report_frame(uint32_t buffer)
+{
+    frame_allocator_report report {};
+    report.frame_index = m_frame_index;
+    report.budget = m_frame_budget;
+
+    uint32_t frees_count = 0;
+    for(uint32_t i = 0; i <= max_thread_lanes; ++i)
+    {
+        const details::frame_lane& lane = m_lanes[i];
+        size_t const used_size = threading::atomic_fetch_relax(lane.used_size[buffer]);
+
+        report.used_size += used_size;
+        report.allocations_count += threading::atomic_fetch_relax(lane.allocations_count[buffer]);
+        frees_count += threading::atomic_fetch_relax(lane.frees_count[buffer]);
+
+        if(used_size > report.largest_lane_used_size)
+        {
+            report.largest_lane_index = i;
+            report.largest_lane_used_size = used_size;
+        }
+    }
+
+    if(report.used_size <= m_frame_budget)
+        return;
+
+    report.live_blocks_count = (report.allocations_count > frees_count) ?
+        report.allocations_count - frees_count : 0;
+
+    threading::atomic_fetch_inc_seq(m_overflow_count);
+    if(m_report_function)
+        m_report_function(report, m_report_user_data);
+}
+
+XR_NAMESPACE_END(xr, memory)
+//-----------------------------------------------------------------------------------------------------------
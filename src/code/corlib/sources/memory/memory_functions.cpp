@@ -4,104 +4,711 @@
 #include "corlib/memory/memory_functions.h"
 #include "corlib/macro/aligning.h"
 #include "corlib/utils/aligning.h"
+#include "corlib/sys/cpu_features.h"
+#include "corlib/threading/interlocked.h"
 #include <string.h>
-#include <intrin.h>
+#include <immintrin.h>
 
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, memory)
 
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+//-----------------------------------------------------------------------------------------------------------
+// Copy and fill below assume non-overlapping blocks and handle any size. Blocks of up to two vectors
+// are written with two overlapping stores, larger ones with four vectors per iteration and the rest
+// with up to four vectors, last of them ending at the end of block, so no path has a byte loop.
+//
+// Streaming versions are called for blocks not smaller than min_non_temporal_threshold only: they
+// store the first vector unaligned, stream from the next aligned address and finish with ordinary
+// stores after sfence.
+typedef void (*copy_function)(uint8_t* destination, const uint8_t* source, size_t size);
+typedef void (*fill_function)(uint8_t* destination, size_t size, uint8_t value);
+
+struct vector_functions
+{
+    vector_isa isa;
+    copy_function copy;
+    copy_function copy_streaming;
+    fill_function fill;
+    fill_function fill_streaming;
+}; // struct vector_functions
+
+XR_CONSTEXPR_CPP14_OR_CONST size_t min_non_temporal_threshold = XR_KILOBYTES_TO_BYTES(4);
+XR_CONSTEXPR_CPP14_OR_CONST size_t default_non_temporal_threshold = XR_MEGABYTES_TO_BYTES(4);
+
 //-----------------------------------------------------------------------------------------------------------
 /**
-*/
-void copy(void* destination, size_t const destination_size, void const* const source, size_t const size)
+ *  Blocks of less than 32 bytes.
+ */
+inline void
+copy_small(uint8_t* destination, const uint8_t* source, size_t size)
 {
-    XR_UNREFERENCED_PARAMETER(destination_size);
-    XR_DEBUG_ASSERTION(destination_size >= size);
-    memcpy(destination, source, size);
+    if(size >= 16)
+    {
+        __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+        __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + size - 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), head);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + size - 16), tail);
+    }
+    else if(size >= 8)
+    {
+        uint64_t head, tail;
+        memcpy(&head, source, 8);
+        memcpy(&tail, source + size - 8, 8);
+        memcpy(destination, &head, 8);
+        memcpy(destination + size - 8, &tail, 8);
+    }
+    else if(size >= 4)
+    {
+        uint32_t head, tail;
+        memcpy(&head, source, 4);
+        memcpy(&tail, source + size - 4, 4);
+        memcpy(destination, &head, 4);
+        memcpy(destination + size - 4, &tail, 4);
+    }
+    else if(size)
+    {
+        uint8_t first = source[0];
+        uint8_t middle = source[size / 2];
+        uint8_t last = source[size - 1];
+        destination[0] = first;
+        destination[size / 2] = middle;
+        destination[size - 1] = last;
+    }
 }
 
 //-----------------------------------------------------------------------------------------------------------
 /**
-*/
-void copy_align_16(void* destination, size_t const destination_size, void const* source, size_t const source_size)
+ *  Blocks of less than 32 bytes.
+ */
+inline void
+fill_small(uint8_t* destination, size_t size, uint8_t value)
 {
-    XR_DEBUG_ASSERTION_MSG(source, "Source data must be provided to copy from");
-    XR_DEBUG_ASSERTION_MSG(destination, "Destination point must be valid!");
+    uint64_t pattern = value * 0x0101010101010101ULL;
+    if(size >= 16)
+    {
+        __m128i vector = _mm_set1_epi8(static_cast<char>(value));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), vector);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + size - 16), vector);
+    }
+    else if(size >= 8)
+    {
+        memcpy(destination, &pattern, 8);
+        memcpy(destination + size - 8, &pattern, 8);
+    }
+    else if(size >= 4)
+    {
+        memcpy(destination, &pattern, 4);
+        memcpy(destination + size - 4, &pattern, 4);
+    }
+    else if(size)
+    {
+        destination[0] = value;
+        destination[size / 2] = value;
+        destination[size - 1] = value;
+    }
+}
 
-    XR_DEBUG_ASSERTION_MSG(source_size, 
-        "Size of copyable data must be higher than zero!");
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Bytes to skip to get to the next aligned address, from 1 to alignment.
+ */
+inline size_t
+distance_to_next_aligned(const uint8_t* pointer, size_t alignment)
+{
+    return alignment - (reinterpret_cast<uintptr_t>(pointer) & (alignment - 1));
+}
 
-    XR_DEBUG_ASSERTION_MSG(destination_size, 
-        "Size of copyable data must be higher than zero!");
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void copy_sse2(uint8_t* destination, const uint8_t* source, size_t size)
+{
+    if(size < 32)
+        return copy_small(destination, source, size);
 
-    XR_ASSERT_16_BYTE_ALIGNED(source);
-    XR_ASSERT_16_BYTE_ALIGNED(destination);
+    if(size <= 64)
+    {
+        __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+        __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 16));
+        __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + size - 32));
+        __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + size - 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), v0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + 16), v1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + size - 32), v2);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + size - 16), v3);
+        return;
+    }
+
+    const uint8_t* source_end = source + size;
+    uint8_t* destination_end = destination + size;
+
+    for(; size > 64; size -= 64, source += 64, destination += 64)
+    {
+        __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+        __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 16));
+        __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 32));
+        __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 48));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), v0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + 16), v1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + 32), v2);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + 48), v3);
+    }
+
+    __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source_end - 64));
+    __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source_end - 48));
+    __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source_end - 32));
+    __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source_end - 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(destination_end - 64), v0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(destination_end - 48), v1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(destination_end - 32), v2);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(destination_end - 16), v3);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void copy_streaming_sse2(uint8_t* destination, const uint8_t* source, size_t size)
+{
+    const uint8_t* source_end = source + size;
+    uint8_t* destination_end = destination + size;
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(destination),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(source)));
+
+    size_t skip = distance_to_next_aligned(destination, 16);
+    destination += skip;
+    source += skip;
+    size -= skip;
+
+    for(; size > 64; size -= 64, source += 64, destination += 64)
+    {
+        __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+        __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 16));
+        __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 32));
+        __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination), v0);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination + 16), v1);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination + 32), v2);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination + 48), v3);
+    }
+
+    _mm_sfence();
+    copy_sse2(destination_end - 64, source_end - 64, 64);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void fill_sse2(uint8_t* destination, size_t size, uint8_t value)
+{
+    if(size < 32)
+        return fill_small(destination, size, value);
+
+    __m128i vector = _mm_set1_epi8(static_cast<char>(value));
+    uint8_t* destination_end = destination + size;
+
+    for(; size > 64; size -= 64, destination += 64)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), vector);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + 16), vector);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + 32), vector);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + 48), vector);
+    }
+
+    if(size > 32)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), vector);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + 16), vector);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(destination_end - 32), vector);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(destination_end - 16), vector);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void fill_streaming_sse2(uint8_t* destination, size_t size, uint8_t value)
+{
+    __m128i vector = _mm_set1_epi8(static_cast<char>(value));
+    uint8_t* destination_end = destination + size;
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), vector);
+
+    size_t skip = distance_to_next_aligned(destination, 16);
+    destination += skip;
+    size -= skip;
+
+    for(; size > 64; size -= 64, destination += 64)
+    {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination), vector);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination + 16), vector);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination + 32), vector);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(destination + 48), vector);
+    }
+
+    _mm_sfence();
+    fill_sse2(destination_end - 64, 64, value);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+XR_TARGET_ISA("avx2")
+void copy_avx2(uint8_t* destination, const uint8_t* source, size_t size)
+{
+    if(size < 32)
+        return copy_small(destination, source, size);
+
+    if(size <= 64)
+    {
+        __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source));
+        __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + size - 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), head);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + size - 32), tail);
+        return;
+    }
+
+    const uint8_t* source_end = source + size;
+    uint8_t* destination_end = destination + size;
+
+    for(; size > 128; size -= 128, source += 128, destination += 128)
+    {
+        __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source));
+        __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + 32));
+        __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + 64));
+        __m256i v3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + 96));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), v0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + 32), v1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + 64), v2);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + 96), v3);
+    }
+
+    if(size > 64)
+    {
+        __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source));
+        __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), v0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + 32), v1);
+    }
+
+    __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source_end - 64));
+    __m256i v3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source_end - 32));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination_end - 64), v2);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination_end - 32), v3);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+XR_TARGET_ISA("avx2")
+void copy_streaming_avx2(uint8_t* destination, const uint8_t* source, size_t size)
+{
+    const uint8_t* source_end = source + size;
+    uint8_t* destination_end = destination + size;
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)));
+
+    size_t skip = distance_to_next_aligned(destination, 32);
+    destination += skip;
+    source += skip;
+    size -= skip;
+
+    for(; size > 128; size -= 128, source += 128, destination += 128)
+    {
+        __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source));
+        __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + 32));
+        __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + 64));
+        __m256i v3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + 96));
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(destination), v0);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(destination + 32), v1);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(destination + 64), v2);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(destination + 96), v3);
+    }
+
+    _mm_sfence();
+    copy_avx2(destination_end - 128, source_end - 128, 128);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+XR_TARGET_ISA("avx2")
+void fill_avx2(uint8_t* destination, size_t size, uint8_t value)
+{
+    if(size < 32)
+        return fill_small(destination, size, value);
 
-    // To prevent stack growing(useful in cases like multitasking)
-    auto const src = const_cast<char*>(static_cast<const char*>(source));
-    auto const dst = static_cast<char*>(destination);
+    __m256i vector = _mm256_set1_epi8(static_cast<char>(value));
+    uint8_t* destination_end = destination + size;
 
-    size_t i = 0;
-    for(; i + 128 <= destination_size; i += 128)
+    if(size <= 64)
     {
-        // There are 8 XMM registers, so they will be automatically placed in 
-        // register memory that's why don't need to place register modifier here
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), vector);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination_end - 32), vector);
+        return;
+    }
 
-        auto const d0 = 
-            _mm_load_si128(reinterpret_cast<__m128i*>(&src[i + 0 * 16]));
+    for(; size > 128; size -= 128, destination += 128)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), vector);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + 32), vector);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + 64), vector);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + 96), vector);
+    }
 
-        auto const d1 = 
-            _mm_load_si128(reinterpret_cast<__m128i*>(&src[i + 1 * 16]));
+    if(size > 64)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), vector);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + 32), vector);
+    }
 
-        auto const d2 = 
-            _mm_load_si128(reinterpret_cast<__m128i*>(&src[i + 2 * 16]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination_end - 64), vector);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination_end - 32), vector);
+}
 
-        auto const d3 = 
-            _mm_load_si128(reinterpret_cast<__m128i*>(&src[i + 3 * 16]));
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+XR_TARGET_ISA("avx2")
+void fill_streaming_avx2(uint8_t* destination, size_t size, uint8_t value)
+{
+    __m256i vector = _mm256_set1_epi8(static_cast<char>(value));
+    uint8_t* destination_end = destination + size;
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), vector);
+
+    size_t skip = distance_to_next_aligned(destination, 32);
+    destination += skip;
+    size -= skip;
+
+    for(; size > 128; size -= 128, destination += 128)
+    {
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(destination), vector);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(destination + 32), vector);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(destination + 64), vector);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(destination + 96), vector);
+    }
 
-        auto const d4 = 
-            _mm_load_si128(reinterpret_cast<__m128i*>(&src[i + 4 * 16]));
+    _mm_sfence();
+    fill_avx2(destination_end - 128, 128, value);
+}
 
-        auto const d5 = 
-            _mm_load_si128(reinterpret_cast<__m128i*>(&src[i + 5 * 16]));
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Blocks up to 128 bytes reuse avx2 path, 512 bit registers pay off on larger ones only.
+ */
+XR_TARGET_ISA("avx512f,avx2")
+void copy_avx512(uint8_t* destination, const uint8_t* source, size_t size)
+{
+    if(size <= 128)
+        return copy_avx2(destination, source, size);
 
-        auto const d6 = 
-            _mm_load_si128(reinterpret_cast<__m128i*>(&src[i + 6 * 16]));
+    const uint8_t* source_end = source + size;
+    uint8_t* destination_end = destination + size;
 
-        auto const d7 = 
-            _mm_load_si128(reinterpret_cast<__m128i*>(&src[i + 7 * 16]));
+    for(; size > 256; size -= 256, source += 256, destination += 256)
+    {
+        __m512i v0 = _mm512_loadu_si512(source);
+        __m512i v1 = _mm512_loadu_si512(source + 64);
+        __m512i v2 = _mm512_loadu_si512(source + 128);
+        __m512i v3 = _mm512_loadu_si512(source + 192);
+        _mm512_storeu_si512(destination, v0);
+        _mm512_storeu_si512(destination + 64, v1);
+        _mm512_storeu_si512(destination + 128, v2);
+        _mm512_storeu_si512(destination + 192, v3);
+    }
 
-        _mm_stream_si128(reinterpret_cast<__m128i*>(&dst[i + 0 * 16]), d0);
-        _mm_stream_si128(reinterpret_cast<__m128i*>(&dst[i + 1 * 16]), d1);
-        _mm_stream_si128(reinterpret_cast<__m128i*>(&dst[i + 2 * 16]), d2);
-        _mm_stream_si128(reinterpret_cast<__m128i*>(&dst[i + 3 * 16]), d3);
-        _mm_stream_si128(reinterpret_cast<__m128i*>(&dst[i + 4 * 16]), d4);
-        _mm_stream_si128(reinterpret_cast<__m128i*>(&dst[i + 5 * 16]), d5);
-        _mm_stream_si128(reinterpret_cast<__m128i*>(&dst[i + 6 * 16]), d6);
-        _mm_stream_si128(reinterpret_cast<__m128i*>(&dst[i + 7 * 16]), d7);
+    if(size > 128)
+    {
+        __m512i v0 = _mm512_loadu_si512(source);
+        __m512i v1 = _mm512_loadu_si512(source + 64);
+        _mm512_storeu_si512(destination, v0);
+        _mm512_storeu_si512(destination + 64, v1);
     }
 
-    for(; i + 16 <= destination_size; i += 16)
+    __m512i v2 = _mm512_loadu_si512(source_end - 128);
+    __m512i v3 = _mm512_loadu_si512(source_end - 64);
+    _mm512_storeu_si512(destination_end - 128, v2);
+    _mm512_storeu_si512(destination_end - 64, v3);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+XR_TARGET_ISA("avx512f,avx2")
+void copy_streaming_avx512(uint8_t* destination, const uint8_t* source, size_t size)
+{
+    const uint8_t* source_end = source + size;
+    uint8_t* destination_end = destination + size;
+
+    _mm512_storeu_si512(destination, _mm512_loadu_si512(source));
+
+    size_t skip = distance_to_next_aligned(destination, 64);
+    destination += skip;
+    source += skip;
+    size -= skip;
+
+    for(; size > 256; size -= 256, source += 256, destination += 256)
     {
-        // No need to set register attribute, because compile will interpret it as
-        // CPU XMM register
+        __m512i v0 = _mm512_loadu_si512(source);
+        __m512i v1 = _mm512_loadu_si512(source + 64);
+        __m512i v2 = _mm512_loadu_si512(source + 128);
+        __m512i v3 = _mm512_loadu_si512(source + 192);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(destination), v0);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(destination + 64), v1);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(destination + 128), v2);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(destination + 192), v3);
+    }
 
-        auto const d = _mm_load_si128(reinterpret_cast<__m128i *>(&src[i]));
-        _mm_stream_si128(reinterpret_cast<__m128i *>(&dst[i]), d);
+    _mm_sfence();
+    copy_avx512(destination_end - 256, source_end - 256, 256);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+XR_TARGET_ISA("avx512f,avx2")
+void fill_avx512(uint8_t* destination, size_t size, uint8_t value)
+{
+    if(size <= 128)
+        return fill_avx2(destination, size, value);
+
+    __m512i vector = _mm512_set1_epi32(static_cast<int>(value * 0x01010101U));
+    uint8_t* destination_end = destination + size;
+
+    for(; size > 256; size -= 256, destination += 256)
+    {
+        _mm512_storeu_si512(destination, vector);
+        _mm512_storeu_si512(destination + 64, vector);
+        _mm512_storeu_si512(destination + 128, vector);
+        _mm512_storeu_si512(destination + 192, vector);
     }
 
-    for(; i + 4 <= destination_size; i += 4)
+    if(size > 128)
     {
-        *reinterpret_cast<uint32_t*>(&dst[i]) = 
-            *reinterpret_cast<const uint32_t*>(&src[i]);
+        _mm512_storeu_si512(destination, vector);
+        _mm512_storeu_si512(destination + 64, vector);
     }
 
-    for(; i < destination_size; i++)
+    _mm512_storeu_si512(destination_end - 128, vector);
+    _mm512_storeu_si512(destination_end - 64, vector);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+XR_TARGET_ISA("avx512f,avx2")
+void fill_streaming_avx512(uint8_t* destination, size_t size, uint8_t value)
+{
+    __m512i vector = _mm512_set1_epi32(static_cast<int>(value * 0x01010101U));
+    uint8_t* destination_end = destination + size;
+
+    _mm512_storeu_si512(destination, vector);
+
+    size_t skip = distance_to_next_aligned(destination, 64);
+    destination += skip;
+    size -= skip;
+
+    for(; size > 256; size -= 256, destination += 256)
     {
-        dst[i] = src[i];
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(destination), vector);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(destination + 64), vector);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(destination + 128), vector);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(destination + 192), vector);
     }
 
     _mm_sfence();
+    fill_avx512(destination_end - 256, 256, value);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+const vector_functions s_sse2_functions
+{
+    vector_isa::sse2, &copy_sse2, &copy_streaming_sse2, &fill_sse2, &fill_streaming_sse2
+};
+
+const vector_functions s_avx2_functions
+{
+    vector_isa::avx2, &copy_avx2, &copy_streaming_avx2, &fill_avx2, &fill_streaming_avx2
+};
+
+const vector_functions s_avx512_functions
+{
+    vector_isa::avx512, &copy_avx512, &copy_streaming_avx512, &fill_avx512, &fill_streaming_avx512
+};
+
+//! both are zero until first call selects them, so functions work during static initialization too
+const vector_functions* volatile s_functions = nullptr;
+size_t volatile s_non_temporal_threshold = 0;
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline bool
+is_supported(vector_isa isa)
+{
+    const sys::cpu_features& features = sys::query_cpu_features();
+    switch(isa)
+    {
+    case vector_isa::sse2:
+        return true;
+    case vector_isa::avx2:
+        return features.avx2;
+    case vector_isa::avx512:
+        return features.avx2 && features.avx512f;
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Several threads may get here at once, all of them store the same values.
+ */
+const vector_functions&
+select_functions()
+{
+    const sys::cpu_features& features = sys::query_cpu_features();
+
+    size_t threshold = features.llc_size ? features.llc_size / 2 : default_non_temporal_threshold;
+    if(threshold < min_non_temporal_threshold)
+        threshold = min_non_temporal_threshold;
+
+    threading::atomic_store_seq(s_non_temporal_threshold, threshold);
+
+    const vector_functions* functions = &s_sse2_functions;
+    if(is_supported(vector_isa::avx512))
+        functions = &s_avx512_functions;
+    else if(is_supported(vector_isa::avx2))
+        functions = &s_avx2_functions;
+
+    threading::atomic_store_rel(s_functions, functions);
+    return *functions;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline const vector_functions&
+get_functions()
+{
+    const vector_functions* functions = threading::atomic_fetch_acq(s_functions);
+    if(!functions)
+        return select_functions();
+
+    return *functions;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+copy_block(void* destination, void const* source, size_t size)
+{
+    const vector_functions& functions = get_functions();
+    copy_function function = size < s_non_temporal_threshold ? functions.copy : functions.copy_streaming;
+    function(static_cast<uint8_t*>(destination), static_cast<const uint8_t*>(source), size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+fill_block(void* destination, size_t size, uint8_t value)
+{
+    const vector_functions& functions = get_functions();
+    fill_function function = size < s_non_temporal_threshold ? functions.fill : functions.fill_streaming;
+    function(static_cast<uint8_t*>(destination), size, value);
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+vector_isa get_vector_isa()
+{
+    return get_functions().isa;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+bool set_vector_isa(vector_isa isa)
+{
+    if(!is_supported(isa))
+        return false;
+
+    get_functions();
+
+    const vector_functions* functions = &s_sse2_functions;
+    if(isa == vector_isa::avx512)
+        functions = &s_avx512_functions;
+    else if(isa == vector_isa::avx2)
+        functions = &s_avx2_functions;
+
+    threading::atomic_store_rel(s_functions, functions);
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+size_t get_non_temporal_threshold()
+{
+    get_functions();
+    return s_non_temporal_threshold;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+void set_non_temporal_threshold(size_t const size)
+{
+    get_functions();
+    threading::atomic_store_seq(s_non_temporal_threshold,
+        size < min_non_temporal_threshold ? min_non_temporal_threshold : size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+void copy(void* destination, size_t const destination_size, void const* const source, size_t const size)
+{
+    XR_UNREFERENCED_PARAMETER(destination_size);
+    XR_DEBUG_ASSERTION(destination_size >= size);
+    XR_DEBUG_ASSERTION_MSG(static_cast<const uint8_t*>(source) + size <= static_cast<uint8_t*>(destination) ||
+        static_cast<uint8_t*>(destination) + size <= static_cast<const uint8_t*>(source),
+        "blocks must not overlap");
+
+    copy_block(destination, source, size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+void copy_align_16(void* destination, size_t const destination_size, void const* source, size_t const source_size)
+{
+    XR_DEBUG_ASSERTION_MSG(source, "Source data must be provided to copy from");
+    XR_DEBUG_ASSERTION_MSG(destination, "Destination point must be valid!");
+
+    XR_DEBUG_ASSERTION_MSG(source_size,
+        "Size of copyable data must be higher than zero!");
+
+    XR_DEBUG_ASSERTION_MSG(destination_size >= source_size,
+        "Destination is smaller than copyable data!");
+
+    XR_ASSERT_16_BYTE_ALIGNED(source);
+    XR_ASSERT_16_BYTE_ALIGNED(destination);
+    XR_UNREFERENCED_PARAMETER(destination_size);
+
+    copy_block(destination, source, source_size);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -109,7 +716,15 @@ void copy_align_16(void* destination, size_t const destination_size, void const*
 */
 void zero(void* destination, size_t const size_in_bytes)
 {
-    memset(destination, 0, size_in_bytes);
+    fill_block(destination, size_in_bytes, 0);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+void fill(void* destination, size_t const size_in_bytes, uint8_t const value)
+{
+    fill_block(destination, size_in_bytes, value);
 }
 
 XR_NAMESPACE_END(xr, memory)
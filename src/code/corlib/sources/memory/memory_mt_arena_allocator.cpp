@@ -1,12 +1,8 @@
 // This file is a part of xray-ng engine
 //
 
-#if !defined(XRAY_PLATFORM_WINDOWS)
-#   error "This code is supported by Windows platform!"
-#endif // !defined(XRAY_PLATFORM_WINDOWS)
-
 #include "corlib/memory/memory_mt_arena_allocator.h"
-#include "memory_utility_for_arena_win32.h"
+#include "memory_arena_heap.h"
 
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, memory)
@@ -22,15 +18,11 @@ mt_arena_allocator::~mt_arena_allocator()
 //-----------------------------------------------------------------------------------------------------------
 /**
 */
-void mt_arena_allocator::initialize(size_t size, size_t initial)
+void mt_arena_allocator::initialize(size_t size, size_t initial, page_kind pages)
 {
     XR_DEBUG_ASSERTION_MSG(!m_arena, "arena already initialized");
-
-    SIZE_T const sz_initial = static_cast<SIZE_T>(initial);
-    SIZE_T const sz_buffer_size = static_cast<SIZE_T>(size);
-
-    DWORD const dw_initial_flags = 0;
-    m_arena = HeapCreate(dw_initial_flags, sz_initial, sz_buffer_size);
+    m_arena = details::arena_heap::create(size, initial, true, pages);
+    XR_DEBUG_ASSERTION_MSG(m_arena, "failed to reserve arena");
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -39,8 +31,7 @@ void mt_arena_allocator::initialize(size_t size, size_t initial)
 bool mt_arena_allocator::can_allocate_block(size_t const size) const XR_NOEXCEPT
 {
     if(!m_arena) return false;
-    // TODO: check if allocating from one block
-    return true;
+    return static_cast<details::arena_heap*>(m_arena)->can_allocate(size);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -48,8 +39,8 @@ bool mt_arena_allocator::can_allocate_block(size_t const size) const XR_NOEXCEPT
 */
 size_t mt_arena_allocator::total_size() const XR_NOEXCEPT
 {
-    HANDLE const heap = static_cast<HANDLE>(m_arena);
-    return (mem_usage(heap, nullptr, nullptr));
+    if(!m_arena) return 0;
+    return static_cast<details::arena_heap*>(m_arena)->committed_size();
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -57,8 +48,17 @@ size_t mt_arena_allocator::total_size() const XR_NOEXCEPT
 */
 size_t mt_arena_allocator::allocated_size() const XR_NOEXCEPT
 {
-    HANDLE const heap = static_cast<HANDLE>(m_arena);
-    return (mem_usage(heap, nullptr, nullptr));
+    if(!m_arena) return 0;
+    return static_cast<details::arena_heap*>(m_arena)->allocated_size();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+size_t mt_arena_allocator::query_large_page_size() const
+{
+    if(!m_arena) return 0;
+    return static_cast<details::arena_heap*>(m_arena)->query_large_page_size();
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -70,9 +70,7 @@ pvoid mt_arena_allocator::call_malloc(size_t size
     XR_DEBUG_PARAMETERS_UNREFERENCED_GUARD;
     XR_DEBUG_ASSERTION_MSG(m_arena, "arena must be initialized before malloc");
 
-    HANDLE const heap = static_cast<HANDLE>(m_arena);
-    pvoid const result = HeapAlloc(heap, 0, size);
-    return result;
+    return static_cast<details::arena_heap*>(m_arena)->allocate(size);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -84,10 +82,7 @@ pvoid mt_arena_allocator::call_realloc(pvoid pointer, size_t new_size
     XR_DEBUG_PARAMETERS_UNREFERENCED_GUARD;
     XR_DEBUG_ASSERTION_MSG(m_arena, "arena must be initialized before reallocation");
 
-    HANDLE const heap = static_cast<HANDLE>(m_arena);
-    if(!pointer) return HeapAlloc(heap, 0, new_size);
-    pvoid const result = HeapReAlloc(heap, 0, pointer, new_size);
-    return result;
+    return static_cast<details::arena_heap*>(m_arena)->reallocate(pointer, new_size);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -98,8 +93,7 @@ void mt_arena_allocator::call_free(pvoid pointer XR_DEBUG_PARAMETERS_DECLARATION
     XR_DEBUG_PARAMETERS_UNREFERENCED_GUARD;
     XR_DEBUG_ASSERTION_MSG(m_arena, "arena must be initialized before freeing");
 
-    HANDLE const heap = static_cast<HANDLE>(m_arena);
-    HeapFree(heap, 0, pointer);
+    static_cast<details::arena_heap*>(m_arena)->free(pointer);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -107,8 +101,8 @@ void mt_arena_allocator::call_free(pvoid pointer XR_DEBUG_PARAMETERS_DECLARATION
 */
 void mt_arena_allocator::finalize()
 {
-    XR_DEBUG_ASSERTION_MSG(m_arena, "arena must be initialized before finishing");
-    HeapDestroy(m_arena);
+    details::arena_heap::destroy(static_cast<details::arena_heap*>(m_arena));
+    m_arena = nullptr;
 }
 
 XR_NAMESPACE_END(xr, memory)
@@ -0,0 +1,219 @@
+// This file is a part of xray-ng engine
+//
+
+#if !defined(XRAY_PLATFORM_LINUX)
+#   error "This code is supported by Linux platform!"
+#endif // !defined(XRAY_PLATFORM_LINUX)
+
+#include "corlib/memory/memory_paging.h"
+#include "corlib/utils/aligning.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, memory)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Reads small procfs or sysfs file as zero terminated string.
+ */
+bool read_proc_file(pcstr path, char* buffer, size_t buffer_size)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return false;
+
+    ssize_t size = read(fd, buffer, buffer_size - 1);
+    close(fd);
+
+    if(size <= 0)
+        return false;
+
+    buffer[size] = 0;
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Transparent huge pages are as large as one page middle directory entry, explicit ones have
+ *  default size of hugetlb pool.
+ */
+size_t read_large_page_size()
+{
+    char buffer[4096];
+    if(read_proc_file("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", buffer, sizeof(buffer)))
+        return static_cast<size_t>(strtoull(buffer, nullptr, 10));
+
+    if(read_proc_file("/proc/meminfo", buffer, sizeof(buffer)))
+    {
+        if(pcstr line = strstr(buffer, "Hugepagesize:"))
+            return static_cast<size_t>(strtoull(line + sizeof("Hugepagesize:") - 1, nullptr, 10)) * 1024;
+    }
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Address space aligned to large pages, kernel backs its committed aligned ranges with transparent
+ *  huge pages when it has them.
+ */
+pvoid reserve_transparent_huge_pages(size_t size, size_t page_size)
+{
+    size_t const mapped_size = size + page_size;
+    pvoid const mapped = mmap(nullptr, mapped_size, PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if(mapped == MAP_FAILED)
+        return nullptr;
+
+    uint8_t* const begin = reinterpret_cast<uint8_t*>(mapped);
+    uint8_t* const address = reinterpret_cast<uint8_t*>(utils::align_up(reinterpret_cast<uintptr_t>(begin), page_size));
+
+    if(address != begin)
+        munmap(begin, address - begin);
+
+    size_t const tail_size = (begin + mapped_size) - (address + size);
+    if(tail_size)
+        munmap(address + size, tail_size);
+
+    // failure leaves normal pages, e.g. if huge pages are disabled
+    madvise(address, size, MADV_HUGEPAGE);
+    return address;
+}
+
+} // anonymous namespace
+//-----------------------------------------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+size_t system_page_size()
+{
+    long const page_size = sysconf(_SC_PAGESIZE);
+    return (page_size > 0) ? static_cast<size_t>(page_size) : 4096;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+size_t large_page_size()
+{
+    static const size_t page_size = read_large_page_size();
+    return page_size;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Explicit huge pages are tried first. Pages of hugetlb pool are reserved by mmap itself, so
+ *  running out of them fails here instead of at first touch. Transparent huge pages are used next.
+ */
+pvoid reserve_pages(size_t size, page_kind kind)
+{
+    size_t const page_size = large_page_size();
+    if(kind == page_kind::large && page_size)
+    {
+        XR_DEBUG_ASSERTION_MSG(size % page_size == 0, "size of large page reservation must be multiple of large page");
+
+        pvoid const address = mmap(nullptr, size, PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if(address != MAP_FAILED)
+            return address;
+
+        if(pvoid const aligned = reserve_transparent_huge_pages(size, page_size))
+            return aligned;
+    }
+
+    pvoid const address = mmap(nullptr, size, PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    return (address == MAP_FAILED) ? nullptr : address;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+bool commit_pages(pvoid address, size_t size)
+{
+    return mprotect(address, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Pages are dropped first, so they don't count towards process memory even if protection fails.
+ */
+void decommit_pages(pvoid address, size_t size)
+{
+    madvise(address, size, MADV_DONTNEED);
+    mprotect(address, size, PROT_NONE);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+void release_pages(pvoid address, size_t size)
+{
+    munmap(address, size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Kernel reports large pages per mapping in smaps. Reservation may be split into several mappings
+ *  by protection changes, so every mapping that overlaps the range is counted.
+ */
+size_t query_large_page_size(pvoid address, size_t size)
+{
+    FILE* file = fopen("/proc/self/smaps", "re");
+    if(!file)
+        return 0;
+
+    uintptr_t const range_begin = reinterpret_cast<uintptr_t>(address);
+    uintptr_t const range_end = range_begin + size;
+
+    size_t result = 0;
+    size_t overlap = 0;
+    size_t mapping_large_size = 0;
+    char line[512];
+
+    while(fgets(line, sizeof(line), file))
+    {
+        unsigned long begin = 0, end = 0;
+        if(sscanf(line, "%lx-%lx ", &begin, &end) == 2)
+        {
+            result += (mapping_large_size < overlap) ? mapping_large_size : overlap;
+            mapping_large_size = 0;
+
+            uintptr_t const overlap_begin = (begin > range_begin) ? begin : range_begin;
+            uintptr_t const overlap_end = (end < range_end) ? end : range_end;
+            overlap = (overlap_begin < overlap_end) ? overlap_end - overlap_begin : 0;
+            continue;
+        }
+
+        if(!overlap)
+            continue;
+
+        unsigned long kilobytes = 0;
+        if(sscanf(line, "AnonHugePages: %lu kB", &kilobytes) == 1 ||
+            sscanf(line, "Private_Hugetlb: %lu kB", &kilobytes) == 1 ||
+            sscanf(line, "Shared_Hugetlb: %lu kB", &kilobytes) == 1)
+        {
+            mapping_large_size += static_cast<size_t>(kilobytes) * 1024;
+        }
+    }
+
+    result += (mapping_large_size < overlap) ? mapping_large_size : overlap;
+    fclose(file);
+    return result;
+}
+
+XR_NAMESPACE_END(xr, memory)
+//-----------------------------------------------------------------------------------------------------------
@@ -3,10 +3,41 @@
 
 #include "corlib/memory/memory_paging.h"
 #include "../os_include_win32.h"
+#include <psapi.h>
 
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, memory)
 
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Large pages need "Lock pages in memory" privilege, it's granted by policy but must be enabled
+ *  in process token as well.
+ */
+bool enable_lock_memory_privilege()
+{
+    HANDLE token = nullptr;
+    if(!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+        return false;
+
+    TOKEN_PRIVILEGES privileges {};
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+    bool result = LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid) &&
+        AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) &&
+        GetLastError() == ERROR_SUCCESS;
+
+    CloseHandle(token);
+    return result;
+}
+
+} // anonymous namespace
+//-----------------------------------------------------------------------------------------------------------
+
 //-----------------------------------------------------------------------------------------------------------
 /**
 */
@@ -17,5 +48,94 @@ size_t system_page_size()
     return sysInfo.dwPageSize;
 }
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+size_t large_page_size()
+{
+    return GetLargePageMinimum();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Large pages can't be reserved without being committed, so the whole range is committed and
+ *  locked in memory right away. Commit and decommit leave such range as is.
+ */
+pvoid reserve_pages(size_t size, page_kind kind)
+{
+    static const bool can_lock_memory = enable_lock_memory_privilege();
+
+    size_t const page_size = large_page_size();
+    if(kind == page_kind::large && page_size && can_lock_memory)
+    {
+        XR_DEBUG_ASSERTION_MSG(size % page_size == 0, "size of large page reservation must be multiple of large page");
+
+        pvoid const address = VirtualAlloc(nullptr, static_cast<SIZE_T>(size),
+            MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+
+        if(address)
+            return address;
+    }
+
+    return VirtualAlloc(nullptr, static_cast<SIZE_T>(size), MEM_RESERVE, PAGE_NOACCESS);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+bool commit_pages(pvoid address, size_t size)
+{
+    if(VirtualAlloc(address, static_cast<SIZE_T>(size), MEM_COMMIT, PAGE_READWRITE) != nullptr)
+        return true;
+
+    // range of large pages is committed since reservation
+    MEMORY_BASIC_INFORMATION info {};
+    return VirtualQuery(address, &info, sizeof(info)) == sizeof(info) &&
+        info.State == MEM_COMMIT && info.RegionSize >= size;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+void decommit_pages(pvoid address, size_t size)
+{
+    VirtualFree(address, static_cast<SIZE_T>(size), MEM_DECOMMIT);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+void release_pages(pvoid address, size_t size)
+{
+    XR_UNREFERENCED_PARAMETER(size);
+    VirtualFree(address, 0, MEM_RELEASE);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Working set tells page kind per virtual page, large pages are checked once per large page.
+ */
+size_t query_large_page_size(pvoid address, size_t size)
+{
+    size_t const page_size = large_page_size();
+    if(!page_size)
+        return 0;
+
+    size_t result = 0;
+    uint8_t* const begin = reinterpret_cast<uint8_t*>(address);
+    for(size_t offset = 0; offset < size; offset += page_size)
+    {
+        PSAPI_WORKING_SET_EX_INFORMATION info {};
+        info.VirtualAddress = begin + offset;
+        if(!QueryWorkingSetEx(GetCurrentProcess(), &info, sizeof(info)))
+            break;
+
+        if(info.VirtualAttributes.Valid && info.VirtualAttributes.LargePage)
+            result += (size - offset < page_size) ? size - offset : page_size;
+    }
+
+    return result;
+}
+
 XR_NAMESPACE_END(xr, memory)
 //-----------------------------------------------------------------------------------------------------------
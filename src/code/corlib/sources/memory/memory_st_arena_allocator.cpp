@@ -1,13 +1,8 @@
 // This file is a part of xray-ng engine
 //
 
-#if !defined(XRAY_PLATFORM_WINDOWS)
-#   error "This code is supported by Windows platform!"
-#endif // !defined(XRAY_PLATFORM_WINDOWS)
-
 #include "corlib/memory/memory_st_arena_allocator.h"
-#include "memory_utility_for_arena_win32.h"
-#include "corlib/threading/interlocked.h"
+#include "memory_arena_heap.h"
 #include "corlib/sys/thread.h"
 
 //-----------------------------------------------------------------------------------------------------------
@@ -33,17 +28,14 @@ st_arena_allocator::~st_arena_allocator()
 /**
 */
 void st_arena_allocator::initialize(size_t size, size_t initial,
-    uint32_t const user_thread_id)
+    uint32_t const user_thread_id, page_kind pages)
 {
     XR_DEBUG_ASSERTION_MSG(!m_arena, "arena already initialized");
     XR_DEBUG_ASSERTION_MSG(user_thread_id != 0, "invalid owning thread id");
     m_user_thread_id = user_thread_id;
 
-    SIZE_T const sz_initial = static_cast<SIZE_T>(initial);
-    SIZE_T const sz_buffer_size = static_cast<SIZE_T>(size);
-
-    DWORD const dw_initial_flags = HEAP_NO_SERIALIZE | HEAP_GENERATE_EXCEPTIONS;
-    m_arena = HeapCreate(dw_initial_flags, sz_initial, sz_buffer_size);
+    m_arena = details::arena_heap::create(size, initial, false, pages);
+    XR_DEBUG_ASSERTION_MSG(m_arena, "failed to reserve arena");
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -52,8 +44,7 @@ void st_arena_allocator::initialize(size_t size, size_t initial,
 bool st_arena_allocator::can_allocate_block(size_t const size) const XR_NOEXCEPT
 {
     if(!m_arena) return false;
-    // TODO: check if allocating from one block
-    return true;
+    return static_cast<details::arena_heap*>(m_arena)->can_allocate(size);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -62,8 +53,7 @@ bool st_arena_allocator::can_allocate_block(size_t const size) const XR_NOEXCEPT
 size_t st_arena_allocator::total_size() const XR_NOEXCEPT
 {
     XR_DEBUG_ASSERTION_MSG(m_arena, "arena must be initialized");
-    HANDLE const heap = static_cast<HANDLE>(m_arena);
-    return (mem_usage(heap, nullptr, nullptr));
+    return static_cast<details::arena_heap*>(m_arena)->committed_size();
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -72,8 +62,16 @@ size_t st_arena_allocator::total_size() const XR_NOEXCEPT
 size_t st_arena_allocator::allocated_size() const XR_NOEXCEPT
 {
     XR_DEBUG_ASSERTION_MSG(m_arena, "arena must be initialized");
-    HANDLE const heap = static_cast<HANDLE>(m_arena);
-    return (mem_usage(heap, nullptr, nullptr));
+    return static_cast<details::arena_heap*>(m_arena)->allocated_size();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+size_t st_arena_allocator::query_large_page_size() const
+{
+    if(!m_arena) return 0;
+    return static_cast<details::arena_heap*>(m_arena)->query_large_page_size();
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -87,9 +85,7 @@ pvoid st_arena_allocator::call_malloc(size_t size
     XR_DEBUG_ASSERTION_MSG(m_user_thread_id == sys::current_thread_id(),
         "could not allocate on other thread than specified");
 
-    HANDLE const heap = static_cast<HANDLE>(m_arena);
-    pvoid const result = HeapAlloc(heap, 0, size);
-    return result;
+    return static_cast<details::arena_heap*>(m_arena)->allocate(size);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -103,10 +99,7 @@ pvoid st_arena_allocator::call_realloc(pvoid pointer, size_t new_size
     XR_DEBUG_ASSERTION_MSG(m_user_thread_id == sys::current_thread_id(),
         "could not reallocate on other thread than specified");
 
-    HANDLE const heap = static_cast<HANDLE>(m_arena);
-    if(!pointer) return HeapAlloc(heap, 0, new_size);
-    pvoid const result = HeapReAlloc(heap, 0, pointer, new_size);
-    return result;
+    return static_cast<details::arena_heap*>(m_arena)->reallocate(pointer, new_size);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -119,8 +112,7 @@ void st_arena_allocator::call_free(pvoid pointer XR_DEBUG_PARAMETERS_DECLARATION
     XR_DEBUG_ASSERTION_MSG(m_user_thread_id == sys::current_thread_id(),
         "could not free on other thread than specified");
 
-    HANDLE const heap = static_cast<HANDLE>(m_arena);
-    HeapFree(heap, 0, pointer);
+    static_cast<details::arena_heap*>(m_arena)->free(pointer);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -128,9 +120,8 @@ void st_arena_allocator::call_free(pvoid pointer XR_DEBUG_PARAMETERS_DECLARATION
 */
 void st_arena_allocator::finalize()
 {
-    XR_DEBUG_ASSERTION_MSG(m_arena, "arena must be initialized before finishing");
-    XR_DEBUG_ASSERTION(m_user_thread_id != 0);
-    HeapDestroy(m_arena);
+    details::arena_heap::destroy(static_cast<details::arena_heap*>(m_arena));
+    m_arena = nullptr;
 }
 
 XR_NAMESPACE_END(xr, memory)
@@ -0,0 +1,673 @@
+// This file is a part of xray-ng engine
+//
+
+#include "corlib/memory/memory_thread_caching_allocator.h"
+#include "corlib/memory/allocator_macro.h"
+#include "corlib/threading/interlocked.h"
+#include "corlib/threading/scoped_lock.h"
+#include "corlib/utils/aligning.h"
+#include "EASTL/algorithm.h"
+#include <string.h> // for memset, memcpy
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, memory)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace details
+{
+
+constexpr size_t slab_shift = 16;
+constexpr size_t slab_size = size_t(1) << slab_shift;
+constexpr size_t slab_header_size = 128;
+//! slabs requested from backing allocator at once
+constexpr size_t slabs_per_chunk = 16;
+
+//! 16 bytes steps up to 128, then 4 classes per power of two
+constexpr uint32_t size_classes[] =
+{
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256, 320, 384, 448, 512,
+    640, 768, 896, 1024, 1280, 1536, 1792, 2048,
+    2560, 3072, 3584, 4096
+};
+
+constexpr uint32_t size_classes_count = static_cast<uint32_t>(sizeof(size_classes) / sizeof(size_classes[0]));
+static_assert(size_classes[size_classes_count - 1] == thread_caching_allocator::max_small_size,
+    "Last size class must match max_small_size");
+
+//-----------------------------------------------------------------------------------------------------------
+// Size class for every 16 bytes step of requested size
+struct size_class_lookup
+{
+    uint8_t classes[thread_caching_allocator::max_small_size / 16 + 1];
+
+    constexpr size_class_lookup()
+        : classes {}
+    {
+        uint32_t size_class = 0;
+        for(uint32_t i = 0; i <= thread_caching_allocator::max_small_size / 16; ++i)
+        {
+            while(size_classes[size_class] < i * 16)
+                ++size_class;
+
+            classes[i] = static_cast<uint8_t>(size_class);
+        }
+    }
+}; // struct size_class_lookup
+
+constexpr size_class_lookup size_class_table {};
+
+//! slab map covers 47 bits of user address space: top level per 4Gb, bit per slab in leaf
+constexpr size_t slab_map_leaf_shift = 32;
+constexpr size_t slab_map_top_count = size_t(1) << (47 - slab_map_leaf_shift);
+constexpr size_t slab_map_leaf_words = (size_t(1) << (slab_map_leaf_shift - slab_shift)) / 64;
+
+//-----------------------------------------------------------------------------------------------------------
+// Prefix of blocks served by backing allocator, keeps 16 bytes alignment
+struct large_header
+{
+    size_t size;
+    size_t reserved;
+}; // struct large_header
+
+//-----------------------------------------------------------------------------------------------------------
+// Placed at the beginning of every slab, objects follow it
+struct slab_header
+{
+    //! links in partial or full list of owner
+    slab_header* next;
+    slab_header* prev;
+    thread_cache* owner;
+
+    //! owner-only list of free objects
+    pvoid local_free;
+    //! objects that were never used start here
+    uint8_t* bump;
+    uint8_t* end;
+
+    uint32_t size_class;
+    uint32_t object_size;
+    //! handed out objects not yet returned to owner
+    uint32_t used_count;
+    uint32_t is_full;
+
+    //! objects freed by other threads, pushed with CAS and taken all at once by owner
+    pvoid volatile remote_free;
+}; // struct slab_header
+
+static_assert(sizeof(slab_header) <= slab_header_size, "Slab header doesn't fit");
+
+//-----------------------------------------------------------------------------------------------------------
+struct thread_cache
+{
+    //! slabs with free objects, head is allocated from
+    slab_header* partial[size_classes_count];
+    //! slabs without free objects, checked again only after remote frees
+    slab_header* full[size_classes_count];
+    //! remote frees since owner has looked at full slabs
+    threading::atomic_uint32 remote_frees[size_classes_count];
+    //! bytes allocated minus bytes freed through this cache, sum over caches is exact
+    threading::atomic_size_t allocated_bytes;
+
+    // prevent false cache sharing between threads
+    uint8_t cacheline[64];
+}; // struct thread_cache
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+push_slab(slab_header*& head, slab_header* slab)
+{
+    slab->prev = nullptr;
+    slab->next = head;
+    if(head)
+        head->prev = slab;
+    head = slab;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+remove_slab(slab_header*& head, slab_header* slab)
+{
+    if(slab->prev)
+        slab->prev->next = slab->next;
+    else
+        head = slab->next;
+
+    if(slab->next)
+        slab->next->prev = slab->prev;
+
+    slab->next = nullptr;
+    slab->prev = nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline slab_header*
+slab_from_pointer(pvoid pointer)
+{
+    return reinterpret_cast<slab_header*>(utils::align_down(reinterpret_cast<uintptr_t>(pointer), slab_size));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Moves objects freed by other threads to local free list. Returns how many were moved.
+ */
+inline uint32_t
+collect_remote_frees(slab_header* slab)
+{
+    if(!threading::atomic_fetch_relax(slab->remote_free))
+        return 0;
+
+    pvoid list = threading::atomic_fetch_store_seq<pvoid>(slab->remote_free, nullptr);
+    uint32_t count = 0;
+    while(list)
+    {
+        pvoid next = *reinterpret_cast<pvoid*>(list);
+        *reinterpret_cast<pvoid*>(list) = slab->local_free;
+        slab->local_free = list;
+        list = next;
+        ++count;
+    }
+
+    slab->used_count -= count;
+    return count;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline pvoid
+pop_object(slab_header* slab)
+{
+    pvoid block = slab->local_free;
+    if(!block && slab->bump == slab->end && collect_remote_frees(slab))
+        block = slab->local_free;
+
+    if(block)
+    {
+        slab->local_free = *reinterpret_cast<pvoid*>(block);
+    }
+    else
+    {
+        if(slab->bump == slab->end)
+            return nullptr;
+
+        block = slab->bump;
+        slab->bump += slab->object_size;
+    }
+
+    ++slab->used_count;
+    return block;
+}
+
+} // namespace details
+//-----------------------------------------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+thread_caching_allocator::~thread_caching_allocator()
+{
+    finalize();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void thread_caching_allocator::initialize(base_allocator& backing)
+{
+    XR_DEBUG_ASSERTION_MSG(!m_backing, "allocator already initialized");
+
+    m_backing = &backing;
+    m_tls = sys::create_thread_local();
+    XR_DEBUG_ASSERTION_MSG(m_tls != sys::invalid_thread_local_storage, "out of thread-local storage");
+
+    size_t caches_size = sizeof(details::thread_cache) * (max_thread_caches + 1);
+    m_caches = reinterpret_cast<details::thread_cache*>(
+        XR_ALLOCATE_MEMORY(backing, caches_size, "thread caches"));
+    memset(m_caches, 0, caches_size);
+
+    size_t slab_map_size = sizeof(uint64_t*) * details::slab_map_top_count;
+    m_slab_map = reinterpret_cast<uint64_t* volatile*>(
+        XR_ALLOCATE_MEMORY(backing, slab_map_size, "slab map"));
+    memset(const_cast<uint64_t**>(m_slab_map), 0, slab_map_size);
+
+    m_backing_size = caches_size + slab_map_size;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool thread_caching_allocator::can_allocate_block(size_t const size) const XR_NOEXCEPT
+{
+    if(!m_backing)
+        return false;
+
+    return (size <= max_small_size) || m_backing->can_allocate_block(size + sizeof(details::large_header));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t thread_caching_allocator::total_size() const XR_NOEXCEPT
+{
+    return threading::atomic_fetch_relax(m_backing_size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t thread_caching_allocator::allocated_size() const XR_NOEXCEPT
+{
+    if(!m_caches)
+        return 0;
+
+    size_t allocated = threading::atomic_fetch_relax(m_large_allocated_size);
+    for(uint32_t i = 0; i <= max_thread_caches; ++i)
+        allocated += threading::atomic_fetch_relax(m_caches[i].allocated_bytes);
+
+    return allocated;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+pvoid thread_caching_allocator::call_malloc(size_t size
+    XR_DEBUG_PARAMETERS_DESCRIPTION_DECLARATION XR_DEBUG_PARAMETERS_DECLARATION)
+{
+    XR_DEBUG_PARAMETERS_UNREFERENCED_GUARD;
+    XR_DEBUG_ASSERTION_MSG(m_backing, "allocator must be initialized before malloc");
+
+    if(size > max_small_size)
+        return allocate_large(size);
+
+    uint32_t size_class = details::size_class_table.classes[(size + 15) >> 4];
+    details::thread_cache& cache = *get_thread_cache();
+    if(&cache != &m_caches[max_thread_caches])
+        return allocate_small(cache, size_class);
+
+    threading::scoped_lock lock { m_shared_cache_lock };
+    return allocate_small(cache, size_class);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+pvoid thread_caching_allocator::call_realloc(pvoid pointer, size_t new_size
+    XR_DEBUG_PARAMETERS_DESCRIPTION_DECLARATION XR_DEBUG_PARAMETERS_DECLARATION)
+{
+    if(!pointer)
+        return call_malloc(new_size XR_DEBUG_PARAMETERS_DESCRIPTION XR_DEBUG_PARAMETERS);
+
+    size_t old_size = 0;
+    if(is_small_block(pointer))
+    {
+        details::slab_header* slab = details::slab_from_pointer(pointer);
+        old_size = slab->object_size;
+
+        // same size class, nothing to do
+        if(new_size <= max_small_size && details::size_class_table.classes[(new_size + 15) >> 4] == slab->size_class)
+            return pointer;
+    }
+    else
+    {
+        if(new_size > max_small_size)
+            return reallocate_large(pointer, new_size);
+
+        old_size = (reinterpret_cast<details::large_header*>(pointer) - 1)->size;
+    }
+
+    pvoid block = call_malloc(new_size XR_DEBUG_PARAMETERS_DESCRIPTION XR_DEBUG_PARAMETERS);
+    if(!block)
+        return nullptr;
+
+    memcpy(block, pointer, eastl::min(old_size, new_size));
+    call_free(pointer XR_DEBUG_PARAMETERS);
+    return block;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void thread_caching_allocator::call_free(pvoid pointer XR_DEBUG_PARAMETERS_DECLARATION)
+{
+    XR_DEBUG_PARAMETERS_UNREFERENCED_GUARD;
+    XR_DEBUG_ASSERTION_MSG(m_backing, "allocator must be initialized before freeing");
+
+    if(!pointer)
+        return;
+
+    if(!is_small_block(pointer))
+    {
+        free_large(pointer);
+        return;
+    }
+
+    details::slab_header* slab = details::slab_from_pointer(pointer);
+    details::thread_cache& cache = *get_thread_cache();
+    if(&cache != &m_caches[max_thread_caches])
+    {
+        free_small(cache, slab, pointer);
+        return;
+    }
+
+    threading::scoped_lock lock { m_shared_cache_lock };
+    free_small(cache, slab, pointer);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void thread_caching_allocator::finalize()
+{
+    if(!m_backing)
+        return;
+
+    for(uint32_t i = 0; i < m_chunks_count; ++i)
+        XR_DEALLOCATE_MEMORY(*m_backing, m_chunks[i]);
+
+    for(size_t i = 0; i < details::slab_map_top_count; ++i)
+    {
+        if(m_slab_map[i])
+            XR_DEALLOCATE_MEMORY(*m_backing, m_slab_map[i]);
+    }
+
+    XR_DEALLOCATE_MEMORY(*m_backing, const_cast<uint64_t**>(m_slab_map));
+    XR_DEALLOCATE_MEMORY(*m_backing, m_caches);
+    sys::destroy_thread_local(m_tls);
+
+    m_chunks_count = 0;
+    m_free_slabs = nullptr;
+    m_slab_map = nullptr;
+    m_caches = nullptr;
+    m_tls = sys::invalid_thread_local_storage;
+    m_backing = nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Threads get private caches while there are free ones, others share the last cache.
+ */
+details::thread_cache* thread_caching_allocator::get_thread_cache()
+{
+    details::thread_cache* cache = sys::get_tls_typed_data<details::thread_cache>(m_tls);
+    if(cache)
+        return cache;
+
+    uint32_t index = threading::atomic_fetch_then_inc_seq(m_caches_count);
+    cache = &m_caches[eastl::min(index, max_thread_caches)];
+    sys::set_tls_data(m_tls, cache);
+    return cache;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool thread_caching_allocator::is_small_block(pvoid pointer) const
+{
+    uint64_t address = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pointer));
+    size_t top_index = static_cast<size_t>(address >> details::slab_map_leaf_shift);
+    if(top_index >= details::slab_map_top_count)
+        return false;
+
+    const uint64_t* leaf = threading::atomic_fetch_acq(m_slab_map[top_index]);
+    if(!leaf)
+        return false;
+
+    size_t slab_index = static_cast<size_t>(address >> details::slab_shift) &
+        (details::slab_map_leaf_words * 64 - 1);
+    return (leaf[slab_index >> 6] >> (slab_index & 63)) & 1;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+pvoid thread_caching_allocator::allocate_small(details::thread_cache& cache, uint32_t size_class)
+{
+    pvoid block = nullptr;
+    for(details::slab_header* slab = cache.partial[size_class]; slab && !block; slab = cache.partial[size_class])
+    {
+        block = details::pop_object(slab);
+        if(!block)
+        {
+            details::remove_slab(cache.partial[size_class], slab);
+            details::push_slab(cache.full[size_class], slab);
+            slab->is_full = 1;
+        }
+    }
+
+    // full slabs are looked at again only if other threads have returned something to them
+    if(!block && threading::atomic_fetch_relax(cache.remote_frees[size_class]))
+    {
+        threading::atomic_fetch_store_seq<uint32_t>(cache.remote_frees[size_class], 0);
+
+        details::slab_header* slab = cache.full[size_class];
+        while(slab)
+        {
+            details::slab_header* next = slab->next;
+            if(details::collect_remote_frees(slab))
+            {
+                details::remove_slab(cache.full[size_class], slab);
+                slab->is_full = 0;
+
+                if(slab->used_count == 0 && cache.partial[size_class])
+                    release_slab(slab);
+                else
+                    details::push_slab(cache.partial[size_class], slab);
+            }
+            slab = next;
+        }
+
+        if(cache.partial[size_class])
+            block = details::pop_object(cache.partial[size_class]);
+    }
+
+    if(!block)
+    {
+        details::slab_header* slab = acquire_slab(cache, size_class);
+        if(!slab)
+            return nullptr;
+
+        details::push_slab(cache.partial[size_class], slab);
+        block = details::pop_object(slab);
+    }
+
+    threading::atomic_store_relax(cache.allocated_bytes,
+        threading::atomic_fetch_relax(cache.allocated_bytes) + details::size_classes[size_class]);
+    return block;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void thread_caching_allocator::free_small(details::thread_cache& cache, details::slab_header* slab, pvoid pointer)
+{
+    uint32_t size_class = slab->size_class;
+    details::thread_cache* owner = slab->owner;
+
+    threading::atomic_store_relax(cache.allocated_bytes,
+        threading::atomic_fetch_relax(cache.allocated_bytes) - details::size_classes[size_class]);
+
+    if(owner != &cache)
+    {
+        // slab may be collected and reused as soon as object is pushed, so it is not touched after that
+        pvoid head = nullptr;
+        do
+        {
+            head = threading::atomic_fetch_acq(slab->remote_free);
+            *reinterpret_cast<pvoid*>(pointer) = head;
+        }
+        while(!threading::atomic_bcas_seq<pvoid>(slab->remote_free, pointer, head));
+
+        threading::atomic_fetch_inc_seq(owner->remote_frees[size_class]);
+        return;
+    }
+
+    *reinterpret_cast<pvoid*>(pointer) = slab->local_free;
+    slab->local_free = pointer;
+    --slab->used_count;
+
+    if(slab->is_full)
+    {
+        details::remove_slab(cache.full[size_class], slab);
+        details::push_slab(cache.partial[size_class], slab);
+        slab->is_full = 0;
+    }
+
+    // slab at the head of partial list is kept, so alloc/free pairs don't bounce slabs
+    if(slab->used_count == 0 && slab != cache.partial[size_class])
+    {
+        details::remove_slab(cache.partial[size_class], slab);
+        release_slab(slab);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+pvoid thread_caching_allocator::allocate_large(size_t size)
+{
+    size_t block_size = size + sizeof(details::large_header);
+    details::large_header* header = reinterpret_cast<details::large_header*>(
+        XR_ALLOCATE_MEMORY(*m_backing, block_size, "large block"));
+
+    if(!header)
+        return nullptr;
+
+    header->size = size;
+    threading::atomic_fetch_add_seq(m_large_allocated_size, size);
+    threading::atomic_fetch_add_seq(m_backing_size, block_size);
+    return header + 1;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+pvoid thread_caching_allocator::reallocate_large(pvoid pointer, size_t new_size)
+{
+    details::large_header* header = reinterpret_cast<details::large_header*>(pointer) - 1;
+    size_t old_size = header->size;
+
+    header = reinterpret_cast<details::large_header*>(XR_REALLOCATE_MEMORY(*m_backing,
+        header, new_size + sizeof(details::large_header), "large block"));
+
+    if(!header)
+        return nullptr;
+
+    header->size = new_size;
+    threading::atomic_fetch_add_seq(m_large_allocated_size, new_size - old_size);
+    threading::atomic_fetch_add_seq(m_backing_size, new_size - old_size);
+    return header + 1;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void thread_caching_allocator::free_large(pvoid pointer)
+{
+    details::large_header* header = reinterpret_cast<details::large_header*>(pointer) - 1;
+    threading::atomic_fetch_add_seq(m_large_allocated_size, size_t(0) - header->size);
+    threading::atomic_fetch_add_seq(m_backing_size, size_t(0) - header->size - sizeof(details::large_header));
+    XR_DEALLOCATE_MEMORY(*m_backing, header);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+details::slab_header* thread_caching_allocator::acquire_slab(details::thread_cache& cache, uint32_t size_class)
+{
+    details::slab_header* slab = nullptr;
+    {
+        threading::scoped_lock lock { m_slabs_lock };
+        if(!m_free_slabs && !refill_slabs())
+            return nullptr;
+
+        slab = m_free_slabs;
+        m_free_slabs = slab->next;
+    }
+
+    uint32_t object_size = details::size_classes[size_class];
+    size_t objects_count = (details::slab_size - details::slab_header_size) / object_size;
+
+    slab->next = nullptr;
+    slab->prev = nullptr;
+    slab->owner = &cache;
+    slab->local_free = nullptr;
+    slab->bump = reinterpret_cast<uint8_t*>(slab) + details::slab_header_size;
+    slab->end = slab->bump + objects_count * object_size;
+    slab->size_class = size_class;
+    slab->object_size = object_size;
+    slab->used_count = 0;
+    slab->is_full = 0;
+    threading::atomic_store_rel<pvoid>(slab->remote_free, nullptr);
+    return slab;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void thread_caching_allocator::release_slab(details::slab_header* slab)
+{
+    threading::scoped_lock lock { m_slabs_lock };
+    slab->next = m_free_slabs;
+    m_free_slabs = slab;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Takes chunk of slabs from backing allocator, called under slabs lock.
+ */
+bool thread_caching_allocator::refill_slabs()
+{
+    if(m_chunks_count == max_chunks_count)
+        return false;
+
+    size_t chunk_size = details::slabs_per_chunk * details::slab_size + details::slab_size;
+    pvoid chunk = XR_ALLOCATE_MEMORY(*m_backing, chunk_size, "slab chunk");
+    if(!chunk)
+        return false;
+
+    m_chunks[m_chunks_count++] = chunk;
+    threading::atomic_fetch_add_seq(m_backing_size, chunk_size);
+
+    uint8_t* first_slab = utils::align_up(reinterpret_cast<uint8_t*>(chunk), details::slab_size);
+    for(size_t i = 0; i < details::slabs_per_chunk; ++i)
+    {
+        uint8_t* slab_memory = first_slab + i * details::slab_size;
+        uint64_t address = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(slab_memory));
+        size_t top_index = static_cast<size_t>(address >> details::slab_map_leaf_shift);
+        XR_DEBUG_ASSERTION_MSG(top_index < details::slab_map_top_count, "Address is out of slab map");
+
+        uint64_t* leaf = m_slab_map[top_index];
+        if(!leaf)
+        {
+            size_t leaf_size = sizeof(uint64_t) * details::slab_map_leaf_words;
+            leaf = reinterpret_cast<uint64_t*>(XR_ALLOCATE_MEMORY(*m_backing, leaf_size, "slab map leaf"));
+            if(!leaf)
+                return false;
+
+            memset(leaf, 0, leaf_size);
+            threading::atomic_fetch_add_seq(m_backing_size, leaf_size);
+            threading::atomic_store_rel(m_slab_map[top_index], leaf);
+        }
+
+        size_t slab_index = static_cast<size_t>(address >> details::slab_shift) &
+            (details::slab_map_leaf_words * 64 - 1);
+        volatile uint64_t& word = leaf[slab_index >> 6];
+        threading::atomic_store_rel(word, word | (uint64_t(1) << (slab_index & 63)));
+
+        details::slab_header* slab = reinterpret_cast<details::slab_header*>(slab_memory);
+        slab->next = m_free_slabs;
+        m_free_slabs = slab;
+    }
+
+    return true;
+}
+
+XR_NAMESPACE_END(xr, memory)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,44 @@
+// This file is a part of xray-ng engine
+//
+
+#if !defined(XRAY_PLATFORM_LINUX)
+#   error "This code is supported by Linux platform!"
+#endif // !defined(XRAY_PLATFORM_LINUX)
+
+#include "corlib/sys/chrono.h"
+#include <time.h>
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, sys)
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline uint64_t monotonic_time(uint64_t units_per_second)
+{
+    timespec ts;
+    int rval = clock_gettime(CLOCK_MONOTONIC, &ts);
+    XR_UNREFERENCED_PARAMETER(rval);
+    XR_DEBUG_ASSERTION_MSG(rval == 0, "clock_gettime failed");
+    return static_cast<uint64_t>(ts.tv_sec) * units_per_second +
+        static_cast<uint64_t>(ts.tv_nsec) / (uint64_t(1000000000) / units_per_second);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+tick now_milliseconds()
+{
+    return monotonic_time(1000);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+tick now_microseconds()
+{
+    return monotonic_time(1000000);
+}
+
+XR_NAMESPACE_END(xr, sys)
+//-----------------------------------------------------------------------------------------------------------
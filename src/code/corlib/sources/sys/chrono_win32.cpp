@@ -12,9 +12,25 @@ XR_NAMESPACE_BEGIN(xr, sys)
  */
 inline uint64_t get_frequency()
 {
-    LARGE_INTEGER frequency;
-    QueryPerformanceFrequency(&frequency);
-    return frequency.QuadPart;
+    static const uint64_t frequency = []()
+    {
+        LARGE_INTEGER value;
+        QueryPerformanceFrequency(&value);
+        return static_cast<uint64_t>(value.QuadPart);
+    }();
+    return frequency;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Converts counter to given units without overflowing on long uptimes.
+ */
+inline uint64_t counter_to_units(uint64_t counter, uint64_t units_per_second)
+{
+    uint64_t frequency = get_frequency();
+    uint64_t seconds = counter / frequency;
+    uint64_t remainder = counter % frequency;
+    return seconds * units_per_second + (remainder * units_per_second) / frequency;
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -25,7 +41,7 @@ tick now_milliseconds()
     LARGE_INTEGER qpcnt;
     int rval = QueryPerformanceCounter(&qpcnt);
     XR_DEBUG_ASSERTION_MSG(rval, "QueryPerformanceCounter failed");
-    return (qpcnt.QuadPart * uint64_t(1000)) / get_frequency();
+    return counter_to_units(qpcnt.QuadPart, 1000);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -36,7 +52,7 @@ tick now_microseconds()
     LARGE_INTEGER qpcnt;
     int rval = QueryPerformanceCounter(&qpcnt);
     XR_DEBUG_ASSERTION_MSG(rval, "QueryPerformanceCounter failed");
-    return (qpcnt.QuadPart * uint64_t(1000000)) / get_frequency();
+    return counter_to_units(qpcnt.QuadPart, 1000000);
 }
 
 XR_NAMESPACE_END(xr, sys)
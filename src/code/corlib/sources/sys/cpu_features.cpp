@@ -0,0 +1,151 @@
+// This file is a part of xray-ng engine
+//
+
+#include "corlib/sys/cpu_features.h"
+
+#if XR_MSVC_COMPILER_FAMILY
+#   include <intrin.h>
+#else
+#   include <cpuid.h>
+#endif // XR_MSVC_COMPILER_FAMILY
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, sys)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+//-----------------------------------------------------------------------------------------------------------
+struct cpuid_registers
+{
+    uint32_t eax;
+    uint32_t ebx;
+    uint32_t ecx;
+    uint32_t edx;
+}; // struct cpuid_registers
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline cpuid_registers
+read_cpuid(uint32_t leaf, uint32_t subleaf)
+{
+    cpuid_registers registers {};
+#if XR_MSVC_COMPILER_FAMILY
+    int values[4];
+    __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+    registers.eax = static_cast<uint32_t>(values[0]);
+    registers.ebx = static_cast<uint32_t>(values[1]);
+    registers.ecx = static_cast<uint32_t>(values[2]);
+    registers.edx = static_cast<uint32_t>(values[3]);
+#else
+    __cpuid_count(leaf, subleaf, registers.eax, registers.ebx, registers.ecx, registers.edx);
+#endif // XR_MSVC_COMPILER_FAMILY
+    return registers;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Register state components enabled by operating system, see XCR0.
+ */
+inline uint64_t
+read_enabled_xstate()
+{
+#if XR_MSVC_COMPILER_FAMILY
+    return _xgetbv(0);
+#else
+    uint32_t low, high;
+    __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return (static_cast<uint64_t>(high) << 32) | low;
+#endif // XR_MSVC_COMPILER_FAMILY
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Deterministic cache parameters of leaf 4, the largest level wins.
+ */
+inline size_t
+read_llc_size(uint32_t max_leaf)
+{
+    if(max_leaf < 4)
+        return 0;
+
+    size_t llc_size = 0;
+    uint32_t llc_level = 0;
+    for(uint32_t subleaf = 0; subleaf < 16; ++subleaf)
+    {
+        cpuid_registers cache = read_cpuid(4, subleaf);
+        uint32_t type = cache.eax & 0x1f;
+        if(type == 0)
+            break;
+
+        // data or unified caches only
+        uint32_t level = (cache.eax >> 5) & 0x7;
+        if(type == 2 || level < llc_level)
+            continue;
+
+        size_t ways = ((cache.ebx >> 22) & 0x3ff) + 1;
+        size_t partitions = ((cache.ebx >> 12) & 0x3ff) + 1;
+        size_t line_size = (cache.ebx & 0xfff) + 1;
+        size_t sets = static_cast<size_t>(cache.ecx) + 1;
+
+        llc_level = level;
+        llc_size = ways * partitions * line_size * sets;
+    }
+
+    return llc_size;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+cpu_features
+read_cpu_features()
+{
+    cpu_features features {};
+
+    uint32_t max_leaf = read_cpuid(0, 0).eax;
+    if(max_leaf < 1)
+        return features;
+
+    cpuid_registers basic = read_cpuid(1, 0);
+    features.sse2 = (basic.edx & (1u << 26)) != 0;
+    features.sse41 = (basic.ecx & (1u << 19)) != 0;
+
+    bool has_osxsave = (basic.ecx & (1u << 27)) != 0;
+    uint64_t xstate = has_osxsave ? read_enabled_xstate() : 0;
+    // sse and avx state
+    bool ymm_enabled = (xstate & 0x6) == 0x6;
+    // opmask, upper halves of zmm0-15 and zmm16-31
+    bool zmm_enabled = ymm_enabled && (xstate & 0xe0) == 0xe0;
+
+    features.avx = ymm_enabled && (basic.ecx & (1u << 28)) != 0;
+
+    if(max_leaf >= 7)
+    {
+        cpuid_registers extended = read_cpuid(7, 0);
+        features.avx2 = features.avx && (extended.ebx & (1u << 5)) != 0;
+        features.avx512f = zmm_enabled && (extended.ebx & (1u << 16)) != 0;
+        features.avx512bw = features.avx512f && (extended.ebx & (1u << 30)) != 0;
+        features.erms = (extended.ebx & (1u << 9)) != 0;
+        features.fsrm = (extended.edx & (1u << 4)) != 0;
+    }
+
+    features.llc_size = read_llc_size(max_leaf);
+    return features;
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+const cpu_features& query_cpu_features()
+{
+    static const cpu_features features = read_cpu_features();
+    return features;
+}
+
+XR_NAMESPACE_END(xr, sys)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,298 @@
+// This file is a part of xray-ng engine
+//
+
+#if !defined(XRAY_PLATFORM_LINUX)
+#   error "This code is supported by Linux platform!"
+#endif // !defined(XRAY_PLATFORM_LINUX)
+
+#include "corlib/sys/thread.h"
+#include "corlib/memory/allocator_helper.h"
+#include "corlib/threading/interlocked.h"
+#include "EASTL/algorithm.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, sys)
+
+//-----------------------------------------------------------------------------------------------------------
+struct posix_thread
+{
+    pthread_t thread;
+    thread_function function;
+    pvoid arg;
+    thread_priority priority;
+    //! pthread names are limited to 15 characters
+    char name[16];
+    //! handle and running thread, the last one to let go frees the memory
+    threading::atomic_uint32 references;
+    //! joined thread must be neither joined nor detached again
+    bool joined;
+}; // struct posix_thread
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void release_posix_thread(posix_thread* thread)
+{
+    if(threading::atomic_dec_fetch_seq(thread->references) == 0)
+    {
+        memory::call_destruct(thread);
+        free(thread);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Niceness applies to calling thread only. Raising priority needs privileges, failure leaves the
+ *  default one.
+ */
+void apply_thread_priority(thread_priority priority)
+{
+    int nice_value = 0;
+    switch(priority)
+    {
+        case thread_priority::low:
+            nice_value = 10;
+            break;
+
+        case thread_priority::medium:
+            return;
+
+        case thread_priority::high:
+            nice_value = -5;
+            break;
+    };
+
+    (void)setpriority(PRIO_PROCESS, static_cast<id_t>(current_thread_id()), nice_value);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void* thread_main(void* arg)
+{
+    posix_thread* thread = reinterpret_cast<posix_thread*>(arg);
+    thread_function function = thread->function;
+    pvoid function_arg = thread->arg;
+
+    (void)pthread_setname_np(pthread_self(), thread->name);
+    apply_thread_priority(thread->priority);
+    release_posix_thread(thread);
+
+    uint32_t const result = function(function_arg);
+    return reinterpret_cast<void*>(static_cast<uintptr_t>(result));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool join_posix_thread(posix_thread* thread, const timespec* deadline)
+{
+    if(thread->joined)
+        return true;
+
+    int const result = deadline ?
+        pthread_timedjoin_np(thread->thread, nullptr, deadline) :
+        pthread_join(thread->thread, nullptr);
+
+    thread->joined = (result == 0);
+    return thread->joined;
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Stack size is a reservation, pages are committed by kernel when touched.
+ */
+thread_handle spawn_thread(thread_function function, void* const arg,
+    utils::wstring_view debug_thread_name, thread_priority priority,
+    size_t stack_size, eastl::optional<uint32_t> hardware_thread)
+{
+    XR_DEBUG_ASSERTION_MSG(stack_size, "Stack size must be set for thread");
+
+    posix_thread* thread = reinterpret_cast<posix_thread*>(malloc(sizeof(posix_thread)));
+    if(!thread)
+        return unknown_thread_handle;
+
+    memory::call_emplace_construct(thread);
+    thread->function = function;
+    thread->arg = arg;
+    thread->priority = priority;
+    thread->references = 2;
+    thread->joined = false;
+
+    // names are ASCII, other characters are replaced
+    size_t const name_length = eastl::min(debug_thread_name.size(), sizeof(thread->name) - 1);
+    for(size_t i = 0; i < name_length; ++i)
+    {
+        wchar_t const c = debug_thread_name[i];
+        thread->name[i] = (c > 0 && c < 128) ? static_cast<char>(c) : '?';
+    }
+    thread->name[name_length] = '\0';
+
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, eastl::max(stack_size, size_t(PTHREAD_STACK_MIN)));
+
+    if(hardware_thread.has_value())
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(hardware_thread.value(), &cpus);
+        (void)pthread_attr_setaffinity_np(&attributes, sizeof(cpus), &cpus);
+    }
+
+    int const result = pthread_create(&thread->thread, &attributes, thread_main, thread);
+    pthread_attr_destroy(&attributes);
+
+    XR_DEBUG_ASSERTION_MSG(result == 0, "Can't create thread");
+    if(result != 0)
+    {
+        memory::call_destruct(thread);
+        free(thread);
+        return unknown_thread_handle;
+    }
+
+    return thread;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Processors the process may run on, not all processors of the system.
+ */
+uint32_t core_count()
+{
+    cpu_set_t cpus;
+    if(sched_getaffinity(0, sizeof(cpus), &cpus) == 0)
+        return static_cast<uint32_t>(CPU_COUNT(&cpus));
+
+    long const count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? static_cast<uint32_t>(count) : 1;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Kernel thread id, cached because queues compare it on every push and pop.
+ */
+thread_id current_thread_id()
+{
+    static thread_local thread_id id = static_cast<thread_id>(syscall(SYS_gettid));
+    return id;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Linux has no processor groups, every processor is in the first one.
+ */
+uint32_t current_thread_affinity()
+{
+    return 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void yield(eastl::optional<sys::tick> timeout)
+{
+    if(!timeout.has_value())
+    {
+        sched_yield();
+        return;
+    }
+
+    uint64_t const t = timeout.value();
+    timespec duration;
+    duration.tv_sec = static_cast<time_t>(t / 1000);
+    duration.tv_nsec = static_cast<long>((t % 1000) * 1000000);
+
+    // like alertable sleep of Win32, signal may end it early
+    (void)nanosleep(&duration, nullptr);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Threads are joined, their handles still have to be detached. Waiting for any thread polls them,
+ *  because pthread can only wait for one.
+ */
+signalling_bool wait_threads(thread_handle const* threads,
+    size_t const threads_count, bool const wait_all_threads,
+    eastl::optional<sys::tick> timeout)
+{
+    XR_DEBUG_ASSERTION_MSG(threads || !threads_count, "Invalid threads passed!");
+
+    // timed join takes absolute time of realtime clock
+    timespec deadline {};
+    if(timeout.has_value())
+    {
+        uint64_t const t = timeout.value();
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += static_cast<time_t>(t / 1000);
+        deadline.tv_nsec += static_cast<long>((t % 1000) * 1000000);
+        if(deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    if(wait_all_threads)
+    {
+        for(size_t i = 0; i < threads_count; ++i)
+        {
+            if(!join_posix_thread(threads[i], timeout.has_value() ? &deadline : nullptr))
+                return false;
+        }
+
+        return true;
+    }
+
+    tick const start_ms = now_milliseconds();
+    for(;;)
+    {
+        for(size_t i = 0; i < threads_count; ++i)
+        {
+            posix_thread* thread = threads[i];
+            if(thread->joined)
+                return true;
+
+            if(pthread_tryjoin_np(thread->thread, nullptr) == 0)
+            {
+                thread->joined = true;
+                return true;
+            }
+        }
+
+        if(timeout.has_value() && now_milliseconds() - start_ms >= timeout.value())
+            return false;
+
+        yield(1);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Thread that was not joined keeps running on its own.
+ */
+void detach_thread(thread_handle thread)
+{
+    XR_DEBUG_ASSERTION(thread != unknown_thread_handle);
+
+    if(!thread->joined)
+        (void)pthread_detach(thread->thread);
+
+    release_posix_thread(thread);
+}
+
+XR_NAMESPACE_END(xr, sys)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,62 @@
+// This file is a part of xray-ng engine
+//
+
+#if !defined(XRAY_PLATFORM_LINUX)
+#   error "This code is supported by Linux platform!"
+#endif // !defined(XRAY_PLATFORM_LINUX)
+
+#include "corlib/sys/tls.h"
+#include <pthread.h>
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, sys)
+
+static_assert(sizeof(pthread_key_t) <= sizeof(tls_handle), "pthread key doesn't fit into handle");
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+tls_handle create_thread_local()
+{
+    pthread_key_t key;
+    if(pthread_key_create(&key, nullptr) != 0)
+        return static_cast<tls_handle>(invalid_thread_local_storage);
+
+    return static_cast<tls_handle>(key);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+bool set_tls_data(tls_handle const tls, void* data)
+{
+    XR_DEBUG_ASSERTION_MSG(tls != invalid_thread_local_storage,
+        "Thread-local storage index cannot be invalid");
+
+    return pthread_setspecific(static_cast<pthread_key_t>(tls), data) == 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+void* get_tls_data(tls_handle const tls)
+{
+    XR_DEBUG_ASSERTION_MSG(tls != invalid_thread_local_storage,
+        "Thread-local storage index cannot be invalid");
+
+    return pthread_getspecific(static_cast<pthread_key_t>(tls));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+void destroy_thread_local(tls_handle const tls)
+{
+    XR_DEBUG_ASSERTION_MSG(tls != invalid_thread_local_storage,
+        "Thread-local storage index cannot be invalid");
+
+    pthread_key_delete(static_cast<pthread_key_t>(tls));
+}
+
+XR_NAMESPACE_END(xr, sys)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,90 @@
+// This file is a part of xray-ng engine
+//
+
+#include "corlib/sys/topology.h"
+#include "EASTL/algorithm.h"
+#include "EASTL/sort.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, sys)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Replaces raw ids of one level with dense ones in order of first appearance. Returns ids count.
+ */
+inline uint32_t
+make_dense_ids(cpu_topology& topology, uint32_t logical_processor_info::* id)
+{
+    uint32_t raw_ids[max_logical_processors];
+    uint32_t count = 0;
+
+    for(uint32_t i = 0; i < topology.processors_count; ++i)
+    {
+        uint32_t raw_id = topology.processors[i].*id;
+        uint32_t dense_id = 0;
+        while(dense_id < count && raw_ids[dense_id] != raw_id)
+            ++dense_id;
+
+        if(dense_id == count)
+            raw_ids[count++] = raw_id;
+
+        topology.processors[i].*id = dense_id;
+    }
+
+    return count;
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void make_flat_cpu_topology(cpu_topology& topology, uint32_t processors_count)
+{
+    topology.processors_count = eastl::min(processors_count, max_logical_processors);
+    for(uint32_t i = 0; i < topology.processors_count; ++i)
+    {
+        logical_processor_info& info = topology.processors[i];
+        info.hardware_thread = i;
+        info.core_id = i;
+        info.llc_id = 0;
+        info.node_id = 0;
+        info.package_id = 0;
+    }
+
+    normalize_cpu_topology(topology);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void normalize_cpu_topology(cpu_topology& topology)
+{
+    logical_processor_info* begin = topology.processors;
+    logical_processor_info* end = topology.processors + topology.processors_count;
+
+    eastl::sort(begin, end, [](const logical_processor_info& left, const logical_processor_info& right)
+    {
+        if(left.node_id != right.node_id)
+            return left.node_id < right.node_id;
+        if(left.package_id != right.package_id)
+            return left.package_id < right.package_id;
+        if(left.llc_id != right.llc_id)
+            return left.llc_id < right.llc_id;
+        if(left.core_id != right.core_id)
+            return left.core_id < right.core_id;
+        return left.hardware_thread < right.hardware_thread;
+    });
+
+    topology.cores_count = make_dense_ids(topology, &logical_processor_info::core_id);
+    topology.llc_count = make_dense_ids(topology, &logical_processor_info::llc_id);
+    topology.nodes_count = make_dense_ids(topology, &logical_processor_info::node_id);
+    topology.packages_count = make_dense_ids(topology, &logical_processor_info::package_id);
+}
+
+XR_NAMESPACE_END(xr, sys)
+//-----------------------------------------------------------------------------------------------------------
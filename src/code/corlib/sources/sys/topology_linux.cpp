@@ -0,0 +1,229 @@
+// This file is a part of xray-ng engine
+//
+
+#if !defined(XRAY_PLATFORM_LINUX)
+#   error "This code is supported by Linux platform!"
+#endif // !defined(XRAY_PLATFORM_LINUX)
+
+#include "corlib/sys/topology.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, sys)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+constexpr uint32_t invalid_id = UINT32_MAX;
+constexpr uint32_t max_cache_indices = 16;
+constexpr uint32_t max_numa_nodes = 64;
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Reads small sysfs file as zero terminated string.
+ */
+bool read_sys_file(pcstr path, char* buffer, size_t buffer_size)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return false;
+
+    ssize_t size = read(fd, buffer, buffer_size - 1);
+    close(fd);
+
+    if(size <= 0)
+        return false;
+
+    buffer[size] = 0;
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+pcstr parse_uint(pcstr str, uint32_t& value)
+{
+    value = 0;
+    while(*str >= '0' && *str <= '9')
+        value = value * 10 + static_cast<uint32_t>(*str++ - '0');
+    return str;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Calls func for every cpu of list formatted like "0-3,8,10-11".
+ */
+template<typename TFunc>
+void for_each_in_cpu_list(pcstr str, TFunc func)
+{
+    while(*str >= '0' && *str <= '9')
+    {
+        uint32_t first = 0;
+        str = parse_uint(str, first);
+
+        uint32_t last = first;
+        if(*str == '-')
+            str = parse_uint(str + 1, last);
+
+        for(uint32_t cpu = first; cpu <= last; ++cpu)
+            func(cpu);
+
+        if(*str != ',')
+            break;
+
+        ++str;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+uint32_t read_uint(pcstr path, uint32_t default_value)
+{
+    char buffer[32];
+    if(!read_sys_file(path, buffer, sizeof(buffer)) || buffer[0] < '0' || buffer[0] > '9')
+        return default_value;
+
+    uint32_t value = 0;
+    parse_uint(buffer, value);
+    return value;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+uint32_t read_first_in_cpu_list(pcstr path, uint32_t default_value)
+{
+    char buffer[1024];
+    if(!read_sys_file(path, buffer, sizeof(buffer)))
+        return default_value;
+
+    uint32_t first = invalid_id;
+    for_each_in_cpu_list(buffer, [&first](uint32_t cpu)
+    {
+        if(cpu < first)
+            first = cpu;
+    });
+    return (first != invalid_id) ? first : default_value;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Shared cache of the highest level is identified by the lowest cpu sharing it.
+ */
+uint32_t read_last_level_cache_id(uint32_t cpu)
+{
+    char path[128];
+    uint32_t best_level = 0;
+    uint32_t llc_id = cpu;
+
+    for(uint32_t index = 0; index < max_cache_indices; ++index)
+    {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/level", cpu, index);
+        uint32_t level = read_uint(path, 0);
+        if(level == 0)
+            break;
+
+        if(level < best_level)
+            continue;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/shared_cpu_list", cpu, index);
+        best_level = level;
+        llc_id = read_first_in_cpu_list(path, cpu);
+    }
+
+    return llc_id;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+uint32_t online_processors_count()
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? static_cast<uint32_t>(count) : 1;
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool query_cpu_topology(cpu_topology& topology)
+{
+    char buffer[1024];
+    if(!read_sys_file("/sys/devices/system/cpu/online", buffer, sizeof(buffer)))
+    {
+        make_flat_cpu_topology(topology, online_processors_count());
+        return false;
+    }
+
+    // cpu index -> position in processors array
+    uint32_t positions[max_logical_processors];
+    for(auto& position : positions)
+        position = invalid_id;
+
+    topology.processors_count = 0;
+    for_each_in_cpu_list(buffer, [&topology, &positions](uint32_t cpu)
+    {
+        if(cpu >= max_logical_processors || topology.processors_count >= max_logical_processors)
+            return;
+
+        char path[128];
+        logical_processor_info& info = topology.processors[topology.processors_count];
+        info.hardware_thread = cpu;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/thread_siblings_list", cpu);
+        info.core_id = read_first_in_cpu_list(path, cpu);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", cpu);
+        info.package_id = read_uint(path, 0);
+
+        info.llc_id = read_last_level_cache_id(cpu);
+        info.node_id = 0;
+
+        positions[cpu] = topology.processors_count++;
+    });
+
+    if(topology.processors_count == 0)
+    {
+        make_flat_cpu_topology(topology, online_processors_count());
+        return false;
+    }
+
+    // Kernels without NUMA support have no node directory, everything stays on node 0
+    if(read_sys_file("/sys/devices/system/node/online", buffer, sizeof(buffer)))
+    {
+        uint32_t nodes[max_numa_nodes];
+        uint32_t nodes_count = 0;
+        for_each_in_cpu_list(buffer, [&nodes, &nodes_count](uint32_t node)
+        {
+            if(nodes_count < max_numa_nodes)
+                nodes[nodes_count++] = node;
+        });
+
+        for(uint32_t i = 0; i < nodes_count; ++i)
+        {
+            char path[128];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", nodes[i]);
+            if(!read_sys_file(path, buffer, sizeof(buffer)))
+                continue;
+
+            uint32_t node = nodes[i];
+            for_each_in_cpu_list(buffer, [&topology, &positions, node](uint32_t cpu)
+            {
+                if(cpu < max_logical_processors && positions[cpu] != invalid_id)
+                    topology.processors[positions[cpu]].node_id = node;
+            });
+        }
+    }
+
+    normalize_cpu_topology(topology);
+    return true;
+}
+
+XR_NAMESPACE_END(xr, sys)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,154 @@
+// This file is a part of xray-ng engine
+//
+
+#include "corlib/sys/topology.h"
+#include "corlib/sys/thread.h"
+#include "../os_include_win32.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, sys)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+// spawn_thread pins threads with SetThreadAffinityMask, so only first processor group is used
+constexpr uint32_t max_group_processors = 64;
+constexpr uint32_t invalid_id = UINT32_MAX;
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename TFunc>
+void for_each_processor_in_mask(const GROUP_AFFINITY& affinity, TFunc func)
+{
+    if(affinity.Group != 0)
+        return;
+
+    for(uint32_t bit = 0; bit < max_group_processors; ++bit)
+    {
+        if(affinity.Mask & (KAFFINITY(1) << bit))
+            func(bit);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename TFunc>
+void for_each_relation(uint8_t* buffer, DWORD length, TFunc func)
+{
+    DWORD offset = 0;
+    while(offset < length)
+    {
+        auto info = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer + offset);
+        func(*info);
+        offset += info->Size;
+    }
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool query_cpu_topology(cpu_topology& topology)
+{
+    DWORD length = 0;
+    GetLogicalProcessorInformationEx(RelationAll, nullptr, &length);
+    if(GetLastError() != ERROR_INSUFFICIENT_BUFFER || length == 0)
+    {
+        make_flat_cpu_topology(topology, core_count());
+        return false;
+    }
+
+    uint8_t* buffer = reinterpret_cast<uint8_t*>(HeapAlloc(GetProcessHeap(), 0, length));
+    if(!buffer || !GetLogicalProcessorInformationEx(RelationAll,
+        reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer), &length))
+    {
+        if(buffer)
+            HeapFree(GetProcessHeap(), 0, buffer);
+
+        make_flat_cpu_topology(topology, core_count());
+        return false;
+    }
+
+    logical_processor_info processors[max_group_processors];
+    for(uint32_t i = 0; i < max_group_processors; ++i)
+    {
+        processors[i].hardware_thread = i;
+        processors[i].core_id = invalid_id;
+        processors[i].llc_id = 0;
+        processors[i].node_id = 0;
+        processors[i].package_id = 0;
+    }
+
+    BYTE last_level = 0;
+    for_each_relation(buffer, length, [&last_level](const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX& info)
+    {
+        if(info.Relationship == RelationCache && info.Cache.Level > last_level)
+            last_level = info.Cache.Level;
+    });
+
+    uint32_t core_index = 0;
+    uint32_t llc_index = 0;
+    uint32_t package_index = 0;
+    for_each_relation(buffer, length, [&](const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX& info)
+    {
+        switch(info.Relationship)
+        {
+            case RelationProcessorCore:
+                for(WORD i = 0; i < info.Processor.GroupCount; ++i)
+                    for_each_processor_in_mask(info.Processor.GroupMask[i],
+                        [&](uint32_t cpu) { processors[cpu].core_id = core_index; });
+                ++core_index;
+                break;
+
+            case RelationProcessorPackage:
+                for(WORD i = 0; i < info.Processor.GroupCount; ++i)
+                    for_each_processor_in_mask(info.Processor.GroupMask[i],
+                        [&](uint32_t cpu) { processors[cpu].package_id = package_index; });
+                ++package_index;
+                break;
+
+            case RelationCache:
+                if(info.Cache.Level == last_level && info.Cache.Type != CacheInstruction)
+                {
+                    for_each_processor_in_mask(info.Cache.GroupMask,
+                        [&](uint32_t cpu) { processors[cpu].llc_id = llc_index; });
+                    ++llc_index;
+                }
+                break;
+
+            case RelationNumaNode:
+                for_each_processor_in_mask(info.NumaNode.GroupMask,
+                    [&](uint32_t cpu) { processors[cpu].node_id = info.NumaNode.NodeNumber; });
+                break;
+
+            default:
+                break;
+        }
+    });
+
+    HeapFree(GetProcessHeap(), 0, buffer);
+
+    // processors without core relation are not present in first group
+    topology.processors_count = 0;
+    for(uint32_t i = 0; i < max_group_processors; ++i)
+    {
+        if(processors[i].core_id != invalid_id)
+            topology.processors[topology.processors_count++] = processors[i];
+    }
+
+    if(topology.processors_count == 0)
+    {
+        make_flat_cpu_topology(topology, core_count());
+        return false;
+    }
+
+    normalize_cpu_topology(topology);
+    return true;
+}
+
+XR_NAMESPACE_END(xr, sys)
+//-----------------------------------------------------------------------------------------------------------
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "corlib/threading/interlocked.h"
+#include "corlib/macro/aligning.h"
 #include "corlib/memory/allocator_helper.h"
 #include "corlib/memory/memory_functions.h"
 
@@ -13,11 +14,13 @@
 XR_NAMESPACE_BEGIN(xr, tasks)
 
 //-----------------------------------------------------------------------------------------------------------
+// Fixed pool of MaxCount nodes. Free nodes are kept in a lock-free list, its head is a pointer with a
+// pointer-wide tag swapped by double-width compare-exchange, so the list is safe from ABA.
 template<typename Node, size_t MaxCount>
 class allocator
 {
 public:
-    using node_t = typename Node;
+    using node_t = Node;
 
     allocator();
     ~allocator();
@@ -56,33 +59,17 @@ private:
 
     node_prefix* from_node(node_t* n)
     {
-        return reinterpret_cast<node_prefix*>(reinterpret_cast<pstr>(n) - node_size);
+        return reinterpret_cast<node_prefix*>(n) - 1;
+    }
+
+    node_prefix* node_at(size_t index)
+    {
+        return reinterpret_cast<node_prefix*>(m_buffer + (index * granularity));
     }
 
     XR_ALIGNAS(XR_MAX_CACHE_LINE_SIZE) uint8_t m_buffer[max_count * granularity];
 
-    union pointer_and_counter
-    {
-        volatile int64_t whole;
-
-#if XRAY_PLATFORM_32BIT
-        struct
-        {
-            uintptr_t pointer;
-            uint32_t counter;
-        };
-#elif XRAY_PLATFORM_64BIT
-        struct
-        {
-            uintptr_t pointer : 48;
-            uint64_t counter : 16;
-        };
-#else
-#   error "Unknown platform"
-#endif // XRAY_PLATFORM_WIN32
-    };
-
-    pointer_and_counter m_free_list;
+    threading::atomic_tagged_pointer m_free_list;
 }; // class allocator<Node, MaxCount>
 
 
@@ -92,19 +79,15 @@ private:
 template<typename Node, size_t MaxCount>
 allocator<Node, MaxCount>::allocator()
     : m_buffer {}
-    , m_free_list { 0 }
+    , m_free_list { nullptr, 0 }
 {
     for(size_t i = 0; i < max_count; ++i)
     {
-        auto current_node = reinterpret_cast<node_prefix*>(
-            reinterpret_cast<pbyte>(m_buffer) + (i * max_size));
-        auto next_node = reinterpret_cast<node_prefix*>(
-            reinterpret_cast<pbyte>(m_buffer) + ((i + 1U) * max_size));
-
-        current_node->next = (i == max_count - 1) ? nullptr : next_node;
+        auto current_node = node_at(i);
+        current_node->next = (i == max_count - 1) ? nullptr : node_at(i + 1U);
     }
 
-    m_free_list.pointer = reinterpret_cast<uintptr_t>(m_buffer);
+    m_free_list.pointer = node_at(0);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -114,8 +97,8 @@ template<typename Node, size_t MaxCount>
 allocator<Node, MaxCount>::~allocator()
 {
     size_t free_count = 0U;
-    node_prefix* current_node =
-        reinterpret_cast<node_prefix*>(m_free_list.pointer);
+    node_prefix* current_node = reinterpret_cast<node_prefix*>(
+        threading::atomic_fetch_tagged_acq(m_free_list).pointer);
 
     while(current_node)
     {
@@ -137,8 +120,8 @@ template<typename F>
 inline void
 allocator<Node, MaxCount>::construct_all_with(F&& functor)
 {
-    node_prefix* current_node =
-        reinterpret_cast<node_prefix*>(m_free_list.pointer);
+    node_prefix* current_node = reinterpret_cast<node_prefix*>(
+        threading::atomic_fetch_tagged_acq(m_free_list).pointer);
 
     while(current_node)
     {
@@ -155,21 +138,21 @@ template<typename Node, size_t MaxCount>
 typename allocator<Node, MaxCount>::node_t*
 allocator<Node, MaxCount>::take_available()
 {
-    pointer_and_counter allocated_task;
-    pointer_and_counter new_head;
+    threading::atomic_tagged_pointer head;
+    threading::atomic_tagged_pointer new_head;
 
     do
     {
-        allocated_task = m_free_list;
-        if(!allocated_task.pointer)
+        head = threading::atomic_fetch_tagged_acq(m_free_list);
+        if(!head.pointer)
             return nullptr;
 
-        new_head.pointer = reinterpret_cast<uintptr_t>(
-            reinterpret_cast<node_prefix*>(allocated_task.pointer)->next);
-        new_head.counter = allocated_task.counter + 1U;
-    } while(!threading::atomic_bcas_seq(m_free_list.whole, new_head.whole, allocated_task.whole));
+        // node may be taken and put back by other threads meanwhile, tag makes such head stale
+        new_head.pointer = reinterpret_cast<node_prefix*>(head.pointer)->next;
+        new_head.tag = head.tag + 1U;
+    } while(!threading::atomic_bcas_tagged_seq(m_free_list, new_head, head));
 
-    return to_node(reinterpret_cast<node_prefix*>(allocated_task.pointer));
+    return to_node(reinterpret_cast<node_prefix*>(head.pointer));
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -178,21 +161,18 @@ allocator<Node, MaxCount>::take_available()
 template<typename Node, size_t MaxCount>
 void allocator<Node, MaxCount>::put_back(node_t* p)
 {
-    pointer_and_counter head;
-    pointer_and_counter new_head;
+    threading::atomic_tagged_pointer head;
+    threading::atomic_tagged_pointer new_head;
 
     auto n = from_node(p);
-    new_head.pointer = reinterpret_cast<uintptr_t>(n);
+    new_head.pointer = n;
 
     do
     {
-        head = m_free_list;
-
-        reinterpret_cast<node_prefix*>(new_head.pointer)->next =
-            reinterpret_cast<node_prefix*>(head.pointer);
-
-        new_head.counter = head.counter;
-    } while(!threading::atomic_bcas_seq(m_free_list.whole, new_head.whole, head.whole));
+        head = threading::atomic_fetch_tagged_acq(m_free_list);
+        n->next = reinterpret_cast<node_prefix*>(head.pointer);
+        new_head.tag = head.tag + 1U;
+    } while(!threading::atomic_bcas_tagged_seq(m_free_list, new_head, head));
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -202,8 +182,8 @@ template<typename Node, size_t MaxCount>
 bool allocator<Node, MaxCount>::check_all_free()
 {
     size_t free_count = 0U;
-    node_prefix const* current_node =
-        reinterpret_cast<node_prefix*>(m_free_list.pointer);
+    node_prefix const* current_node = reinterpret_cast<node_prefix*>(
+        threading::atomic_fetch_tagged_acq(m_free_list).pointer);
 
     while(current_node)
     {
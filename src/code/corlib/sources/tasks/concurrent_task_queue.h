@@ -256,7 +256,7 @@ inline bool
 priority_task_queue<T, Priority, Capacity>::try_pop_oldest(T& item)
 {
     threading::scoped_lock lock { m_mutex };
-    for(uint32_t queueIndex = 0; queueIndex < 3; queueIndex++)
+    for(uint32_t queueIndex = 0; queueIndex < eastl::size(m_queues); queueIndex++)
     {
         queue& q = m_queues[queueIndex];
         if(q.try_pop_oldest(item))
@@ -274,7 +274,7 @@ inline bool
 priority_task_queue<T, Priority, Capacity>::try_pop_newest(T& item)
 {
     threading::scoped_lock lock { m_mutex };
-    for(uint32_t queueIndex = 0; queueIndex < 3; queueIndex++)
+    for(uint32_t queueIndex = 0; queueIndex < eastl::size(m_queues); queueIndex++)
     {
         queue& queue = m_queues[queueIndex];
         if(queue.try_pop_newest(item))
@@ -5,11 +5,19 @@
 
 #include "corlib/threading/interlocked.h"
 
+#if defined(XRAY_PLATFORM_WINDOWS)
+#   define XR_FIBER_CALLCONV __stdcall
+#else
+#   define XR_FIBER_CALLCONV
+#endif // defined(XRAY_PLATFORM_WINDOWS)
+
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, tasks)
 
+// On Windows handle is a Win32 fiber, on Linux it is the saved stack pointer of
+// suspended fiber (see fiber_linux.cpp).
 using fiber_handle_t = pvoid;
-using fiber_proc_t = void(__stdcall*)(pvoid);
+using fiber_proc_t = void(XR_FIBER_CALLCONV*)(pvoid);
 constexpr fiber_handle_t INVALID_FIBER = nullptr;
 
 //-----------------------------------------------------------------------------------------------------------
@@ -23,18 +31,43 @@ public:
 
     void create_from_thread_and_run(fiber_proc_t proc, pvoid arg);
     void create(size_t stack, size_t reserve, fiber_proc_t proc, pvoid arg);
+#if defined(XRAY_PLATFORM_LINUX)
+    // Runs on committed memory owned by caller, e.g. a slot of large page stack region
+    void create_on_stack(pvoid stack_memory, size_t stack_size, fiber_proc_t proc, pvoid arg);
+
+    // Paints free part of suspended fiber stack and returns deepest stack use since previous call
+    // in bytes. The first call only paints the stack and returns 0.
+    size_t sample_stack_usage();
+
+    // Stacks without guard page have a canary at the bottom, it is overwritten by overflow
+    bool is_stack_overflowed() const;
+#endif // defined(XRAY_PLATFORM_LINUX)
     void reset(fiber_proc_t proc, pvoid arg);
+    void destroy();
 
     bool is_valid() const;
     bool is_constructed() const;
 
 private:
     void cleanup() XR_NOEXCEPT;
-    static void __stdcall fiber_func_internal(void* arg);
+#if defined(XRAY_PLATFORM_LINUX)
+    uint64_t* get_stack_bottom() const;
+#endif // defined(XRAY_PLATFORM_LINUX)
+    static void XR_FIBER_CALLCONV fiber_func_internal(void* arg);
 
     pvoid m_func_data { nullptr };
     fiber_proc_t m_func { nullptr };
     fiber_handle_t m_fiber { INVALID_FIBER };
+#if defined(XRAY_PLATFORM_LINUX)
+    //! stack mapping including guard page, null for fibers converted from thread
+    pvoid m_stack_memory { nullptr };
+    //! size of stack mapping in bytes
+    size_t m_stack_memory_size { 0 };
+    //! stack given to create_on_stack is not unmapped by fiber
+    bool m_owns_stack_memory { false };
+    //! free part of stack is filled with paint pattern
+    bool m_stack_painted { false };
+#endif // defined(XRAY_PLATFORM_LINUX)
     bool m_valid { false };
 };
 
@@ -46,6 +79,15 @@ inline fiber::~fiber()
     cleanup();
 }
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+fiber::destroy()
+{
+    cleanup();
+}
+
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
@@ -67,7 +109,7 @@ fiber::is_constructed() const
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
-inline void __stdcall 
+inline void XR_FIBER_CALLCONV
 fiber::fiber_func_internal(void* arg)
 {
     auto self = reinterpret_cast<fiber*>(arg);
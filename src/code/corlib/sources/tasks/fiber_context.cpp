@@ -80,6 +80,9 @@ void fiber_context::reset()
  */
 void fiber_context::yield()
 {
+    XR_DEBUG_ASSERTION_MSG(required_stack != task_stack_request::run_to_completion,
+        "Run-to-completion task can't yield");
+
     m_task_status = fiber_task_status::YIELDED;
     fiber& scheduler_fiber = m_thread_context->scheduler_fiber;
 
@@ -98,6 +101,53 @@ void fiber_context::yield()
 #endif
 }
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Operation is accounted like one more subtask: whoever drops children count to zero resumes
+ *  the fiber, so completion that comes before the fiber left this worker can't resume it twice.
+ */
+void fiber_context::wait(awaitable& operation)
+{
+    XR_DEBUG_ASSERTION_MSG(required_stack != task_stack_request::run_to_completion,
+        "Run-to-completion task can't wait, it has no fiber to suspend");
+    XR_DEBUG_ASSERTION_MSG(m_thread_context, "Sanity check failed!");
+
+    if(operation.is_ready())
+        return;
+
+    task_scheduler& scheduler = *(m_thread_context->current_scheduler);
+
+    threading::atomic_fetch_inc_seq(children_fibers_count);
+    threading::atomic_fetch_inc_seq(scheduler.m_awaiting_fibers_count);
+
+    if(!operation.try_suspend(this, &scheduler))
+    {
+        // completed while we were getting ready
+        threading::atomic_dec_fetch_seq(scheduler.m_awaiting_fibers_count);
+        threading::atomic_dec_fetch_seq(children_fibers_count);
+        return;
+    }
+
+    m_task_status = fiber_task_status::AWAITING_CHILD;
+    fiber& scheduler_fiber = m_thread_context->scheduler_fiber;
+
+#ifdef XR_INSTRUMENTED_BUILD
+    m_thread_context->notify_task_execute_state_changed(current_task.debug_color, current_task.debug_id,
+        task_execute_state::suspend, fiber_index);
+#endif
+
+    // Waiting, so reset thread context
+    m_thread_context = nullptr;
+
+    //switch to scheduler
+    fiber::switch_to(system_fiber, scheduler_fiber);
+
+#ifdef XR_INSTRUMENTED_BUILD
+    m_thread_context->notify_task_execute_state_changed(current_task.debug_color, current_task.debug_id,
+        task_execute_state::resume, fiber_index);
+#endif
+}
+
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
@@ -125,6 +175,15 @@ size_t fiber_context::effective_coroutine_buckets(size_t task_count)
     return bucket_count;
 }
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+memory::frame_allocator* fiber_context::get_frame_allocator()
+{
+    XR_DEBUG_ASSERTION_MSG(m_thread_context, "thread_context is nullptr");
+    return m_thread_context->current_scheduler->get_frame_allocator();
+}
+
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
@@ -143,7 +202,7 @@ void fiber_context::run_subtasks_on_scheduler(
 {
     XR_DEBUG_ASSERTION_MSG(m_thread_context, "Sanity check failed!");
     task_scheduler& scheduler = *(m_thread_context->current_scheduler);
-    scheduler.run_tasks_internal(buckets, nullptr, restored_from_awaiting);
+    scheduler.run_tasks_internal(buckets, nullptr, restored_from_awaiting, m_thread_context);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -151,6 +210,8 @@ void fiber_context::run_subtasks_on_scheduler(
  */
 void fiber_context::run_subtasks_and_yield_impl(utils::array_view<details::task_bucket>& buckets)
 {
+    XR_DEBUG_ASSERTION_MSG(required_stack != task_stack_request::run_to_completion,
+        "Run-to-completion task can't wait for subtasks. Use run_async instead.");
     XR_DEBUG_ASSERTION_MSG(m_thread_context, "Sanity check failed!");
     XR_DEBUG_ASSERTION_MSG(m_thread_context->current_scheduler, "Sanity check failed!");
     XR_DEBUG_ASSERTION_MSG(m_thread_context->current_scheduler->is_worker_thread(),
@@ -159,7 +220,7 @@ void fiber_context::run_subtasks_and_yield_impl(utils::array_view<details::task_
         "Thread context sanity check failed");
 
     // add to scheduler
-    m_thread_context->current_scheduler->run_tasks_internal(buckets, this, false);
+    m_thread_context->current_scheduler->run_tasks_internal(buckets, this, false, m_thread_context);
 
     //
     XR_DEBUG_ASSERTION_MSG(m_thread_context->current_thread_id == sys::current_thread_id(),
@@ -171,7 +232,7 @@ void fiber_context::run_subtasks_and_yield_impl(utils::array_view<details::task_
 
 #ifdef XR_INSTRUMENTED_BUILD
     m_thread_context->notify_task_execute_state_changed(current_task.debug_color, current_task.debug_id,
-        task_execute_state::suspend, (int32)fiber_index);
+        task_execute_state::suspend, fiber_index);
 #endif
 
     // Yielding, so reset thread context
@@ -182,7 +243,7 @@ void fiber_context::run_subtasks_and_yield_impl(utils::array_view<details::task_
 
 #ifdef XR_INSTRUMENTED_BUILD
     m_thread_context->notify_task_execute_state_changed(current_task.debug_color, current_task.debug_id,
-        task_execute_state::resume, (int32)fiber_index);
+        task_execute_state::resume, fiber_index);
 #endif
 }
 
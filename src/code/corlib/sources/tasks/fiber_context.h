@@ -41,6 +41,8 @@ public:
 private:
 
     virtual void yield();
+    virtual void wait(awaitable& operation) override;
+    virtual memory::frame_allocator* get_frame_allocator() override;
     virtual void assert_subtasks_valid(size_t task_count, bool fire_forget) override;
     virtual size_t effective_coroutine_buckets(size_t task_count) override;
     virtual pvoid current_effective_buffer() override;
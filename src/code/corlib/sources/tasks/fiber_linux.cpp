@@ -0,0 +1,315 @@
+// This file is a part of xray-ng engine
+//
+
+#if !defined(XRAY_PLATFORM_LINUX)
+#   error "This code is supported by Linux platform!"
+#endif // !defined(XRAY_PLATFORM_LINUX)
+
+#if !defined(__x86_64__)
+#   error "Fiber context switch is implemented for x86-64 only!"
+#endif // !defined(__x86_64__)
+
+#include "fiber.h"
+#include "corlib/threading/interlocked.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+//-----------------------------------------------------------------------------------------------------------
+// Context switch for System V x86-64 ABI. Only callee-saved state is stored on the stack of
+// suspended fiber: rbp, rbx, r12-r15, MXCSR and x87 control word (same as FIBER_FLAG_FLOAT_SWITCH
+// on Windows). Everything else is already saved by the caller according to ABI.
+//
+//   void xr_fiber_switch_context(void** from_sp, void* to_sp);
+//   void xr_fiber_trampoline(); // r12 = argument, r13 = entry point
+extern "C" void xr_fiber_switch_context(void** from_sp, void* to_sp);
+extern "C" void xr_fiber_trampoline();
+
+asm(R"(
+    .text
+    .globl xr_fiber_switch_context
+    .type xr_fiber_switch_context, @function
+    .align 16
+xr_fiber_switch_context:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw 4(%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw 4(%rsp)
+    addq $8, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size xr_fiber_switch_context, .-xr_fiber_switch_context
+
+    .globl xr_fiber_trampoline
+    .type xr_fiber_trampoline, @function
+    .align 16
+xr_fiber_trampoline:
+    movq %r12, %rdi
+    callq *%r13
+    ud2
+    .size xr_fiber_trampoline, .-xr_fiber_trampoline
+)");
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+constexpr uint32_t default_mxcsr = 0x1F80;
+constexpr uint16_t default_fpu_control_word = 0x037F;
+
+//! free stack memory is filled with this pattern, the first word that differs is the deepest use
+constexpr uint64_t stack_paint_pattern = 0xFEEDFACECAFEBEEFULL;
+//! words at the bottom of stacks without guard page
+constexpr size_t stack_canary_words = 8;
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline size_t
+fiber_page_size()
+{
+    static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return page_size;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Fills [begin, end) with stack_paint_pattern, so the deepest stack use can be found later.
+ */
+inline void
+fiber_paint_stack(uint64_t* begin, uint64_t* end)
+{
+    for(uint64_t* word = begin; word < end; ++word)
+        *word = stack_paint_pattern;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Builds initial frame so the first switch to fiber "returns" into xr_fiber_trampoline.
+ */
+inline pvoid
+fiber_prepare_stack(pvoid stack_top, fiber_proc_t entry, pvoid arg)
+{
+    uint64_t* top = reinterpret_cast<uint64_t*>(reinterpret_cast<uintptr_t>(stack_top) & ~uintptr_t(15));
+
+    // After ret into trampoline rsp must be 16-byte aligned, so trampoline call is ABI conformant
+    uint64_t* sp = top - 8;
+    sp[7] = reinterpret_cast<uint64_t>(&xr_fiber_trampoline); // return address
+    sp[6] = 0; // rbp
+    sp[5] = 0; // rbx
+    sp[4] = reinterpret_cast<uint64_t>(arg); // r12
+    sp[3] = reinterpret_cast<uint64_t>(entry); // r13
+    sp[2] = 0; // r14
+    sp[1] = 0; // r15
+    sp[0] = (static_cast<uint64_t>(default_fpu_control_word) << 32) | default_mxcsr;
+    return sp;
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+fiber::switch_to(fiber& from, fiber& to)
+{
+    XR_MEMORY_FULLCONSISTENCY_BARRIER;
+
+    XR_DEBUG_ASSERTION_MSG(from.m_fiber != INVALID_FIBER, "Invalid from fiber");
+    XR_DEBUG_ASSERTION_MSG(to.m_fiber != INVALID_FIBER, "Invalid to fiber");
+
+    xr_fiber_switch_context(&from.m_fiber, to.m_fiber);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+fiber::create_from_thread_and_run(fiber_proc_t proc, pvoid arg)
+{
+    XR_DEBUG_ASSERTION_MSG(!m_valid, "Fiber already created");
+    reset(nullptr, nullptr);
+
+    // Thread stack is used as is, stack pointer is stored here on first switch
+    m_fiber = this;
+    m_valid = true;
+    proc(arg);
+    cleanup();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+fiber::create(size_t stack, size_t reserve, fiber_proc_t proc, pvoid arg)
+{
+    XR_DEBUG_ASSERTION_MSG(!m_valid, "Fiber already created");
+
+    reset(proc, arg);
+
+    // Pages are committed lazily by kernel, so reserve only affects the mapping size
+    size_t page_size = fiber_page_size();
+    size_t stack_size = (stack > reserve) ? stack : reserve;
+    stack_size = (stack_size + page_size - 1) & ~(page_size - 1);
+
+    // lowest page is a guard page: overflow faults instead of corrupting neighbour memory
+    m_stack_memory_size = stack_size + page_size;
+    m_stack_memory = mmap(nullptr, m_stack_memory_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+
+    XR_DEBUG_ASSERTION_MSG(m_stack_memory != MAP_FAILED, "Can't allocate fiber stack");
+    if(m_stack_memory == MAP_FAILED)
+    {
+        m_stack_memory = nullptr;
+        return;
+    }
+
+    int guard_result = mprotect(m_stack_memory, page_size, PROT_NONE);
+    XR_UNREFERENCED_PARAMETER(guard_result);
+    XR_DEBUG_ASSERTION_MSG(guard_result == 0, "Can't protect fiber stack guard page");
+
+    pvoid stack_top = reinterpret_cast<uint8_t*>(m_stack_memory) + m_stack_memory_size;
+    m_fiber = fiber_prepare_stack(stack_top, fiber_func_internal, this);
+    m_owns_stack_memory = true;
+
+    XR_DEBUG_ASSERTION_MSG(m_fiber != INVALID_FIBER, "Can't create fiber");
+    m_valid = true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+fiber::create_on_stack(pvoid stack_memory, size_t stack_size, fiber_proc_t proc, pvoid arg)
+{
+    XR_DEBUG_ASSERTION_MSG(!m_valid, "Fiber already created");
+    XR_DEBUG_ASSERTION_MSG(stack_memory, "Fiber stack must be provided");
+
+    reset(proc, arg);
+
+    m_stack_memory = stack_memory;
+    m_stack_memory_size = stack_size;
+    m_owns_stack_memory = false;
+
+    // neighbouring stack lies right below, overflow is found by canary instead of guard page
+    uint64_t* bottom = get_stack_bottom();
+    fiber_paint_stack(bottom, bottom + stack_canary_words);
+
+    pvoid stack_top = reinterpret_cast<uint8_t*>(m_stack_memory) + m_stack_memory_size;
+    m_fiber = fiber_prepare_stack(stack_top, fiber_func_internal, this);
+    m_valid = true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Suspended fiber never touches memory below its saved stack pointer, so that part is painted.
+ */
+size_t
+fiber::sample_stack_usage()
+{
+    XR_DEBUG_ASSERTION_MSG(m_valid && m_stack_memory, "Fiber has no stack of its own");
+    if(!m_valid || !m_stack_memory)
+        return 0;
+
+    uint64_t* bottom = get_stack_bottom();
+    uint64_t* top = reinterpret_cast<uint64_t*>(reinterpret_cast<uint8_t*>(m_stack_memory) + m_stack_memory_size);
+    uint64_t* stack_pointer = reinterpret_cast<uint64_t*>(m_fiber);
+
+    if(!m_stack_painted)
+    {
+        fiber_paint_stack(bottom, stack_pointer);
+        m_stack_painted = true;
+        return 0;
+    }
+
+    uint64_t* deepest = bottom;
+    while(deepest < stack_pointer && *deepest == stack_paint_pattern)
+        ++deepest;
+
+    fiber_paint_stack(deepest, stack_pointer);
+    return static_cast<size_t>(top - deepest) * sizeof(uint64_t);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool
+fiber::is_stack_overflowed() const
+{
+    if(!m_valid || !m_stack_memory || m_owns_stack_memory)
+        return false;
+
+    uint64_t const* bottom = get_stack_bottom();
+    for(size_t i = 0; i < stack_canary_words; ++i)
+    {
+        if(bottom[i] != stack_paint_pattern)
+            return true;
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Lowest usable word, guard page of own mapping is skipped.
+ */
+uint64_t*
+fiber::get_stack_bottom() const
+{
+    uint8_t* bottom = reinterpret_cast<uint8_t*>(m_stack_memory);
+    if(m_owns_stack_memory)
+        bottom += fiber_page_size();
+
+    return reinterpret_cast<uint64_t*>(bottom);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+fiber::reset(fiber_proc_t proc, pvoid arg)
+{
+    m_func = proc;
+    m_func_data = arg;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+fiber::cleanup() XR_NOEXCEPT
+{
+    if(m_valid)
+    {
+        // fibers created from thread or on given stack don't own their stack
+        if(m_stack_memory && m_owns_stack_memory)
+            munmap(m_stack_memory, m_stack_memory_size);
+
+        m_stack_memory = nullptr;
+        m_stack_memory_size = 0;
+        m_owns_stack_memory = false;
+        m_stack_painted = false;
+
+        m_fiber = INVALID_FIBER;
+        m_valid = false;
+    }
+}
+
+XR_NAMESPACE_END(xr, tasks)
+//-----------------------------------------------------------------------------------------------------------
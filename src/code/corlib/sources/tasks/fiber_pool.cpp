@@ -0,0 +1,567 @@
+// This file is a part of xray-ng engine
+//
+
+#include "fiber_pool.h"
+#include "corlib/memory/allocator_macro.h"
+#include "corlib/memory/memory_functions.h"
+#include "corlib/threading/scoped_lock.h"
+#include "corlib/utils/aligning.h"
+#include "EASTL/algorithm.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+update_max(threading::atomic_uint32& target, uint32_t value)
+{
+    uint32_t current = threading::atomic_fetch_relax(target);
+    while(value > current)
+    {
+        if(threading::atomic_bcas_seq(target, value, current))
+            break;
+
+        current = threading::atomic_fetch_relax(target);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline size_t
+suggest_stack_size(size_t high_water_bytes)
+{
+    size_t const wanted = high_water_bytes + high_water_bytes / 4;
+
+    size_t size = memory::system_page_size();
+    while(size < wanted)
+        size <<= 1;
+
+    return size;
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+fiber_pool::fiber_pool()
+    : m_allocator { nullptr }
+    , m_desc {}
+    , m_proc { nullptr }
+    , m_contexts { nullptr }
+    , m_available {}
+    , m_max_count { 0 }
+    , m_created_count { 0 }
+    , m_committed_count { 0 }
+    , m_in_use_count { 0 }
+    , m_high_water_mark { 0 }
+    , m_exhausted_count { 0 }
+    , m_period_high_water_mark { 0 }
+    , m_period_start_ms { 0 }
+    , m_trim_lock { 0 }
+    , m_stack_region { nullptr }
+    , m_stack_region_size { 0 }
+    , m_stack_slot_size { 0 }
+    , m_stack_chunk_size { 0 }
+    , m_stack_slots_count { 0 }
+    , m_chunk_users { nullptr }
+    , m_stack_usage { nullptr }
+    , m_stack_usage_tracking { 0 }
+{}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+fiber_pool::~fiber_pool()
+{
+    XR_DEBUG_ASSERTION_MSG(m_contexts == nullptr, "Fiber pool must be shut down before destruction");
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+fiber_pool::initialize(memory::base_allocator& alloc, const fiber_pool_desc& desc, fiber_proc_t proc)
+{
+    XR_DEBUG_ASSERTION_MSG(desc.max_count <= max_capacity, "Fiber pool limit is too big");
+    XR_DEBUG_ASSERTION_MSG(desc.initial_count <= desc.max_count, "Invalid fiber pool description");
+
+    m_allocator = &alloc;
+    m_desc = desc;
+    m_proc = proc;
+    m_max_count = eastl::min(desc.max_count, max_capacity);
+    m_period_start_ms = sys::now_milliseconds();
+
+    m_contexts = XR_ALLOCATE_OBJECT_ARRAY_T(alloc, fiber_context*, max_capacity, "fiber pool contexts");
+    m_available.create(alloc);
+
+    // without region every stack is mapped separately with normal pages
+    if(desc.stack_pages == memory::page_kind::large)
+        reserve_stack_region();
+
+    for(uint32_t i = 0; i < desc.initial_count; ++i)
+    {
+        fiber_context* fiber_ctx = grow();
+        XR_DEBUG_ASSERTION_MSG(fiber_ctx != nullptr, "Can't create initial fibers");
+
+        bool committed = commit_stack(*fiber_ctx);
+        XR_UNREFERENCED_PARAMETER(committed);
+        XR_DEBUG_ASSERTION_MSG(committed, "Can't commit initial fiber stacks");
+
+        bool res = m_available.enqueue(fiber_ctx);
+        XR_UNREFERENCED_PARAMETER(res);
+        XR_DEBUG_ASSERTION_MSG(res, "Can't add fiber to storage");
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+fiber_pool::shutdown()
+{
+    if(!m_contexts)
+        return;
+
+    XR_DEBUG_ASSERTION_MSG(threading::atomic_fetch_acq(m_in_use_count) == 0,
+        "Fiber pool shut down while fibers are in use");
+
+    uint32_t created_count = threading::atomic_fetch_acq(m_created_count);
+    for(uint32_t i = 0; i < created_count; ++i)
+    {
+        XR_DEALLOCATE_MEMORY_T(*m_allocator, m_contexts[i]);
+    }
+
+    m_available.destroy(*m_allocator);
+    XR_DEALLOCATE_MEMORY(*m_allocator, m_contexts);
+    m_contexts = nullptr;
+
+    if(m_stack_region)
+    {
+        memory::release_pages(m_stack_region, m_stack_region_size);
+        XR_DEALLOCATE_MEMORY(*m_allocator, m_chunk_users);
+        m_stack_region = nullptr;
+        m_chunk_users = nullptr;
+    }
+
+    if(m_stack_usage)
+    {
+        XR_DEALLOCATE_MEMORY(*m_allocator, m_stack_usage);
+        m_stack_usage = nullptr;
+        m_stack_usage_tracking = 0;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+fiber_context*
+fiber_pool::acquire()
+{
+    fiber_context* fiber_ctx = nullptr;
+    if(!m_available.dequeue(fiber_ctx))
+    {
+        fiber_ctx = grow();
+        if(!fiber_ctx)
+        {
+            threading::atomic_inc_fetch_seq(m_exhausted_count);
+            return nullptr;
+        }
+    }
+
+    if(!fiber_ctx->system_fiber.is_valid() && !commit_stack(*fiber_ctx))
+    {
+        // context stays in pool without stack, next acquire tries again
+        bool res = m_available.enqueue(fiber_ctx);
+        XR_UNREFERENCED_PARAMETER(res);
+        XR_DEBUG_ASSERTION_MSG(res, "Can't return fiber to storage");
+        threading::atomic_inc_fetch_seq(m_exhausted_count);
+        return nullptr;
+    }
+
+    uint32_t in_use_count = threading::atomic_inc_fetch_seq(m_in_use_count);
+    update_max(m_high_water_mark, in_use_count);
+    update_max(m_period_high_water_mark, in_use_count);
+    return fiber_ctx;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+fiber_pool::release(fiber_context* fiber_ctx)
+{
+    XR_DEBUG_ASSERTION_MSG(fiber_ctx, "Can't release nullptr fiber");
+#if defined(XRAY_PLATFORM_LINUX)
+    XR_DEBUG_ASSERTION_MSG(!fiber_ctx->system_fiber.is_stack_overflowed(), "Fiber stack overflow");
+#endif // defined(XRAY_PLATFORM_LINUX)
+    threading::atomic_dec_fetch_seq(m_in_use_count);
+
+    // queue capacity covers every context that can ever be created
+    bool res = m_available.enqueue(fiber_ctx);
+    XR_UNREFERENCED_PARAMETER(res);
+    XR_DEBUG_ASSERTION_MSG(res, "Can't return fiber to storage");
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+fiber_pool::trim(sys::tick now_ms, sys::tick period_ms)
+{
+    if(now_ms - threading::atomic_fetch_acq(m_period_start_ms) < period_ms)
+        return;
+
+    if(!threading::atomic_bcas_seq(m_trim_lock, 1U, 0U))
+        return;
+
+    uint32_t keep_count = eastl::max(m_desc.initial_count,
+        threading::atomic_fetch_acq(m_period_high_water_mark));
+
+    // Rotate through free contexts once, dropping stacks until committed count fits
+    uint32_t free_count = threading::atomic_fetch_acq(m_created_count) -
+        threading::atomic_fetch_acq(m_in_use_count);
+
+    for(uint32_t i = 0; i < free_count; ++i)
+    {
+        if(threading::atomic_fetch_acq(m_committed_count) <= keep_count)
+            break;
+
+        fiber_context* fiber_ctx = nullptr;
+        if(!m_available.dequeue(fiber_ctx))
+            break;
+
+        if(fiber_ctx->system_fiber.is_valid())
+            release_stack(*fiber_ctx);
+
+        bool res = m_available.enqueue(fiber_ctx);
+        XR_UNREFERENCED_PARAMETER(res);
+        XR_DEBUG_ASSERTION_MSG(res, "Can't return fiber to storage");
+    }
+
+    threading::atomic_store_rel(m_period_high_water_mark, threading::atomic_fetch_acq(m_in_use_count));
+    threading::atomic_store_rel(m_period_start_ms, now_ms);
+    threading::atomic_store_rel(m_trim_lock, 0U);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+fiber_pool::set_max_count(uint32_t max_count)
+{
+    XR_DEBUG_ASSERTION_MSG(max_count <= max_capacity, "Fiber pool limit is too big");
+    threading::atomic_store_rel(m_max_count, eastl::min(max_count, max_capacity));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+fiber_pool_stats
+fiber_pool::get_stats() const
+{
+    fiber_pool_stats stats {};
+    stats.max_count = threading::atomic_fetch_acq(m_max_count);
+    stats.created_count = threading::atomic_fetch_acq(m_created_count);
+    stats.committed_count = threading::atomic_fetch_acq(m_committed_count);
+    stats.in_use_count = threading::atomic_fetch_acq(m_in_use_count);
+    stats.high_water_mark = threading::atomic_fetch_acq(m_high_water_mark);
+    stats.exhausted_count = threading::atomic_fetch_acq(m_exhausted_count);
+    return stats;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t
+fiber_pool::query_large_page_size() const
+{
+    if(!m_stack_region)
+        return 0;
+
+    return memory::query_large_page_size(m_stack_region, m_stack_region_size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+fiber_pool::set_stack_usage_tracking(bool enabled)
+{
+#if defined(XRAY_PLATFORM_LINUX)
+    if(enabled && !m_stack_usage)
+    {
+        threading::scoped_lock lock { m_stack_usage_lock };
+        if(!m_stack_usage)
+        {
+            fiber_stack_usage* table = XR_ALLOCATE_OBJECT_ARRAY_T(*m_allocator, fiber_stack_usage,
+                max_stack_usage_types, "fiber stack usage");
+            memory::zero(table, max_stack_usage_types * sizeof(fiber_stack_usage));
+            m_stack_usage = table;
+        }
+    }
+
+    threading::atomic_store_rel(m_stack_usage_tracking, enabled ? 1U : 0U);
+#else
+    XR_UNREFERENCED_PARAMETER(enabled);
+#endif // defined(XRAY_PLATFORM_LINUX)
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Stack of every fiber is painted on its first release with tracking enabled, measured from the
+ *  second one on.
+ */
+void
+fiber_pool::record_stack_usage(fiber_context& fiber_ctx)
+{
+#if defined(XRAY_PLATFORM_LINUX)
+    if(!threading::atomic_fetch_acq(m_stack_usage_tracking))
+        return;
+
+    size_t const high_water_bytes = fiber_ctx.system_fiber.sample_stack_usage();
+    if(!high_water_bytes)
+        return;
+
+    threading::scoped_lock lock { m_stack_usage_lock };
+    fiber_stack_usage* usage = find_stack_usage(fiber_ctx.current_task.task_func);
+    if(!usage)
+        return;
+
+    if(!usage->task_func)
+    {
+        usage->task_func = fiber_ctx.current_task.task_func;
+        usage->debug_id = fiber_ctx.current_task.debug_id;
+        usage->stack_request = fiber_ctx.required_stack;
+    }
+
+    usage->high_water_bytes = eastl::max(usage->high_water_bytes, high_water_bytes);
+    ++usage->samples_count;
+#else
+    XR_UNREFERENCED_PARAMETER(fiber_ctx);
+#endif // defined(XRAY_PLATFORM_LINUX)
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+fiber_pool::report_stack_usage(fiber_stack_usage_function function, pvoid user_data, size_t small_stack_size)
+{
+    XR_DEBUG_ASSERTION_MSG(function, "invalid report function");
+
+    threading::scoped_lock lock { m_stack_usage_lock };
+    if(!m_stack_usage)
+        return;
+
+    for(uint32_t i = 0; i < max_stack_usage_types; ++i)
+    {
+        fiber_stack_usage const& usage = m_stack_usage[i];
+        if(!usage.task_func)
+            continue;
+
+        fiber_stack_usage_report report {};
+        report.name = usage.debug_id;
+        report.stack_request = usage.stack_request;
+        report.stack_size = m_desc.stack_size;
+        report.high_water_bytes = usage.high_water_bytes;
+        report.samples_count = usage.samples_count;
+        report.suggested_stack_size = suggest_stack_size(usage.high_water_bytes);
+        report.fits_small_stack = report.suggested_stack_size <= small_stack_size;
+        function(report, user_data);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Returns entry of task type or free entry for it, nullptr if table is full.
+ */
+fiber_stack_usage*
+fiber_pool::find_stack_usage(details::task_entry_function task_func)
+{
+    uintptr_t const key = reinterpret_cast<uintptr_t>(task_func);
+    uint32_t index = static_cast<uint32_t>((key >> 4) * 2654435761U) & (max_stack_usage_types - 1);
+
+    for(uint32_t i = 0; i < max_stack_usage_types; ++i)
+    {
+        fiber_stack_usage* usage = m_stack_usage + index;
+        if(!usage->task_func || usage->task_func == task_func)
+            return usage;
+
+        index = (index + 1) & (max_stack_usage_types - 1);
+    }
+
+    return nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+fiber_context*
+fiber_pool::grow()
+{
+    uint32_t index = threading::atomic_fetch_acq(m_created_count);
+    for(;;)
+    {
+        if(index >= threading::atomic_fetch_acq(m_max_count))
+            return nullptr;
+
+        if(threading::atomic_bcas_seq(m_created_count, index + 1, index))
+            break;
+
+        index = threading::atomic_fetch_acq(m_created_count);
+    }
+
+    fiber_context* fiber_ctx = XR_ALLOCATE_OBJECT_T(*m_allocator, fiber_context, "fiber context") {};
+    fiber_ctx->fiber_index = m_desc.first_fiber_index + index;
+    m_contexts[index] = fiber_ctx;
+    return fiber_ctx;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Returns false if memory for the stack can't be had, context is left without stack then.
+ */
+bool
+fiber_pool::commit_stack(fiber_context& fiber_ctx)
+{
+#if defined(XRAY_PLATFORM_LINUX)
+    uint32_t const index = fiber_ctx.fiber_index - m_desc.first_fiber_index;
+    if(m_stack_region && index < m_stack_slots_count)
+    {
+        pvoid stack = acquire_stack_slot(index);
+        if(!stack)
+            return false;
+
+        fiber_ctx.system_fiber.create_on_stack(stack, m_stack_slot_size, m_proc, &fiber_ctx);
+        threading::atomic_inc_fetch_seq(m_committed_count);
+        return true;
+    }
+#endif // defined(XRAY_PLATFORM_LINUX)
+
+    fiber_ctx.system_fiber.create(m_desc.commit_size, m_desc.stack_size, m_proc, &fiber_ctx);
+    if(!fiber_ctx.system_fiber.is_valid())
+        return false;
+
+    threading::atomic_inc_fetch_seq(m_committed_count);
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+fiber_pool::release_stack(fiber_context& fiber_ctx)
+{
+    fiber_ctx.system_fiber.destroy();
+
+    uint32_t const index = fiber_ctx.fiber_index - m_desc.first_fiber_index;
+    if(m_stack_region && index < m_stack_slots_count)
+        release_stack_slot(index);
+
+    threading::atomic_dec_fetch_seq(m_committed_count);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Region has a slot for every initial context only. Explicit huge pages are set aside for the whole
+ *  region when it is reserved, so sizing it by max_count would take hundreds of megabytes of hugetlb
+ *  pool at scheduler start. Contexts created on demand past initial count get stacks of their own.
+ */
+bool
+fiber_pool::reserve_stack_region()
+{
+#if defined(XRAY_PLATFORM_LINUX)
+    size_t const chunk_size = memory::large_page_size();
+    if(!chunk_size)
+        return false;
+
+    size_t const stack_size = eastl::max(m_desc.stack_size, m_desc.commit_size);
+    size_t const slot_size = utils::align_up(stack_size, memory::system_page_size());
+    uint32_t const slots_count = m_desc.initial_count;
+    if(!slots_count)
+        return false;
+
+    size_t const region_size = utils::align_up(slot_size * slots_count, chunk_size);
+
+    pvoid region = memory::reserve_pages(region_size, memory::page_kind::large);
+    if(!region)
+        return false;
+
+    size_t const chunks_count = region_size / chunk_size;
+    m_chunk_users = XR_ALLOCATE_OBJECT_ARRAY_T(*m_allocator, uint16_t, chunks_count, "fiber stack chunks");
+    memory::zero(m_chunk_users, chunks_count * sizeof(uint16_t));
+
+    m_stack_region = reinterpret_cast<uint8_t*>(region);
+    m_stack_region_size = region_size;
+    m_stack_slot_size = slot_size;
+    m_stack_chunk_size = chunk_size;
+    m_stack_slots_count = slots_count;
+    return true;
+#else
+    return false;
+#endif // defined(XRAY_PLATFORM_LINUX)
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Commits large pages under the slot that had no stacks yet, returns nullptr if that failed.
+ */
+pvoid
+fiber_pool::acquire_stack_slot(uint32_t index)
+{
+    size_t const begin = index * m_stack_slot_size;
+    size_t const first_chunk = begin / m_stack_chunk_size;
+    size_t const last_chunk = (begin + m_stack_slot_size - 1) / m_stack_chunk_size;
+
+    threading::scoped_lock lock { m_stack_region_lock };
+    for(size_t chunk = first_chunk; chunk <= last_chunk; ++chunk)
+    {
+        if(m_chunk_users[chunk]++ != 0)
+            continue;
+
+        if(memory::commit_pages(m_stack_region + chunk * m_stack_chunk_size, m_stack_chunk_size))
+            continue;
+
+        // chunks below were taken by this slot, they are given back like on release
+        --m_chunk_users[chunk];
+        while(chunk-- > first_chunk)
+        {
+            if(--m_chunk_users[chunk] == 0)
+                memory::decommit_pages(m_stack_region + chunk * m_stack_chunk_size, m_stack_chunk_size);
+        }
+
+        return nullptr;
+    }
+
+    return m_stack_region + begin;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+fiber_pool::release_stack_slot(uint32_t index)
+{
+    size_t const begin = index * m_stack_slot_size;
+    size_t const first_chunk = begin / m_stack_chunk_size;
+    size_t const last_chunk = (begin + m_stack_slot_size - 1) / m_stack_chunk_size;
+
+    threading::scoped_lock lock { m_stack_region_lock };
+    for(size_t chunk = first_chunk; chunk <= last_chunk; ++chunk)
+    {
+        XR_DEBUG_ASSERTION_MSG(m_chunk_users[chunk], "Fiber stack chunk is not in use");
+        if(--m_chunk_users[chunk] == 0)
+            memory::decommit_pages(m_stack_region + chunk * m_stack_chunk_size, m_stack_chunk_size);
+    }
+}
+
+XR_NAMESPACE_END(xr, tasks)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,155 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "fiber_context.h"
+#include "work_stealing_queue.h"
+#include "corlib/memory/memory_allocator_base.h"
+#include "corlib/memory/memory_paging.h"
+#include "corlib/sys/chrono.h"
+#include "corlib/tasks/telemetry.h"
+#include "corlib/threading/spin_wait.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks)
+
+//-----------------------------------------------------------------------------------------------------------
+struct fiber_pool_desc
+{
+    //! full stack size (reserved address space)
+    size_t stack_size { 0 };
+    //! initially committed part of stack
+    size_t commit_size { 0 };
+    //! fibers created up front and never trimmed
+    uint32_t initial_count { 0 };
+    //! pool never grows beyond this count
+    uint32_t max_count { 0 };
+    //! index of first fiber, used for profiling
+    uint32_t first_fiber_index { 0 };
+    //! large pages are shared by neighbouring stacks, so there are no guard pages between them.
+    //! Linux only, Win32 fibers always get stacks of their own.
+    memory::page_kind stack_pages { memory::page_kind::normal };
+}; // struct fiber_pool_desc
+
+//-----------------------------------------------------------------------------------------------------------
+struct fiber_pool_stats
+{
+    //! current growth limit
+    uint32_t max_count;
+    //! fiber contexts created so far
+    uint32_t created_count;
+    //! fiber contexts that currently own a stack
+    uint32_t committed_count;
+    //! fiber contexts executing or awaiting tasks
+    uint32_t in_use_count;
+    //! maximum of in_use_count since pool creation
+    uint32_t high_water_mark;
+    //! acquires that found no fiber to hand out
+    uint32_t exhausted_count;
+}; // struct fiber_pool_stats
+
+//-----------------------------------------------------------------------------------------------------------
+// Deepest stack use of one task type
+struct fiber_stack_usage
+{
+    details::task_entry_function task_func;
+    pcstr debug_id;
+    task_stack_request stack_request;
+    size_t high_water_bytes;
+    uint64_t samples_count;
+}; // struct fiber_stack_usage
+
+//-----------------------------------------------------------------------------------------------------------
+// Pool of fiber contexts that grows on demand up to a limit. Stacks are created when a context is
+// handed out for the first time, and released again by trim() when recent demand went down.
+//
+// With large pages every initial context has a fixed slot in one reserved region. A large
+// page is committed with its first stack and decommitted when its last stack is dropped.
+class fiber_pool
+{
+public:
+    static constexpr uint32_t max_capacity = 4096;
+    static constexpr uint32_t max_stack_usage_types = 256;
+
+    fiber_pool();
+    ~fiber_pool();
+
+    XR_DECLARE_DELETE_COPY_ASSIGNMENT(fiber_pool);
+    XR_DECLARE_DELETE_MOVE_ASSIGNMENT(fiber_pool);
+
+    void initialize(memory::base_allocator& alloc, const fiber_pool_desc& desc, fiber_proc_t proc);
+    void shutdown();
+
+    // Returns nullptr if pool has reached its limit and all fibers are in use, or stack can't be committed
+    fiber_context* acquire();
+    void release(fiber_context* fiber_ctx);
+
+    // Drops stacks of free fibers above recent high-water mark once per period
+    void trim(sys::tick now_ms, sys::tick period_ms);
+
+    void set_max_count(uint32_t max_count);
+    fiber_pool_stats get_stats() const;
+
+    // Bytes of stacks that actually got large pages
+    size_t query_large_page_size() const;
+
+    // Debug mode, stacks are painted and deepest use of every task type is kept. Linux only,
+    // painting commits whole stacks.
+    void set_stack_usage_tracking(bool enabled);
+
+    // Called when task is done with fiber, before context is reset
+    void record_stack_usage(fiber_context& fiber_ctx);
+
+    // Suggested sizes leave a quarter of headroom, tasks fit small stacks below small_stack_size
+    void report_stack_usage(fiber_stack_usage_function function, pvoid user_data, size_t small_stack_size);
+
+private:
+    fiber_context* grow();
+    bool commit_stack(fiber_context& fiber_ctx);
+    void release_stack(fiber_context& fiber_ctx);
+
+    fiber_stack_usage* find_stack_usage(details::task_entry_function task_func);
+
+    bool reserve_stack_region();
+    pvoid acquire_stack_slot(uint32_t index);
+    void release_stack_slot(uint32_t index);
+
+    memory::base_allocator* m_allocator;
+    fiber_pool_desc m_desc;
+    fiber_proc_t m_proc;
+    //! every context ever created, indexed by creation order
+    fiber_context** m_contexts;
+    //! contexts ready to be acquired
+    mpmc_queue<fiber_context*, max_capacity> m_available;
+
+    threading::atomic_uint32 m_max_count;
+    threading::atomic_uint32 m_created_count;
+    threading::atomic_uint32 m_committed_count;
+    threading::atomic_uint32 m_in_use_count;
+    threading::atomic_uint32 m_high_water_mark;
+    threading::atomic_uint32 m_exhausted_count;
+    //! high-water mark of current trim period
+    threading::atomic_uint32 m_period_high_water_mark;
+    threading::atomic_uint64 m_period_start_ms;
+    threading::atomic_uint32 m_trim_lock;
+
+    //! large page region with stack slots, nullptr if every stack is mapped separately
+    uint8_t* m_stack_region;
+    size_t m_stack_region_size;
+    size_t m_stack_slot_size;
+    size_t m_stack_chunk_size;
+    //! contexts with slot in region, those created past initial count have none
+    uint32_t m_stack_slots_count;
+    //! stacks on every large page of region
+    uint16_t* m_chunk_users;
+    threading::spin_wait_fairness m_stack_region_lock;
+
+    //! open addressing table of task types, allocated when tracking is enabled for the first time
+    fiber_stack_usage* m_stack_usage;
+    threading::atomic_uint32 m_stack_usage_tracking;
+    threading::spin_wait_fairness m_stack_usage_lock;
+}; // class fiber_pool
+
+XR_NAMESPACE_END(xr, tasks)
+//-----------------------------------------------------------------------------------------------------------
@@ -1,11 +1,15 @@
 // This file is a part of xray-ng engine
 //
 
+#if !defined(XRAY_PLATFORM_WINDOWS)
+#   error "This code is supported by Windows platform!"
+#endif // !defined(XRAY_PLATFORM_WINDOWS)
+
 #include "fiber.h"
 #include "corlib/threading/interlocked.h"
 #include "../os_include_win32.h"
 
-#if XRAY_PLATFORM_64BIT
+#if defined(XRAY_PLATFORM_64BIT)
 #define ReadTeb(offset) __readgsqword(offset);
 #define WriteTeb(offset, v) __writegsqword(offset, v)
 
@@ -94,7 +98,7 @@ fiber::create(size_t stack, size_t reserve, fiber_proc_t proc, pvoid arg)
         fiber_func_internal, this);
 
     XR_DEBUG_ASSERTION_MSG(m_fiber != INVALID_FIBER, "Can't create fiber");
-    m_valid = true;
+    m_valid = (m_fiber != INVALID_FIBER);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -4,16 +4,25 @@
 #pragma once
 
 #include "corlib/threading/interlocked.h"
+#include "corlib/memory/allocator_helper.h"
+#include "corlib/memory/allocator_macro.h"
+#include "corlib/memory/memory_allocator_base.h"
+#include "corlib/macro/aligning.h"
 #include "corlib/utils/type_traits.h"
-#include "EASTL/array.h"
+#include "EASTL/utility.h"
 
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, tasks)
 
+//-----------------------------------------------------------------------------------------------------------
+// Bounded multi-producer/multi-consumer ring (D. Vyukov). Cells are taken from allocator by create,
+// queue is just dummy until then.
 template<typename T, size_t kBoundedSize>
 class mpmc_queue
 {
 private:
+    static_assert((kBoundedSize & (kBoundedSize - 1)) == 0, "kBoundedSize must be a power of two");
+
     static_assert(eastl::is_nothrow_copy_assignable<T>::value ||
         eastl::is_nothrow_move_assignable_v<T>,
         "T must be nothrow copy or move assignable");
@@ -22,10 +31,21 @@ private:
         "T must be nothrow destructible");
 
 public:
-    constexpr mpmc_queue();
+    mpmc_queue();
+    ~mpmc_queue();
+
     XR_DECLARE_DELETE_COPY_ASSIGNMENT(mpmc_queue);
+    XR_DECLARE_DELETE_MOVE_ASSIGNMENT(mpmc_queue);
+
+    void create(memory::base_allocator& alloc);
+    void destroy(memory::base_allocator& alloc);
+
+    bool is_created() const;
+    // Snapshot only, any thread may call it
+    bool is_empty() const;
 
     signalling_bool enqueue(T&& data);
+    signalling_bool enqueue(const T& data);
     signalling_bool dequeue(T& data);
 
 private:
@@ -35,60 +55,155 @@ private:
         T data;
     };
 
+    cell* acquire_enqueue_cell(size_t& pos);
+
     static constexpr size_t mask = (kBoundedSize - 1);
     // Align to avoid false sharing between head and tail
     XR_ALIGNAS(XR_MAX_CACHE_LINE_SIZE) threading::atomic_size_t m_enqueue_pos;
     XR_ALIGNAS(XR_MAX_CACHE_LINE_SIZE) threading::atomic_size_t m_dequeue_pos;
-    XR_ALIGNAS(XR_MAX_CACHE_LINE_SIZE) eastl::array<cell, kBoundedSize> m_values;
+    XR_ALIGNAS(XR_MAX_CACHE_LINE_SIZE) cell* m_values;
 }; // class mpmc_queue
 
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
 template<typename T, size_t kBoundedSize>
-constexpr mpmc_queue<T, kBoundedSize>::mpmc_queue()
+inline mpmc_queue<T, kBoundedSize>::mpmc_queue()
     : m_enqueue_pos { 0 }
     , m_dequeue_pos { 0 }
-    , m_values {}
+    , m_values { nullptr }
+{}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t kBoundedSize>
+inline mpmc_queue<T, kBoundedSize>::~mpmc_queue()
+{
+    XR_DEBUG_ASSERTION_MSG(m_values == nullptr, "mpmc_queue must be destroyed with its allocator");
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t kBoundedSize>
+inline void
+mpmc_queue<T, kBoundedSize>::create(memory::base_allocator& alloc)
 {
-    for(size_t i = 0; i < eastl::size(m_values); ++i)
+    XR_DEBUG_ASSERTION_MSG(m_values == nullptr, "mpmc_queue is already created");
+
+    m_values = XR_ALLOCATE_OBJECT_ARRAY_T(alloc, cell, kBoundedSize, "mpmc queue");
+    for(size_t i = 0; i < kBoundedSize; ++i)
+    {
+        memory::call_emplace_construct(&m_values[i]);
         m_values[i].sequence = i;
+    }
+
+    m_enqueue_pos = 0;
+    m_dequeue_pos = 0;
 }
 
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
 template<typename T, size_t kBoundedSize>
-inline signalling_bool 
-mpmc_queue<T, kBoundedSize>::enqueue(T&& data)
+inline void
+mpmc_queue<T, kBoundedSize>::destroy(memory::base_allocator& alloc)
 {
-    cell* c = nullptr;
-    auto pos = threading::atomic_fetch_acq(m_enqueue_pos);
+    if(!m_values)
+        return;
+
+    for(size_t i = 0; i < kBoundedSize; ++i)
+        memory::call_destruct(&m_values[i]);
+
+    XR_DEALLOCATE_MEMORY(alloc, m_values);
+    m_values = nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t kBoundedSize>
+inline bool
+mpmc_queue<T, kBoundedSize>::is_created() const
+{
+    return m_values != nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t kBoundedSize>
+inline bool
+mpmc_queue<T, kBoundedSize>::is_empty() const
+{
+    return threading::atomic_fetch_acq(m_dequeue_pos) == threading::atomic_fetch_acq(m_enqueue_pos);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Returns cell the caller owns until it publishes it, nullptr if queue is full.
+ */
+template<typename T, size_t kBoundedSize>
+inline typename mpmc_queue<T, kBoundedSize>::cell*
+mpmc_queue<T, kBoundedSize>::acquire_enqueue_cell(size_t& pos)
+{
+    pos = threading::atomic_fetch_acq(m_enqueue_pos);
     for(;;)
     {
-        c = &m_values[pos & mask];
-        auto seq = threading::atomic_fetch_acq(c->sequence);
-        intptr_t diff = (seq - pos);
+        cell* c = &m_values[pos & mask];
+        size_t seq = threading::atomic_fetch_acq(c->sequence);
+        intptr_t diff = static_cast<intptr_t>(seq - pos);
         if(!diff)
         {
             if(threading::atomic_bcas_seq(m_enqueue_pos, pos + 1, pos))
-                break;
+                return c;
         }
         else if(diff < 0)
         {
-            return false;
+            return nullptr;
         }
         else
         {
             pos = threading::atomic_fetch_acq(m_enqueue_pos);
         }
     }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t kBoundedSize>
+inline signalling_bool
+mpmc_queue<T, kBoundedSize>::enqueue(T&& data)
+{
+    size_t pos = 0;
+    cell* c = acquire_enqueue_cell(pos);
+    if(!c)
+        return false;
 
     c->data = eastl::move(data);
     threading::atomic_store_rel(c->sequence, pos + 1);
     return true;
 }
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t kBoundedSize>
+inline signalling_bool
+mpmc_queue<T, kBoundedSize>::enqueue(const T& data)
+{
+    size_t pos = 0;
+    cell* c = acquire_enqueue_cell(pos);
+    if(!c)
+        return false;
+
+    c->data = data;
+    threading::atomic_store_rel(c->sequence, pos + 1);
+    return true;
+}
+
 //-----------------------------------------------------------------------------------------------------------
 /**
 */
@@ -97,12 +212,12 @@ inline signalling_bool
 mpmc_queue<T, kBoundedSize>::dequeue(T& data)
 {
     cell* c = nullptr;
-    auto pos = threading::atomic_fetch_acq(m_dequeue_pos);
+    size_t pos = threading::atomic_fetch_acq(m_dequeue_pos);
     for(;;)
     {
         c = &m_values[pos & mask];
-        auto seq = threading::atomic_fetch_acq(c->sequence);
-        intptr_t diff = (seq - (pos + 1));
+        size_t seq = threading::atomic_fetch_acq(c->sequence);
+        intptr_t diff = static_cast<intptr_t>(seq - (pos + 1));
         if(!diff)
         {
             if(threading::atomic_bcas_seq(m_dequeue_pos, pos + 1, pos))
@@ -6,13 +6,11 @@
 #include "corlib/memory/memory_allocator_base.h"
 #include "corlib/utils/static_vector.h"
 #include "corlib/threading/atomic_backoff.h"
+#include "corlib/threading/scoped_lock.h"
 #include "corlib/tasks/details/work_distribution.h"
+#include "corlib/sys/chrono.h"
 #include <string.h> // for memset
-#include <stdio.h> // for _snwprintf
-
-// Enable low latency experimental wait code path.
-// Low latency hybrid wait works better on consoles, but a little worse on PC.
-// #define XR_EXPERIMENTAL_WAIT (1)
+#include <wchar.h> // for swprintf
 
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, tasks, details)
@@ -47,21 +45,45 @@ XR_NAMESPACE_BEGIN(xr, tasks)
 
 constexpr size_t scheduler_stack_size = XR_MEGABYTES_TO_BYTES(1); // 1Mb
 constexpr size_t standard_fiber_stack_size = XR_KILOBYTES_TO_BYTES(256); // 256Kb
-constexpr size_t reserve_standard_fiber_stack_size = standard_fiber_stack_size / 2;
+constexpr size_t commit_standard_fiber_stack_size = XR_KILOBYTES_TO_BYTES(16);
 constexpr size_t extended_fiber_stack_size = XR_MEGABYTES_TO_BYTES(1); // 1Mb
-constexpr size_t reserve_extended_fiber_stack_size = extended_fiber_stack_size / 2;
+constexpr size_t commit_extended_fiber_stack_size = XR_KILOBYTES_TO_BYTES(64);
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Disabled telemetry costs one relaxed load per event.
+ */
+inline void
+record_telemetry_event(details::thread_context& context, telemetry_event_type type, pcstr name = nullptr)
+{
+    if(context.telemetry && context.current_scheduler->is_telemetry_enabled())
+        context.telemetry->push(type, name, sys::cpu_timestamp());
+}
 
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
 #ifdef XR_INSTRUMENTED_BUILD
-task_scheduler::task_scheduler(memory::base_allocator& alloc, uint32_t workerThreadsCount, base_profiler_event_listener* listener)
+task_scheduler::task_scheduler(memory::base_allocator& alloc, uint32_t workerThreadsCount,
+    memory::page_kind fiberStackPages, base_profiler_event_listener* listener)
 #else
-task_scheduler::task_scheduler(memory::base_allocator& alloc, uint32_t workerThreadsCount)
+task_scheduler::task_scheduler(memory::base_allocator& alloc, uint32_t workerThreadsCount,
+    memory::page_kind fiberStackPages)
 #endif
     : m_aligned_allocator { alloc }
     , m_round_robin_thread_index { 0 }
     , m_started_threads_count { 0 }
+    , m_overflow_count { 0 }
+    , m_frame_allocator { nullptr }
+    , m_steal_policy { static_cast<uint32_t>(steal_policy::hierarchical) }
+    , m_telemetry_rings { nullptr }
+    , m_telemetry_enabled { 0 }
+    , m_telemetry_origin_timestamp { sys::cpu_timestamp() }
+    , m_telemetry_origin_us { sys::now_microseconds() }
+    , m_completion_pollers_count { 0 }
+    , m_active_completion_polls { 0 }
+    , m_awaiting_fibers_count { 0 }
+    , m_pending_high_priority_count { 0 }
 {
 
 #ifdef XR_INSTRUMENTED_BUILD
@@ -73,39 +95,30 @@ task_scheduler::task_scheduler(memory::base_allocator& alloc, uint32_t workerThr
     else
         m_threads_count = eastl::clamp<uint32_t>(sys::core_count() - 1, 1, max_thread_count);
 
-    uint32_t fiber_index = 0;
-    // create fiber pool (fibers with standard stack size)
-    for(uint32_t i = 0; i < max_standard_fibers_count; i++)
-    {
-        fiber_context& context = m_standard_fiber_contexts[i];
-        context.system_fiber.create(standard_fiber_stack_size, 
-            reserve_standard_fiber_stack_size, fiber_main, &context);
-
-        context.fiber_index = fiber_index;
-        bool res = m_standard_fibers_available.enqueue(&context);
-        XR_UNREFERENCED_PARAMETER(res);
-        XR_DEBUG_ASSERTION_MSG(res == true, "Can't add fiber to storage");
-        fiber_index++;
-    }
-
-    // create fiber pool (fibers with extended stack size)
-    for(uint32_t i = 0; i < max_extended_fibers_count; i++)
-    {
-        fiber_context& context = m_extended_fiber_contexts[i];
-        context.system_fiber.create(extended_fiber_stack_size, 
-            reserve_extended_fiber_stack_size, fiber_main, &context);
-
-        context.fiber_index = fiber_index;
-        bool res = m_extended_fibers_available.enqueue(&context);
-        XR_UNREFERENCED_PARAMETER(res);
-        XR_DEBUG_ASSERTION_MSG(res == true, "Can't add fiber to storage");
-        fiber_index++;
-    }
+    // fiber pools grow on demand, only a few fibers are created up front
+    fiber_pool_desc standard_desc {};
+    standard_desc.stack_size = standard_fiber_stack_size;
+    standard_desc.commit_size = commit_standard_fiber_stack_size;
+    standard_desc.initial_count = initial_standard_fibers_count;
+    standard_desc.max_count = max_standard_fibers_count;
+    standard_desc.first_fiber_index = 0;
+    standard_desc.stack_pages = fiberStackPages;
+    m_standard_fibers.initialize(m_aligned_allocator, standard_desc, fiber_main);
+
+    fiber_pool_desc extended_desc {};
+    extended_desc.stack_size = extended_fiber_stack_size;
+    extended_desc.commit_size = commit_extended_fiber_stack_size;
+    extended_desc.initial_count = initial_extended_fibers_count;
+    extended_desc.max_count = max_extended_fibers_count;
+    extended_desc.first_fiber_index = fiber_pool::max_capacity;
+    extended_desc.stack_pages = fiberStackPages;
+    m_extended_fibers.initialize(m_aligned_allocator, extended_desc, fiber_main);
 
 #ifdef XR_INSTRUMENTED_BUILD
-    notify_fibers_created(kMaxStandardFibersCount + kMaxExtendedFibersCount);
+    notify_fibers_created(max_standard_fibers_count + max_extended_fibers_count);
 #endif
 
+    m_available_groups.create(m_aligned_allocator);
     for(uint16_t i = 0; i < task_group::max_groups_count; i++)
     {
         if(i != task_group::default_group)
@@ -120,15 +133,26 @@ task_scheduler::task_scheduler(memory::base_allocator& alloc, uint32_t workerThr
     m_group_stats[task_group::default_group].set_debug_is_free(false);
 #endif // defined(DEBUG)
 
+    m_overflow_tasks.create(m_aligned_allocator);
+
     // create worker thread pool
     uint32_t total_threads_count = get_workers_count();
 
 #ifdef XR_INSTRUMENTED_BUILD
-    notify_threads_created(total_thread_count);
+    notify_threads_created(total_threads_count);
 #endif
 
+    // workers are pinned following cpu topology, stealing prefers topologically near workers
+    sys::cpu_topology topology;
+    sys::query_cpu_topology(topology);
+
+    uint32_t worker_processors[max_thread_count];
+    details::assign_worker_processors(topology, total_threads_count, worker_processors);
+
     m_thread_context = XR_ALLOCATE_OBJECT_ARRAY_T(m_aligned_allocator, 
         details::thread_context, total_threads_count, "thread contexts for threads");
+    m_telemetry_rings = XR_ALLOCATE_OBJECT_ARRAY_T(m_aligned_allocator,
+        details::telemetry_ring, total_threads_count, "telemetry rings for threads");
 
     for(uint32_t i = 0; i < total_threads_count; i++)
     {
@@ -138,13 +162,19 @@ task_scheduler::task_scheduler(memory::base_allocator& alloc, uint32_t workerThr
         uint32_t thread_index = static_cast<uint32_t>(i);
         context.set_thread_index(thread_index);
         context.current_scheduler = this;
+        memory::call_emplace_construct(&m_telemetry_rings[i]);
+        context.telemetry = &m_telemetry_rings[i];
+        details::build_steal_order(topology, worker_processors, total_threads_count,
+            thread_index, context.steal_victims);
 
         auto priority = sys::thread_priority::medium;
+        uint32_t hardware_thread = topology.processors[worker_processors[i]].hardware_thread;
+        m_worker_hardware_threads[i] = hardware_thread;
 
         wchar_t worker_name[16];
-        _snwprintf_s(worker_name, eastl::size(worker_name), L"task_worker %u", i);
+        swprintf(worker_name, eastl::size(worker_name), L"task_worker %u", i);
         context.current_thread = sys::spawn_thread(worker_thread_main, &context,
-            worker_name, priority, scheduler_stack_size, thread_index);
+            worker_name, priority, scheduler_stack_size, hardware_thread);
     }
 }
 
@@ -155,10 +185,9 @@ void task_scheduler::join_worker_threads()
 {
     size_t total_threads_count = get_workers_count();
     for(size_t i = 0; i < total_threads_count; i++)
-    {
         threading::atomic_store_rel(m_thread_context[i].state, (uint32_t)details::thread_state::EXIT);
-        m_thread_context[i].has_new_tasks_event.set(true);
-    }
+
+    m_parking_lot.unpark_all();
 
     sys::thread_handle thread_ids[64];
     for(size_t i = 0; i < total_threads_count; i++)
@@ -166,6 +195,10 @@ void task_scheduler::join_worker_threads()
 
     bool result = sys::wait_threads(thread_ids, total_threads_count);
     XR_UNREFERENCED_PARAMETER(result);
+    XR_DEBUG_ASSERTION_MSG(result, "Can't join worker threads");
+
+    for(size_t i = 0; i < total_threads_count; i++)
+        sys::detach_thread(thread_ids[i]);
 
     for(size_t i = 0; i < total_threads_count; i++)
     {
@@ -173,6 +206,11 @@ void task_scheduler::join_worker_threads()
         memory::call_destruct(&context);
     }
     XR_DEALLOCATE_MEMORY(m_aligned_allocator, m_thread_context);
+    XR_DEALLOCATE_MEMORY(m_aligned_allocator, m_telemetry_rings);
+    m_overflow_tasks.destroy(m_aligned_allocator);
+
+    m_standard_fibers.shutdown();
+    m_extended_fibers.shutdown();
 
     threading::atomic_store_rel<uint32_t>(m_threads_count, 0);
 }
@@ -184,6 +222,8 @@ task_scheduler::~task_scheduler()
 {
     if(get_workers_count() > 0)
         join_worker_threads();
+
+    m_available_groups.destroy(m_aligned_allocator);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -199,29 +239,13 @@ fiber_context* task_scheduler::request_fiber_context(details::grouped_task& t)
     }
 
     auto required_stack = t.desc.required_stack;
+    fiber_pool& pool = get_fiber_pool(required_stack);
 
-    fiber_ctx = nullptr;
-    bool res = false;
-    XR_UNREFERENCED_PARAMETER(res);
-    switch(required_stack)
-    {
-        case task_stack_request::small_stack:
-            res = m_standard_fibers_available.dequeue(fiber_ctx);
-            XR_UNREFERENCED_PARAMETER(res);
-            XR_DEBUG_ASSERTION_MSG(res, "Can't get more standard fibers!");
-            break;
-
-        case task_stack_request::huge_stack:
-            res = m_extended_fibers_available.dequeue(fiber_ctx);
-            XR_UNREFERENCED_PARAMETER(res);
-            XR_DEBUG_ASSERTION_MSG(res, "Can't get more extended fibers!");
-            break;
-
-        default:
-            XR_DEBUG_ASSERTION_MSG(false, "Unknown stack requrements");
-    }
+    // Pool is at its limit, caller keeps the task
+    fiber_ctx = pool.acquire();
+    if(!fiber_ctx)
+        return nullptr;
 
-    XR_DEBUG_ASSERTION_MSG(fiber_ctx != nullptr, "Can't get more fibers. Too many tasks in flight simultaneously?");
     fiber_ctx->current_task = t.desc;
     fiber_ctx->current_group = t.group;
     fiber_ctx->parent_fiber = t.parent_fiber;
@@ -237,28 +261,185 @@ void task_scheduler::release_fiber_context(fiber_context*&& fiber_ctx)
     XR_DEBUG_ASSERTION_MSG(fiber_ctx, "Can't release nullptr Fiber. fiber_ctx is nullptr");
 
     auto required_stack = fiber_ctx->required_stack;
+    fiber_pool& pool = get_fiber_pool(required_stack);
+    pool.record_stack_usage(*fiber_ctx);
     fiber_ctx->reset();
 
-    XR_DEBUG_ASSERTION_MSG(fiber_ctx != nullptr, "Fiber context can't be nullptr");
+    pool.release(fiber_ctx);
+    fiber_ctx = nullptr;
+}
 
-    bool res = false;
-    XR_UNREFERENCED_PARAMETER(res);
-    switch(required_stack)
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+fiber_pool& task_scheduler::get_fiber_pool(task_stack_request stack_request)
+{
+    XR_DEBUG_ASSERTION_MSG(stack_request == task_stack_request::small_stack ||
+        stack_request == task_stack_request::huge_stack, "Unknown stack requrements");
+
+    if(stack_request == task_stack_request::huge_stack)
+        return m_extended_fibers;
+
+    return m_standard_fibers;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_scheduler::trim_fiber_pools()
+{
+    sys::tick now = sys::now_milliseconds();
+    m_standard_fibers.trim(now, fiber_pool_trim_period_ms);
+    m_extended_fibers.trim(now, fiber_pool_trim_period_ms);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+fiber_pool_stats task_scheduler::get_fiber_pool_stats(task_stack_request stack_request) const
+{
+    if(stack_request == task_stack_request::huge_stack)
+        return m_extended_fibers.get_stats();
+
+    return m_standard_fibers.get_stats();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_scheduler::set_fiber_pool_limit(task_stack_request stack_request, uint32_t max_count)
+{
+    get_fiber_pool(stack_request).set_max_count(max_count);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t task_scheduler::query_fiber_stacks_large_page_size(task_stack_request stack_request) const
+{
+    if(stack_request == task_stack_request::huge_stack)
+        return m_extended_fibers.query_large_page_size();
+
+    return m_standard_fibers.query_large_page_size();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_scheduler::set_stack_usage_tracking(bool enabled)
+{
+    m_standard_fibers.set_stack_usage_tracking(enabled);
+    m_extended_fibers.set_stack_usage_tracking(enabled);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_scheduler::report_fiber_stack_usage(fiber_stack_usage_function function, pvoid user_data)
+{
+    m_standard_fibers.report_stack_usage(function, user_data, standard_fiber_stack_size);
+    m_extended_fibers.report_stack_usage(function, user_data, standard_fiber_stack_size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_scheduler::add_completion_poller(completion_poller_function function, pvoid user_data)
+{
+    XR_DEBUG_ASSERTION_MSG(function, "Invalid completion poller");
+    threading::scoped_lock lock { m_completion_pollers_lock };
+
+    uint32_t count = threading::atomic_fetch_acq(m_completion_pollers_count);
+    XR_DEBUG_ASSERTION_MSG(count < max_completion_pollers, "Too many completion pollers");
+    if(count >= max_completion_pollers)
+        return;
+
+    // slot past the count is never read, publishing the count is enough
+    m_completion_pollers[count] = completion_poller { function, user_data };
+    threading::atomic_store_rel(m_completion_pollers_count, count + 1);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Pollers are hidden until workers have left them, so poller can be destroyed right after return.
+ *  Must not be called from a poller.
+ */
+void task_scheduler::remove_completion_poller(completion_poller_function function, pvoid user_data)
+{
+    threading::scoped_lock lock { m_completion_pollers_lock };
+
+    uint32_t count = threading::atomic_fetch_acq(m_completion_pollers_count);
+    threading::atomic_store_seq(m_completion_pollers_count, uint32_t(0));
+
+    threading::default_atomic_backoff backoff {};
+    while(threading::atomic_fetch_seq(m_active_completion_polls) != 0)
+        backoff.pause();
+
+    for(uint32_t i = 0; i < count; ++i)
     {
-        case task_stack_request::small_stack:
-            res = m_standard_fibers_available.enqueue(eastl::move(fiber_ctx));
+        completion_poller& poller = m_completion_pollers[i];
+        if(poller.function == function && poller.user_data == user_data)
+        {
+            poller = m_completion_pollers[--count];
             break;
+        }
+    }
 
-        case task_stack_request::huge_stack:
-            res = m_extended_fibers_available.enqueue(eastl::move(fiber_ctx));
-            break;
+    threading::atomic_store_rel(m_completion_pollers_count, count);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Nothing is polled while no task waits, so idle scheduler costs one relaxed load here.
+ */
+uint32_t task_scheduler::poll_completions()
+{
+    if(threading::atomic_fetch_relax(m_awaiting_fibers_count) == 0)
+        return 0;
 
-        default:
-            XR_DEBUG_ASSERTION_MSG(false, "Unknown stack requrements");
+    threading::atomic_fetch_inc_seq(m_active_completion_polls);
+
+    uint32_t completed = 0;
+    uint32_t count = threading::atomic_fetch_seq(m_completion_pollers_count);
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        completion_poller const& poller = m_completion_pollers[i];
+        completed += poller.function(poller.user_data);
     }
 
-    XR_UNREFERENCED_PARAMETER(res);
-    XR_DEBUG_ASSERTION_MSG(res != false, "Can't return fiber to storage");
+    threading::atomic_dec_fetch_seq(m_active_completion_polls);
+    return completed;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Puts suspended fiber back into queues, it continues from the point it was suspended at.
+ */
+void task_scheduler::requeue_fiber(fiber_context* fiber_ctx, details::thread_context* helper_context)
+{
+    details::grouped_task storage;
+    details::task_bucket bucket;
+    utils::array_view<details::grouped_task> buffer(&storage, 1);
+    utils::array_view<details::task_bucket> buckets(&bucket, 1);
+
+    utils::static_vector<fiber_context*, 1> fibers_queue(1, fiber_ctx);
+    details::distibute_descriptions(task_group(task_group::assign_from_context),
+        fibers_queue.begin(), buffer, buckets);
+
+    run_tasks_internal(buckets, nullptr, true, helper_context, true);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Completion drops the guard taken in fiber_context::wait. If the worker is still switching away
+ *  from the fiber it holds the execution guard too, and resumes the fiber by itself.
+ */
+void task_scheduler::resume_awaiting_fiber(fiber_context* fiber_ctx)
+{
+    threading::atomic_dec_fetch_seq(m_awaiting_fibers_count);
+
+    if(threading::atomic_dec_fetch_seq(fiber_ctx->children_fibers_count) == 0)
+        requeue_fiber(fiber_ctx, nullptr);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -285,9 +466,16 @@ fiber_context* task_scheduler::execute_task(details::thread_context& thread_ctx,
     thread_ctx.notify_task_execute_state_changed(XR_SYSTEM_TASK_COLOR, XR_SYSTEM_TASK_NAME, task_execute_state::stop, XR_SYSTEM_FIBER_INDEX);
 #endif
 
+    record_telemetry_event(thread_ctx, telemetry_event_type::task_start, fiber_ctx->current_task.debug_id);
+
     // Run current task code
     fiber::switch_to(thread_ctx.scheduler_fiber, fiber_ctx->system_fiber);
 
+#if defined(XRAY_PLATFORM_LINUX)
+    // stacks on large pages have no guard page, canary is checked every time task fiber switches out
+    XR_DEBUG_ASSERTION_MSG(!fiber_ctx->system_fiber.is_stack_overflowed(), "Fiber stack overflow");
+#endif // defined(XRAY_PLATFORM_LINUX)
+
 #ifdef XR_INSTRUMENTED_BUILD
     thread_ctx.notify_task_execute_state_changed(XR_SYSTEM_TASK_COLOR, XR_SYSTEM_TASK_NAME, task_execute_state::start, XR_SYSTEM_FIBER_INDEX);
 #endif
@@ -296,61 +484,120 @@ fiber_context* task_scheduler::execute_task(details::thread_context& thread_ctx,
     auto task_status = fiber_ctx->get_status();
     if(task_status == fiber_task_status::FINISHED)
     {
-        task_group group = fiber_ctx->current_group;
-        task_group_description& group_desc = thread_ctx.current_scheduler->get_group_desc(group);
+        record_telemetry_event(thread_ctx, telemetry_event_type::task_stop);
+        return complete_task(thread_ctx, fiber_ctx);
+    }
 
-        // Update group status
-        int32_t group_task_count = group_desc.decrement();
-        XR_DEBUG_ASSERTION_MSG(group_task_count >= 0, "Sanity check failed!");
-        if(group_task_count == 0)
-            fiber_ctx->current_group = task_group::invalid;
+    XR_DEBUG_ASSERTION_MSG(task_status != fiber_task_status::RUNNED, "Incorrect task status");
+    record_telemetry_event(thread_ctx, telemetry_event_type::task_yield);
+    details::worker_counters::add(thread_ctx.counters.yields, 1);
+    return nullptr;
+}
 
-        // Update total task count
-        int32_t all_group_task_count = thread_ctx.current_scheduler->m_all_groups.decrement();
-        XR_UNREFERENCED_PARAMETER(all_group_task_count);
-        XR_DEBUG_ASSERTION_MSG(all_group_task_count >= 0, "Sanity check failed!");
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Runs task marked as run_to_completion directly on the scheduler fiber. Temporary fiber context
+ *  has no system fiber, so the task can't be suspended; it only carries the task bookkeeping.
+ */
+fiber_context* task_scheduler::execute_task_inline(details::thread_context& thread_ctx, details::grouped_task& task)
+{
+    XR_DEBUG_ASSERTION_MSG(thread_ctx.current_thread_id == sys::current_thread_id(),
+        "Thread context sanity check failed");
+    XR_DEBUG_ASSERTION_MSG(task.desc.is_valid(), "Invalid task");
+    XR_DEBUG_ASSERTION_MSG(task.awaiting_fiber == nullptr, "Run-to-completion task can't be resumed");
 
-        fiber_context* parent_fiber_context = fiber_ctx->parent_fiber;
-        if(parent_fiber_context != nullptr)
-        {
-            size_t children_fibers_count = threading::atomic_dec_fetch_seq(parent_fiber_context->children_fibers_count);
-            XR_DEBUG_ASSERTION_MSG(children_fibers_count >= 0, "Sanity check failed!");
+    fiber_context inline_ctx {};
+    inline_ctx.current_task = task.desc;
+    inline_ctx.current_group = task.group;
+    inline_ctx.parent_fiber = task.parent_fiber;
+    inline_ctx.required_stack = task.desc.required_stack;
+    inline_ctx.set_thread_context(&thread_ctx);
+    inline_ctx.set_status(fiber_task_status::RUNNED);
 
-            if(children_fibers_count == 0)
-            {
-                // This is a last subtask. Restore parent task
-                XR_DEBUG_ASSERTION_MSG(thread_ctx.current_thread_id == sys::current_thread_id(),
-                    "Thread context sanity check failed");
-                XR_DEBUG_ASSERTION_MSG(parent_fiber_context->get_thread_context() == nullptr,
-                    "Inactive parent should not have a valid thread context");
+#ifdef XR_INSTRUMENTED_BUILD
+    thread_ctx.notify_task_execute_state_changed(inline_ctx.current_task.debug_color,
+        inline_ctx.current_task.debug_id, task_execute_state::start, XR_SYSTEM_FIBER_INDEX);
+#endif
 
-                // WARNING!! Thread context can changed here! Set actual current thread context.
-                parent_fiber_context->set_thread_context(&thread_ctx);
+    record_telemetry_event(thread_ctx, telemetry_event_type::task_start, task.desc.debug_id);
+    task.desc.task_func(inline_ctx, task.desc.user_data);
+    inline_ctx.set_status(fiber_task_status::FINISHED);
+    record_telemetry_event(thread_ctx, telemetry_event_type::task_stop);
 
-                XR_DEBUG_ASSERTION_MSG(parent_fiber_context->get_thread_context()->current_thread_id == sys::current_thread_id(),
-                    "Thread context sanity check failed");
+#ifdef XR_INSTRUMENTED_BUILD
+    thread_ctx.notify_task_execute_state_changed(inline_ctx.current_task.debug_color,
+        inline_ctx.current_task.debug_id, task_execute_state::stop, XR_SYSTEM_FIBER_INDEX);
+#endif
 
-                // All subtasks is done.
-                // Exiting and return parent fiber to scheduler
-                return parent_fiber_context;
-            }
-            else
-            {
-                // Other subtasks still exist
-                // Exiting
-                return nullptr;
-            }
+    fiber_context* parent_fiber = complete_task(thread_ctx, &inline_ctx);
+    inline_ctx.reset();
+    return parent_fiber;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Updates group counters of finished task. Returns parent fiber if it was waiting for this task only.
+ */
+fiber_context* task_scheduler::complete_task(details::thread_context& thread_ctx, fiber_context* fiber_ctx)
+{
+    details::worker_counters::add(thread_ctx.counters.executed_tasks, 1);
+
+    task_group group = fiber_ctx->current_group;
+    task_group_description& group_desc = thread_ctx.current_scheduler->get_group_desc(group);
+
+    // Update group status
+    int32_t group_task_count = group_desc.decrement();
+    XR_DEBUG_ASSERTION_MSG(group_task_count >= 0, "Sanity check failed!");
+    if(group_task_count == 0)
+    {
+        fiber_ctx->current_group = task_group::invalid;
+        group_desc.notify_finished();
+    }
+
+    // Update total task count
+    task_group_description& all_groups = thread_ctx.current_scheduler->m_all_groups;
+    int32_t all_group_task_count = all_groups.decrement();
+    XR_DEBUG_ASSERTION_MSG(all_group_task_count >= 0, "Sanity check failed!");
+    if(all_group_task_count == 0)
+        all_groups.notify_finished();
+
+    fiber_context* parent_fiber_context = fiber_ctx->parent_fiber;
+    if(parent_fiber_context != nullptr)
+    {
+        size_t children_fibers_count = threading::atomic_dec_fetch_seq(parent_fiber_context->children_fibers_count);
+        XR_DEBUG_ASSERTION_MSG(children_fibers_count >= 0, "Sanity check failed!");
+
+        if(children_fibers_count == 0)
+        {
+            // This is a last subtask. Restore parent task
+            XR_DEBUG_ASSERTION_MSG(thread_ctx.current_thread_id == sys::current_thread_id(),
+                "Thread context sanity check failed");
+            XR_DEBUG_ASSERTION_MSG(parent_fiber_context->get_thread_context() == nullptr,
+                "Inactive parent should not have a valid thread context");
+
+            // WARNING!! Thread context can changed here! Set actual current thread context.
+            parent_fiber_context->set_thread_context(&thread_ctx);
+
+            XR_DEBUG_ASSERTION_MSG(parent_fiber_context->get_thread_context()->current_thread_id == sys::current_thread_id(),
+                "Thread context sanity check failed");
+
+            // All subtasks is done.
+            // Exiting and return parent fiber to scheduler
+            return parent_fiber_context;
         }
         else
         {
-            // Task is finished and no parent task
+            // Other subtasks still exist
             // Exiting
             return nullptr;
         }
     }
-
-    XR_DEBUG_ASSERTION_MSG(task_status != fiber_task_status::RUNNED, "Incorrect task status");
-    return nullptr;
+    else
+    {
+        // Task is finished and no parent task
+        // Exiting
+        return nullptr;
+    }
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -367,7 +614,6 @@ void task_scheduler::fiber_main(void* user_data)
             "Thread context sanity check failed");
 
 #ifdef XR_INSTRUMENTED_BUILD
-        fiber_ctx.fiber.SetName(MT_SYSTEM_TASK_FIBER_NAME);
         fiber_ctx.get_thread_context()->notify_task_execute_state_changed(fiber_ctx.current_task.debug_color,
             fiber_ctx.current_task.debug_id, task_execute_state::start, fiber_ctx.fiber_index);
 #endif
@@ -377,7 +623,6 @@ void task_scheduler::fiber_main(void* user_data)
         fiber_ctx.set_status(fiber_task_status::FINISHED);
 
 #ifdef XR_INSTRUMENTED_BUILD
-        fiber_ctx.fiber.set_name(MT_SYSTEM_TASK_FIBER_NAME);
         fiber_ctx.get_thread_context()->notify_task_execute_state_changed(fiber_ctx.current_task.debug_color,
             fiber_ctx.current_task.debug_id, task_execute_state::stop, fiber_ctx.fiber_index);
 #endif
@@ -391,7 +636,49 @@ void task_scheduler::fiber_main(void* user_data)
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
-bool task_scheduler::try_steal_task(details::thread_context& thread_context, details::grouped_task& task)
+bool task_scheduler::try_pop_overflow_task(details::thread_context& thread_context, details::grouped_task& task)
+{
+    task_scheduler& scheduler = *thread_context.current_scheduler;
+    if(!scheduler.m_overflow_tasks.dequeue(task))
+        return false;
+
+    // one slot got free, let blocked submitters continue
+    scheduler.m_overflow_space_lot.unpark_one();
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool task_scheduler::try_steal_task(details::thread_context& thread_context, 
+    details::grouped_task& task, size_t lowest_priority)
+{
+    task_scheduler& scheduler = *thread_context.current_scheduler;
+
+    // temporary contexts of waiting threads have no place in topology
+    bool stolen = (scheduler.get_steal_policy() == steal_policy::hierarchical &&
+        thread_context.current_worker_index < scheduler.get_workers_count()) ?
+        try_steal_hierarchical(thread_context, task, lowest_priority) :
+        try_steal_uniform(thread_context, task, lowest_priority);
+
+    if(stolen)
+    {
+        record_telemetry_event(thread_context, telemetry_event_type::steal);
+        details::worker_counters::add(thread_context.counters.steals, 1);
+    }
+    else
+    {
+        details::worker_counters::add(thread_context.counters.failed_steals, 1);
+    }
+
+    return stolen;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool task_scheduler::try_steal_uniform(details::thread_context& thread_context,
+    details::grouped_task& task, size_t lowest_priority)
 {
     auto workers_count = thread_context.current_scheduler->get_workers_count();
     auto victim_index = thread_context.random.get();
@@ -406,7 +693,7 @@ bool task_scheduler::try_steal_task(details::thread_context& thread_context, det
         }
 
         auto& victim_context = thread_context.current_scheduler->m_thread_context[index];
-        if(victim_context.queue.try_pop_newest(task))
+        if(victim_context.queue.try_steal(task, lowest_priority))
             return true;
 
         victim_index++;
@@ -415,6 +702,39 @@ bool task_scheduler::try_steal_task(details::thread_context& thread_context, det
     return false;
 }
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Tries all victims of nearest tier in random order before moving to farther tier.
+ */
+bool task_scheduler::try_steal_hierarchical(details::thread_context& thread_context,
+    details::grouped_task& task, size_t lowest_priority)
+{
+    const details::steal_order& order = thread_context.steal_victims;
+    uint32_t tier_begin = 0;
+
+    for(uint32_t tier = 0; tier < static_cast<uint32_t>(details::steal_tier::count); ++tier)
+    {
+        uint32_t tier_end = order.tier_end[tier];
+        uint32_t tier_size = tier_end - tier_begin;
+
+        if(tier_size)
+        {
+            uint32_t start = thread_context.random.get() % tier_size;
+            for(uint32_t i = 0; i < tier_size; ++i)
+            {
+                uint32_t index = order.victims[tier_begin + (start + i) % tier_size];
+                auto& victim_context = thread_context.current_scheduler->m_thread_context[index];
+                if(victim_context.queue.try_steal(task, lowest_priority))
+                    return true;
+            }
+        }
+
+        tier_begin = tier_end;
+    }
+
+    return false;
+}
+
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
@@ -423,6 +743,7 @@ uint32_t task_scheduler::worker_thread_main(void* user_data)
     details::thread_context& context = *reinterpret_cast<details::thread_context*>(user_data);
     XR_DEBUG_ASSERTION_MSG(context.current_scheduler, "Task scheduler must be not null!");
     context.current_thread_id = sys::current_thread_id();
+    context.queue.bind_owner(context.current_thread_id);
     context.scheduler_fiber.create_from_thread_and_run(scheduler_fiber_main, user_data);
     return 0;
 }
@@ -435,7 +756,7 @@ void task_scheduler::scheduler_fiber_wait(void* user_data)
     wait_context_desc& wait_context = *reinterpret_cast<wait_context_desc*>(user_data);
     details::thread_context& context = *wait_context.thread_ctx;
     XR_DEBUG_ASSERTION_MSG(context.current_scheduler, "Task scheduler must be not null!");
-    XR_DEBUG_ASSERTION_MSG(wait_context.wait_counter, "Wait counter must be not null!");
+    XR_DEBUG_ASSERTION_MSG(wait_context.group_desc, "Wait group must be not null!");
 
 #ifdef XR_INSTRUMENTED_BUILD
     context.notify_temporary_worker_thread_join();
@@ -444,31 +765,41 @@ void task_scheduler::scheduler_fiber_wait(void* user_data)
     context.notify_task_execute_state_changed(XR_SYSTEM_TASK_COLOR, XR_SYSTEM_TASK_NAME, task_execute_state::start, XR_SYSTEM_FIBER_INDEX);
 #endif
 
-    sys::tick time_out = sys::now_milliseconds() + (wait_context.wait_time_ms * 1000U);
-    threading::default_atomic_backoff backoff {};
+    sys::tick deadline_us = sys::infinite;
+    if(wait_context.wait_time_ms != infinite_wait_time)
+        deadline_us = sys::now_microseconds() + sys::tick(wait_context.wait_time_ms) * 1000U;
 
+    volatile int32_t& wait_counter = wait_context.group_desc->get_wait_counter();
+    uint32_t executed_steps = 0;
     for(;;)
     {
-        if(!scheduler_fiber_step(context))
-            backoff.pause();
-        else
-            backoff.reset();
-
-        uint32_t group_task_count = threading::atomic_fetch_acq(*wait_context.wait_counter);
-        if(group_task_count == 0)
+        if(threading::atomic_fetch_acq(wait_counter) == 0)
         {
             wait_context.exit_code = 0;
             break;
         }
 
-        sys::tick time_now = sys::now_milliseconds();
-        if(time_now >= time_out)
+        // Help while there is something to execute, clock is read only once in a while
+        bool in_time = true;
+        if(scheduler_fiber_step(context))
+        {
+            if((++executed_steps % wait_deadline_check_steps) == 0 && deadline_us != sys::infinite)
+                in_time = sys::now_microseconds() < deadline_us;
+        }
+        else
         {
-            wait_context.exit_code = 1;
+            in_time = scheduler_fiber_wait_idle(wait_context, deadline_us);
+        }
+
+        if(!in_time)
+        {
+            wait_context.exit_code = (threading::atomic_fetch_acq(wait_counter) == 0) ? 0 : 1;
             break;
         }
     }
 
+    context.counters.merge_to(context.current_scheduler->m_external_counters);
+
 #ifdef XR_INSTRUMENTED_BUILD
     context.notify_task_execute_state_changed(XR_SYSTEM_TASK_COLOR, XR_SYSTEM_TASK_NAME, task_execute_state::stop, XR_SYSTEM_FIBER_INDEX);
     context.notify_wait_finished();
@@ -477,6 +808,54 @@ void task_scheduler::scheduler_fiber_wait(void* user_data)
 #endif
 }
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Waits until group is finished, new work appears or deadline expires.
+ *  Returns false if deadline expired.
+ */
+bool task_scheduler::scheduler_fiber_wait_idle(wait_context_desc& wait_context, sys::tick deadline_us)
+{
+    details::thread_context& context = *wait_context.thread_ctx;
+    volatile int32_t& wait_counter = wait_context.group_desc->get_wait_counter();
+
+    // Bounded spin first: group usually finishes or gets new work soon
+    threading::default_atomic_backoff backoff {};
+    while(backoff.bounded_pause())
+    {
+        if(threading::atomic_fetch_acq(wait_counter) == 0 || has_pending_tasks(context) ||
+            context.current_scheduler->poll_completions())
+            return true;
+    }
+
+    threading::parking_lot& lot = wait_context.group_desc->get_waiters();
+    uint32_t ticket = lot.prepare_park();
+
+    // re-check after registering as parked, otherwise wakeup may be lost
+    if(threading::atomic_fetch_acq(wait_counter) == 0 || has_pending_tasks(context))
+    {
+        lot.cancel_park();
+        return true;
+    }
+
+    sys::tick timeout_ms = sys::infinite;
+    if(deadline_us != sys::infinite)
+    {
+        sys::tick now_us = sys::now_microseconds();
+        if(now_us >= deadline_us)
+        {
+            lot.cancel_park();
+            return false;
+        }
+
+        timeout_ms = (deadline_us - now_us + 999U) / 1000U;
+    }
+
+    // Workers don't unpark group waiters on new work, so park in short slices and look at
+    // queues again: waiter helps only if workers lag behind
+    lot.commit_park(ticket, eastl::min<sys::tick>(timeout_ms, wait_help_period_ms));
+    return deadline_us == sys::infinite || sys::now_microseconds() < deadline_us;
+}
+
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
@@ -486,7 +865,7 @@ void task_scheduler::scheduler_fiber_main(void* user_data)
     XR_DEBUG_ASSERTION_MSG(context.current_scheduler, "Task scheduler must be not null!");
 
 #ifdef XR_INSTRUMENTED_BUILD
-    context.notify_thread_created(context.worker_index);
+    context.notify_thread_created(context.current_worker_index);
 #endif
 
     uint32_t total_threads_count = threading::atomic_fetch_acq(context.current_scheduler->m_threads_count);
@@ -508,71 +887,99 @@ void task_scheduler::scheduler_fiber_main(void* user_data)
     XR_MEMORY_FULLCONSISTENCY_BARRIER;
 
 #ifdef XR_INSTRUMENTED_BUILD
-    context.notify_thread_started(context.worker_index);
+    context.notify_thread_started(context.current_worker_index);
     context.notify_task_execute_state_changed(XR_SYSTEM_TASK_COLOR, XR_SYSTEM_TASK_NAME, task_execute_state::start, XR_SYSTEM_FIBER_INDEX);
 #endif
 
+    bool unparked = false;
     while(threading::atomic_fetch_acq(context.state) != (uint32_t)details::thread_state::EXIT)
     {
-        if(!scheduler_fiber_step(context))
+        if(scheduler_fiber_step(context))
         {
+            unparked = false;
+            continue;
+        }
+
+        if(unparked)
+        {
+            // somebody else has taken the work we were woken for
+            context.current_scheduler->m_parking_lot.report_spurious_wakeup();
+            unparked = false;
+        }
+
 #ifdef XR_INSTRUMENTED_BUILD
-            context.notify_thread_idle_started(context.worker_index);
+        context.notify_thread_idle_started(context.current_worker_index);
 #endif
 
-#if XR_EXPERIMENTAL_WAIT
-            SpinWait spinWait;
+        record_telemetry_event(context, telemetry_event_type::idle_start);
+        uint64_t idle_start = sys::cpu_timestamp();
 
-            for(;;)
-            {
-                // queue is empty and stealing attempt has failed.
-                // Fast Spin Wait for new tasks
-                if(spinWait.SpinOnce() >= SpinWait::YIELD_SLEEP0_THRESHOLD)
-                {
-                    // Fast Spin wait for new tasks has failed.
-                    // Wait for new events using events
-                    context.has_new_tasks_event.wait(20000);
+        unparked = scheduler_fiber_idle(context);
 
-                    spinWait.reset();
+        details::worker_counters::add(context.counters.idle_ticks, sys::cpu_timestamp() - idle_start);
+        record_telemetry_event(context, telemetry_event_type::idle_stop);
 
 #ifdef XR_INSTRUMENTED_BUILD
-                    context.notify_thread_idle_finished(context.worker_index);
+        context.notify_thread_idle_finished(context.current_worker_index);
 #endif
+    } // main thread loop
 
-                    break;
-                }
-
-                details::grouped_task task;
-                if(context.queue.try_pop_oldest(task))
-                {
 #ifdef XR_INSTRUMENTED_BUILD
-                    context.notify_thread_idle_finished(context.worker_index);
+    context.notify_task_execute_state_changed(XR_SYSTEM_TASK_COLOR, XR_SYSTEM_TASK_NAME, task_execute_state::stop, XR_SYSTEM_FIBER_INDEX);
+    context.notify_thread_stopped(context.current_worker_index);
 #endif
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool task_scheduler::has_pending_tasks(details::thread_context& context)
+{
+    if(!context.queue.is_empty() || !context.current_scheduler->m_overflow_tasks.is_empty())
+        return true;
 
-                    scheduler_fiber_process_task(context, task);
+    uint32_t workers_count = context.current_scheduler->get_workers_count();
+    for(uint32_t i = 0; i < workers_count; ++i)
+    {
+        if(!context.current_scheduler->m_thread_context[i].queue.is_empty())
+            return true;
+    }
 
-                    break;
-                }
+    return false;
+}
 
-            }
-#else
-            // queue is empty and stealing attempt has failed.
-            // Wait for new events using events
-            context.has_new_tasks_event.wait_timeout(20000);
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool task_scheduler::scheduler_fiber_idle(details::thread_context& context)
+{
+    // Bounded spin first: new work often arrives shortly after the queue got drained
+    threading::default_atomic_backoff backoff {};
+    while(backoff.bounded_pause())
+    {
+        if(has_pending_tasks(context) || context.current_scheduler->poll_completions())
+            return false;
+    }
 
-#ifdef XR_INSTRUMENTED_BUILD
-            context.notify_thread_idle_finished(context.worker_index);
-#endif
+    // good moment to give back stacks nobody needed recently
+    context.current_scheduler->trim_fiber_pools();
 
-#endif
+    threading::parking_lot& lot = context.current_scheduler->m_parking_lot;
+    uint32_t ticket = lot.prepare_park();
 
-        }
-    } // main thread loop
+    // re-check after registering as parked, otherwise wakeup may be lost
+    if(has_pending_tasks(context) ||
+        threading::atomic_fetch_acq(context.state) == (uint32_t)details::thread_state::EXIT)
+    {
+        lot.cancel_park();
+        return false;
+    }
 
-#ifdef XR_INSTRUMENTED_BUILD
-    context.notify_task_execute_state_changed(XR_SYSTEM_TASK_COLOR, XR_SYSTEM_TASK_NAME, task_execute_state::stop, XR_SYSTEM_FIBER_INDEX);
-    context.notify_thread_stopped(context.worker_index);
-#endif
+    // nobody is dedicated to completions, so wake up soon to poll them while tasks wait
+    sys::tick timeout_ms = threading::atomic_fetch_relax(context.current_scheduler->m_awaiting_fibers_count) ?
+        completion_poll_timeout_ms : sys::infinite;
+
+    return lot.commit_park(ticket, timeout_ms) == threading::park_result::unparked;
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -584,11 +991,29 @@ void task_scheduler::scheduler_fiber_process_task(details::thread_context& conte
     bool isNewTask = (task.awaiting_fiber == nullptr);
 #endif
 
-    // There is a new task
-    fiber_context* fiber_ctx = context.current_scheduler->request_fiber_context(task);
-    XR_DEBUG_ASSERTION_MSG(fiber_ctx, "Can't get execution context from pool");
+    fiber_context* fiber_ctx = nullptr;
+    if(task.awaiting_fiber == nullptr && task.desc.required_stack == task_stack_request::run_to_completion)
+    {
+        // Leaf task: no fiber is needed, continue with parent fiber if this was its last subtask
+        fiber_ctx = execute_task_inline(context, task);
+        if(!fiber_ctx)
+            return;
+    }
+    else
+    {
+        // There is a new task
+        fiber_ctx = context.current_scheduler->request_fiber_context(task);
+        if(!fiber_ctx)
+        {
+            // No fiber until some running task finishes: task goes behind queued work, resumed fibers included
+            context.current_scheduler->return_task(context, task);
+            return;
+        }
+
+        XR_DEBUG_ASSERTION_MSG(fiber_ctx->required_stack == task.desc.required_stack, "Sanity check failed");
+    }
+
     XR_DEBUG_ASSERTION_MSG(fiber_ctx->current_task.is_valid(), "Task validation check failed");
-    XR_DEBUG_ASSERTION_MSG(fiber_ctx->required_stack == task.desc.required_stack, "Sanity check failed");
 
     while(fiber_ctx)
     {
@@ -638,18 +1063,7 @@ void task_scheduler::scheduler_fiber_process_task(details::thread_context& conte
             if(task_status == fiber_task_status::YIELDED)
             {
                 // Task is yielded, add to tasks queue
-                utils::array_view<details::grouped_task> buffer(context.desc_buffer, 1);
-                utils::array_view<details::task_bucket> buckets(
-                    XR_STACK_ALLOCATE_MEMORY(sizeof(details::task_bucket)), 1);
-
-                fiber_context* yieldedTask = fiber_ctx;
-                utils::static_vector<fiber_context*, 1> yielded_tasks_queue(1, yieldedTask);
-
-                details::distibute_descriptions(task_group(task_group::assign_from_context),
-                    yielded_tasks_queue.begin(), buffer, buckets);
-
-                // add yielded task to scheduler
-                context.current_scheduler->run_tasks_internal(buckets, nullptr, true);
+                context.current_scheduler->requeue_fiber(fiber_ctx, &context);
 
                 // ATENTION! yielded task can be already completed at this point
 
@@ -665,40 +1079,64 @@ void task_scheduler::scheduler_fiber_process_task(details::thread_context& conte
 bool task_scheduler::scheduler_fiber_step(details::thread_context& context)
 {
     details::grouped_task task;
+    task_scheduler& scheduler = *context.current_scheduler;
+
+    // Busy worker looks at completions once in a while, resumed tasks get into queues below
+    if((++context.completion_poll_steps % completion_poll_period_steps) == 0)
+        scheduler.poll_completions();
+
+    // Strict priority across workers: high priority work is taken from anywhere
+    // before any lower priority work from the local queue.
+    constexpr size_t high_priority = task_priority_enum::high;
+    constexpr size_t lowest_priority = details::max_priority_count - 1;
 
     bool from_foreign_context = false;
-    bool from_current_context = context.queue.try_pop_oldest(task);
-    if(!from_current_context)
+    bool from_current_context = context.queue.try_pop(task, high_priority);
+    if(!from_current_context && threading::atomic_fetch_acq(scheduler.m_pending_high_priority_count))
+        from_foreign_context = try_steal_task(context, task, high_priority);
+
+    if(!from_current_context && !from_foreign_context)
     {
-        from_foreign_context = try_steal_task(context, task);
+        from_current_context = context.queue.try_pop(task, lowest_priority);
+        if(!from_current_context)
+        {
+            from_foreign_context = try_pop_overflow_task(context, task) ||
+                try_steal_task(context, task, lowest_priority);
+        }
     }
 
     if(from_current_context || from_foreign_context)
     {
+        if(task.desc.priority == task_priority_enum::high)
+            threading::atomic_fetch_sub_seq(scheduler.m_pending_high_priority_count, 1U);
+
         scheduler_fiber_process_task(context, task);
         return true;
     }
 
-    return false;
+    // Queues are drained, resumed tasks are picked up by the next step
+    return scheduler.poll_completions() != 0;
 }
 
 //-----------------------------------------------------------------------------------------------------------
 /**
+ *  Puts back task that was taken from queues but can't be started yet, counters already account for it.
  */
-void task_scheduler::run_tasks_internal(utils::array_view<details::task_bucket>& buckets, 
-    fiber_context* parent_fiber, bool restored_from_awaiting)
+void task_scheduler::return_task(details::thread_context& context, const details::grouped_task& task)
 {
-#if XR_EXPERIMENTAL_WAIT
-    // Early wakeup worker threads (worker thread spin wait for some time before sleep)
-    int32 round_robin_index = m_round_robin_thread_index.LoadRelaxed();
-    for(size_t i = 0; i < buckets.size(); ++i)
-    {
-        int bucket_index = ((round_robin_index + i) % m_threads_count.LoadRelaxed());
-        details::thread_context& context = thread_ctx[bucket_index];
-        context.has_new_tasks_event.set(true);
-    }
-#endif
+    if(task.desc.priority == task_priority_enum::high)
+        threading::atomic_fetch_add_seq(m_pending_high_priority_count, 1U);
 
+    spill_overflow_tasks(&task, 1, &context, true);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_scheduler::run_tasks_internal(utils::array_view<details::task_bucket>& buckets, 
+    fiber_context* parent_fiber, bool restored_from_awaiting, details::thread_context* submitter_context,
+    bool from_scheduler_fiber)
+{
     // This storage is necessary to calculate how many tasks we add to different groups
     uint32_t new_task_count_in_group[task_group::max_groups_count];
     // Default value is 0
@@ -708,6 +1146,7 @@ void task_scheduler::run_tasks_internal(utils::array_view<details::task_bucket>&
     // Calculate the number of tasks per group
     // Calculate total number of tasks
     size_t count = 0;
+    uint32_t high_priority_count = 0;
     for(size_t i = 0; i < buckets.size(); ++i)
     {
         details::task_bucket& bucket = buckets[i];
@@ -719,6 +1158,9 @@ void task_scheduler::run_tasks_internal(utils::array_view<details::task_bucket>&
             int idx = task.group.get_valid_index();
             XR_DEBUG_ASSERTION_MSG(idx >= 0 && idx < task_group::max_groups_count, "Invalid index");
             new_task_count_in_group[idx]++;
+
+            if(task.desc.priority == task_priority_enum::high)
+                high_priority_count++;
         }
 
         count += bucket.count;
@@ -746,6 +1188,10 @@ void task_scheduler::run_tasks_internal(utils::array_view<details::task_bucket>&
         // If task's restored from await state, counters already in correct state
     }
 
+    // counted before tasks become visible, so the counter never drops below the queued ones
+    if(high_priority_count)
+        threading::atomic_fetch_add_seq(m_pending_high_priority_count, high_priority_count);
+
     // add to thread queue
     for(size_t i = 0; i < buckets.size(); ++i)
     {
@@ -753,21 +1199,85 @@ void task_scheduler::run_tasks_internal(utils::array_view<details::task_bucket>&
         details::thread_context& context = m_thread_context[bucket_index];
         details::task_bucket& bucket = buckets[i];
 
-        for(;;)
+        XR_DEBUG_ASSERTION_MSG(bucket.count < (details::max_task_buffer_capacity - 1),
+            "Sanity check failed. Too many tasks per one bucket.");
+
+        size_t added = context.queue.add(bucket.tasks, bucket.count);
+        if(added != bucket.count)
         {
-            XR_DEBUG_ASSERTION_MSG(bucket.count < (details::max_task_buffer_capacity - 1),
-                "Sanity check failed. Too many tasks per one bucket.");
+            // Can't add new tasks onto the queue. Look like the job system is overloaded.
+            threading::atomic_fetch_inc_seq(m_overflow_count);
+            spill_overflow_tasks(bucket.tasks + added, bucket.count - added, submitter_context, from_scheduler_fiber);
+        }
+    }
 
-            bool res = context.queue.add(bucket.tasks, bucket.count);
-            if(res == true) break;
+    // one wakeup per bucket at most, no syscalls if nobody is parked
+    m_parking_lot.unpark(static_cast<uint32_t>(buckets.size()));
+}
 
-            // Can't add new tasks onto the queue. Look like the job system is overloaded.
-            // Wait some time and try again.
-            // TODO: implement waiting until workers done using events.
-            sys::yield(10);
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Worker never waits for space while it can make progress by itself: new run-to-completion task is
+ *  executed right here on the submitter stack, worker on its scheduler fiber takes any task from queues.
+ *  Only submitters that can do neither wait for overflow space, the workers keep draining it meanwhile.
+ */
+void task_scheduler::spill_overflow_tasks(const details::grouped_task* tasks, size_t count,
+    details::thread_context* submitter_context, bool from_scheduler_fiber)
+{
+    constexpr sys::tick overflow_wait_timeout_ms = 1;
+
+    size_t added = 0;
+    while(added < count)
+    {
+        if(m_overflow_tasks.enqueue(tasks[added]))
+        {
+            ++added;
+            continue;
+        }
+
+        // Overflow queue is full too: make sure everybody is draining it
+        m_parking_lot.unpark_all();
+
+        // Nested steps may spill again, depth keeps scheduler stack bounded
+        if(submitter_context && submitter_context->spill_depth < max_spill_help_depth)
+        {
+            details::thread_context& context = *submitter_context;
+            details::grouped_task task = tasks[added];
+            bool progressed = false;
+
+            ++context.spill_depth;
+            if(task.awaiting_fiber == nullptr && task.desc.required_stack == task_stack_request::run_to_completion)
+            {
+                if(task.desc.priority == task_priority_enum::high)
+                    threading::atomic_fetch_sub_seq(m_pending_high_priority_count, 1U);
+
+                // Parent is resumed through queues, this stack may belong to another task
+                if(fiber_context* parent_fiber = execute_task_inline(context, task))
+                    requeue_fiber(parent_fiber, from_scheduler_fiber ? &context : nullptr);
+
+                ++added;
+                progressed = true;
+            }
+            else if(from_scheduler_fiber)
+            {
+                progressed = scheduler_fiber_step(context);
+            }
+            --context.spill_depth;
+
+            if(progressed)
+                continue;
+        }
+
+        uint32_t ticket = m_overflow_space_lot.prepare_park();
+        if(m_overflow_tasks.enqueue(tasks[added]))
+        {
+            m_overflow_space_lot.cancel_park();
+            ++added;
+            continue;
         }
 
-        context.has_new_tasks_event.set(true);
+        // Timeout guards against a submitter that is also the last worker able to drain
+        m_overflow_space_lot.commit_park(ticket, overflow_wait_timeout_ms);
     }
 }
 
@@ -793,7 +1303,7 @@ signalling_bool task_scheduler::wait_group(task_group group, uint32_t millisecon
 
     wait_context_desc wait_context {};
     wait_context.thread_ctx = &context;
-    wait_context.wait_counter = &group_desc.get_wait_counter();
+    wait_context.group_desc = &group_desc;
     wait_context.wait_time_ms = milliseconds;
 
     uint32_t next_slot = threading::atomic_fetch_inc_seq(m_next_awaiting_master_index);
@@ -827,7 +1337,7 @@ signalling_bool task_scheduler::wait_all(uint32_t milliseconds)
 
     wait_context_desc wait_context {};
     wait_context.thread_ctx = &context;
-    wait_context.wait_counter = &m_all_groups.get_wait_counter();
+    wait_context.group_desc = &m_all_groups;
     wait_context.wait_time_ms = milliseconds;
 
     uint32_t next_slot = threading::atomic_fetch_inc_seq(m_next_awaiting_master_index);
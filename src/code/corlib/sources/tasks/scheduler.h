@@ -5,11 +5,13 @@
 
 #include "thread_context.h"
 #include "fiber_context.h"
+#include "fiber_pool.h"
 #include "mpmc_queue.h"
 #include "corlib/tasks/details/grouped_task.h"
 #include "corlib/memory/memory_aligned_allocator.h"
 #include "corlib/utils/static_vector.h"
 #include "corlib/sys/thread.h"
+#include "corlib/threading/parking_lot.h"
 
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, tasks, details)
@@ -61,6 +63,18 @@ public:
         return m_in_progress_task_count;
     }
 
+    // Threads waiting for this group to become empty
+    threading::parking_lot& get_waiters()
+    {
+        return m_waiters;
+    }
+
+    // Called after decrement that made group empty
+    void notify_finished()
+    {
+        m_waiters.unpark_all();
+    }
+
 #if defined(DEBUG)
     void set_debug_is_free(bool debug_is_free)
     {
@@ -75,22 +89,35 @@ public:
 
 private:
     threading::atomic_int32 m_in_progress_task_count;
+    threading::parking_lot m_waiters;
 
 #if defined(DEBUG)
     bool m_debug_is_free;
 #endif // defined(DEBUG)
 }; // class task_group_description
 
+//-----------------------------------------------------------------------------------------------------------
+enum class steal_policy : uint32_t
+{
+    //! victims are picked randomly among all workers
+    uniform,
+    //! SMT sibling first, then same last level cache, same node and remote workers
+    hierarchical
+}; // enum class steal_policy
+
 //-----------------------------------------------------------------------------------------------------------
 class task_scheduler : public scheduler
 {
 public:
     /// \brief Initializes a new instance of the task_scheduler class.
     /// \param workerThreadsCount Worker threads count. Automatically determines the required number of threads if workerThreadsCount set to 0
+    /// \param fiberStackPages Large pages put fiber stacks on fewer TLB entries, see fiber_pool_desc::stack_pages
 #ifdef XR_INSTRUMENTED_BUILD
-    task_scheduler(memory::base_allocator& alloc, uint32_t workerThreadsCount = 0, base_profiler_event_listener* listener = nullptr);
+    task_scheduler(memory::base_allocator& alloc, uint32_t workerThreadsCount = 0,
+        memory::page_kind fiberStackPages = memory::page_kind::normal, base_profiler_event_listener* listener = nullptr);
 #else
-    task_scheduler(memory::base_allocator& alloc, uint32_t workerThreadsCount = 0);
+    task_scheduler(memory::base_allocator& alloc, uint32_t workerThreadsCount = 0,
+        memory::page_kind fiberStackPages = memory::page_kind::normal);
 #endif
 
 
@@ -107,14 +134,52 @@ public:
     task_group create_group();
     void release_group(task_group group);
 
+    void set_frame_allocator(memory::frame_allocator* allocator);
+    memory::frame_allocator* get_frame_allocator() const;
+
     uint32_t get_workers_count() const;
 
     bool is_worker_thread() const;
 
     memory::base_allocator& get_allocator();
 
+    threading::parking_lot_stats get_idle_stats() const;
+
+    fiber_pool_stats get_fiber_pool_stats(task_stack_request stack_request) const;
+    void set_fiber_pool_limit(task_stack_request stack_request, uint32_t max_count);
+    // Bytes of fiber stacks that actually got large pages
+    size_t query_fiber_stacks_large_page_size(task_stack_request stack_request) const;
+
+    // Debug mode that paints fiber stacks and keeps deepest stack use of every task type
+    void set_stack_usage_tracking(bool enabled);
+    // Calls function for every task type measured while tracking was enabled
+    void report_fiber_stack_usage(fiber_stack_usage_function function, pvoid user_data);
+
+    // How many times submitted tasks didn't fit into worker queues, tasks put back for lack of
+    // fibers are counted by fiber pool stats
+    uint64_t get_overflow_count() const;
+
+    void set_steal_policy(steal_policy policy);
+    steal_policy get_steal_policy() const;
+
+    // Hardware thread worker is pinned to
+    uint32_t get_worker_hardware_thread(uint32_t worker_index) const;
+
+    // Counters are always gathered, events are recorded only while telemetry is enabled
+    void set_telemetry_enabled(bool enabled);
+    bool is_telemetry_enabled() const;
+
+    void get_worker_counters(uint32_t worker_index, worker_telemetry_counters& counters) const;
+    void get_telemetry_counters(scheduler_telemetry_counters& counters) const;
+
+    // Writes recent events of all workers as Chrome trace JSON
+    void export_chrome_trace(telemetry_write_function write, pvoid user_data);
+
+    void add_completion_poller(completion_poller_function function, pvoid user_data);
+    void remove_completion_poller(completion_poller_function function, pvoid user_data);
+
 #ifdef XR_INSTRUMENTED_BUILD
-    base_profiler_event_listener* get_profiler_event_listener()
+    base_profiler_event_listener* get_profiler_event_listener();
     void notify_fibers_created(uint32_t fibers_count);
     void notify_threads_created(uint32_t threads_count);
 #endif
@@ -127,38 +192,81 @@ protected:
 
 private:
     friend class fiber_context;
+    friend class awaitable;
     friend struct details::thread_context;
 
     static constexpr uint32_t max_awaiting_contexts = 4;
     static constexpr uint32_t max_thread_count = 64;
-    static constexpr uint32_t max_standard_fibers_count = 256;
-    static constexpr uint32_t max_extended_fibers_count = 8;
+    static constexpr uint32_t initial_standard_fibers_count = 32;
+    static constexpr uint32_t max_standard_fibers_count = 1024;
+    static constexpr uint32_t initial_extended_fibers_count = 2;
+    static constexpr uint32_t max_extended_fibers_count = 32;
+    static constexpr sys::tick fiber_pool_trim_period_ms = 5000;
+    //! parked waiter looks at queues this often in case workers can't keep up
+    static constexpr sys::tick wait_help_period_ms = 10;
+    //! waiter that keeps executing tasks checks its deadline after this many tasks
+    static constexpr uint32_t wait_deadline_check_steps = 64;
+    static constexpr uint32_t max_completion_pollers = 8;
+    //! busy worker polls completions once per this many tasks
+    static constexpr uint32_t completion_poll_period_steps = 8;
+    //! idle worker sleeps this long while some task waits for completion
+    static constexpr sys::tick completion_poll_timeout_ms = 1;
+    //! worker waiting for overflow space runs nested scheduler steps at most this deep
+    static constexpr uint32_t max_spill_help_depth = 4;
 
     struct wait_context_desc
     {
-        volatile int32_t* wait_counter { nullptr };
+        task_group_description* group_desc { nullptr };
         details::thread_context* thread_ctx { nullptr };
-        sys::tick wait_time_ms { 0 };
+        uint32_t wait_time_ms { 0 };
         uint32_t exit_code { 0 };
     };
 
+    struct completion_poller
+    {
+        completion_poller_function function { nullptr };
+        pvoid user_data { nullptr };
+    };
+
     fiber_context* request_fiber_context(details::grouped_task& task);
     void release_fiber_context(fiber_context*&& execution_context);
+    fiber_pool& get_fiber_pool(task_stack_request stack_request);
+    void trim_fiber_pools();
 
     void run_tasks_internal(utils::array_view<details::task_bucket>& buckets,
-        fiber_context* parent_fiber, bool restored_from_awaiting);
+        fiber_context* parent_fiber, bool restored_from_awaiting,
+        details::thread_context* submitter_context = nullptr, bool from_scheduler_fiber = false);
+
+    void spill_overflow_tasks(const details::grouped_task* tasks, size_t count,
+        details::thread_context* submitter_context, bool from_scheduler_fiber);
+    void return_task(details::thread_context& context, const details::grouped_task& task);
 
     task_group_description& get_group_desc(task_group group);
 
+    void requeue_fiber(fiber_context* fiber_ctx, details::thread_context* helper_context);
+    void resume_awaiting_fiber(fiber_context* fiber_ctx);
+    uint32_t poll_completions();
+
     static uint32_t worker_thread_main(void* user_data);
     static void scheduler_fiber_main(void* user_data);
     static void scheduler_fiber_wait(void* user_data);
     static bool scheduler_fiber_step(details::thread_context& thread_ctx);
+    static bool scheduler_fiber_idle(details::thread_context& thread_ctx);
+    static bool scheduler_fiber_wait_idle(wait_context_desc& wait_context, sys::tick deadline_us);
+    static bool has_pending_tasks(details::thread_context& thread_ctx);
     static void scheduler_fiber_process_task(details::thread_context& context, details::grouped_task& task);
     static void fiber_main(void* user_data);
-    static bool try_steal_task(details::thread_context& thread_ctx, details::grouped_task& task);
+    static bool try_pop_overflow_task(details::thread_context& thread_ctx, details::grouped_task& task);
+    static bool try_steal_task(details::thread_context& thread_ctx, details::grouped_task& task,
+        size_t lowest_priority = details::max_priority_count - 1);
+    static bool try_steal_uniform(details::thread_context& thread_ctx, details::grouped_task& task,
+        size_t lowest_priority);
+    static bool try_steal_hierarchical(details::thread_context& thread_ctx, details::grouped_task& task,
+        size_t lowest_priority);
 
     static fiber_context* execute_task(details::thread_context& thread_ctx, fiber_context* fiber_ctx);
+    static fiber_context* execute_task_inline(details::thread_context& thread_ctx, details::grouped_task& task);
+    static fiber_context* complete_task(details::thread_context& thread_ctx, fiber_context* fiber_ctx);
 
     //! central memory allocator for tasks system
     memory::aligned_allocator<XR_DEFAULT_MACHINE_ALIGNMENT> m_aligned_allocator;
@@ -178,16 +286,45 @@ private:
     mpmc_queue<task_group, task_group::max_groups_count * 2> m_available_groups;
     //! groups statistics
     task_group_description m_group_stats[task_group::max_groups_count];
-    //! standard fibers context
-    fiber_context m_standard_fiber_contexts[max_standard_fibers_count];
-    //! extended fibers context
-    fiber_context m_extended_fiber_contexts[max_extended_fibers_count];
     //! standard fibers pool
-    mpmc_queue<fiber_context*, max_standard_fibers_count * 2> m_standard_fibers_available;
+    fiber_pool m_standard_fibers;
     //! extended fibers pool
-    mpmc_queue<fiber_context*, max_extended_fibers_count * 2> m_extended_fibers_available;
+    fiber_pool m_extended_fibers;
     //! thread contexts
     details::thread_context* m_thread_context;
+    //! idle workers sleep here until new tasks arrive
+    threading::parking_lot m_parking_lot;
+    //! tasks which didn't fit into worker queues
+    mpmc_queue<details::grouped_task, details::max_overflow_task_capacity> m_overflow_tasks;
+    //! submitters sleep here until overflow queue has free space
+    threading::parking_lot m_overflow_space_lot;
+    //! how many times overflow happened
+    threading::atomic_uint64 m_overflow_count;
+    //! transient memory for tasks, owned by user
+    memory::frame_allocator* m_frame_allocator;
+    //! how workers choose steal victims
+    threading::atomic_uint32 m_steal_policy;
+    //! hardware thread every worker is pinned to
+    uint32_t m_worker_hardware_threads[max_thread_count];
+    //! event rings of workers
+    details::telemetry_ring* m_telemetry_rings;
+    threading::atomic_uint32 m_telemetry_enabled;
+    //! counters of threads that helped while waiting
+    details::worker_counters m_external_counters;
+    //! time stamp counter and clock at creation, used to calibrate event time stamps
+    uint64_t m_telemetry_origin_timestamp;
+    uint64_t m_telemetry_origin_us;
+    //! pollers of operations tasks wait for
+    completion_poller m_completion_pollers[max_completion_pollers];
+    threading::atomic_uint32 m_completion_pollers_count;
+    //! workers inside pollers, pollers are changed only when nobody is inside
+    threading::atomic_uint32 m_active_completion_polls;
+    //! serializes changes of pollers
+    threading::spin_wait_fairness m_completion_pollers_lock;
+    //! fibers suspended on awaitables, nobody polls completions when it is zero
+    threading::atomic_uint32 m_awaiting_fibers_count;
+    //! high priority tasks queued anywhere, other workers are scanned for them only when it is not zero
+    threading::atomic_uint32 m_pending_high_priority_count;
 
 #ifdef XR_INSTRUMENTED_BUILD
     base_profiler_event_listener* m_profiler_event_listener;
@@ -203,6 +340,79 @@ task_scheduler::get_allocator()
     return m_aligned_allocator;
 }
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline threading::parking_lot_stats
+task_scheduler::get_idle_stats() const
+{
+    return m_parking_lot.get_stats();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+task_scheduler::set_frame_allocator(memory::frame_allocator* allocator)
+{
+    m_frame_allocator = allocator;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline memory::frame_allocator*
+task_scheduler::get_frame_allocator() const
+{
+    return m_frame_allocator;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline uint64_t
+task_scheduler::get_overflow_count() const
+{
+    return threading::atomic_fetch_acq(m_overflow_count);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+task_scheduler::set_steal_policy(steal_policy policy)
+{
+    threading::atomic_store_rel(m_steal_policy, static_cast<uint32_t>(policy));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline steal_policy
+task_scheduler::get_steal_policy() const
+{
+    return static_cast<steal_policy>(threading::atomic_fetch_relax(m_steal_policy));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline bool
+task_scheduler::is_telemetry_enabled() const
+{
+    return threading::atomic_fetch_relax(m_telemetry_enabled) != 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline uint32_t
+task_scheduler::get_worker_hardware_thread(uint32_t worker_index) const
+{
+    XR_DEBUG_ASSERTION_MSG(worker_index < get_workers_count(), "Invalid worker index");
+    return m_worker_hardware_threads[worker_index];
+}
+
 #ifdef XR_INSTRUMENTED_BUILD
 
 //-----------------------------------------------------------------------------------------------------------
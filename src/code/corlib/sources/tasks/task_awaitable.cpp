@@ -0,0 +1,36 @@
+// This file is a part of xray-ng engine
+//
+
+#include "scheduler.h"
+#include "corlib/tasks/task_awaitable.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks)
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Waiter and scheduler are published before the state, complete() reads them only after it has
+ *  seen the waiting state.
+ */
+bool awaitable::try_suspend(fiber_context* waiter, task_scheduler* scheduler)
+{
+    m_waiter = waiter;
+    m_scheduler = scheduler;
+    return threading::atomic_bcas_seq(m_state, static_cast<uint32_t>(waiting), static_cast<uint32_t>(pending));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void awaitable::complete()
+{
+    uint32_t previous = threading::atomic_fetch_store_seq(m_state, static_cast<uint32_t>(ready));
+    XR_DEBUG_ASSERTION_MSG(previous != ready, "awaitable is completed twice");
+
+    // waiting fiber can't be resumed before we release it, so awaitable is still alive here
+    if(previous == waiting)
+        m_scheduler->resume_awaiting_fiber(m_waiter);
+}
+
+XR_NAMESPACE_END(xr, tasks)
+//-----------------------------------------------------------------------------------------------------------
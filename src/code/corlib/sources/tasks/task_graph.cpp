@@ -0,0 +1,302 @@
+// This file is a part of xray-ng engine
+//
+
+#include "corlib/tasks/task_graph.h"
+#include "corlib/memory/allocator_macro.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Checks if task with next_stack requirements can run on stack of task with running_stack ones.
+ */
+inline bool
+can_continue_on_stack(task_stack_request running_stack, task_stack_request next_stack)
+{
+    if(next_stack == task_stack_request::run_to_completion)
+        return true;
+
+    if(running_stack == task_stack_request::huge_stack)
+        return true;
+
+    return running_stack == next_stack;
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_graph_node::node_entry(execution_context& context, pvoid user_data)
+{
+    task_graph_node* node = reinterpret_cast<task_graph_node*>(user_data);
+    task_stack_request running_stack = node->desc.required_stack;
+
+    while(node)
+    {
+        node->desc.task_func(context, node->desc.user_data);
+
+        // WARNING! Graph can be destroyed right after last node is completed
+        node = node->graph->complete_node(context, *node, running_stack);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+task_graph::task_graph(memory::base_allocator& alloc, uint32_t max_nodes, uint32_t max_edges)
+    : m_allocator { alloc }
+    , m_nodes { nullptr }
+    , m_edges { nullptr }
+    , m_successors { nullptr }
+    , m_roots { nullptr }
+    , m_max_nodes { max_nodes }
+    , m_max_edges { max_edges }
+    , m_nodes_count { 0 }
+    , m_edges_count { 0 }
+    , m_roots_count { 0 }
+    , m_compiled { false }
+    , m_group {}
+    , m_pending_nodes { 0 }
+    , m_finished {}
+{
+    m_nodes = XR_ALLOCATE_OBJECT_ARRAY_T(m_allocator, task_graph_node, max_nodes, "task graph nodes");
+    m_roots = XR_ALLOCATE_OBJECT_ARRAY_T(m_allocator, node_id, max_nodes, "task graph roots");
+
+    if(max_edges)
+    {
+        m_edges = XR_ALLOCATE_OBJECT_ARRAY_T(m_allocator, edge, max_edges, "task graph edges");
+        m_successors = XR_ALLOCATE_OBJECT_ARRAY_T(m_allocator, node_id, max_edges, "task graph successors");
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+task_graph::~task_graph()
+{
+    XR_DEBUG_ASSERTION_MSG(is_finished(), "Task graph destroyed while executing");
+
+    XR_DEALLOCATE_MEMORY(m_allocator, m_nodes);
+    XR_DEALLOCATE_MEMORY(m_allocator, m_roots);
+
+    if(m_edges)
+    {
+        XR_DEALLOCATE_MEMORY(m_allocator, m_edges);
+        XR_DEALLOCATE_MEMORY(m_allocator, m_successors);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+task_graph::node_id task_graph::add_node_desc(const details::task_desc& desc)
+{
+    XR_DEBUG_ASSERTION_MSG(is_finished(), "Can't change graph while executing");
+    XR_DEBUG_ASSERTION_MSG(m_nodes_count < m_max_nodes, "Too many nodes in task graph");
+    if(m_nodes_count >= m_max_nodes)
+        return invalid_node;
+
+    node_id id = m_nodes_count++;
+    task_graph_node& node = m_nodes[id];
+    memory::call_emplace_construct(&node);
+    node.desc = desc;
+    node.graph = this;
+
+    m_compiled = false;
+    return id;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_graph::add_dependency(node_id before, node_id after)
+{
+    XR_DEBUG_ASSERTION_MSG(is_finished(), "Can't change graph while executing");
+    XR_DEBUG_ASSERTION_MSG(before < m_nodes_count && after < m_nodes_count, "Invalid node");
+    XR_DEBUG_ASSERTION_MSG(before != after, "Node can't depend on itself");
+    XR_DEBUG_ASSERTION_MSG(m_edges_count < m_max_edges, "Too many dependencies in task graph");
+    if(m_edges_count >= m_max_edges)
+        return;
+
+    m_edges[m_edges_count++] = edge { before, after };
+    m_compiled = false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Cycles are rejected in every build, nodes on a cycle would never become ready.
+ */
+bool task_graph::compile()
+{
+    XR_DEBUG_ASSERTION_MSG(is_finished(), "Can't change graph while executing");
+
+    for(uint32_t i = 0; i < m_nodes_count; ++i)
+    {
+        m_nodes[i].predecessors_count = 0;
+        m_nodes[i].successors_count = 0;
+    }
+
+    for(uint32_t i = 0; i < m_edges_count; ++i)
+    {
+        m_nodes[m_edges[i].before].successors_count++;
+        m_nodes[m_edges[i].after].predecessors_count++;
+    }
+
+    // Successor lists are packed one after another, pending_predecessors is used as fill cursor
+    uint32_t first_successor = 0;
+    for(uint32_t i = 0; i < m_nodes_count; ++i)
+    {
+        m_nodes[i].first_successor = first_successor;
+        m_nodes[i].pending_predecessors = 0;
+        first_successor += m_nodes[i].successors_count;
+    }
+
+    for(uint32_t i = 0; i < m_edges_count; ++i)
+    {
+        task_graph_node& node = m_nodes[m_edges[i].before];
+        uint32_t cursor = node.pending_predecessors;
+        m_successors[node.first_successor + cursor] = m_edges[i].after;
+        node.pending_predecessors = cursor + 1;
+    }
+
+    m_roots_count = 0;
+    for(uint32_t i = 0; i < m_nodes_count; ++i)
+    {
+        m_nodes[i].pending_predecessors = m_nodes[i].predecessors_count;
+        if(m_nodes[i].predecessors_count == 0)
+            m_roots[m_roots_count++] = i;
+    }
+
+    // Walk graph in topological order to find cycles. Roots array has room for all nodes,
+    // visited nodes are appended after roots and dropped afterwards.
+    uint32_t visited_count = m_roots_count;
+    for(uint32_t i = 0; i < visited_count; ++i)
+    {
+        const task_graph_node& node = m_nodes[m_roots[i]];
+        for(uint32_t j = 0; j < node.successors_count; ++j)
+        {
+            node_id successor_id = m_successors[node.first_successor + j];
+            uint32_t pending_predecessors = m_nodes[successor_id].pending_predecessors - 1;
+            m_nodes[successor_id].pending_predecessors = pending_predecessors;
+
+            if(pending_predecessors == 0)
+                m_roots[visited_count++] = successor_id;
+        }
+    }
+
+    m_compiled = (visited_count == m_nodes_count);
+    return m_compiled;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_graph::clear()
+{
+    XR_DEBUG_ASSERTION_MSG(is_finished(), "Can't change graph while executing");
+    m_nodes_count = 0;
+    m_edges_count = 0;
+    m_roots_count = 0;
+    m_compiled = false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_graph::start_execution(task_group group)
+{
+    XR_DEBUG_ASSERTION_MSG(is_finished(), "Task graph is already executing");
+
+    for(uint32_t i = 0; i < m_nodes_count; ++i)
+        threading::atomic_store_relax(m_nodes[i].pending_predecessors, m_nodes[i].predecessors_count);
+
+    m_group = group;
+    m_finished.reset();
+    threading::atomic_store_seq(m_pending_nodes, m_nodes_count);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_graph::execute(scheduler& sched)
+{
+    XR_DEBUG_ASSERTION_MSG(m_compiled, "Task graph must be compiled before execution");
+    if(!m_nodes_count || !m_compiled)
+        return;
+
+    task_group group = sched.create_group();
+    XR_DEBUG_ASSERTION_MSG(group.is_valid(), "Can't create group for task graph");
+    start_execution(group);
+
+    for(uint32_t i = 0; i < m_roots_count; ++i)
+        sched.run_async(group, &m_nodes[m_roots[i]], 1);
+
+    bool finished = sched.wait_group(group, infinite_wait_time);
+    XR_UNREFERENCED_PARAMETER(finished);
+    XR_DEBUG_ASSERTION_MSG(finished, "Task graph wait failed");
+
+    sched.release_group(group);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_graph::execute(execution_context& context)
+{
+    XR_DEBUG_ASSERTION_MSG(m_compiled, "Task graph must be compiled before execution");
+    if(!m_nodes_count || !m_compiled)
+        return;
+
+    start_execution(task_group::get_default_group());
+
+    for(uint32_t i = 0; i < m_roots_count; ++i)
+        submit_node(context, m_nodes[m_roots[i]]);
+
+    // resumed by the last node, no polling meanwhile
+    context.wait(m_finished);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_graph::submit_node(execution_context& context, task_graph_node& node)
+{
+    context.run_async(m_group, &node, 1);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Releases successors of finished node. Returns successor that should be continued on current fiber.
+ */
+task_graph_node* task_graph::complete_node(execution_context& context, task_graph_node& node,
+    task_stack_request running_stack)
+{
+    task_graph_node* continuation = nullptr;
+
+    for(uint32_t i = 0; i < node.successors_count; ++i)
+    {
+        task_graph_node& successor = m_nodes[m_successors[node.first_successor + i]];
+        if(threading::atomic_dec_fetch_seq(successor.pending_predecessors) != 0)
+            continue;
+
+        if(!continuation && can_continue_on_stack(running_stack, successor.desc.required_stack))
+            continuation = &successor;
+        else
+            submit_node(context, successor);
+    }
+
+    // Must be the last access to graph: waiter may destroy it as soon as it is resumed
+    if(threading::atomic_dec_fetch_seq(m_pending_nodes) == 0)
+        m_finished.complete();
+
+    return continuation;
+}
+
+XR_NAMESPACE_END(xr, tasks)
+//-----------------------------------------------------------------------------------------------------------
@@ -18,11 +18,11 @@ static memory::uninitialized_reference<task_scheduler> main_scheduler;
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
-void initialize_tasks(memory::base_allocator& alloc)
+void initialize_tasks(memory::base_allocator& alloc, memory::page_kind fiber_stack_pages)
 {
     XR_DEBUG_ASSERTION_MSG(!main_scheduler.is_constructed(),
         "Task scheduler already initialized");
-    memory::construct_reference(main_scheduler, alloc, sys::core_count());
+    memory::construct_reference(main_scheduler, alloc, sys::core_count(), fiber_stack_pages);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,210 @@
+// This file is a part of xray-ng engine
+//
+
+#include "scheduler.h"
+#include "corlib/sys/chrono.h"
+#include "corlib/memory/allocator_macro.h"
+#include <string.h> // for memmove
+#include <stdio.h> // for snprintf
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks, details)
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t telemetry_ring::read(telemetry_event* events) const
+{
+    uint64_t head = threading::atomic_fetch_acq(m_head);
+    uint64_t first = (head > telemetry_ring_capacity) ? head - telemetry_ring_capacity : 0;
+
+    for(uint64_t i = first; i < head; ++i)
+        events[i - first] = m_events[i & (telemetry_ring_capacity - 1)];
+
+    XR_MEMORY_READWRITE_BARRIER;
+
+    // slot of event being written now belongs to the oldest event too
+    uint64_t new_head = threading::atomic_fetch_acq(m_head);
+    uint64_t valid_first = (new_head + 1 > telemetry_ring_capacity) ?
+        new_head + 1 - telemetry_ring_capacity : 0;
+
+    if(valid_first <= first)
+        return static_cast<size_t>(head - first);
+
+    if(valid_first >= head)
+        return 0;
+
+    size_t count = static_cast<size_t>(head - valid_first);
+    memmove(events, events + (valid_first - first), count * sizeof(telemetry_event));
+    return count;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void telemetry_ring::clear()
+{
+    threading::atomic_store_rel(m_head, uint64_t(0));
+}
+
+XR_NAMESPACE_END(xr, tasks, details)
+//-----------------------------------------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void write_text(telemetry_write_function write, pvoid user_data, pcstr text, int length)
+{
+    if(length > 0)
+        write(text, static_cast<size_t>(length), user_data);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Task names are type names, but quotes and backslashes would still break JSON.
+ */
+void copy_json_name(pcstr name, char* buffer, size_t buffer_size)
+{
+    size_t i = 0;
+    for(; name && name[i] && i + 1 < buffer_size; ++i)
+        buffer[i] = (name[i] == '"' || name[i] == '\\') ? '_' : name[i];
+    buffer[i] = 0;
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_scheduler::set_telemetry_enabled(bool enabled)
+{
+    threading::atomic_store_rel(m_telemetry_enabled, enabled ? 1U : 0U);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_scheduler::get_worker_counters(uint32_t worker_index, worker_telemetry_counters& counters) const
+{
+    XR_DEBUG_ASSERTION_MSG(worker_index < get_workers_count(), "Invalid worker index");
+    m_thread_context[worker_index].counters.load(counters);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void task_scheduler::get_telemetry_counters(scheduler_telemetry_counters& counters) const
+{
+    counters = {};
+    for(uint32_t i = 0; i <= get_workers_count(); ++i)
+    {
+        worker_telemetry_counters worker {};
+        if(i < get_workers_count())
+            get_worker_counters(i, worker);
+        else
+            m_external_counters.load(worker);
+
+        counters.total.executed_tasks += worker.executed_tasks;
+        counters.total.yields += worker.yields;
+        counters.total.steals += worker.steals;
+        counters.total.failed_steals += worker.failed_steals;
+        counters.total.idle_ticks += worker.idle_ticks;
+    }
+
+    fiber_pool_stats standard = m_standard_fibers.get_stats();
+    fiber_pool_stats extended = m_extended_fibers.get_stats();
+    counters.standard_fibers_in_use = standard.in_use_count;
+    counters.standard_fibers_high_water_mark = standard.high_water_mark;
+    counters.extended_fibers_in_use = extended.in_use_count;
+    counters.extended_fibers_high_water_mark = extended.high_water_mark;
+    counters.overflow_count = get_overflow_count();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Writes events of all workers in Chrome trace event format (chrome://tracing, Perfetto).
+ *  Time stamp counter is calibrated against the monotonic clock since scheduler creation.
+ */
+void task_scheduler::export_chrome_trace(telemetry_write_function write, pvoid user_data)
+{
+    XR_DEBUG_ASSERTION_MSG(write, "Invalid write function");
+
+    uint64_t elapsed_ticks = sys::cpu_timestamp() - m_telemetry_origin_timestamp;
+    uint64_t elapsed_us = sys::now_microseconds() - m_telemetry_origin_us;
+    double ticks_per_us = elapsed_us ?
+        static_cast<double>(elapsed_ticks) / static_cast<double>(elapsed_us) : 1.0;
+    if(ticks_per_us <= 0.0)
+        ticks_per_us = 1.0;
+
+    telemetry_event* events = XR_ALLOCATE_OBJECT_ARRAY_T(m_aligned_allocator,
+        telemetry_event, details::telemetry_ring_capacity, "telemetry export buffer");
+
+    char line[256];
+    char name[96];
+    bool first_line = true;
+    static const char header[] = "{\"traceEvents\":[\n";
+    write(header, sizeof(header) - 1, user_data);
+
+    for(uint32_t worker = 0; worker < get_workers_count(); ++worker)
+    {
+        int length = snprintf(line, sizeof(line),
+            "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"task_worker %u\"}}",
+            first_line ? "" : ",\n", worker, worker);
+        write_text(write, user_data, line, length);
+        first_line = false;
+
+        size_t count = m_telemetry_rings[worker].read(events);
+        for(size_t i = 0; i < count; ++i)
+        {
+            const telemetry_event& event = events[i];
+            double ts = static_cast<double>(event.timestamp - m_telemetry_origin_timestamp) / ticks_per_us;
+
+            switch(event.type)
+            {
+                case telemetry_event_type::task_start:
+                    copy_json_name(event.name ? event.name : "task", name, sizeof(name));
+                    length = snprintf(line, sizeof(line),
+                        ",\n{\"name\":\"%s\",\"ph\":\"B\",\"pid\":0,\"tid\":%u,\"ts\":%.3f}", name, worker, ts);
+                    break;
+
+                case telemetry_event_type::task_stop:
+                case telemetry_event_type::task_yield:
+                case telemetry_event_type::idle_stop:
+                    length = snprintf(line, sizeof(line),
+                        ",\n{\"ph\":\"E\",\"pid\":0,\"tid\":%u,\"ts\":%.3f}", worker, ts);
+                    break;
+
+                case telemetry_event_type::idle_start:
+                    length = snprintf(line, sizeof(line),
+                        ",\n{\"name\":\"idle\",\"ph\":\"B\",\"pid\":0,\"tid\":%u,\"ts\":%.3f}", worker, ts);
+                    break;
+
+                case telemetry_event_type::steal:
+                    length = snprintf(line, sizeof(line),
+                        ",\n{\"name\":\"steal\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%u,\"ts\":%.3f}", worker, ts);
+                    break;
+
+                default:
+                    length = 0;
+                    break;
+            }
+
+            write_text(write, user_data, line, length);
+        }
+    }
+
+    static const char footer[] = "\n],\"displayTimeUnit\":\"ms\"}\n";
+    write(footer, sizeof(footer) - 1, user_data);
+
+    XR_DEALLOCATE_MEMORY(m_aligned_allocator, events);
+}
+
+XR_NAMESPACE_END(xr, tasks)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,117 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "corlib/tasks/telemetry.h"
+#include "corlib/threading/interlocked.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks, details)
+
+constexpr size_t telemetry_ring_capacity = 8192;
+
+//-----------------------------------------------------------------------------------------------------------
+// Per-worker event ring. Only owning worker writes, oldest events are overwritten.
+// Readers copy events and drop the ones that could be overwritten while copying.
+class telemetry_ring
+{
+    static_assert((telemetry_ring_capacity & (telemetry_ring_capacity - 1)) == 0,
+        "Capacity must be a power of two");
+
+public:
+    telemetry_ring();
+
+    XR_DECLARE_DELETE_COPY_ASSIGNMENT(telemetry_ring);
+    XR_DECLARE_DELETE_MOVE_ASSIGNMENT(telemetry_ring);
+
+    void push(telemetry_event_type type, pcstr name, uint64_t timestamp);
+
+    // Copies up to telemetry_ring_capacity latest events, returns how many were copied
+    size_t read(telemetry_event* events) const;
+
+    void clear();
+
+private:
+    //! events written since creation
+    threading::atomic_uint64 m_head;
+    telemetry_event m_events[telemetry_ring_capacity];
+}; // class telemetry_ring
+
+//-----------------------------------------------------------------------------------------------------------
+// Counters of one worker, written only by that worker
+struct worker_counters
+{
+    threading::atomic_uint64 executed_tasks { 0 };
+    threading::atomic_uint64 yields { 0 };
+    threading::atomic_uint64 steals { 0 };
+    threading::atomic_uint64 failed_steals { 0 };
+    threading::atomic_uint64 idle_ticks { 0 };
+
+    // single writer, so plain read-modify-write is enough
+    static void add(threading::atomic_uint64& counter, uint64_t value);
+
+    void load(worker_telemetry_counters& counters) const;
+
+    // Adds counters of temporary context to shared ones, many threads may do it at once
+    void merge_to(worker_counters& target) const;
+}; // struct worker_counters
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline telemetry_ring::telemetry_ring()
+    : m_head { 0 }
+{}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+telemetry_ring::push(telemetry_event_type type, pcstr name, uint64_t timestamp)
+{
+    uint64_t head = threading::atomic_fetch_relax(m_head);
+    telemetry_event& event = m_events[head & (telemetry_ring_capacity - 1)];
+    event.timestamp = timestamp;
+    event.name = name;
+    event.type = type;
+    threading::atomic_store_rel(m_head, head + 1);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+worker_counters::add(threading::atomic_uint64& counter, uint64_t value)
+{
+    threading::atomic_store_relax(counter, threading::atomic_fetch_relax(counter) + value);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+worker_counters::load(worker_telemetry_counters& counters) const
+{
+    counters.executed_tasks = threading::atomic_fetch_relax(executed_tasks);
+    counters.yields = threading::atomic_fetch_relax(yields);
+    counters.steals = threading::atomic_fetch_relax(steals);
+    counters.failed_steals = threading::atomic_fetch_relax(failed_steals);
+    counters.idle_ticks = threading::atomic_fetch_relax(idle_ticks);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void
+worker_counters::merge_to(worker_counters& target) const
+{
+    threading::atomic_fetch_add_seq(target.executed_tasks, threading::atomic_fetch_relax(executed_tasks));
+    threading::atomic_fetch_add_seq(target.yields, threading::atomic_fetch_relax(yields));
+    threading::atomic_fetch_add_seq(target.steals, threading::atomic_fetch_relax(steals));
+    threading::atomic_fetch_add_seq(target.failed_steals, threading::atomic_fetch_relax(failed_steals));
+    threading::atomic_fetch_add_seq(target.idle_ticks, threading::atomic_fetch_relax(idle_ticks));
+}
+
+XR_NAMESPACE_END(xr, tasks, details)
+//-----------------------------------------------------------------------------------------------------------
@@ -2,6 +2,7 @@
 //
 
 #include "thread_context.h"
+#include "scheduler.h"
 #include "corlib/memory/allocator_macro.h"
 
 //-----------------------------------------------------------------------------------------------------------
@@ -18,7 +19,6 @@ thread_context::thread_context(memory::base_allocator& alloc)
     , current_thread_id { 0 }
     , scheduler_fiber {}
     , queue {}
-    , has_new_tasks_event {}
     , state { (uint32_t)thread_state::ALIVE }
     , desc_buffer { nullptr }
     , current_worker_index { 0 }
@@ -28,6 +28,7 @@ thread_context::thread_context(memory::base_allocator& alloc)
         "Memory allocator must be initialized before thread_context access");
 
     queue.initialize_memory_pool(*allocator);
+    queue.set_aging_threshold(priority_aging_threshold);
 
     desc_buffer = XR_ALLOCATE_MEMORY(*allocator, 
         memory_requrements_for_desc_buffer, "thread_context local data");
@@ -43,7 +44,6 @@ thread_context::thread_context(void* externalDescBuffer)
     , current_thread_id { 0 }
     , scheduler_fiber {}
     , queue {}
-    , has_new_tasks_event {}
     , state { (uint32_t)thread_state::ALIVE }
     , desc_buffer { nullptr }
     , current_worker_index { 0 }
@@ -124,7 +124,8 @@ void thread_context::notify_temporary_worker_thread_leave()
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
-void thread_context::notify_task_execute_state_changed(math::color_table debug_color, const mt_char* debug_id, task_execute_state type, int32 fiber_index)
+void thread_context::notify_task_execute_state_changed(math::color_table debug_color, pcstr debug_id,
+    task_execute_state type, uint32_t fiber_index)
 {
     if(base_profiler_event_listener* event_listener = current_scheduler->get_profiler_event_listener())
     {
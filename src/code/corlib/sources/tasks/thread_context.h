@@ -6,19 +6,20 @@
 //#include "wait_free_queue.h"
 #include "fiber.h"
 //#include "mpmc_queue.h"
-#include "concurrent_task_queue.h"
+#include "work_stealing_queue.h"
+#include "worker_topology.h"
+#include "telemetry_ring.h"
 #include "corlib/tasks/details/grouped_task.h"
 #include "corlib/sys/thread.h"
-#include "corlib/threading/event.h"
 #include "corlib/math/random.h"
+#include "corlib/tasks/profiler_event_listener.h"
 
 
 #ifdef XR_INSTRUMENTED_BUILD
 
-#define XR_SYSTEM_TASK_COLOR (xr::tasks::Color::Yellow)
+#define XR_SYSTEM_TASK_COLOR (xr::math::color_table::yellow)
 #define XR_SYSTEM_TASK_NAME "SchedulerTask"
-#define MT_SYSTEM_TASK_FIBER_NAME "IdleFiber"
-#define XR_SYSTEM_FIBER_INDEX (int32)(-1)
+#define XR_SYSTEM_FIBER_INDEX UINT32_MAX
 
 #endif
 
@@ -30,26 +31,19 @@ XR_NAMESPACE_BEGIN(xr, tasks)
 class fiber_context;
 class task_scheduler;
 
-#ifdef XR_INSTRUMENTED_BUILD
-enum class task_execute_state
-{
-    start,
-    stop,
-    resume,
-    suspend
-}; // enum class task_execute_state
-#endif
-
 XR_NAMESPACE_END(xr, tasks)
 //-----------------------------------------------------------------------------------------------------------
 
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, tasks, details)
 
-constexpr size_t max_priority_count = 3;
+constexpr size_t max_priority_count = task_priority_enum::count;
+//! pops of higher priority work allowed while lower priority work keeps waiting
+constexpr uint32_t priority_aging_threshold = 64;
 constexpr size_t max_task_buffer_capacity = 4096;
+constexpr size_t max_overflow_task_capacity = 16384;
 
-using task_queue = priority_task_queue<
+using task_queue = priority_work_stealing_queue<
     grouped_task, max_priority_count, max_task_buffer_capacity>;
 
 constexpr size_t memory_requrements_for_desc_buffer = 
@@ -84,9 +78,6 @@ struct thread_context
     // task queue awaiting execution
     task_queue queue;
 
-    // new task has arrived to queue event
-    threading::event has_new_tasks_event;
-
     // thread is alive or not
     threading::atomic_uint32 state;
 
@@ -99,9 +90,24 @@ struct thread_context
     // Task stream lane selector for local tasks
     uint32_t current_lane_index { 0 };
 
+    // Scheduler steps counter, completions are polled every few steps
+    uint32_t completion_poll_steps { 0 };
+
+    // Nesting of scheduler steps taken while waiting for overflow space
+    uint32_t spill_depth { 0 };
+
     // Thread random number generator
     math::fast_random<uint16_t> random { rand() };
 
+    // Other workers ordered by topological distance, empty for temporary contexts
+    steal_order steal_victims {};
+
+    // Events of this worker, nullptr for temporary contexts
+    telemetry_ring* telemetry { nullptr };
+
+    // Always gathered worker statistics
+    worker_counters counters;
+
     bool is_external_desc_buffer;
 
     // prevent false cache sharing between threads
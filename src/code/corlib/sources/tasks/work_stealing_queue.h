@@ -0,0 +1,508 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "mpmc_queue.h"
+#include "corlib/threading/interlocked.h"
+#include "corlib/sys/thread.h"
+#include "corlib/memory/allocator_macro.h"
+#include "corlib/macro/aligning.h"
+#include "EASTL/type_traits.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks)
+
+//-----------------------------------------------------------------------------------------------------------
+// Bounded Chase-Lev deque. Only the owner thread may call push/pop, which work on the bottom end
+// in LIFO order; any thread may call steal, which takes from the top end in FIFO order.
+template<typename T, size_t Capacity>
+class work_stealing_deque
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    // steal() copies the slot before it knows whether it won the race for it
+    static_assert(eastl::is_trivially_copyable_v<T>, "T must be trivially copyable");
+
+public:
+    work_stealing_deque();
+    ~work_stealing_deque();
+
+    XR_DECLARE_DELETE_COPY_ASSIGNMENT(work_stealing_deque);
+    XR_DECLARE_DELETE_MOVE_ASSIGNMENT(work_stealing_deque);
+
+    // deque is just dummy until you call the create
+    void create(memory::base_allocator& alloc);
+    void destroy(memory::base_allocator& alloc);
+
+    bool push(const T& item);
+    bool pop(T& item);
+    bool steal(T& item);
+
+    size_t free_space() const;
+    bool is_empty() const;
+
+private:
+    static constexpr int64_t mask = static_cast<int64_t>(Capacity - 1);
+
+    //! thieves end
+    XR_ALIGNAS(XR_MAX_CACHE_LINE_SIZE) threading::atomic_int64 m_top;
+    //! owner end
+    XR_ALIGNAS(XR_MAX_CACHE_LINE_SIZE) threading::atomic_int64 m_bottom;
+    //! ring buffer storage
+    XR_ALIGNAS(XR_MAX_CACHE_LINE_SIZE) T* m_data;
+}; // class work_stealing_deque<T, Capacity>
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Capacity>
+inline work_stealing_deque<T, Capacity>::work_stealing_deque()
+    : m_top { 0 }
+    , m_bottom { 0 }
+    , m_data { nullptr }
+{}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Capacity>
+inline work_stealing_deque<T, Capacity>::~work_stealing_deque()
+{
+    XR_DEBUG_ASSERTION(m_data == nullptr);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Capacity>
+inline void
+work_stealing_deque<T, Capacity>::create(memory::base_allocator& alloc)
+{
+    size_t bytes_count = sizeof(T) * Capacity;
+    m_data = reinterpret_cast<T*>(XR_ALLOCATE_MEMORY(alloc, bytes_count, "work stealing deque"));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Capacity>
+inline void
+work_stealing_deque<T, Capacity>::destroy(memory::base_allocator& alloc)
+{
+    XR_DEALLOCATE_MEMORY(alloc, m_data);
+    m_data = nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Capacity>
+inline bool
+work_stealing_deque<T, Capacity>::push(const T& item)
+{
+    XR_DEBUG_ASSERTION_MSG(m_data, "Can't push items to dummy deque");
+
+    int64_t bottom = threading::atomic_fetch_relax(m_bottom);
+    int64_t top = threading::atomic_fetch_relax(m_top);
+    // slot must not be overwritten before the thief that freed it has read it
+    threading::atomic_thread_fence<threading::memory_order::acquire>();
+    if((bottom - top) >= static_cast<int64_t>(Capacity))
+        return false;
+
+    m_data[bottom & mask] = item;
+    // publish slot contents before thieves can see the new bottom
+    threading::atomic_thread_fence<threading::memory_order::release>();
+    threading::atomic_store_relax(m_bottom, bottom + 1);
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Capacity>
+inline bool
+work_stealing_deque<T, Capacity>::pop(T& item)
+{
+    int64_t bottom = threading::atomic_fetch_relax(m_bottom) - 1;
+    threading::atomic_store_relax(m_bottom, bottom);
+    // Store-load ordering is required here: thieves must observe the reserved
+    // bottom before we read top, otherwise both sides may take the last item.
+    threading::atomic_thread_fence<threading::memory_order::sequential>();
+    int64_t top = threading::atomic_fetch_relax(m_top);
+
+    if(top > bottom)
+    {
+        // deque is empty, restore bottom
+        threading::atomic_store_relax(m_bottom, bottom + 1);
+        return false;
+    }
+
+    item = m_data[bottom & mask];
+    if(top != bottom)
+        return true;
+
+    // Last item: race against thieves for it
+    bool won = threading::atomic_bcas_seq(m_top, top + 1, top);
+    threading::atomic_store_relax(m_bottom, bottom + 1);
+    return won;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Capacity>
+inline bool
+work_stealing_deque<T, Capacity>::steal(T& item)
+{
+    // Pairs with the fence in pop: either owner sees our claim on top or we see its reserved bottom.
+    int64_t top = threading::atomic_fetch_relax(m_top);
+    threading::atomic_thread_fence<threading::memory_order::sequential>();
+    int64_t bottom = threading::atomic_fetch_relax(m_bottom);
+    // slot contents published by push are read only after bottom
+    threading::atomic_thread_fence<threading::memory_order::acquire>();
+    if(top >= bottom)
+        return false;
+
+    T stolen = m_data[top & mask];
+    if(!threading::atomic_bcas_seq(m_top, top + 1, top))
+        return false; // lost the race against the owner or another thief
+
+    item = stolen;
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Capacity>
+inline size_t
+work_stealing_deque<T, Capacity>::free_space() const
+{
+    int64_t size = threading::atomic_fetch_acq(m_bottom) - threading::atomic_fetch_acq(m_top);
+    return (size > 0) ? (Capacity - static_cast<size_t>(size)) : Capacity;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Capacity>
+inline bool
+work_stealing_deque<T, Capacity>::is_empty() const
+{
+    return threading::atomic_fetch_acq(m_bottom) <= threading::atomic_fetch_acq(m_top);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// Per-worker task queue without locks: one work_stealing_deque per priority plus a mailbox lane per
+// priority for tasks submitted from other threads. The owner pops newest tasks first to keep caches warm,
+// thieves take the oldest ones. Levels are served in strict order, except that a lower level
+// which was passed over too many times in a row gets its oldest task served (aging).
+template<typename T, size_t Priority, size_t Capacity>
+class priority_work_stealing_queue
+{
+public:
+    priority_work_stealing_queue();
+    ~priority_work_stealing_queue();
+
+    void initialize_memory_pool(memory::base_allocator& alloc);
+    void shutdown_memory_pool(memory::base_allocator& alloc);
+
+    XR_DECLARE_DELETE_COPY_ASSIGNMENT(priority_work_stealing_queue);
+    XR_DECLARE_DELETE_MOVE_ASSIGNMENT(priority_work_stealing_queue);
+
+    void bind_owner(sys::thread_id owner);
+    void set_aging_threshold(uint32_t threshold);
+
+    // Returns count of accepted items, items are always accepted from the front of array
+    size_t add(const T* item_array, size_t count);
+
+    // Only levels [0, lowest_priority] are looked at, except starving levels served by aging.
+    bool try_pop(T& item, size_t lowest_priority = Priority - 1);
+    bool try_steal(T& item, size_t lowest_priority = Priority - 1);
+
+    // Snapshot only, any thread may call it
+    bool is_empty() const;
+
+private:
+    using deque = work_stealing_deque<T, Capacity>;
+    using mailbox = mpmc_queue<T, Capacity>;
+
+    bool push_local(const T& item);
+    bool push_mailbox(const T& item);
+    bool drain_mailbox(T& overflow_item);
+    bool try_pop_starving(T& item);
+    void on_level_served(size_t level);
+
+    deque m_deques[Priority];
+    //! lanes are indexed by priority, so thieves can take foreign high priority work before the owner
+    //! gets to drain them
+    mailbox m_mailboxes[Priority];
+    sys::thread_id m_owner;
+    //! owner-only counters of passes that skipped a non-empty level
+    uint32_t m_starvation[Priority];
+    //! 0 disables aging
+    uint32_t m_aging_threshold;
+}; // class priority_work_stealing_queue<T, Priority, Capacity>
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Priority, size_t Capacity>
+inline priority_work_stealing_queue<T, Priority, Capacity>::priority_work_stealing_queue()
+    : m_owner { sys::invalid_thread_id }
+    , m_starvation {}
+    , m_aging_threshold { 0 }
+{}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Priority, size_t Capacity>
+inline priority_work_stealing_queue<T, Priority, Capacity>::~priority_work_stealing_queue()
+{}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Priority, size_t Capacity>
+inline void
+priority_work_stealing_queue<T, Priority, Capacity>::initialize_memory_pool(memory::base_allocator& alloc)
+{
+    for(uint32_t i = 0; i < eastl::size(m_deques); i++)
+    {
+        m_deques[i].create(alloc);
+        m_mailboxes[i].create(alloc);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Priority, size_t Capacity>
+inline void
+priority_work_stealing_queue<T, Priority, Capacity>::shutdown_memory_pool(memory::base_allocator& alloc)
+{
+    for(uint32_t i = 0; i < eastl::size(m_deques); i++)
+    {
+        m_deques[i].destroy(alloc);
+        m_mailboxes[i].destroy(alloc);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Priority, size_t Capacity>
+inline void
+priority_work_stealing_queue<T, Priority, Capacity>::bind_owner(sys::thread_id owner)
+{
+    threading::atomic_store_rel(m_owner, owner);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Priority, size_t Capacity>
+inline void
+priority_work_stealing_queue<T, Priority, Capacity>::set_aging_threshold(uint32_t threshold)
+{
+    m_aging_threshold = threshold;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Priority, size_t Capacity>
+inline bool
+priority_work_stealing_queue<T, Priority, Capacity>::push_local(const T& item)
+{
+    uint32_t queue_index = (uint32_t)item.desc.priority;
+    XR_DEBUG_ASSERTION_MSG(queue_index < eastl::size(m_deques), "Invalid task priority");
+    return m_deques[queue_index].push(item);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Priority, size_t Capacity>
+inline bool
+priority_work_stealing_queue<T, Priority, Capacity>::push_mailbox(const T& item)
+{
+    uint32_t queue_index = (uint32_t)item.desc.priority;
+    XR_DEBUG_ASSERTION_MSG(queue_index < eastl::size(m_mailboxes), "Invalid task priority");
+    return m_mailboxes[queue_index].enqueue(item);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Priority, size_t Capacity>
+inline size_t
+priority_work_stealing_queue<T, Priority, Capacity>::add(const T* item_array, size_t count)
+{
+    size_t added = 0;
+    if(threading::atomic_fetch_acq(m_owner) == sys::current_thread_id())
+    {
+        // Owner pushes directly to its deques, overflow goes to mailbox
+        for(; added < count; ++added)
+        {
+            if(!push_local(item_array[added]))
+                break;
+        }
+    }
+
+    for(; added < count; ++added)
+    {
+        if(!push_mailbox(item_array[added]))
+            break;
+    }
+
+    return added;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Priority, size_t Capacity>
+inline bool
+priority_work_stealing_queue<T, Priority, Capacity>::drain_mailbox(T& overflow_item)
+{
+    T item;
+    for(size_t level = 0; level < Priority; ++level)
+    {
+        if(!m_mailboxes[level].is_created())
+            return false;
+
+        while(m_mailboxes[level].dequeue(item))
+        {
+            if(!push_local(item))
+            {
+                // Deque is full, hand this one to the caller directly
+                overflow_item = item;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Priority, size_t Capacity>
+inline bool
+priority_work_stealing_queue<T, Priority, Capacity>::try_pop_starving(T& item)
+{
+    if(!m_aging_threshold)
+        return false;
+
+    for(size_t level = Priority - 1; level > 0; --level)
+    {
+        if(m_starvation[level] < m_aging_threshold)
+            continue;
+
+        // take the oldest task of starving level, it waited the longest
+        m_starvation[level] = 0;
+        if(m_deques[level].steal(item))
+        {
+            on_level_served(level);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Priority, size_t Capacity>
+inline void
+priority_work_stealing_queue<T, Priority, Capacity>::on_level_served(size_t level)
+{
+    m_starvation[level] = 0;
+    for(size_t lower = level + 1; lower < Priority; ++lower)
+    {
+        if(m_deques[lower].is_empty())
+            m_starvation[lower] = 0;
+        else
+            ++m_starvation[lower];
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Priority, size_t Capacity>
+inline bool
+priority_work_stealing_queue<T, Priority, Capacity>::try_pop(T& item, size_t lowest_priority)
+{
+    XR_DEBUG_ASSERTION_MSG(threading::atomic_fetch_acq(m_owner) == sys::invalid_thread_id ||
+        threading::atomic_fetch_acq(m_owner) == sys::current_thread_id(),
+        "Only owner thread can pop from its queue");
+    XR_DEBUG_ASSERTION_MSG(lowest_priority < Priority, "Invalid task priority");
+
+    // Move foreign submissions into deques first so priorities are respected
+    if(drain_mailbox(item))
+        return true;
+
+    if(try_pop_starving(item))
+        return true;
+
+    for(size_t level = 0; level <= lowest_priority; ++level)
+    {
+        if(m_deques[level].pop(item))
+        {
+            on_level_served(level);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Priority, size_t Capacity>
+inline bool
+priority_work_stealing_queue<T, Priority, Capacity>::try_steal(T& item, size_t lowest_priority)
+{
+    XR_DEBUG_ASSERTION_MSG(lowest_priority < Priority, "Invalid task priority");
+
+    for(size_t level = 0; level <= lowest_priority; ++level)
+    {
+        if(m_deques[level].steal(item))
+            return true;
+
+        // foreign submission waits in its lane while the owner is busy with a long task
+        if(m_mailboxes[level].is_created() && m_mailboxes[level].dequeue(item))
+            return true;
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+template<typename T, size_t Priority, size_t Capacity>
+inline bool
+priority_work_stealing_queue<T, Priority, Capacity>::is_empty() const
+{
+    for(size_t level = 0; level < Priority; ++level)
+    {
+        if(!m_deques[level].is_empty())
+            return false;
+
+        if(m_mailboxes[level].is_created() && !m_mailboxes[level].is_empty())
+            return false;
+    }
+
+    return true;
+}
+
+XR_NAMESPACE_END(xr, tasks)
+//-----------------------------------------------------------------------------------------------------------
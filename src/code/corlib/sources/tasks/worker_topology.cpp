@@ -0,0 +1,84 @@
+// This file is a part of xray-ng engine
+//
+
+#include "worker_topology.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks, details)
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void assign_worker_processors(const sys::cpu_topology& topology, uint32_t workers_count,
+    uint32_t* worker_processors)
+{
+    XR_DEBUG_ASSERTION_MSG(topology.processors_count > 0, "Empty topology");
+
+    // Processors are sorted by core, so first processor of every core goes to first part of list
+    uint32_t candidates[sys::max_logical_processors];
+    uint32_t candidates_count = 0;
+
+    for(uint32_t i = 0; i < topology.processors_count; ++i)
+    {
+        if(i == 0 || topology.processors[i].core_id != topology.processors[i - 1].core_id)
+            candidates[candidates_count++] = i;
+    }
+
+    for(uint32_t i = 0; i < topology.processors_count; ++i)
+    {
+        if(i != 0 && topology.processors[i].core_id == topology.processors[i - 1].core_id)
+            candidates[candidates_count++] = i;
+    }
+
+    uint32_t first_candidate = (candidates_count > workers_count) ? 1 : 0;
+    for(uint32_t i = 0; i < workers_count; ++i)
+        worker_processors[i] = candidates[(first_candidate + i) % candidates_count];
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+steal_tier get_steal_tier(const sys::logical_processor_info& thief, const sys::logical_processor_info& victim)
+{
+    if(thief.core_id == victim.core_id)
+        return steal_tier::smt_sibling;
+
+    if(thief.llc_id == victim.llc_id)
+        return steal_tier::shared_cache;
+
+    if(thief.node_id == victim.node_id)
+        return steal_tier::same_node;
+
+    return steal_tier::remote;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void build_steal_order(const sys::cpu_topology& topology, const uint32_t* worker_processors,
+    uint32_t workers_count, uint32_t worker_index, steal_order& order)
+{
+    XR_DEBUG_ASSERTION_MSG(workers_count <= max_topology_workers_count, "Too many workers");
+    XR_DEBUG_ASSERTION_MSG(worker_index < workers_count, "Invalid worker index");
+
+    const sys::logical_processor_info& thief = topology.processors[worker_processors[worker_index]];
+
+    uint32_t victims_count = 0;
+    for(uint32_t tier = 0; tier < static_cast<uint32_t>(steal_tier::count); ++tier)
+    {
+        for(uint32_t i = 0; i < workers_count; ++i)
+        {
+            if(i == worker_index)
+                continue;
+
+            const sys::logical_processor_info& victim = topology.processors[worker_processors[i]];
+            if(static_cast<uint32_t>(get_steal_tier(thief, victim)) == tier)
+                order.victims[victims_count++] = static_cast<uint8_t>(i);
+        }
+
+        order.tier_end[tier] = static_cast<uint8_t>(victims_count);
+    }
+}
+
+XR_NAMESPACE_END(xr, tasks, details)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,57 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "corlib/sys/topology.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks, details)
+
+constexpr uint32_t max_topology_workers_count = 64;
+
+//-----------------------------------------------------------------------------------------------------------
+// Distance between two workers, stealing goes from nearest tier to farthest one
+enum class steal_tier : uint32_t
+{
+    //! SMT sibling on same physical core
+    smt_sibling,
+    //! core sharing last level cache
+    shared_cache,
+    //! core on same NUMA node
+    same_node,
+    //! everything else
+    remote,
+    count
+}; // enum class steal_tier
+
+//-----------------------------------------------------------------------------------------------------------
+struct steal_order
+{
+    //! other workers sorted by steal tier
+    uint8_t victims[max_topology_workers_count];
+    //! victims of tier t are victims[tier_end[t - 1] .. tier_end[t])
+    uint8_t tier_end[static_cast<size_t>(steal_tier::count)];
+}; // struct steal_order
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Picks processor (index in topology) for every worker. Physical cores are used before SMT siblings,
+ *  first core is left to the main thread when there are more processors than workers.
+ */
+void assign_worker_processors(const sys::cpu_topology& topology, uint32_t workers_count,
+    uint32_t* worker_processors);
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+steal_tier get_steal_tier(const sys::logical_processor_info& thief, const sys::logical_processor_info& victim);
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void build_steal_order(const sys::cpu_topology& topology, const uint32_t* worker_processors,
+    uint32_t workers_count, uint32_t worker_index, steal_order& order);
+
+XR_NAMESPACE_END(xr, tasks, details)
+//-----------------------------------------------------------------------------------------------------------
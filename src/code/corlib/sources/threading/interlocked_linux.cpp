@@ -0,0 +1,241 @@
+// This file is a part of xray-ng engine
+//
+
+#if !defined(XRAY_PLATFORM_LINUX)
+#   error "This code is supported by Linux platform!"
+#endif // !defined(XRAY_PLATFORM_LINUX)
+
+#include "corlib/threading/interlocked.h"
+#include <cassert>
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, threading, details)
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int8_t __atomic_exchange(volatile int8_t* ptr, int8_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int16_t __atomic_exchange(volatile int16_t* ptr, int16_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int32_t __atomic_exchange(volatile int32_t* ptr, int32_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int64_t __atomic_exchange(volatile int64_t* ptr, int64_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+void* __atomic_exchange(void* volatile* ptr, void* value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int8_t __atomic_exchange_add(volatile int8_t* ptr, int8_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int16_t __atomic_exchange_add(volatile int16_t* ptr, int16_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int32_t __atomic_exchange_add(volatile int32_t* ptr, int32_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int64_t __atomic_exchange_add(volatile int64_t* ptr, int64_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int8_t __atomic_compare_exchange(volatile int8_t* ptr, int8_t value, int8_t comparand) XR_NOEXCEPT
+{
+    assert(ptr);
+    __atomic_compare_exchange_n(ptr, &comparand, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int16_t __atomic_compare_exchange(volatile int16_t* ptr, int16_t value, int16_t comparand) XR_NOEXCEPT
+{
+    assert(ptr);
+    __atomic_compare_exchange_n(ptr, &comparand, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int32_t __atomic_compare_exchange(volatile int32_t* ptr, int32_t value, int32_t comparand) XR_NOEXCEPT
+{
+    assert(ptr);
+    __atomic_compare_exchange_n(ptr, &comparand, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int64_t __atomic_compare_exchange(volatile int64_t* ptr, int64_t value, int64_t comparand) XR_NOEXCEPT
+{
+    assert(ptr);
+    __atomic_compare_exchange_n(ptr, &comparand, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+void* __atomic_compare_exchange(void* volatile* ptr, void* value, void* comparand) XR_NOEXCEPT
+{
+    assert(ptr);
+    __atomic_compare_exchange_n(ptr, &comparand, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+#if defined(XRAY_PLATFORM_64BIT)
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+bool __atomic_compare_exchange128(volatile int64_t* ptr, int64_t value_high,
+    int64_t value_low, int64_t* comparand) XR_NOEXCEPT
+{
+    assert(ptr);
+    assert((reinterpret_cast<uintptr_t>(ptr) & 15) == 0);
+
+    // cmpxchg16b directly, builtins on 128-bit integers may fall back to a lock in libatomic
+    bool result;
+    __asm__ __volatile__(
+        "lock cmpxchg16b %1\n\t"
+        "setz %0"
+        : "=q"(result), "+m"(*ptr), "+a"(comparand[0]), "+d"(comparand[1])
+        : "b"(value_low), "c"(value_high)
+        : "cc", "memory");
+
+    return result;
+}
+#endif // defined(XRAY_PLATFORM_64BIT)
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int8_t __atomic_or_operation(volatile int8_t* ptr, int8_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_fetch_or(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int16_t __atomic_or_operation(volatile int16_t* ptr, int16_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_fetch_or(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int32_t __atomic_or_operation(volatile int32_t* ptr, int32_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_fetch_or(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int64_t __atomic_or_operation(volatile int64_t* ptr, int64_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_fetch_or(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int8_t __atomic_and_operation(volatile int8_t* ptr, int8_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_fetch_and(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int16_t __atomic_and_operation(volatile int16_t* ptr, int16_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_fetch_and(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int32_t __atomic_and_operation(volatile int32_t* ptr, int32_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_fetch_and(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+int64_t __atomic_and_operation(volatile int64_t* ptr, int64_t value) XR_NOEXCEPT
+{
+    assert(ptr);
+    return __atomic_fetch_and(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+XR_NAMESPACE_END(xr, threading, details)
+//-----------------------------------------------------------------------------------------------------------
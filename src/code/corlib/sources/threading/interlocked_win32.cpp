@@ -32,6 +32,9 @@
 #pragma intrinsic(_InterlockedCompareExchange16)
 #pragma intrinsic(_InterlockedCompareExchange)
 #pragma intrinsic(_InterlockedCompareExchange64)
+#if defined(XRAY_PLATFORM_64BIT)
+#pragma intrinsic(_InterlockedCompareExchange128)
+#endif // defined(XRAY_PLATFORM_64BIT)
 
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, threading, details)
@@ -212,6 +215,23 @@ void* __atomic_compare_exchange(void* volatile* ptr, void* value, void* comparan
     return InterlockedCompareExchangePointer(ptr, value, comparand);
 }
 
+#if defined(XRAY_PLATFORM_64BIT)
+//-----------------------------------------------------------------------------------------------------------
+/**
+*/
+bool __atomic_compare_exchange128(volatile int64_t* ptr, int64_t value_high,
+    int64_t value_low, int64_t* comparand) XR_NOEXCEPT
+{
+    assert(ptr);
+    assert((reinterpret_cast<uintptr_t>(ptr) & 15) == 0);
+
+    auto const p = reinterpret_cast<volatile LONG64*>(ptr);
+    auto const c = reinterpret_cast<LONG64*>(comparand);
+
+    return _InterlockedCompareExchange128(p, value_high, value_low, c) != 0;
+}
+#endif // defined(XRAY_PLATFORM_64BIT)
+
 //-----------------------------------------------------------------------------------------------------------
 /**
 */
@@ -0,0 +1,134 @@
+// This file is a part of xray-ng engine
+//
+
+#include "corlib/threading/parking_lot.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, threading)
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+parking_lot::parking_lot() XR_NOEXCEPT
+    : m_epoch { 0 }
+    , m_parked { 0 }
+    , m_wakeups { 0 }
+    , m_spurious_wakeups { 0 }
+    , m_wake_syscalls { 0 }
+    , m_idle_microseconds { 0 }
+{}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+parking_lot::~parking_lot()
+{
+    XR_DEBUG_ASSERTION_MSG(parked_count() == 0, "Parking lot destroyed while threads are still parked");
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+uint32_t
+parking_lot::prepare_park() XR_NOEXCEPT
+{
+    // Full barrier: the caller re-checks for work after this point, producers
+    // publish work before looking at parked count, so one of them must see the other.
+    atomic_fetch_inc_seq(m_parked);
+    return atomic_fetch_acq(m_epoch);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+parking_lot::cancel_park() XR_NOEXCEPT
+{
+    atomic_dec_fetch_seq(m_parked);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+park_result
+parking_lot::commit_park(uint32_t ticket, sys::tick timeout_ms) XR_NOEXCEPT
+{
+    sys::tick start_time = sys::now_microseconds();
+    park_result result = park_result::unparked;
+
+    for(;;)
+    {
+        if(atomic_fetch_acq(m_epoch) != ticket)
+        {
+            result = park_result::unparked;
+            break;
+        }
+
+        if(!wait_on_epoch(ticket, timeout_ms))
+        {
+            result = park_result::timed_out;
+            break;
+        }
+
+        if(atomic_fetch_acq(m_epoch) == ticket)
+        {
+            // kernel returned without epoch change (signal, stale wake)
+            result = park_result::spurious;
+            break;
+        }
+    }
+
+    atomic_dec_fetch_seq(m_parked);
+    atomic_fetch_add_seq(m_idle_microseconds, sys::now_microseconds() - start_time);
+
+    if(result == park_result::unparked)
+        atomic_fetch_inc_seq(m_wakeups);
+    else if(result == park_result::spurious)
+        atomic_fetch_inc_seq(m_spurious_wakeups);
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+parking_lot::unpark(uint32_t count) XR_NOEXCEPT
+{
+    XR_MEMORY_FULLCONSISTENCY_BARRIER;
+
+    // Fast path: nobody is parked, no need to enter the kernel
+    uint32_t parked = atomic_fetch_seq(m_parked);
+    if(!parked || !count)
+        return;
+
+    atomic_fetch_inc_seq(m_epoch);
+    atomic_fetch_inc_seq(m_wake_syscalls);
+    wake_on_epoch(count < parked ? count : parked);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+parking_lot::report_spurious_wakeup() XR_NOEXCEPT
+{
+    atomic_fetch_inc_seq(m_spurious_wakeups);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+parking_lot_stats
+parking_lot::get_stats() const XR_NOEXCEPT
+{
+    parking_lot_stats stats {};
+    stats.wakeups = atomic_fetch_acq(m_wakeups);
+    stats.spurious_wakeups = atomic_fetch_acq(m_spurious_wakeups);
+    stats.wake_syscalls = atomic_fetch_acq(m_wake_syscalls);
+    stats.idle_microseconds = atomic_fetch_acq(m_idle_microseconds);
+    return stats;
+}
+
+XR_NAMESPACE_END(xr, threading)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,51 @@
+// This file is a part of xray-ng engine
+//
+
+#if !defined(XRAY_PLATFORM_LINUX)
+#   error "This code is supported by Linux platform!"
+#endif // !defined(XRAY_PLATFORM_LINUX)
+
+#include "corlib/threading/parking_lot.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, threading)
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool
+parking_lot::wait_on_epoch(uint32_t expected, sys::tick timeout_ms) XR_NOEXCEPT
+{
+    struct timespec timeout {};
+    struct timespec* timeout_ptr = nullptr;
+    if(timeout_ms != sys::infinite)
+    {
+        timeout.tv_sec = static_cast<time_t>(timeout_ms / 1000);
+        timeout.tv_nsec = static_cast<long>((timeout_ms % 1000) * 1000000);
+        timeout_ptr = &timeout;
+    }
+
+    // EAGAIN (epoch already changed) and EINTR are reported as wakeups,
+    // parking_lot::commit_park sorts them out by looking at the epoch.
+    long result = syscall(SYS_futex, &m_epoch, FUTEX_WAIT_PRIVATE, expected, timeout_ptr, nullptr, 0);
+    return !(result == -1 && errno == ETIMEDOUT);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+parking_lot::wake_on_epoch(uint32_t count) XR_NOEXCEPT
+{
+    int wake_count = (count > static_cast<uint32_t>(INT_MAX)) ? INT_MAX : static_cast<int>(count);
+    syscall(SYS_futex, &m_epoch, FUTEX_WAKE_PRIVATE, wake_count, nullptr, nullptr, 0);
+}
+
+XR_NAMESPACE_END(xr, threading)
+//-----------------------------------------------------------------------------------------------------------
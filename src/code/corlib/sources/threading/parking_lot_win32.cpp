@@ -0,0 +1,44 @@
+// This file is a part of xray-ng engine
+//
+
+#if !defined(XRAY_PLATFORM_WINDOWS)
+#   error "This code is supported by Windows platform!"
+#endif // !defined(XRAY_PLATFORM_WINDOWS)
+
+#include "corlib/threading/parking_lot.h"
+#include "../os_include_win32.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, threading)
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool
+parking_lot::wait_on_epoch(uint32_t expected, sys::tick timeout_ms) XR_NOEXCEPT
+{
+    DWORD timeout = (timeout_ms == sys::infinite) ? INFINITE : static_cast<DWORD>(timeout_ms);
+    if(WaitOnAddress(const_cast<uint32_t*>(&m_epoch), &expected, sizeof(expected), timeout))
+        return true;
+
+    return GetLastError() != ERROR_TIMEOUT;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void
+parking_lot::wake_on_epoch(uint32_t count) XR_NOEXCEPT
+{
+    if(count == 1)
+    {
+        WakeByAddressSingle(const_cast<uint32_t*>(&m_epoch));
+        return;
+    }
+
+    // WaitOnAddress has no wake-N primitive
+    WakeByAddressAll(const_cast<uint32_t*>(&m_epoch));
+}
+
+XR_NAMESPACE_END(xr, threading)
+//-----------------------------------------------------------------------------------------------------------
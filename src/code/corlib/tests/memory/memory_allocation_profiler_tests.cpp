@@ -0,0 +1,234 @@
+// This file is a part of xray-ng engine
+//
+
+#include "catch/catch.hpp"
+#include "corlib/memory/memory_allocation_profiler.h"
+#include "corlib/memory/memory_crt_allocator.h"
+#include "corlib/memory/allocator_macro.h"
+#include "corlib/threading/interlocked.h"
+#include "corlib/sys/thread.h"
+#include <stdio.h>
+
+using namespace xr;
+
+//-----------------------------------------------------------------------------------------------------------
+struct sites_summary
+{
+    uint32_t sites_count;
+    uint64_t allocations_count;
+    uint64_t period_allocations_count;
+    size_t live_bytes;
+}; // struct sites_summary
+
+static void summarize_site(const memory::allocation_site_report& report, pvoid user_data)
+{
+    auto* summary = reinterpret_cast<sites_summary*>(user_data);
+    ++summary->sites_count;
+    summary->allocations_count += report.allocations_count;
+    summary->period_allocations_count += report.period_allocations_count;
+    summary->live_bytes += report.live_bytes;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// Threads allocate blocks and swap them through shared slots, so most blocks are freed by a thread
+// that didn't allocate them.
+struct profiler_churn_context
+{
+    static constexpr size_t slots_count = 512;
+
+    memory::base_allocator* allocator { nullptr };
+    pvoid volatile slots[slots_count] {};
+    uint32_t iterations { 0 };
+    threading::atomic_uint32 next_thread { 0 };
+
+    static uint32_t thread_main(pvoid arg)
+    {
+        auto& self = *reinterpret_cast<profiler_churn_context*>(arg);
+        uint32_t hash = threading::atomic_fetch_then_inc_seq(self.next_thread) * 2654435761U + 1;
+
+        for(uint32_t i = 0; i < self.iterations; ++i)
+        {
+            hash = hash * 1103515245U + 12345U;
+            size_t size = 16 + ((hash >> 16) & 255);
+
+            pvoid block = XR_ALLOCATE_MEMORY(*self.allocator, size, "profiler churn");
+            pvoid previous = threading::atomic_fetch_store_seq(self.slots[(hash >> 8) % slots_count], block);
+            if(previous)
+                XR_DEALLOCATE_MEMORY(*self.allocator, previous);
+        }
+
+        return 0;
+    }
+
+    void run(memory::base_allocator& alloc, uint32_t threads_count, uint32_t iterations_count)
+    {
+        allocator = &alloc;
+        iterations = iterations_count;
+        next_thread = 0;
+
+        sys::thread_handle threads[16];
+        for(uint32_t i = 0; i < threads_count; ++i)
+        {
+            threads[i] = sys::spawn_thread(&profiler_churn_context::thread_main, this,
+                L"profiler churn", sys::thread_priority::medium, XR_KILOBYTES_TO_BYTES(64));
+        }
+
+        bool joined = sys::wait_threads(threads, threads_count);
+        XR_UNREFERENCED_PARAMETER(joined);
+
+        for(uint32_t i = 0; i < threads_count; ++i)
+            sys::detach_thread(threads[i]);
+    }
+
+    void release_all()
+    {
+        for(size_t i = 0; i < slots_count; ++i)
+        {
+            if(slots[i])
+                XR_DEALLOCATE_MEMORY(*allocator, slots[i]);
+
+            slots[i] = nullptr;
+        }
+    }
+}; // struct profiler_churn_context
+
+TEST_CASE("allocation profiler tests")
+{
+    memory::crt_allocator backing;
+    memory::crt_allocator profiled;
+    memory::allocation_profiler profiler;
+    profiler.initialize(backing);
+    profiled.set_event_listener(&profiler);
+
+    SECTION("live and peak bytes test")
+    {
+        pvoid first = XR_ALLOCATE_MEMORY(profiled, 100, "first site");
+        pvoid second = XR_ALLOCATE_MEMORY(profiled, 300, "second site");
+
+        memory::allocation_profiler_totals totals = profiler.get_totals();
+        REQUIRE(totals.allocations_count == 2);
+        REQUIRE(totals.live_bytes == 400);
+        REQUIRE(totals.live_blocks_count == 2);
+
+        XR_DEALLOCATE_MEMORY(profiled, second);
+        second = XR_ALLOCATE_MEMORY(profiled, 50, "second site");
+
+        totals = profiler.get_totals();
+        REQUIRE(totals.live_bytes == 150);
+        REQUIRE(totals.peak_live_bytes == 400);
+
+        sites_summary summary {};
+        profiler.report_sites(&summarize_site, &summary);
+        REQUIRE(summary.sites_count >= 2);
+        REQUIRE(summary.allocations_count == 3);
+        REQUIRE(summary.live_bytes == 150);
+
+        XR_DEALLOCATE_MEMORY(profiled, first);
+        XR_DEALLOCATE_MEMORY(profiled, second);
+
+        totals = profiler.get_totals();
+        REQUIRE(totals.live_bytes == 0);
+        REQUIRE(totals.live_blocks_count == 0);
+        REQUIRE(totals.unknown_frees_count == 0);
+    }
+
+    SECTION("realloc test")
+    {
+        pvoid block = XR_ALLOCATE_MEMORY(profiled, 64, "realloc site");
+        block = XR_REALLOCATE_MEMORY(profiled, block, 4096, "realloc site");
+
+        memory::allocation_profiler_totals totals = profiler.get_totals();
+        REQUIRE(totals.live_bytes == 4096);
+        REQUIRE(totals.live_blocks_count == 1);
+
+        XR_DEALLOCATE_MEMORY(profiled, block);
+        REQUIRE(profiler.get_totals().live_bytes == 0);
+    }
+
+    SECTION("snapshot test")
+    {
+        pvoid first = XR_ALLOCATE_MEMORY(profiled, 32, "snapshot site");
+        profiler.take_snapshot();
+        pvoid second = XR_ALLOCATE_MEMORY(profiled, 32, "snapshot site");
+
+        sites_summary summary {};
+        profiler.report_sites(&summarize_site, &summary);
+        REQUIRE(summary.allocations_count == 2);
+        REQUIRE(summary.period_allocations_count == 1);
+
+        XR_DEALLOCATE_MEMORY(profiled, first);
+        XR_DEALLOCATE_MEMORY(profiled, second);
+    }
+
+    SECTION("unknown free test")
+    {
+        profiled.set_event_listener(nullptr);
+        pvoid block = XR_ALLOCATE_MEMORY(profiled, 32, "unprofiled site");
+        profiled.set_event_listener(&profiler);
+        XR_DEALLOCATE_MEMORY(profiled, block);
+
+        // free is kept for one more drain in case its allocation is published late
+        profiler.flush();
+        memory::allocation_profiler_totals totals = profiler.get_totals();
+        REQUIRE(totals.unknown_frees_count == 1);
+        REQUIRE(totals.live_blocks_count == 0);
+    }
+
+    SECTION("frees on other threads test")
+    {
+        auto* context = XR_ALLOCATE_OBJECT_T(backing, profiler_churn_context, "churn context") {};
+        context->run(profiled, 8, 100000);
+
+        memory::allocation_profiler_totals totals = profiler.get_totals();
+        REQUIRE(totals.allocations_count == 8 * 100000);
+        REQUIRE(totals.unknown_frees_count == 0);
+
+        uint64_t live_blocks = 0;
+        for(size_t i = 0; i < profiler_churn_context::slots_count; ++i)
+            live_blocks += context->slots[i] ? 1 : 0;
+
+        REQUIRE(totals.live_blocks_count == live_blocks);
+
+        context->release_all();
+        totals = profiler.get_totals();
+        REQUIRE(totals.live_bytes == 0);
+        REQUIRE(totals.live_blocks_count == 0);
+        XR_DEALLOCATE_MEMORY_T(backing, context);
+    }
+
+    profiled.set_event_listener(nullptr);
+}
+
+TEST_CASE("Allocation Profiler Overhead", "[.benchmark]")
+{
+    memory::crt_allocator backing;
+    memory::crt_allocator profiled;
+    memory::allocation_profiler profiler;
+    profiler.initialize(backing);
+
+    auto* context = XR_ALLOCATE_OBJECT_T(backing, profiler_churn_context, "churn context") {};
+    char name[64];
+
+    for(uint32_t threads_count = 1; threads_count <= 16; threads_count *= 4)
+    {
+        snprintf(name, sizeof(name), "without profiler, %u threads", threads_count);
+        BENCHMARK(name)
+        {
+            context->run(profiled, threads_count, 200000);
+            context->release_all();
+        }
+
+        profiled.set_event_listener(&profiler);
+        snprintf(name, sizeof(name), "with profiler, %u threads", threads_count);
+        BENCHMARK(name)
+        {
+            context->run(profiled, threads_count, 200000);
+            context->release_all();
+            profiler.flush();
+        }
+
+        profiled.set_event_listener(nullptr);
+    }
+
+    XR_DEALLOCATE_MEMORY_T(backing, context);
+}
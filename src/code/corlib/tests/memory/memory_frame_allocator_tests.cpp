@@ -0,0 +1,113 @@
+// This file is a part of xray-ng engine
+//
+
+#include "catch/catch.hpp"
+#include "corlib/memory/memory_frame_allocator.h"
+#include "corlib/memory/memory_crt_allocator.h"
+#include "corlib/memory/allocator_macro.h"
+#include <string.h>
+
+using namespace xr;
+
+static void count_reports(const memory::frame_allocator_report& report, pvoid user_data)
+{
+    auto* last_report = reinterpret_cast<memory::frame_allocator_report*>(user_data);
+    *last_report = report;
+}
+
+TEST_CASE("frame_allocator tests")
+{
+    XR_CONSTEXPR_CPP14_OR_CONST size_t budget = XR_KILOBYTES_TO_BYTES(256);
+
+    memory::crt_allocator backing;
+    memory::frame_allocator allocator;
+    allocator.initialize(backing, 2, budget);
+
+    SECTION("malloc test")
+    {
+        uint8_t* first = reinterpret_cast<uint8_t*>(XR_ALLOCATE_MEMORY(allocator, 24, "test to allocate"));
+        uint8_t* second = reinterpret_cast<uint8_t*>(XR_ALLOCATE_MEMORY(allocator, 24, "test to allocate"));
+        REQUIRE(first != nullptr);
+        REQUIRE(second != nullptr);
+        REQUIRE((reinterpret_cast<uintptr_t>(first) & 15) == 0);
+        REQUIRE((reinterpret_cast<uintptr_t>(second) & 15) == 0);
+        // blocks are bumped one after another
+        REQUIRE(second == first + 32);
+        REQUIRE(allocator.allocated_size() == 48);
+    }
+
+    SECTION("large block test")
+    {
+        size_t s = XR_KILOBYTES_TO_BYTES(200);
+        uint8_t* block = reinterpret_cast<uint8_t*>(XR_ALLOCATE_MEMORY(allocator, s, "test to allocate"));
+        REQUIRE(block != nullptr);
+        memset(block, 0xcd, s);
+        REQUIRE(allocator.allocated_size() == s);
+    }
+
+    SECTION("realloc test")
+    {
+        uint8_t* block = reinterpret_cast<uint8_t*>(XR_ALLOCATE_MEMORY(allocator, 16, "test to allocate"));
+        for(uint8_t i = 0; i < 16; ++i)
+            block[i] = i;
+
+        // latest block grows in place
+        REQUIRE(XR_REALLOCATE_MEMORY(allocator, block, 64, "test to reallocate") == block);
+
+        pvoid other = XR_ALLOCATE_MEMORY(allocator, 16, "test to allocate");
+        REQUIRE(other != nullptr);
+
+        uint8_t* moved = reinterpret_cast<uint8_t*>(XR_REALLOCATE_MEMORY(allocator, block, 128, "test to reallocate"));
+        REQUIRE(moved != block);
+        for(uint8_t i = 0; i < 16; ++i)
+            REQUIRE(moved[i] == i);
+    }
+
+    SECTION("frame reset test")
+    {
+        pvoid first_frame = XR_ALLOCATE_MEMORY(allocator, 64, "test to allocate");
+        allocator.next_frame();
+        pvoid second_frame = XR_ALLOCATE_MEMORY(allocator, 64, "test to allocate");
+        REQUIRE(second_frame != first_frame);
+        REQUIRE(allocator.allocated_size() == 128);
+
+        // memory of the first frame is recycled two frames later
+        allocator.next_frame();
+        REQUIRE(allocator.allocated_size() == 64);
+
+        size_t total = allocator.total_size();
+        for(uint32_t frame = 0; frame < 16; ++frame)
+        {
+            for(uint32_t i = 0; i < 1024; ++i)
+                REQUIRE(XR_ALLOCATE_MEMORY(allocator, 100, "test to allocate") != nullptr);
+
+            allocator.next_frame();
+        }
+
+        REQUIRE(allocator.total_size() <= total + XR_MEGABYTES_TO_BYTES(2));
+        REQUIRE(allocator.get_frame_index() == 18);
+    }
+
+    SECTION("budget report test")
+    {
+        memory::frame_allocator_report report {};
+        allocator.set_report_function(&count_reports, &report);
+
+        pvoid block = XR_ALLOCATE_MEMORY(allocator, budget / 2, "test to allocate");
+        XR_DEALLOCATE_MEMORY(allocator, block);
+        allocator.next_frame();
+        REQUIRE(allocator.get_overflow_count() == 0);
+
+        XR_ALLOCATE_MEMORY(allocator, budget / 2, "test to allocate");
+        XR_ALLOCATE_MEMORY(allocator, budget, "test to allocate");
+        allocator.next_frame();
+
+        REQUIRE(allocator.get_overflow_count() == 1);
+        REQUIRE(report.frame_index == 1);
+        REQUIRE(report.budget == budget);
+        REQUIRE(report.used_size == budget + budget / 2);
+        REQUIRE(report.allocations_count == 2);
+        REQUIRE(report.live_blocks_count == 2);
+        REQUIRE(report.largest_lane_used_size == report.used_size);
+    }
+}
@@ -3,6 +3,10 @@
 
 #include "catch/catch.hpp"
 #include "corlib/memory/memory_functions.h"
+#include "corlib/memory/memory_crt_allocator.h"
+#include "corlib/memory/allocator_macro.h"
+#include <stdio.h>
+#include <string.h>
 
 using namespace xr;
 
@@ -35,4 +39,156 @@ TEST_CASE("memory functions tests")
         REQUIRE(blockB.i == const_val_A);
         REQUIRE(blockB.a == const_val_B);
     }
-}
\ No newline at end of file
+
+    SECTION("fill memory")
+    {
+        uint8_t block[100];
+        memory::fill(block, sizeof(block), 0x5c);
+        REQUIRE(block[0] == 0x5c);
+        REQUIRE(block[99] == 0x5c);
+    }
+
+    SECTION("every size and vector isa")
+    {
+        constexpr size_t max_size = 1100;
+        constexpr size_t padding = 64;
+        constexpr size_t block_size = max_size + 2 * padding;
+
+        const memory::vector_isa detected_isa = memory::get_vector_isa();
+        const size_t detected_threshold = memory::get_non_temporal_threshold();
+
+        uint8_t source[block_size];
+        uint8_t destination[block_size];
+        uint8_t expected[block_size];
+        for(size_t i = 0; i < block_size; ++i)
+            source[i] = static_cast<uint8_t>(i * 7 + 3);
+
+        const memory::vector_isa isas[] = { memory::vector_isa::sse2, memory::vector_isa::avx2, memory::vector_isa::avx512 };
+        for(memory::vector_isa isa : isas)
+        {
+            if(!memory::set_vector_isa(isa))
+                continue;
+
+            // smallest threshold makes blocks of 4Kb and larger take the streaming path
+            for(size_t threshold : { size_t(0), detected_threshold })
+            {
+                memory::set_non_temporal_threshold(threshold);
+
+                for(size_t size = 0; size <= max_size; ++size)
+                {
+                    for(size_t offset : { size_t(0), size_t(1), size_t(31) })
+                    {
+                        memset(destination, 0xab, block_size);
+                        memset(expected, 0xab, block_size);
+                        memcpy(expected + padding + offset, source + 3, size);
+                        memory::copy(destination + padding + offset, size, source + 3, size);
+                        REQUIRE(memcmp(destination, expected, block_size) == 0);
+
+                        memset(expected + padding + offset, 0, size);
+                        memory::zero(destination + padding + offset, size);
+                        REQUIRE(memcmp(destination, expected, block_size) == 0);
+                    }
+                }
+
+                memory::crt_allocator allocator;
+                constexpr size_t large_size = XR_KILOBYTES_TO_BYTES(64) + 13;
+                auto* large_source = reinterpret_cast<uint8_t*>(XR_ALLOCATE_MEMORY(allocator, large_size, "copy test"));
+                auto* large_destination = reinterpret_cast<uint8_t*>(XR_ALLOCATE_MEMORY(allocator, large_size + 1, "copy test"));
+                for(size_t i = 0; i < large_size; ++i)
+                    large_source[i] = static_cast<uint8_t>(i * 13);
+
+                large_destination[large_size] = 0xab;
+                memory::copy(large_destination + 1, large_size, large_source + 1, large_size - 1);
+                REQUIRE(memcmp(large_destination + 1, large_source + 1, large_size - 1) == 0);
+
+                memory::fill(large_destination, large_size, 0x5c);
+                REQUIRE(large_destination[0] == 0x5c);
+                REQUIRE(large_destination[large_size - 1] == 0x5c);
+                REQUIRE(large_destination[large_size] == 0xab);
+
+                XR_DEALLOCATE_MEMORY(allocator, large_source);
+                XR_DEALLOCATE_MEMORY(allocator, large_destination);
+            }
+        }
+
+        memory::set_vector_isa(detected_isa);
+        memory::set_non_temporal_threshold(detected_threshold);
+    }
+}
+
+TEST_CASE("Memory Copy And Zero", "[.benchmark]")
+{
+    constexpr size_t max_size = XR_MEGABYTES_TO_BYTES(64);
+    // every benchmark moves this much, so times of different sizes are comparable
+    constexpr size_t bytes_per_benchmark = XR_MEGABYTES_TO_BYTES(512);
+
+    const memory::vector_isa detected_isa = memory::get_vector_isa();
+    const size_t detected_threshold = memory::get_non_temporal_threshold();
+
+    memory::crt_allocator allocator;
+    auto* source = reinterpret_cast<uint8_t*>(XR_ALLOCATE_MEMORY(allocator, max_size, "copy benchmark"));
+    auto* destination = reinterpret_cast<uint8_t*>(XR_ALLOCATE_MEMORY(allocator, max_size, "copy benchmark"));
+    memset(source, 1, max_size);
+    memset(destination, 2, max_size);
+
+    const memory::vector_isa isas[] = { memory::vector_isa::sse2, memory::vector_isa::avx2, memory::vector_isa::avx512 };
+    const char* isa_names[] = { "sse2", "avx2", "avx512" };
+    char name[128];
+
+    for(size_t size = 16; size <= max_size; size *= 4)
+    {
+        const size_t repeats = bytes_per_benchmark / size;
+
+        snprintf(name, sizeof(name), "memcpy %zu bytes", size);
+        BENCHMARK(name)
+        {
+            for(size_t i = 0; i < repeats; ++i)
+                memcpy(destination, source, size);
+        }
+
+        for(uint32_t i = 0; i < 3; ++i)
+        {
+            if(!memory::set_vector_isa(isas[i]))
+                continue;
+
+            memory::set_non_temporal_threshold(SIZE_MAX);
+            snprintf(name, sizeof(name), "copy %s %zu bytes", isa_names[i], size);
+            BENCHMARK(name)
+            {
+                for(size_t j = 0; j < repeats; ++j)
+                    memory::copy(destination, size, source, size);
+            }
+
+            snprintf(name, sizeof(name), "zero %s %zu bytes", isa_names[i], size);
+            BENCHMARK(name)
+            {
+                for(size_t j = 0; j < repeats; ++j)
+                    memory::zero(destination, size);
+            }
+
+            if(size < XR_KILOBYTES_TO_BYTES(4))
+                continue;
+
+            memory::set_non_temporal_threshold(0);
+            snprintf(name, sizeof(name), "copy %s non-temporal %zu bytes", isa_names[i], size);
+            BENCHMARK(name)
+            {
+                for(size_t j = 0; j < repeats; ++j)
+                    memory::copy(destination, size, source, size);
+            }
+
+            snprintf(name, sizeof(name), "zero %s non-temporal %zu bytes", isa_names[i], size);
+            BENCHMARK(name)
+            {
+                for(size_t j = 0; j < repeats; ++j)
+                    memory::zero(destination, size);
+            }
+        }
+    }
+
+    memory::set_vector_isa(detected_isa);
+    memory::set_non_temporal_threshold(detected_threshold);
+
+    XR_DEALLOCATE_MEMORY(allocator, source);
+    XR_DEALLOCATE_MEMORY(allocator, destination);
+}
@@ -4,9 +4,42 @@
 #include "catch/catch.hpp"
 #include "corlib/memory/memory_mt_arena_allocator.h"
 #include "corlib/memory/allocator_macro.h"
+#include "corlib/memory/memory_functions.h"
+
+#if defined(XRAY_PLATFORM_LINUX)
+#   include <stdio.h>
+#endif // defined(XRAY_PLATFORM_LINUX)
 
 using namespace xr;
 
+namespace
+{
+
+// Bytes of free explicit huge pages, reservation of that size can't fall back to normal pages
+size_t free_huge_pages_size()
+{
+    size_t result = 0;
+#if defined(XRAY_PLATFORM_LINUX)
+    FILE* file = fopen("/proc/meminfo", "re");
+    if(!file)
+        return 0;
+
+    unsigned long free_count = 0, kilobytes = 0;
+    char line[256];
+    while(fgets(line, sizeof(line), file))
+    {
+        sscanf(line, "HugePages_Free: %lu", &free_count);
+        sscanf(line, "Hugepagesize: %lu kB", &kilobytes);
+    }
+
+    fclose(file);
+    result = static_cast<size_t>(free_count) * kilobytes * 1024;
+#endif // defined(XRAY_PLATFORM_LINUX)
+    return result;
+}
+
+} // anonymous namespace
+
 TEST_CASE("mt_arena_allocator tests")
 {
     XR_CONSTEXPR_CPP14_OR_CONST size_t initial = XR_KILOBYTES_TO_BYTES(64);
@@ -36,4 +69,53 @@ TEST_CASE("mt_arena_allocator tests")
         bool result = allocator.can_allocate_block(s);
         REQUIRE(result == true);
     }
-}
\ No newline at end of file
+
+    SECTION("allocated and committed size test")
+    {
+        REQUIRE(allocator.allocated_size() == 0);
+        REQUIRE(allocator.total_size() >= initial);
+
+        pvoid block = XR_ALLOCATE_MEMORY(allocator, 1000, "test to allocate");
+        REQUIRE(block != nullptr);
+        REQUIRE(allocator.allocated_size() >= 1000);
+
+        block = XR_REALLOCATE_MEMORY(allocator, block, XR_KILOBYTES_TO_BYTES(100), "test to reallocate");
+        REQUIRE(block != nullptr);
+        REQUIRE(allocator.allocated_size() >= XR_KILOBYTES_TO_BYTES(100));
+        REQUIRE(allocator.total_size() >= allocator.allocated_size());
+
+        XR_DEALLOCATE_MEMORY(allocator, block);
+        REQUIRE(allocator.allocated_size() == 0);
+    }
+
+    SECTION("malloc over the size test")
+    {
+        pvoid block = XR_ALLOCATE_MEMORY(allocator, size * 2, "test to allocate");
+        REQUIRE(block == nullptr);
+    }
+}
+
+TEST_CASE("mt_arena_allocator large pages tests")
+{
+    XR_CONSTEXPR_CPP14_OR_CONST size_t size = XR_MEGABYTES_TO_BYTES(16);
+
+    // taken before arena takes its pages out of the pool
+    bool const has_huge_pages = memory::large_page_size() && free_huge_pages_size() >= size;
+
+    memory::mt_arena_allocator allocator;
+    allocator.initialize(size, size, memory::page_kind::large);
+
+    // large pages may be unavailable, then arena falls back to normal pages
+    pvoid block = XR_ALLOCATE_MEMORY(allocator, XR_MEGABYTES_TO_BYTES(4), "test to allocate");
+    REQUIRE(block != nullptr);
+    memory::fill(block, XR_MEGABYTES_TO_BYTES(4), 0xcd);
+
+    if(has_huge_pages)
+        REQUIRE(allocator.query_large_page_size() >= XR_MEGABYTES_TO_BYTES(4));
+    else if(memory::large_page_size())
+        REQUIRE(allocator.query_large_page_size() <= allocator.total_size());
+    else
+        REQUIRE(allocator.query_large_page_size() == 0);
+
+    XR_DEALLOCATE_MEMORY(allocator, block);
+}
@@ -36,4 +36,28 @@ TEST_CASE("st_arena_allocator tests")
         bool result = allocator.can_allocate_block(s);
         REQUIRE(result == true);
     }
+
+    SECTION("allocated and committed size test")
+    {
+        REQUIRE(allocator.allocated_size() == 0);
+        REQUIRE(allocator.total_size() >= initial);
+
+        pvoid block = XR_ALLOCATE_MEMORY(allocator, 1000, "test to allocate");
+        REQUIRE(block != nullptr);
+        REQUIRE(allocator.allocated_size() >= 1000);
+
+        block = XR_REALLOCATE_MEMORY(allocator, block, XR_KILOBYTES_TO_BYTES(100), "test to reallocate");
+        REQUIRE(block != nullptr);
+        REQUIRE(allocator.allocated_size() >= XR_KILOBYTES_TO_BYTES(100));
+        REQUIRE(allocator.total_size() >= allocator.allocated_size());
+
+        XR_DEALLOCATE_MEMORY(allocator, block);
+        REQUIRE(allocator.allocated_size() == 0);
+    }
+
+    SECTION("malloc over the size test")
+    {
+        pvoid block = XR_ALLOCATE_MEMORY(allocator, size * 2, "test to allocate");
+        REQUIRE(block == nullptr);
+    }
 }
\ No newline at end of file
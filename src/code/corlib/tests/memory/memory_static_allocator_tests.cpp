@@ -0,0 +1,117 @@
+// This file is a part of xray-ng engine
+//
+
+#include "catch/catch.hpp"
+#include "corlib/memory/memory_static_allocator.h"
+#include "corlib/memory/allocator_macro.h"
+#include "corlib/threading/interlocked.h"
+#include "corlib/sys/thread.h"
+#include <string.h>
+
+using namespace xr;
+
+constexpr size_t static_block_size = 48;
+constexpr size_t static_block_count = 16;
+
+using test_static_allocator = memory::static_allocator<static_block_size, static_block_count>;
+
+//-----------------------------------------------------------------------------------------------------------
+// Threads take blocks, mark them as owned in the first word and give them back. Pool is small, so every
+// block passes through many threads and a stale free list head would hand the same block out twice.
+struct static_churn_context
+{
+    static constexpr size_t batch_size = 4;
+
+    test_static_allocator allocator {};
+    uint32_t iterations { 0 };
+    threading::atomic_uint32 duplicates { 0 };
+
+    static uint32_t thread_main(pvoid arg)
+    {
+        auto& self = *reinterpret_cast<static_churn_context*>(arg);
+        threading::atomic_uint32* blocks[batch_size] {};
+
+        for(uint32_t i = 0; i < self.iterations; ++i)
+        {
+            size_t count = 0;
+            for(; count < batch_size; ++count)
+            {
+                blocks[count] = reinterpret_cast<threading::atomic_uint32*>(
+                    XR_ALLOCATE_MEMORY(self.allocator, sizeof(uint32_t), "static churn"));
+
+                if(!blocks[count])
+                    break;
+
+                if(threading::atomic_fetch_then_inc_seq(*blocks[count]) != 0)
+                    threading::atomic_fetch_inc_seq(self.duplicates);
+            }
+
+            for(size_t j = 0; j < count; ++j)
+            {
+                threading::atomic_fetch_store_seq(*blocks[j], 0U);
+                XR_DEALLOCATE_MEMORY(self.allocator, const_cast<uint32_t*>(blocks[j]));
+            }
+        }
+
+        return 0;
+    }
+}; // struct static_churn_context
+
+TEST_CASE("static allocator tests")
+{
+    SECTION("allocate and free test")
+    {
+        test_static_allocator allocator {};
+        allocator.initialize(0x5a5a);
+
+        REQUIRE(allocator.total_size() == static_block_size * static_block_count);
+        REQUIRE(allocator.check_all_free());
+
+        pvoid blocks[static_block_count] {};
+        for(size_t i = 0; i < static_block_count; ++i)
+        {
+            blocks[i] = XR_ALLOCATE_MEMORY(allocator, static_block_size, "static block");
+            REQUIRE(blocks[i] != nullptr);
+            // whole block is usable and doesn't overlap with its neighbours
+            memset(blocks[i], static_cast<int>(i), static_block_size);
+        }
+
+        REQUIRE(allocator.allocated_size() == static_block_size * static_block_count);
+        REQUIRE(XR_ALLOCATE_MEMORY(allocator, static_block_size, "static block") == nullptr);
+
+        for(size_t i = 0; i < static_block_count; ++i)
+        {
+            REQUIRE(reinterpret_cast<uint8_t*>(blocks[i])[0] == i);
+            REQUIRE(reinterpret_cast<uint8_t*>(blocks[i])[static_block_size - 1] == i);
+            XR_DEALLOCATE_MEMORY(allocator, blocks[i]);
+        }
+
+        REQUIRE(allocator.allocated_size() == 0);
+        REQUIRE(allocator.check_all_free());
+    }
+
+    SECTION("concurrent churn never hands out the same block twice")
+    {
+        constexpr uint32_t threads_count = 16;
+
+        static_churn_context context {};
+        context.allocator.initialize(0x5a5a);
+        context.iterations = 100000;
+
+        sys::thread_handle threads[threads_count];
+        for(uint32_t i = 0; i < threads_count; ++i)
+        {
+            threads[i] = sys::spawn_thread(&static_churn_context::thread_main, &context,
+                L"static allocator churn", sys::thread_priority::medium, XR_KILOBYTES_TO_BYTES(64));
+        }
+
+        bool joined = sys::wait_threads(threads, threads_count);
+        for(uint32_t i = 0; i < threads_count; ++i)
+            sys::detach_thread(threads[i]);
+
+        REQUIRE(joined);
+        REQUIRE(context.duplicates == 0);
+        REQUIRE(context.allocator.allocated_size() == 0);
+        REQUIRE(context.allocator.check_all_free());
+    }
+}
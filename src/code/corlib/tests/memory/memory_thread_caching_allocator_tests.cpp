@@ -0,0 +1,231 @@
+// This file is a part of xray-ng engine
+//
+
+#include "catch/catch.hpp"
+#include "corlib/memory/memory_thread_caching_allocator.h"
+#include "corlib/memory/memory_mt_arena_allocator.h"
+#include "corlib/memory/memory_crt_allocator.h"
+#include "corlib/memory/allocator_macro.h"
+#include "corlib/threading/interlocked.h"
+#include "corlib/sys/thread.h"
+#include "EASTL/algorithm.h"
+#include <string.h>
+#include <stdio.h>
+
+using namespace xr;
+
+//-----------------------------------------------------------------------------------------------------------
+// Every thread allocates blocks of varying sizes and swaps them with blocks of other threads through
+// shared slots, so about half of the frees are done by a thread that didn't allocate the block.
+struct churn_context
+{
+    static constexpr size_t slots_count = 1024;
+    static constexpr uint32_t max_threads = 64;
+
+    memory::base_allocator* allocator { nullptr };
+    pvoid volatile slots[slots_count] {};
+    uint32_t iterations { 0 };
+    threading::atomic_uint32 failures { 0 };
+    threading::atomic_uint32 next_thread { 0 };
+
+    static size_t block_size(uint32_t thread, uint32_t iteration)
+    {
+        uint32_t hash = (thread * 2654435761U) ^ (iteration * 40503U);
+        // mostly small blocks, every 64th one goes past the small size limit
+        return ((hash & 63) == 0) ? 8192 + (hash & 4095) : 8 + (hash % 1024);
+    }
+
+    static uint32_t thread_main(pvoid arg)
+    {
+        auto& self = *reinterpret_cast<churn_context*>(arg);
+        uint32_t thread = threading::atomic_fetch_then_inc_seq(self.next_thread);
+
+        pvoid local[64] {};
+        for(uint32_t i = 0; i < self.iterations; ++i)
+        {
+            size_t size = block_size(thread, i);
+            uint8_t* block = reinterpret_cast<uint8_t*>(XR_ALLOCATE_MEMORY(*self.allocator, size, "churn block"));
+            if(!block)
+            {
+                threading::atomic_fetch_inc_seq(self.failures);
+                continue;
+            }
+
+            block[0] = static_cast<uint8_t>(thread);
+            block[size - 1] = static_cast<uint8_t>(thread);
+
+            pvoid released = nullptr;
+            if(i & 1)
+            {
+                size_t slot = (thread * 131 + i) & (slots_count - 1);
+                released = threading::atomic_fetch_store_seq<pvoid>(self.slots[slot], block);
+            }
+            else
+            {
+                released = local[i & 63];
+                local[i & 63] = block;
+            }
+
+            if(released)
+                XR_DEALLOCATE_MEMORY(*self.allocator, released);
+        }
+
+        for(pvoid block : local)
+        {
+            if(block)
+                XR_DEALLOCATE_MEMORY(*self.allocator, block);
+        }
+        return 0;
+    }
+
+    uint32_t run(memory::base_allocator& alloc, uint32_t threads_count, uint32_t iterations_per_thread)
+    {
+        allocator = &alloc;
+        iterations = iterations_per_thread;
+        failures = 0;
+        next_thread = 0;
+
+        sys::thread_handle threads[max_threads];
+        threads_count = eastl::min(threads_count, max_threads);
+        for(uint32_t i = 0; i < threads_count; ++i)
+        {
+            threads[i] = sys::spawn_thread(&churn_context::thread_main, this,
+                L"allocator churn", sys::thread_priority::medium, XR_KILOBYTES_TO_BYTES(64));
+        }
+
+        bool joined = sys::wait_threads(threads, threads_count);
+        XR_UNREFERENCED_PARAMETER(joined);
+
+        for(uint32_t i = 0; i < threads_count; ++i)
+            sys::detach_thread(threads[i]);
+
+        for(size_t i = 0; i < slots_count; ++i)
+        {
+            if(slots[i])
+                XR_DEALLOCATE_MEMORY(alloc, slots[i]);
+            slots[i] = nullptr;
+        }
+
+        return failures;
+    }
+}; // struct churn_context
+
+TEST_CASE("thread_caching_allocator tests")
+{
+    memory::crt_allocator backing;
+    memory::thread_caching_allocator allocator;
+    allocator.initialize(backing);
+
+    SECTION("malloc-free test")
+    {
+        size_t sizes[] = { 0, 1, 16, 17, 100, 128, 129, 1000, 2048, 4096 };
+        pvoid blocks[sizeof(sizes) / sizeof(sizes[0])];
+
+        for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+        {
+            blocks[i] = XR_ALLOCATE_MEMORY(allocator, sizes[i], "test to allocate");
+            REQUIRE(blocks[i] != nullptr);
+            REQUIRE((reinterpret_cast<uintptr_t>(blocks[i]) & 15) == 0);
+            memset(blocks[i], 0xcd, sizes[i]);
+        }
+
+        REQUIRE(allocator.allocated_size() >= 1000 + 2048 + 4096);
+
+        for(pvoid block : blocks)
+            XR_DEALLOCATE_MEMORY(allocator, block);
+
+        REQUIRE(allocator.allocated_size() == 0);
+    }
+
+    SECTION("large block test")
+    {
+        pvoid block = XR_ALLOCATE_MEMORY(allocator, XR_KILOBYTES_TO_BYTES(256), "test to allocate");
+        REQUIRE(block != nullptr);
+        REQUIRE(allocator.allocated_size() == XR_KILOBYTES_TO_BYTES(256));
+        XR_DEALLOCATE_MEMORY(allocator, block);
+        REQUIRE(allocator.allocated_size() == 0);
+    }
+
+    SECTION("realloc test")
+    {
+        uint8_t* block = reinterpret_cast<uint8_t*>(XR_ALLOCATE_MEMORY(allocator, 24, "test to allocate"));
+        REQUIRE(block != nullptr);
+        for(uint8_t i = 0; i < 24; ++i)
+            block[i] = i;
+
+        // same size class keeps the block
+        REQUIRE(XR_REALLOCATE_MEMORY(allocator, block, 32, "test to reallocate") == block);
+
+        block = reinterpret_cast<uint8_t*>(XR_REALLOCATE_MEMORY(allocator, block, 3000, "test to reallocate"));
+        REQUIRE(block != nullptr);
+        block = reinterpret_cast<uint8_t*>(XR_REALLOCATE_MEMORY(allocator, block, 10000, "test to reallocate"));
+        REQUIRE(block != nullptr);
+
+        for(uint8_t i = 0; i < 24; ++i)
+            REQUIRE(block[i] == i);
+
+        XR_DEALLOCATE_MEMORY(allocator, block);
+        REQUIRE(allocator.allocated_size() == 0);
+    }
+
+    SECTION("slab reuse test")
+    {
+        pvoid blocks[2048];
+        for(pvoid& block : blocks)
+            block = XR_ALLOCATE_MEMORY(allocator, 64, "test to allocate");
+
+        size_t total = allocator.total_size();
+        for(pvoid block : blocks)
+            XR_DEALLOCATE_MEMORY(allocator, block);
+
+        for(pvoid& block : blocks)
+            block = XR_ALLOCATE_MEMORY(allocator, 64, "test to allocate");
+
+        REQUIRE(allocator.total_size() == total);
+
+        for(pvoid block : blocks)
+            XR_DEALLOCATE_MEMORY(allocator, block);
+    }
+
+    SECTION("cross-thread free test")
+    {
+        auto* context = XR_ALLOCATE_OBJECT_T(backing, churn_context, "churn context") {};
+        REQUIRE(context->run(allocator, 8, 20000) == 0);
+        REQUIRE(allocator.allocated_size() == 0);
+        XR_DEALLOCATE_MEMORY_T(backing, context);
+    }
+}
+
+TEST_CASE("Small Object Churn", "[.benchmark]")
+{
+    memory::crt_allocator crt;
+    auto* context = XR_ALLOCATE_OBJECT_T(crt, churn_context, "churn context") {};
+    char name[64];
+
+    for(uint32_t threads_count = 1; threads_count <= 16; threads_count *= 2)
+    {
+        snprintf(name, sizeof(name), "crt_allocator, %u threads", threads_count);
+        BENCHMARK(name)
+        {
+            REQUIRE(context->run(crt, threads_count, 200000) == 0);
+        }
+
+        memory::mt_arena_allocator arena;
+        arena.initialize(XR_MEGABYTES_TO_BYTES(512), XR_MEGABYTES_TO_BYTES(16));
+        snprintf(name, sizeof(name), "mt_arena_allocator, %u threads", threads_count);
+        BENCHMARK(name)
+        {
+            REQUIRE(context->run(arena, threads_count, 200000) == 0);
+        }
+
+        memory::thread_caching_allocator caching;
+        caching.initialize(crt);
+        snprintf(name, sizeof(name), "thread_caching_allocator, %u threads", threads_count);
+        BENCHMARK(name)
+        {
+            REQUIRE(context->run(caching, threads_count, 200000) == 0);
+        }
+    }
+
+    XR_DEALLOCATE_MEMORY_T(crt, context);
+}
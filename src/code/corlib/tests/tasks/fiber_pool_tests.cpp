@@ -0,0 +1,165 @@
+// This file is a part of xray-ng engine
+//
+
+#include "catch/catch.hpp"
+#include "../../sources/tasks/fiber_pool.h"
+#include "corlib/memory/memory_crt_allocator.h"
+
+using namespace xr;
+
+static memory::crt_allocator pool_allocator {};
+
+//-----------------------------------------------------------------------------------------------------------
+static void pool_fiber_main(void*)
+{
+    // fibers from this pool are never switched to
+    FAIL();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+static tasks::fiber_pool_desc make_pool_desc(uint32_t initial_count, uint32_t max_count)
+{
+    tasks::fiber_pool_desc desc {};
+    desc.stack_size = XR_KILOBYTES_TO_BYTES(64);
+    desc.commit_size = XR_KILOBYTES_TO_BYTES(16);
+    desc.initial_count = initial_count;
+    desc.max_count = max_count;
+    return desc;
+}
+
+TEST_CASE("fiber pool: grows on demand up to the limit", "[tasks]")
+{
+    tasks::fiber_pool pool {};
+    pool.initialize(pool_allocator, make_pool_desc(1, 4), pool_fiber_main);
+    REQUIRE(pool.get_stats().created_count == 1);
+
+    tasks::fiber_context* fibers[4] = {};
+    for(auto& fiber_ctx : fibers)
+    {
+        fiber_ctx = pool.acquire();
+        REQUIRE(fiber_ctx != nullptr);
+        REQUIRE(fiber_ctx->system_fiber.is_constructed());
+    }
+
+    REQUIRE(pool.acquire() == nullptr);
+
+    tasks::fiber_pool_stats stats = pool.get_stats();
+    REQUIRE(stats.created_count == 4);
+    REQUIRE(stats.in_use_count == 4);
+    REQUIRE(stats.high_water_mark == 4);
+    REQUIRE(stats.exhausted_count == 1);
+
+    pool.set_max_count(5);
+    tasks::fiber_context* extra = pool.acquire();
+    REQUIRE(extra != nullptr);
+    pool.release(extra);
+
+    for(auto fiber_ctx : fibers)
+        pool.release(fiber_ctx);
+
+    REQUIRE(pool.get_stats().in_use_count == 0);
+    REQUIRE(pool.get_stats().high_water_mark == 5);
+    pool.shutdown();
+}
+
+TEST_CASE("fiber pool: trim drops stacks above recent demand", "[tasks]")
+{
+    tasks::fiber_pool pool {};
+    pool.initialize(pool_allocator, make_pool_desc(1, 8), pool_fiber_main);
+
+    tasks::fiber_context* fibers[6] = {};
+    for(auto& fiber_ctx : fibers)
+        fiber_ctx = pool.acquire();
+
+    for(auto fiber_ctx : fibers)
+        pool.release(fiber_ctx);
+
+    REQUIRE(pool.get_stats().committed_count == 6);
+
+    // first period still remembers the burst of six fibers
+    pool.trim(sys::now_milliseconds() + 1000, 1000);
+    REQUIRE(pool.get_stats().committed_count == 6);
+
+    // nothing was used during second period, keep only initial fibers
+    pool.trim(sys::now_milliseconds() + 2000, 1000);
+    REQUIRE(pool.get_stats().committed_count == 1);
+    REQUIRE(pool.get_stats().created_count == 6);
+
+    // trimmed fibers get their stacks back lazily
+    tasks::fiber_context* fiber_ctx = pool.acquire();
+    REQUIRE(fiber_ctx->system_fiber.is_constructed());
+    pool.release(fiber_ctx);
+
+    pool.shutdown();
+}
+
+TEST_CASE("fiber pool: large page stacks are committed with their users", "[tasks]")
+{
+    tasks::fiber_pool_desc desc = make_pool_desc(1, 8);
+    desc.stack_pages = memory::page_kind::large;
+
+    tasks::fiber_pool pool {};
+    pool.initialize(pool_allocator, desc, pool_fiber_main);
+
+    tasks::fiber_context* fibers[8] = {};
+    for(auto& fiber_ctx : fibers)
+    {
+        fiber_ctx = pool.acquire();
+        REQUIRE(fiber_ctx != nullptr);
+        REQUIRE(fiber_ctx->system_fiber.is_constructed());
+    }
+
+    // stacks may still land on normal pages when system has no large pages to give, region has a slot
+    // for the initial fiber only, so one large page at most
+    size_t const large_bytes = pool.query_large_page_size();
+    REQUIRE(large_bytes <= memory::large_page_size());
+
+    for(auto fiber_ctx : fibers)
+        pool.release(fiber_ctx);
+
+    pool.trim(sys::now_milliseconds() + 1000, 1000);
+    pool.trim(sys::now_milliseconds() + 2000, 1000);
+    REQUIRE(pool.get_stats().committed_count == 1);
+    REQUIRE(pool.query_large_page_size() <= large_bytes);
+
+    pool.shutdown();
+}
+
+#if defined(XRAY_PLATFORM_LINUX)
+//-----------------------------------------------------------------------------------------------------------
+static void stack_usage_task(tasks::execution_context&, pvoid)
+{}
+
+//-----------------------------------------------------------------------------------------------------------
+static void collect_stack_usage(const tasks::fiber_stack_usage_report& report, pvoid user_data)
+{
+    *reinterpret_cast<tasks::fiber_stack_usage_report*>(user_data) = report;
+}
+
+TEST_CASE("fiber pool: stack usage is kept per task type", "[tasks]")
+{
+    tasks::fiber_pool pool {};
+    pool.initialize(pool_allocator, make_pool_desc(1, 1), pool_fiber_main);
+    pool.set_stack_usage_tracking(true);
+
+    tasks::fiber_context* fiber_ctx = pool.acquire();
+    fiber_ctx->current_task.task_func = &stack_usage_task;
+    fiber_ctx->current_task.debug_id = "stack_usage_task";
+    fiber_ctx->required_stack = tasks::task_stack_request::small_stack;
+
+    // first release paints stack, fiber entry frame is measured on the second one
+    pool.record_stack_usage(*fiber_ctx);
+    pool.record_stack_usage(*fiber_ctx);
+    pool.release(fiber_ctx);
+
+    tasks::fiber_stack_usage_report report {};
+    pool.report_stack_usage(&collect_stack_usage, &report, XR_KILOBYTES_TO_BYTES(64));
+    REQUIRE(report.samples_count == 1);
+    REQUIRE(report.high_water_bytes > 0);
+    REQUIRE(report.high_water_bytes < XR_KILOBYTES_TO_BYTES(64));
+    REQUIRE(report.suggested_stack_size >= report.high_water_bytes);
+    REQUIRE(report.fits_small_stack);
+
+    pool.shutdown();
+}
+#endif // defined(XRAY_PLATFORM_LINUX)
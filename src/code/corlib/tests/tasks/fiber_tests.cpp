@@ -376,4 +376,126 @@ TEST_CASE("Floating Point Fiber Switch", "[fiber]")
     // Main -> 1 -> 2 -> 3 -> 4 -> 5 -> 6 -> 1 -> 5 -> 1 -> 3 -> 2 -> 4 -> 6 -> 4 -> 2 -> 5 -> 3 -> 6 -> Main
 
     REQUIRE(((((((((((((((((((0.0 + 8.0) * 3.0) + 7.0) * 6.0) - 9.0) * 2.0) * 4.0) * 5.0) + 1.0) * 3.0) + 9.0) + 8.0) - 9.0) * 5.0) + 7.0) + 1.0) * 6.0) - 3.0) == arg.counter);
-}
\ No newline at end of file
+}
+//-----------------------------------------------------------------------------------------------------------
+
+struct ping_pong_fiber_arg
+{
+    uint64_t switches_count { 0 };
+    volatile uint64_t counter { 0 };
+    tasks::fiber main_fiber;
+    tasks::fiber other_fiber;
+};
+
+void ping_pong_fiber_start(void* arg)
+{
+    auto* pingPongArg = reinterpret_cast<ping_pong_fiber_arg*>(arg);
+
+    for(;;)
+    {
+        pingPongArg->counter = pingPongArg->counter + 1;
+        tasks::fiber::switch_to(pingPongArg->other_fiber, pingPongArg->main_fiber);
+    }
+}
+
+void ping_pong_main_fiber_start(void* arg)
+{
+    auto* pingPongArg = reinterpret_cast<ping_pong_fiber_arg*>(arg);
+
+    for(uint64_t i = 0; i < pingPongArg->switches_count; ++i)
+        tasks::fiber::switch_to(pingPongArg->main_fiber, pingPongArg->other_fiber);
+}
+
+TEST_CASE("Fiber Switch Latency", "[.benchmark][fiber]")
+{
+    // Every iteration is two switches: main -> other -> main
+    constexpr uint64_t round_trips_count = 1000000;
+
+    ping_pong_fiber_arg arg;
+    arg.switches_count = round_trips_count;
+    arg.other_fiber.create(commit_size, reserve_size, ping_pong_fiber_start, &arg);
+
+    BENCHMARK("1M fiber round trips")
+    {
+        arg.main_fiber.create_from_thread_and_run(ping_pong_main_fiber_start, &arg);
+    }
+
+    REQUIRE(arg.counter >= round_trips_count);
+}
+
+#if defined(XRAY_PLATFORM_LINUX)
+//-----------------------------------------------------------------------------------------------------------
+
+struct stack_usage_fiber_arg
+{
+    size_t touch_size { 0 };
+    tasks::fiber main_fiber;
+    tasks::fiber other_fiber;
+};
+
+void touch_stack(size_t size)
+{
+    volatile uint8_t buffer[XR_KILOBYTES_TO_BYTES(1)];
+    buffer[0] = 1;
+
+    if(size > sizeof(buffer))
+        touch_stack(size - sizeof(buffer));
+
+    buffer[sizeof(buffer) - 1] = buffer[0];
+}
+
+void stack_usage_fiber_start(void* arg)
+{
+    auto* stackUsageArg = reinterpret_cast<stack_usage_fiber_arg*>(arg);
+
+    for(;;)
+    {
+        touch_stack(stackUsageArg->touch_size);
+        tasks::fiber::switch_to(stackUsageArg->other_fiber, stackUsageArg->main_fiber);
+    }
+}
+
+void stack_usage_main_fiber_start(void* arg)
+{
+    auto* stackUsageArg = reinterpret_cast<stack_usage_fiber_arg*>(arg);
+    tasks::fiber::switch_to(stackUsageArg->main_fiber, stackUsageArg->other_fiber);
+}
+
+TEST_CASE("Fiber Stack Usage", "[fiber]")
+{
+    stack_usage_fiber_arg arg;
+    arg.other_fiber.create(commit_size, reserve_size, stack_usage_fiber_start, &arg);
+
+    // first sample paints stack only
+    REQUIRE(arg.other_fiber.sample_stack_usage() == 0);
+
+    arg.touch_size = XR_KILOBYTES_TO_BYTES(100);
+    arg.main_fiber.create_from_thread_and_run(stack_usage_main_fiber_start, &arg);
+    size_t deep_usage = arg.other_fiber.sample_stack_usage();
+    REQUIRE(deep_usage >= XR_KILOBYTES_TO_BYTES(100));
+    REQUIRE(deep_usage < reserve_size);
+
+    // stack was painted again, so shallow call shows smaller usage
+    arg.touch_size = XR_KILOBYTES_TO_BYTES(4);
+    arg.main_fiber.create_from_thread_and_run(stack_usage_main_fiber_start, &arg);
+    size_t shallow_usage = arg.other_fiber.sample_stack_usage();
+    REQUIRE(shallow_usage >= XR_KILOBYTES_TO_BYTES(4));
+    REQUIRE(shallow_usage < deep_usage);
+
+    // stack with guard page has no canary
+    REQUIRE(!arg.other_fiber.is_stack_overflowed());
+}
+
+TEST_CASE("Fiber Stack Canary", "[fiber]")
+{
+    alignas(16) static uint64_t stack_memory[XR_KILOBYTES_TO_BYTES(16) / sizeof(uint64_t)];
+
+    tasks::fiber fiber;
+    fiber.create_on_stack(stack_memory, sizeof(stack_memory), stack_usage_fiber_start, &fiber);
+    REQUIRE(!fiber.is_stack_overflowed());
+
+    // overflow of the stack above lands here
+    stack_memory[2] = 0;
+    REQUIRE(fiber.is_stack_overflowed());
+}
+#endif // defined(XRAY_PLATFORM_LINUX)
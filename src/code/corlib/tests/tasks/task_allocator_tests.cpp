@@ -3,6 +3,10 @@
 
 #include "catch/catch.hpp"
 #include "../../sources/tasks/allocator.h"
+#include "corlib/threading/interlocked.h"
+#include "corlib/sys/thread.h"
+
+using namespace xr;
 
 struct simple_node
 {
@@ -27,3 +31,73 @@ TEST_CASE("Allocate and free task_bases")
 
     REQUIRE(allocator.check_all_free());
 }
+
+//-----------------------------------------------------------------------------------------------------------
+struct owned_node
+{
+    threading::atomic_uint32 owners { 0 };
+}; // struct owned_node
+
+//-----------------------------------------------------------------------------------------------------------
+// Threads take a few nodes, mark them as owned and put them back. Pool is small, so every node passes
+// through many threads and a stale head would hand the same node out twice.
+struct allocator_stress_context
+{
+    static constexpr size_t pool_size = 32;
+    static constexpr size_t batch_size = 4;
+
+    tasks::allocator<owned_node, pool_size> allocator {};
+    uint32_t iterations { 0 };
+    threading::atomic_uint32 duplicates { 0 };
+
+    static uint32_t thread_main(pvoid arg)
+    {
+        auto& self = *reinterpret_cast<allocator_stress_context*>(arg);
+        owned_node* nodes[batch_size] {};
+
+        for(uint32_t i = 0; i < self.iterations; ++i)
+        {
+            size_t count = 0;
+            for(; count < batch_size; ++count)
+            {
+                nodes[count] = self.allocator.take_available();
+                if(!nodes[count])
+                    break;
+
+                if(threading::atomic_fetch_then_inc_seq(nodes[count]->owners) != 0)
+                    threading::atomic_fetch_inc_seq(self.duplicates);
+            }
+
+            for(size_t j = 0; j < count; ++j)
+            {
+                threading::atomic_fetch_store_seq(nodes[j]->owners, 0U);
+                self.allocator.put_back(nodes[j]);
+            }
+        }
+
+        return 0;
+    }
+}; // struct allocator_stress_context
+
+TEST_CASE("task allocator never hands out the same node twice", "[tasks]")
+{
+    constexpr uint32_t threads_count = 16;
+
+    allocator_stress_context context {};
+    context.iterations = 100000;
+
+    sys::thread_handle threads[threads_count];
+    for(uint32_t i = 0; i < threads_count; ++i)
+    {
+        threads[i] = sys::spawn_thread(&allocator_stress_context::thread_main, &context,
+            L"allocator stress", sys::thread_priority::medium, XR_KILOBYTES_TO_BYTES(64));
+    }
+
+    bool joined = sys::wait_threads(threads, threads_count);
+    for(uint32_t i = 0; i < threads_count; ++i)
+        sys::detach_thread(threads[i]);
+
+    REQUIRE(joined);
+    REQUIRE(context.duplicates == 0);
+    REQUIRE(context.allocator.check_all_free());
+}
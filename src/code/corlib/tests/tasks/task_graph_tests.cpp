@@ -0,0 +1,177 @@
+// This file is a part of xray-ng engine
+//
+
+#include "catch/catch.hpp"
+#include "corlib/tasks/task_graph.h"
+#include "corlib/memory/memory_crt_allocator.h"
+#include "../sources/tasks/scheduler.h"
+
+using namespace xr;
+
+static memory::crt_allocator graph_allocator {};
+
+//-----------------------------------------------------------------------------------------------------------
+struct graph_execution_log
+{
+    threading::atomic_uint32 position { 0 };
+    uint32_t order[8] {};
+};
+
+//-----------------------------------------------------------------------------------------------------------
+template<tasks::task_stack_request StackRequest>
+class logging_task
+{
+public:
+    XR_DECLARE_TASK(logging_task, StackRequest, tasks::task_priority::default_prority, 0);
+
+    void operator()(tasks::execution_context&)
+    {
+        uint32_t position = threading::atomic_fetch_then_inc_seq(log->position);
+        log->order[position % 8] = id;
+    }
+
+    graph_execution_log* log { nullptr };
+    uint32_t id { 0 };
+};
+
+typedef logging_task<tasks::task_stack_request::small_stack> fiber_logging_task;
+typedef logging_task<tasks::task_stack_request::run_to_completion> inline_logging_task;
+
+//-----------------------------------------------------------------------------------------------------------
+static uint32_t position_of(const graph_execution_log& log, uint32_t id)
+{
+    for(uint32_t i = 0; i < 8; ++i)
+    {
+        if(log.order[i] == id)
+            return i;
+    }
+    return UINT32_MAX;
+}
+
+TEST_CASE("task graph: diamond respects dependencies on every replay", "[tasks]")
+{
+    tasks::task_scheduler scheduler { graph_allocator };
+    graph_execution_log log {};
+
+    // 1 -> (2, 3) -> 4
+    fiber_logging_task first { &log, 1 };
+    inline_logging_task left { &log, 2 };
+    fiber_logging_task right { &log, 3 };
+    inline_logging_task last { &log, 4 };
+
+    tasks::task_graph graph { graph_allocator, 4, 4 };
+    auto n1 = graph.add_node(first);
+    auto n2 = graph.add_node(left);
+    auto n3 = graph.add_node(right);
+    auto n4 = graph.add_node(last);
+    graph.add_dependency(n1, n2);
+    graph.add_dependency(n1, n3);
+    graph.add_dependency(n2, n4);
+    graph.add_dependency(n3, n4);
+    REQUIRE(graph.compile());
+
+    for(uint32_t frame = 0; frame < 16; ++frame)
+    {
+        log.position = 0;
+        graph.execute(scheduler);
+
+        REQUIRE(graph.is_finished());
+        REQUIRE(log.position == 4);
+        REQUIRE(position_of(log, 1) == 0);
+        REQUIRE(position_of(log, 4) == 3);
+    }
+}
+
+TEST_CASE("task graph: independent nodes are all executed", "[tasks]")
+{
+    tasks::task_scheduler scheduler { graph_allocator };
+    graph_execution_log log {};
+
+    inline_logging_task tasks_array[6] = {
+        { &log, 1 }, { &log, 2 }, { &log, 3 }, { &log, 4 }, { &log, 5 }, { &log, 6 } };
+
+    tasks::task_graph graph { graph_allocator, 6, 0 };
+    for(auto& task : tasks_array)
+        graph.add_node(task);
+
+    graph.compile();
+    graph.execute(scheduler);
+
+    REQUIRE(log.position == 6);
+    for(uint32_t id = 1; id <= 6; ++id)
+        REQUIRE(position_of(log, id) != UINT32_MAX);
+}
+
+TEST_CASE("task graph: cycle is rejected by compile", "[tasks]")
+{
+    tasks::task_scheduler scheduler { graph_allocator };
+    graph_execution_log log {};
+
+    // 1 -> 2 -> 3 -> 2
+    inline_logging_task tasks_array[3] = { { &log, 1 }, { &log, 2 }, { &log, 3 } };
+
+    tasks::task_graph graph { graph_allocator, 3, 3 };
+    auto n1 = graph.add_node(tasks_array[0]);
+    auto n2 = graph.add_node(tasks_array[1]);
+    auto n3 = graph.add_node(tasks_array[2]);
+    graph.add_dependency(n1, n2);
+    graph.add_dependency(n2, n3);
+    graph.add_dependency(n3, n2);
+
+    REQUIRE_FALSE(graph.compile());
+
+    graph.clear();
+    n1 = graph.add_node(tasks_array[0]);
+    n2 = graph.add_node(tasks_array[1]);
+    graph.add_dependency(n1, n2);
+    REQUIRE(graph.compile());
+
+    graph.execute(scheduler);
+    REQUIRE(log.position == 2);
+    REQUIRE(position_of(log, 1) == 0);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+struct graph_executing_task
+{
+    XR_DECLARE_TASK(graph_executing_task, tasks::task_stack_request::small_stack,
+        tasks::task_priority::default_prority, 0);
+
+    void operator()(tasks::execution_context& context)
+    {
+        graph->execute(context);
+        finished = graph->is_finished();
+    }
+
+    tasks::task_graph* graph { nullptr };
+    bool finished { false };
+};
+
+TEST_CASE("task graph: task is resumed when its graph is finished", "[tasks]")
+{
+    tasks::task_scheduler scheduler { graph_allocator };
+    graph_execution_log log {};
+
+    // 1 -> (2, 3)
+    fiber_logging_task first { &log, 1 };
+    inline_logging_task left { &log, 2 };
+    fiber_logging_task right { &log, 3 };
+
+    tasks::task_graph graph { graph_allocator, 3, 2 };
+    auto n1 = graph.add_node(first);
+    graph.add_dependency(n1, graph.add_node(left));
+    graph.add_dependency(n1, graph.add_node(right));
+    REQUIRE(graph.compile());
+
+    for(uint32_t frame = 0; frame < 16; ++frame)
+    {
+        log.position = 0;
+        graph_executing_task task { &graph, false };
+        scheduler.run_async(tasks::task_group::get_default_group(), &task, 1);
+        REQUIRE(scheduler.wait_all(tasks::infinite_wait_time));
+
+        REQUIRE(task.finished);
+        REQUIRE(log.position == 3);
+        REQUIRE(position_of(log, 1) == 0);
+    }
+}
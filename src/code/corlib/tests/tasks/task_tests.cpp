@@ -4,8 +4,13 @@
 #include "catch/catch.hpp"
 #include "corlib/tasks/task_system.h"
 #include "corlib/memory/memory_crt_allocator.h"
+#include "corlib/sys/chrono.h"
 #include "corlib/sys/thread.h"
+#include "corlib/threading/interlocked.h"
 #include "../sources/tasks/scheduler.h"
+#include <mutex>
+#include <string>
+#include <vector>
 
 static xr::memory::crt_allocator main_allocator {};
 
@@ -29,3 +34,348 @@ TEST_CASE("CleanupTests: not finished task")
     scheduler.run_async(xr::tasks::task_group::get_default_group(), tasks);
     REQUIRE(scheduler.wait_all(3));
 }
+
+//-----------------------------------------------------------------------------------------------------------
+template<xr::tasks::task_stack_request StackRequest>
+class counting_task
+{
+public:
+    XR_DECLARE_TASK(counting_task, StackRequest, xr::tasks::task_priority::default_prority, 0);
+
+    void operator()(xr::tasks::execution_context&)
+    {
+        xr::threading::atomic_fetch_inc_seq(*counter);
+    }
+
+    xr::threading::atomic_uint32* counter { nullptr };
+};
+
+typedef counting_task<xr::tasks::task_stack_request::small_stack> fiber_counting_task;
+typedef counting_task<xr::tasks::task_stack_request::run_to_completion> inline_counting_task;
+
+//-----------------------------------------------------------------------------------------------------------
+template<typename TTask, size_t N>
+static bool run_counting_tasks(xr::tasks::task_scheduler& scheduler, TTask(&tasks)[N],
+    xr::threading::atomic_uint32& counter)
+{
+    for(auto& task : tasks)
+        task.counter = &counter;
+
+    scheduler.run_async(xr::tasks::task_group::get_default_group(), tasks);
+    return scheduler.wait_all(10000);
+}
+
+TEST_CASE("run-to-completion tasks are executed once", "[tasks]")
+{
+    xr::tasks::task_scheduler scheduler { main_allocator };
+
+    xr::threading::atomic_uint32 counter { 0 };
+    static inline_counting_task tasks[1024];
+    REQUIRE(run_counting_tasks(scheduler, tasks, counter));
+    REQUIRE(xr::threading::atomic_fetch_acq(counter) == 1024);
+    REQUIRE(scheduler.get_fiber_pool_stats(xr::tasks::task_stack_request::small_stack).in_use_count == 0);
+}
+
+TEST_CASE("Run-To-Completion Task Overhead", "[.benchmark]")
+{
+    xr::tasks::task_scheduler scheduler { main_allocator };
+
+    xr::threading::atomic_uint32 counter { 0 };
+    static fiber_counting_task fiber_tasks[2048];
+    static inline_counting_task inline_tasks[2048];
+
+    BENCHMARK("2048 tasks on fibers")
+    {
+        run_counting_tasks(scheduler, fiber_tasks, counter);
+    }
+
+    BENCHMARK("2048 run-to-completion tasks")
+    {
+        run_counting_tasks(scheduler, inline_tasks, counter);
+    }
+}
+
+TEST_CASE("parallel_for visits every index once", "[tasks]")
+{
+    xr::tasks::task_scheduler scheduler { main_allocator };
+
+    static xr::threading::atomic_uint32 visits[10000];
+    for(auto& visit : visits)
+        visit = 0;
+
+    scheduler.parallel_for(xr::tasks::parallel_range { 0, 10000 }, 16,
+        [](xr::tasks::parallel_range range)
+        {
+            for(size_t i = range.begin; i < range.end; ++i)
+                xr::threading::atomic_fetch_inc_relax(visits[i]);
+        });
+
+    for(auto& visit : visits)
+        REQUIRE(xr::threading::atomic_fetch_acq(visit) == 1);
+}
+
+TEST_CASE("parallel_reduce sums range", "[tasks]")
+{
+    xr::tasks::task_scheduler scheduler { main_allocator };
+
+    uint64_t sum = scheduler.parallel_reduce(xr::tasks::parallel_range { 1, 100001 }, 64, uint64_t(0),
+        [](xr::tasks::parallel_range range)
+        {
+            uint64_t partial = 0;
+            for(size_t i = range.begin; i < range.end; ++i)
+                partial += i;
+            return partial;
+        },
+        [](uint64_t left, uint64_t right) { return left + right; });
+
+    REQUIRE(sum == 5000050000ULL);
+    REQUIRE(scheduler.parallel_reduce(xr::tasks::parallel_range { 5, 5 }, 1, uint64_t(7),
+        [](xr::tasks::parallel_range) { return uint64_t(0); },
+        [](uint64_t left, uint64_t right) { return left + right; }) == 7);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+class sleeping_task
+{
+public:
+    XR_DECLARE_TASK(sleeping_task, xr::tasks::task_stack_request::small_stack,
+        xr::tasks::task_priority::default_prority, 0);
+
+    void operator()(xr::tasks::execution_context&)
+    {
+        xr::sys::yield(50);
+    }
+};
+
+TEST_CASE("wait_group times out and then waits for group to finish", "[tasks]")
+{
+    xr::tasks::task_scheduler scheduler { main_allocator };
+    xr::tasks::task_group group = scheduler.create_group();
+
+    sleeping_task task {};
+    scheduler.run_async(group, &task, 1);
+
+    REQUIRE_FALSE(scheduler.wait_group(group, 1));
+    REQUIRE(scheduler.wait_group(group, xr::tasks::infinite_wait_time));
+    scheduler.release_group(group);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+static void append_trace(xr::pcstr data, size_t size, xr::pvoid user_data)
+{
+    static_cast<std::string*>(user_data)->append(data, size);
+}
+
+TEST_CASE("telemetry counts tasks and exports chrome trace", "[tasks]")
+{
+    xr::tasks::task_scheduler scheduler { main_allocator };
+    scheduler.set_telemetry_enabled(true);
+
+    xr::threading::atomic_uint32 counter { 0 };
+    static inline_counting_task inline_tasks[256];
+    static fiber_counting_task fiber_tasks[256];
+    REQUIRE(run_counting_tasks(scheduler, inline_tasks, counter));
+    REQUIRE(run_counting_tasks(scheduler, fiber_tasks, counter));
+
+    xr::tasks::scheduler_telemetry_counters counters {};
+    scheduler.get_telemetry_counters(counters);
+    REQUIRE(counters.total.executed_tasks == 512);
+    REQUIRE(counters.standard_fibers_in_use == 0);
+
+    std::string trace;
+    scheduler.export_chrome_trace(append_trace, &trace);
+    REQUIRE(trace.find("\"traceEvents\"") != std::string::npos);
+    REQUIRE(trace.find("counting_task") != std::string::npos);
+    REQUIRE(trace.back() == '\n');
+}
+
+//-----------------------------------------------------------------------------------------------------------
+class frame_memory_task
+{
+public:
+    XR_DECLARE_TASK(frame_memory_task, xr::tasks::task_stack_request::small_stack,
+        xr::tasks::task_priority::default_prority, 0);
+
+    void operator()(xr::tasks::execution_context& context)
+    {
+        xr::memory::frame_allocator* allocator = context.get_frame_allocator();
+        if(allocator && XR_ALLOCATE_MEMORY(*allocator, 1024, "frame memory task"))
+            xr::threading::atomic_fetch_inc_seq(*counter);
+    }
+
+    xr::threading::atomic_uint32* counter { nullptr };
+};
+
+TEST_CASE("tasks allocate transient memory from frame allocator", "[tasks]")
+{
+    xr::memory::frame_allocator frame_allocator;
+    frame_allocator.initialize(main_allocator, 2, XR_MEGABYTES_TO_BYTES(1));
+
+    xr::tasks::task_scheduler scheduler { main_allocator };
+    scheduler.set_frame_allocator(&frame_allocator);
+
+    xr::threading::atomic_uint32 counter { 0 };
+    static frame_memory_task tasks[256];
+    REQUIRE(run_counting_tasks(scheduler, tasks, counter));
+    REQUIRE(xr::threading::atomic_fetch_acq(counter) == 256);
+    REQUIRE(frame_allocator.allocated_size() == 256 * 1024);
+
+    frame_allocator.next_frame();
+    frame_allocator.next_frame();
+    REQUIRE(frame_allocator.allocated_size() == 0);
+    REQUIRE(frame_allocator.get_overflow_count() == 0);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// Completes operations submitted before the poll, or the ones whose latency has passed
+class fake_io_device
+{
+public:
+    explicit fake_io_device(xr::sys::tick latency_us = 0) : m_latency_us { latency_us } {}
+
+    void submit(xr::tasks::awaitable& operation)
+    {
+        std::lock_guard<std::mutex> lock { m_lock };
+        m_pending.push_back({ &operation, xr::sys::now_microseconds() + m_latency_us });
+    }
+
+    static uint32_t poll(xr::pvoid user_data)
+    {
+        fake_io_device& device = *static_cast<fake_io_device*>(user_data);
+        std::vector<xr::tasks::awaitable*> completed;
+        {
+            std::unique_lock<std::mutex> lock { device.m_lock, std::try_to_lock };
+            if(!lock)
+                return 0;
+
+            xr::sys::tick now_us = xr::sys::now_microseconds();
+            auto it = device.m_pending.begin();
+            while(it != device.m_pending.end())
+            {
+                if(it->deadline_us > now_us)
+                {
+                    ++it;
+                    continue;
+                }
+
+                completed.push_back(it->operation);
+                it = device.m_pending.erase(it);
+            }
+        }
+
+        // waiting tasks are resumed outside of the lock
+        for(xr::tasks::awaitable* operation : completed)
+            operation->complete();
+
+        return static_cast<uint32_t>(completed.size());
+    }
+
+private:
+    struct pending_operation
+    {
+        xr::tasks::awaitable* operation;
+        xr::sys::tick deadline_us;
+    };
+
+    std::mutex m_lock;
+    std::vector<pending_operation> m_pending;
+    xr::sys::tick m_latency_us;
+};
+
+//-----------------------------------------------------------------------------------------------------------
+template<bool Suspend>
+class reading_task
+{
+public:
+    XR_DECLARE_TASK(reading_task, xr::tasks::task_stack_request::small_stack,
+        xr::tasks::task_priority::default_prority, 0);
+
+    void operator()(xr::tasks::execution_context& context)
+    {
+        for(uint32_t i = 0; i < reads_count; ++i)
+        {
+            xr::tasks::awaitable operation;
+            device->submit(operation);
+
+            if(Suspend)
+            {
+                context.wait(operation);
+            }
+            else
+            {
+                // blocking read occupies the worker for the whole latency
+                while(!operation.is_ready())
+                    fake_io_device::poll(device);
+            }
+
+            if(operation.is_ready())
+                xr::threading::atomic_fetch_inc_seq(*counter);
+        }
+    }
+
+    fake_io_device* device { nullptr };
+    xr::threading::atomic_uint32* counter { nullptr };
+    uint32_t reads_count { 1 };
+};
+
+typedef reading_task<true> awaiting_reading_task;
+typedef reading_task<false> blocking_reading_task;
+
+//-----------------------------------------------------------------------------------------------------------
+template<typename TTask, size_t N>
+static bool run_reading_tasks(xr::tasks::task_scheduler& scheduler, TTask(&tasks)[N],
+    fake_io_device& device, xr::threading::atomic_uint32& counter, uint32_t reads_count)
+{
+    for(auto& task : tasks)
+    {
+        task.device = &device;
+        task.counter = &counter;
+        task.reads_count = reads_count;
+    }
+
+    scheduler.run_async(xr::tasks::task_group::get_default_group(), tasks);
+    return scheduler.wait_all(10000);
+}
+
+TEST_CASE("waiting tasks are resumed by completion poller", "[tasks]")
+{
+    xr::tasks::task_scheduler scheduler { main_allocator };
+
+    fake_io_device device {};
+    scheduler.add_completion_poller(fake_io_device::poll, &device);
+
+    xr::threading::atomic_uint32 counter { 0 };
+    static awaiting_reading_task tasks[256];
+    REQUIRE(run_reading_tasks(scheduler, tasks, device, counter, 16));
+    REQUIRE(xr::threading::atomic_fetch_acq(counter) == 256 * 16);
+    REQUIRE(scheduler.get_fiber_pool_stats(xr::tasks::task_stack_request::small_stack).in_use_count == 0);
+
+    scheduler.remove_completion_poller(fake_io_device::poll, &device);
+}
+
+TEST_CASE("Loading Files From Tasks", "[.benchmark]")
+{
+    // M tasks load N files each, every read takes 1ms on the device
+    constexpr uint32_t files_per_task = 16;
+
+    xr::tasks::task_scheduler scheduler { main_allocator };
+
+    fake_io_device device { 1000 };
+    scheduler.add_completion_poller(fake_io_device::poll, &device);
+
+    xr::threading::atomic_uint32 counter { 0 };
+    static blocking_reading_task blocking_tasks[64];
+    static awaiting_reading_task awaiting_tasks[64];
+
+    BENCHMARK("64 tasks x 16 files, blocking reads")
+    {
+        run_reading_tasks(scheduler, blocking_tasks, device, counter, files_per_task);
+    }
+
+    BENCHMARK("64 tasks x 16 files, suspending reads")
+    {
+        run_reading_tasks(scheduler, awaiting_tasks, device, counter, files_per_task);
+    }
+
+    scheduler.remove_completion_poller(fake_io_device::poll, &device);
+}
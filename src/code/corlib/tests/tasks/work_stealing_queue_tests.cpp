@@ -0,0 +1,342 @@
+// This file is a part of xray-ng engine
+//
+
+#include "catch/catch.hpp"
+#include "../../sources/tasks/work_stealing_queue.h"
+#include "../../sources/tasks/concurrent_task_queue.h"
+#include "corlib/tasks/details/grouped_task.h"
+#include "corlib/memory/memory_crt_allocator.h"
+#include "corlib/threading/interlocked.h"
+#include "corlib/sys/thread.h"
+#include "corlib/sys/chrono.h"
+#include <stdio.h>
+
+using namespace xr;
+
+static memory::crt_allocator queue_allocator {};
+
+constexpr size_t test_priority_count = 3;
+constexpr size_t test_queue_capacity = 4096;
+
+using lock_free_queue = tasks::priority_work_stealing_queue<
+    tasks::details::grouped_task, test_priority_count, test_queue_capacity>;
+
+using locked_queue = tasks::priority_task_queue<
+    tasks::details::grouped_task, test_priority_count, test_queue_capacity>;
+
+//-----------------------------------------------------------------------------------------------------------
+static tasks::details::grouped_task make_test_task(size_t index)
+{
+    tasks::details::grouped_task task {};
+    task.desc.user_data = reinterpret_cast<pvoid>(index + 1);
+    return task;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+static size_t test_task_index(const tasks::details::grouped_task& task)
+{
+    return reinterpret_cast<size_t>(task.desc.user_data) - 1;
+}
+
+TEST_CASE("work stealing queue: owner pops newest, thieves steal oldest", "[tasks]")
+{
+    lock_free_queue queue {};
+    queue.initialize_memory_pool(queue_allocator);
+    queue.bind_owner(sys::current_thread_id());
+
+    tasks::details::grouped_task items[3] = { make_test_task(0), make_test_task(1), make_test_task(2) };
+    REQUIRE(queue.add(items, 3) == 3);
+
+    tasks::details::grouped_task task {};
+    REQUIRE(queue.try_steal(task));
+    REQUIRE(test_task_index(task) == 0);
+
+    REQUIRE(queue.try_pop(task));
+    REQUIRE(test_task_index(task) == 2);
+
+    REQUIRE(queue.try_pop(task));
+    REQUIRE(test_task_index(task) == 1);
+
+    REQUIRE(!queue.try_pop(task));
+    REQUIRE(!queue.try_steal(task));
+
+    queue.shutdown_memory_pool(queue_allocator);
+}
+
+TEST_CASE("work stealing queue: foreign submissions go through mailbox", "[tasks]")
+{
+    lock_free_queue queue {};
+    queue.initialize_memory_pool(queue_allocator);
+
+    // queue is not bound to this thread, so items are treated as foreign
+    tasks::details::grouped_task items[2] = { make_test_task(0), make_test_task(1) };
+    REQUIRE(queue.add(items, 2) == 2);
+
+    tasks::details::grouped_task task {};
+    REQUIRE(queue.try_steal(task));
+    REQUIRE(test_task_index(task) == 0);
+
+    REQUIRE(queue.try_pop(task));
+    REQUIRE(test_task_index(task) == 1);
+
+    REQUIRE(!queue.try_pop(task));
+
+    queue.shutdown_memory_pool(queue_allocator);
+}
+
+TEST_CASE("work stealing queue: foreign high priority submission is stolen by high priority pass", "[tasks]")
+{
+    lock_free_queue queue {};
+    queue.initialize_memory_pool(queue_allocator);
+
+    tasks::details::grouped_task items[2] = { make_test_task(0), make_test_task(1) };
+    items[0].desc.priority = tasks::task_priority::background;
+    items[1].desc.priority = tasks::task_priority::high;
+    REQUIRE(queue.add(items, 2) == 2);
+
+    // owner is busy and never drained its mailbox
+    tasks::details::grouped_task task {};
+    REQUIRE(queue.try_steal(task, tasks::task_priority::high));
+    REQUIRE(test_task_index(task) == 1);
+
+    REQUIRE(!queue.try_steal(task, tasks::task_priority::high));
+    REQUIRE(!queue.is_empty());
+
+    REQUIRE(queue.try_steal(task));
+    REQUIRE(test_task_index(task) == 0);
+    REQUIRE(queue.is_empty());
+
+    queue.shutdown_memory_pool(queue_allocator);
+}
+
+TEST_CASE("mpmc queue: fifo order and bounded capacity", "[tasks]")
+{
+    tasks::mpmc_queue<tasks::details::grouped_task, 4> queue {};
+    REQUIRE(!queue.is_created());
+
+    queue.create(queue_allocator);
+    REQUIRE(queue.is_empty());
+
+    for(size_t i = 0; i < 4; ++i)
+        REQUIRE(queue.enqueue(make_test_task(i)));
+
+    REQUIRE(!queue.enqueue(make_test_task(4)));
+
+    tasks::details::grouped_task task {};
+    for(size_t round = 0; round < 2; ++round)
+    {
+        REQUIRE(queue.dequeue(task));
+        REQUIRE(test_task_index(task) == round);
+
+        // freed cell is reused after wrapping around
+        REQUIRE(queue.enqueue(make_test_task(4 + round)));
+    }
+
+    for(size_t i = 2; i < 6; ++i)
+    {
+        REQUIRE(queue.dequeue(task));
+        REQUIRE(test_task_index(task) == i);
+    }
+
+    REQUIRE(!queue.dequeue(task));
+    REQUIRE(queue.is_empty());
+
+    queue.destroy(queue_allocator);
+}
+
+TEST_CASE("work stealing queue: strict priority order with aging", "[tasks]")
+{
+    lock_free_queue queue {};
+    queue.initialize_memory_pool(queue_allocator);
+    queue.bind_owner(sys::current_thread_id());
+    queue.set_aging_threshold(2);
+
+    tasks::details::grouped_task items[5] = { make_test_task(0), make_test_task(1),
+        make_test_task(2), make_test_task(3), make_test_task(4) };
+
+    items[0].desc.priority = tasks::task_priority::background;
+    for(size_t i = 1; i < eastl::size(items); ++i)
+        items[i].desc.priority = tasks::task_priority::high;
+
+    REQUIRE(queue.add(items, eastl::size(items)) == eastl::size(items));
+
+    tasks::details::grouped_task task {};
+    REQUIRE(queue.try_steal(task, tasks::task_priority::high));
+    REQUIRE(test_task_index(task) == 1);
+
+    REQUIRE(queue.try_pop(task));
+    REQUIRE(test_task_index(task) == 4);
+    REQUIRE(queue.try_pop(task));
+    REQUIRE(test_task_index(task) == 3);
+
+    // background task was passed over twice, so it is served before remaining high one
+    REQUIRE(queue.try_pop(task));
+    REQUIRE(test_task_index(task) == 0);
+    REQUIRE(queue.try_pop(task));
+    REQUIRE(test_task_index(task) == 2);
+    REQUIRE(!queue.try_pop(task));
+
+    queue.shutdown_memory_pool(queue_allocator);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+struct lock_free_queue_traits
+{
+    using queue = lock_free_queue;
+
+    static void prepare(queue& q) { q.bind_owner(sys::current_thread_id()); }
+    static size_t push(queue& q, const tasks::details::grouped_task* items, size_t count) { return q.add(items, count); }
+    static bool pop(queue& q, tasks::details::grouped_task& task) { return q.try_pop(task); }
+    static bool steal(queue& q, tasks::details::grouped_task& task) { return q.try_steal(task); }
+}; // struct lock_free_queue_traits
+
+//-----------------------------------------------------------------------------------------------------------
+struct locked_queue_traits
+{
+    using queue = locked_queue;
+
+    static void prepare(queue&) {}
+    static size_t push(queue& q, const tasks::details::grouped_task* items, size_t count) { return q.add(items, count) ? count : 0; }
+    static bool pop(queue& q, tasks::details::grouped_task& task) { return q.try_pop_oldest(task); }
+    static bool steal(queue& q, tasks::details::grouped_task& task) { return q.try_pop_newest(task); }
+}; // struct locked_queue_traits
+
+//-----------------------------------------------------------------------------------------------------------
+template<typename Traits>
+struct queue_stress_context
+{
+    static constexpr size_t batch_size = 64;
+
+    typename Traits::queue queue;
+    tasks::details::grouped_task* items { nullptr };
+    threading::atomic_uint32* taken { nullptr };
+    size_t total { 0 };
+    threading::atomic_size_t consumed { 0 };
+    threading::atomic_uint32 duplicates { 0 };
+
+    void consume(const tasks::details::grouped_task& task)
+    {
+        size_t index = test_task_index(task);
+        if(threading::atomic_fetch_then_inc_seq(taken[index]) != 0)
+            threading::atomic_fetch_inc_seq(duplicates);
+
+        threading::atomic_fetch_inc_seq(consumed);
+    }
+
+    static uint32_t thief_main(pvoid arg)
+    {
+        auto& self = *reinterpret_cast<queue_stress_context*>(arg);
+        tasks::details::grouped_task task {};
+        while(threading::atomic_fetch_acq(self.consumed) < self.total)
+        {
+            if(Traits::steal(self.queue, task))
+                self.consume(task);
+        }
+        return 0;
+    }
+
+    void owner_main()
+    {
+        Traits::prepare(queue);
+        tasks::details::grouped_task task {};
+
+        size_t pushed = 0;
+        while(pushed < total)
+        {
+            size_t count = eastl::min(batch_size, total - pushed);
+            pushed += Traits::push(queue, items + pushed, count);
+
+            // owner keeps half of every batch for itself
+            for(size_t i = 0; i < batch_size / 2; ++i)
+            {
+                if(Traits::pop(queue, task))
+                    consume(task);
+            }
+        }
+
+        while(threading::atomic_fetch_acq(consumed) < total)
+        {
+            if(Traits::pop(queue, task))
+                consume(task);
+        }
+    }
+}; // struct queue_stress_context<Traits>
+
+//-----------------------------------------------------------------------------------------------------------
+template<typename Traits>
+static uint32_t run_queue_stress(uint32_t threads_count, size_t total)
+{
+    using context_type = queue_stress_context<Traits>;
+
+    auto* context = XR_ALLOCATE_OBJECT_T(queue_allocator, context_type, "queue stress context") {};
+    context->queue.initialize_memory_pool(queue_allocator);
+    context->total = total;
+    context->items = XR_ALLOCATE_OBJECT_ARRAY_T(queue_allocator,
+        tasks::details::grouped_task, total, "queue stress items");
+    context->taken = XR_ALLOCATE_OBJECT_ARRAY_T(queue_allocator,
+        threading::atomic_uint32, total, "queue stress markers");
+
+    for(size_t i = 0; i < total; ++i)
+    {
+        context->items[i] = make_test_task(i);
+        context->taken[i] = 0;
+    }
+
+    sys::thread_handle thieves[63];
+    uint32_t thieves_count = eastl::min<uint32_t>(threads_count - 1, 63);
+    for(uint32_t i = 0; i < thieves_count; ++i)
+    {
+        thieves[i] = sys::spawn_thread(&context_type::thief_main, context,
+            L"queue thief", sys::thread_priority::medium, XR_KILOBYTES_TO_BYTES(64));
+    }
+
+    context->owner_main();
+
+    if(thieves_count > 0)
+    {
+        bool joined = sys::wait_threads(thieves, thieves_count);
+        XR_UNREFERENCED_PARAMETER(joined);
+
+        for(uint32_t i = 0; i < thieves_count; ++i)
+            sys::detach_thread(thieves[i]);
+    }
+
+    uint32_t duplicates = context->duplicates;
+    for(size_t i = 0; i < total; ++i)
+    {
+        if(context->taken[i] != 1)
+            ++duplicates;
+    }
+
+    XR_DEALLOCATE_MEMORY(queue_allocator, const_cast<uint32_t*>(context->taken));
+    XR_DEALLOCATE_MEMORY(queue_allocator, context->items);
+    context->queue.shutdown_memory_pool(queue_allocator);
+    XR_DEALLOCATE_MEMORY_T(queue_allocator, context);
+    return duplicates;
+}
+
+TEST_CASE("work stealing queue: concurrent steal never duplicates or loses tasks", "[tasks]")
+{
+    REQUIRE(run_queue_stress<lock_free_queue_traits>(8, 100000) == 0);
+}
+
+TEST_CASE("work stealing queue: push/pop/steal throughput", "[.benchmark][tasks]")
+{
+    constexpr size_t total = 1 << 20;
+    char name[64];
+
+    for(uint32_t threads_count = 1; threads_count <= 64; threads_count *= 2)
+    {
+        snprintf(name, sizeof(name), "spin-locked queue, %u threads", threads_count);
+        BENCHMARK(name)
+        {
+            REQUIRE(run_queue_stress<locked_queue_traits>(threads_count, total) == 0);
+        }
+
+        snprintf(name, sizeof(name), "chase-lev queue, %u threads", threads_count);
+        BENCHMARK(name)
+        {
+            REQUIRE(run_queue_stress<lock_free_queue_traits>(threads_count, total) == 0);
+        }
+    }
+}
@@ -0,0 +1,118 @@
+// This file is a part of xray-ng engine
+//
+
+#include "catch/catch.hpp"
+#include "corlib/tasks/task_system.h"
+#include "corlib/memory/memory_crt_allocator.h"
+#include "corlib/threading/interlocked.h"
+#include "../sources/tasks/scheduler.h"
+#include "../sources/tasks/worker_topology.h"
+
+static xr::memory::crt_allocator main_allocator {};
+
+//-----------------------------------------------------------------------------------------------------------
+// 2 nodes, 2 last level caches per node, 2 cores per cache, 2 hardware threads per core
+static void make_test_topology(xr::sys::cpu_topology& topology)
+{
+    topology.processors_count = 16;
+    for(uint32_t i = 0; i < 16; ++i)
+    {
+        xr::sys::logical_processor_info& info = topology.processors[i];
+        uint32_t core = i / 2;
+        info.hardware_thread = i;
+        info.core_id = core * 2;
+        info.llc_id = core / 2;
+        info.node_id = core / 4;
+        info.package_id = core / 4;
+    }
+
+    xr::sys::normalize_cpu_topology(topology);
+}
+
+TEST_CASE("cpu topology is normalized", "[tasks]")
+{
+    xr::sys::cpu_topology topology;
+    make_test_topology(topology);
+
+    REQUIRE(topology.cores_count == 8);
+    REQUIRE(topology.llc_count == 4);
+    REQUIRE(topology.nodes_count == 2);
+    REQUIRE(topology.packages_count == 2);
+    REQUIRE(topology.processors[15].core_id == 7);
+
+    xr::sys::cpu_topology system_topology;
+    xr::sys::query_cpu_topology(system_topology);
+    REQUIRE(system_topology.processors_count > 0);
+    REQUIRE(system_topology.cores_count <= system_topology.processors_count);
+}
+
+TEST_CASE("workers are placed on physical cores first", "[tasks]")
+{
+    xr::sys::cpu_topology topology;
+    make_test_topology(topology);
+
+    uint32_t worker_processors[16];
+    xr::tasks::details::assign_worker_processors(topology, 16, worker_processors);
+    for(uint32_t i = 0; i < 8; ++i)
+    {
+        REQUIRE(topology.processors[worker_processors[i]].core_id == i);
+        REQUIRE(topology.processors[worker_processors[i + 8]].core_id == i);
+    }
+
+    // first core is left to main thread
+    xr::tasks::details::assign_worker_processors(topology, 7, worker_processors);
+    for(uint32_t i = 0; i < 7; ++i)
+        REQUIRE(topology.processors[worker_processors[i]].core_id == i + 1);
+}
+
+TEST_CASE("steal order goes from nearest workers to remote ones", "[tasks]")
+{
+    xr::sys::cpu_topology topology;
+    make_test_topology(topology);
+
+    uint32_t worker_processors[16];
+    xr::tasks::details::assign_worker_processors(topology, 16, worker_processors);
+
+    xr::tasks::details::steal_order order {};
+    xr::tasks::details::build_steal_order(topology, worker_processors, 16, 0, order);
+
+    REQUIRE(order.tier_end[0] == 1);
+    REQUIRE(order.tier_end[1] == 3);
+    REQUIRE(order.tier_end[2] == 7);
+    REQUIRE(order.tier_end[3] == 15);
+    REQUIRE(order.victims[0] == 8);
+
+    const xr::sys::logical_processor_info& thief = topology.processors[worker_processors[0]];
+    for(uint32_t tier = 0, begin = 0; tier < 4; begin = order.tier_end[tier++])
+    {
+        for(uint32_t i = begin; i < order.tier_end[tier]; ++i)
+        {
+            const xr::sys::logical_processor_info& victim = topology.processors[worker_processors[order.victims[i]]];
+            REQUIRE(static_cast<uint32_t>(xr::tasks::details::get_steal_tier(thief, victim)) == tier);
+        }
+    }
+}
+
+TEST_CASE("Steal Policy", "[.benchmark]")
+{
+    xr::tasks::task_scheduler scheduler { main_allocator };
+
+    static xr::threading::atomic_uint32 visits[65536];
+    auto visit = [](xr::tasks::parallel_range range)
+    {
+        for(size_t i = range.begin; i < range.end; ++i)
+            xr::threading::atomic_fetch_inc_relax(visits[i]);
+    };
+
+    scheduler.set_steal_policy(xr::tasks::steal_policy::uniform);
+    BENCHMARK("65536 fine-grained items, uniform stealing")
+    {
+        scheduler.parallel_for(xr::tasks::parallel_range { 0, 65536 }, 8, visit);
+    }
+
+    scheduler.set_steal_policy(xr::tasks::steal_policy::hierarchical);
+    BENCHMARK("65536 fine-grained items, hierarchical stealing")
+    {
+        scheduler.parallel_for(xr::tasks::parallel_range { 0, 65536 }, 8, visit);
+    }
+}
@@ -0,0 +1,73 @@
+// This file is a part of xray-ng engine
+//
+
+#include "catch/catch.hpp"
+#include "corlib/threading/parking_lot.h"
+#include "corlib/sys/thread.h"
+
+using namespace xr;
+
+//-----------------------------------------------------------------------------------------------------------
+struct parked_thread_context
+{
+    threading::parking_lot* lot { nullptr };
+    threading::park_result result { threading::park_result::timed_out };
+};
+
+//-----------------------------------------------------------------------------------------------------------
+static uint32_t parked_thread_main(pvoid arg)
+{
+    auto& context = *reinterpret_cast<parked_thread_context*>(arg);
+    uint32_t ticket = context.lot->prepare_park();
+    context.result = context.lot->commit_park(ticket, sys::infinite);
+    return 0;
+}
+
+TEST_CASE("parking lot: unpark without parked threads stays in user mode", "[threading]")
+{
+    threading::parking_lot lot {};
+    lot.unpark_one();
+    lot.unpark(8);
+
+    REQUIRE(lot.get_stats().wake_syscalls == 0);
+}
+
+TEST_CASE("parking lot: cancelled park leaves no parked threads", "[threading]")
+{
+    threading::parking_lot lot {};
+    lot.prepare_park();
+    REQUIRE(lot.parked_count() == 1);
+
+    lot.cancel_park();
+    REQUIRE(lot.parked_count() == 0);
+}
+
+TEST_CASE("parking lot: park times out", "[threading]")
+{
+    threading::parking_lot lot {};
+    uint32_t ticket = lot.prepare_park();
+
+    REQUIRE(lot.commit_park(ticket, 10) == threading::park_result::timed_out);
+    REQUIRE(lot.parked_count() == 0);
+}
+
+TEST_CASE("parking lot: unpark wakes parked thread", "[threading]")
+{
+    threading::parking_lot lot {};
+    parked_thread_context context {};
+    context.lot = &lot;
+
+    sys::thread_handle thread = sys::spawn_thread(parked_thread_main, &context,
+        L"parked thread", sys::thread_priority::medium, XR_KILOBYTES_TO_BYTES(64));
+
+    while(lot.parked_count() == 0)
+        sys::yield();
+
+    lot.unpark_one();
+    REQUIRE(sys::wait_threads(&thread, 1));
+    sys::detach_thread(thread);
+
+    REQUIRE(context.result == threading::park_result::unparked);
+    REQUIRE(lot.get_stats().wakeups == 1);
+    REQUIRE(lot.get_stats().wake_syscalls == 1);
+}
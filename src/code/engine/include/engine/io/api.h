@@ -4,24 +4,140 @@
 #pragma once
 
 #include "engine/linkage.h"
+#include "corlib/macro/aligning.h"
 #include "corlib/utils/string_view.h"
+#include "corlib/memory/buffer_range.h"
+#include "corlib/memory/buffer_ref.h"
 #include "corlib/memory/memory_allocator_base.h"
+#include "corlib/tasks/task_awaitable.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, tasks)
+
+class scheduler;
+
+XR_NAMESPACE_END(xr, tasks)
+//-----------------------------------------------------------------------------------------------------------
 
 //-----------------------------------------------------------------------------------------------------------
 XR_NAMESPACE_BEGIN(xr, engine, io)
 
 class base_file_handle;
 
+//-----------------------------------------------------------------------------------------------------------
+struct async_io_desc
+{
+    //! requests every thread queue holds at once
+    uint32_t queue_depth { 128 };
+    //! page aligned staging buffers registered in every queue, buffered readers take them first
+    uint32_t registered_buffers_count { 0 };
+    size_t registered_buffer_size { 0 };
+    //! workers of this scheduler complete reads tasks wait for, must outlive asynchronous I/O
+    tasks::scheduler* scheduler { nullptr };
+}; // struct async_io_desc
+
+//-----------------------------------------------------------------------------------------------------------
+struct buffered_read_desc
+{
+    //! bytes of one read, rounded up to the page size
+    size_t buffer_size { XR_KILOBYTES_TO_BYTES(256) };
+    //! up to buffer_count - 1 buffers are read ahead while sequential reads keep hitting them
+    uint32_t buffer_count { 4 };
+    //! bypass page cache, ignored where file system doesn't support it. read_async of such file
+    //! needs page aligned offsets and buffers
+    bool direct_io { false };
+}; // struct buffered_read_desc
+
+//-----------------------------------------------------------------------------------------------------------
+// Read in flight. Task waits for it with execution_context::wait and keeps working thread free for
+// other tasks meanwhile. Must stay alive until it is ready.
+class async_read : public tasks::awaitable
+{
+public:
+    //! bytes read or negative error code, valid once ready
+    int32_t result { 0 };
+    //! request of the platform backend
+    XR_ALIGNAS(8) uint8_t platform_request[40];
+}; // class async_read
+
+//-----------------------------------------------------------------------------------------------------------
+// How range of mapped file is going to be accessed
+enum class access_advice : uint8_t
+{
+    normal,
+    //! pages are read ahead aggressively and dropped soon after they were used
+    sequential,
+    //! nothing is read ahead
+    random,
+    //! pages are read in background right away
+    will_need,
+    //! pages may be dropped, they are read again on the next access
+    dont_need
+}; // enum class access_advice
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Creates submission queues of asynchronous I/O, every thread gets its own queue on first request.
+ *  Without them files are read with blocking calls.
+ */
+bool initialize_async_io(memory::base_allocator& alloc, const async_io_desc& desc);
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  No requests may be in flight.
+ */
+void shutdown_async_io();
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Completes finished requests of all threads without blocking, returns their count.
+ */
+uint32_t poll_async_io();
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Starts reading size bytes at offset, file position is not changed. Read is always completed, result is
+ *  negative if it failed. Returns false if read failed before it was started.
+ */
+bool read_async(base_file_handle* handle, size_t offset, memory::buffer_ref ref, size_t size, async_read& operation);
+
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
 base_file_handle* open_read(memory::base_allocator& alloc, utils::wstring_view filename, bool allow_write);
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Large buffers and deep read-ahead keep fast devices busy, reads still look sequential to the caller.
+ */
+base_file_handle* open_read(memory::base_allocator& alloc, utils::wstring_view filename, bool allow_write,
+    const buffered_read_desc& desc);
+
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
 base_file_handle* open_read_no_buffering(memory::base_allocator& alloc, utils::wstring_view filename, bool allow_write);
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Maps whole file for reading, returns nullptr if file can't be mapped on this platform.
+ */
+base_file_handle* open_read_mapped(memory::base_allocator& alloc, utils::wstring_view filename);
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Returns view right into the mapped file, nothing is copied. Range is invalid if file is not mapped
+ *  or is shorter than offset + size. Every valid view must be released before the handle is closed.
+ */
+memory::buffer_range acquire_view(base_file_handle* handle, size_t offset, size_t size);
+void release_view(base_file_handle* handle, memory::buffer_range view);
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Hints how mapped range is going to be read, zero size means up to the end of file.
+ */
+bool advise(base_file_handle* handle, size_t offset, size_t size, access_advice advice);
+
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
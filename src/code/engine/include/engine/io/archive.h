@@ -0,0 +1,65 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "engine/io/api.h"
+#include "corlib/utils/hash_string.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+// Archive is one file: header, directory sorted by path hash, names of entries and aligned entry data.
+// Paths are stored as given, they are case sensitive and '/' separated.
+struct archive_header
+{
+    static XR_CONSTEXPR_CPP14_OR_CONST uint32_t the_magic = 0x4B505258; // "XRPK"
+    static XR_CONSTEXPR_CPP14_OR_CONST uint32_t the_version = 1;
+
+    uint32_t magic; //!< the_magic
+    uint32_t version; //!< the_version
+    uint32_t entries_count; //!< Number of entries in directory
+    uint32_t alignment; //!< Every entry data starts at offset multiple of it
+    uint64_t directory_offset; //!< Array of entries_count archive_entry sorted by path hash
+    uint64_t names_offset; //!< Path of every entry, not null terminated
+    uint64_t names_size; //!< Bytes of all paths
+}; // struct archive_header
+
+//-----------------------------------------------------------------------------------------------------------
+struct archive_entry
+{
+    uint64_t path_hash; //!< utils::hash_string_func of the path
+    uint64_t offset; //!< Offset of data from the start of archive
+    uint64_t size; //!< Bytes of data
+    uint32_t name_offset; //!< Offset of the path from names_offset
+    uint32_t name_size; //!< Bytes of the path
+}; // struct archive_entry
+
+//-----------------------------------------------------------------------------------------------------------
+// Loose file packed into archive under the path
+struct archive_source
+{
+    utils::string_view path;
+    utils::wstring_view filename;
+}; // struct archive_source
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Hash archive directory is keyed by.
+ */
+inline uint64_t archive_path_hash(utils::string_view path)
+{
+    return uint64_t(utils::hash_string_func(path));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Packs loose files into archive, alignment is power of two. Page aligned entries can be viewed in mapped
+ *  archives and read with direct I/O. Fails if two sources share the path.
+ */
+bool pack_archive(memory::base_allocator& alloc, utils::wstring_view archive_filename, const archive_source* sources,
+    uint32_t sources_count, uint32_t alignment = XR_KILOBYTES_TO_BYTES(4));
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,60 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "engine/io/archive.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+class mounted_archive;
+
+//-----------------------------------------------------------------------------------------------------------
+// Read-only file system over mounted archives. Directories of all archives are merged into one hash index,
+// so lookup costs the same however many archives are mounted and never touches the disk. Archive mounted
+// with higher priority hides entries of the same path in lower ones, with equal priorities the later
+// mount wins, patches are mounted over base archives this way.
+// Lookups and opens may run on any thread, mount and unmount must not run concurrently with them.
+class file_system final
+{
+public:
+    explicit file_system(memory::base_allocator& alloc);
+    ~file_system();
+
+    XR_DECLARE_DELETE_COPY_ASSIGNMENT(file_system);
+
+    // Returns nullptr if archive can't be opened or is damaged
+    mounted_archive* mount(utils::wstring_view archive_filename, int32_t priority = 0);
+
+    // Every file opened from the archive must be closed before
+    void unmount(mounted_archive* archive);
+
+    bool exists(utils::string_view path) const;
+
+    // Returns false if there is no such file
+    bool get_file_size(utils::string_view path, size_t& size) const;
+
+    // Handle reads only the entry, it is closed with close_file_handle
+    base_file_handle* open_read(utils::string_view path) const;
+
+private:
+    struct index_slot
+    {
+        uint64_t path_hash; //!< Hash of the path of the entry
+        mounted_archive* archive; //!< Archive of the entry, nullptr if slot is free
+        uint32_t entry; //!< Index of the entry in the directory of archive
+    }; // struct index_slot
+
+    const index_slot* find(utils::string_view path) const;
+    bool rebuild_index();
+
+    memory::base_allocator& m_allocator;
+    mounted_archive* m_archives; //!< Mounted archives sorted by priority, the highest one is the first
+    index_slot* m_index; //!< Open addressing table of the visible entries, power of two size
+    uint32_t m_index_mask; //!< Size of index minus one
+}; // class file_system
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
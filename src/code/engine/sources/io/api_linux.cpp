@@ -0,0 +1,304 @@
+// This file is a part of xray-ng engine
+//
+
+#if !defined(XRAY_PLATFORM_LINUX)
+#   error "This code is supported by Linux platform!"
+#endif // !defined(XRAY_PLATFORM_LINUX)
+
+#include "pch.h"
+#include "async_buffered_file_handler_linux.h"
+#include "async_file_handler_linux.h"
+#include "io_ring_linux.h"
+#include "mapped_file_handle_linux.h"
+#include "corlib/memory/allocator_macro.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Encodes wide characters as UTF-8, kernel takes paths as bytes.
+ */
+static char* linux_normalized_filename(utils::wstring_view filename)
+{
+    XR_CONSTEXPR_CPP14_OR_STATIC_CONST uint8_t max_nested_buffers = 4;
+
+    static thread_local uint8_t index = 0;
+    static thread_local char the_localized_filename[max_nested_buffers][PATH_MAX] = {};
+
+    char* current_buffer = the_localized_filename[index];
+    index = (index + 1) % max_nested_buffers;
+
+    size_t length = 0;
+    for(wchar_t const symbol : filename)
+    {
+        uint32_t const code = static_cast<uint32_t>(symbol);
+        size_t const encoded = code < 0x80 ? 1 : code < 0x800 ? 2 : code < 0x10000 ? 3 : 4;
+        if(length + encoded >= PATH_MAX)
+            break;
+
+        char* out = current_buffer + length;
+        switch(encoded)
+        {
+        case 1:
+            out[0] = char(code);
+            break;
+        case 2:
+            out[0] = char(0xC0 | (code >> 6));
+            out[1] = char(0x80 | (code & 0x3F));
+            break;
+        case 3:
+            out[0] = char(0xE0 | (code >> 12));
+            out[1] = char(0x80 | ((code >> 6) & 0x3F));
+            out[2] = char(0x80 | (code & 0x3F));
+            break;
+        default:
+            out[0] = char(0xF0 | (code >> 18));
+            out[1] = char(0x80 | ((code >> 12) & 0x3F));
+            out[2] = char(0x80 | ((code >> 6) & 0x3F));
+            out[3] = char(0x80 | (code & 0x3F));
+            break;
+        }
+
+        length += encoded;
+    }
+
+    current_buffer[length] = '\0';
+    return current_buffer;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Linux has no share modes, allow_write is kept for interface parity.
+ */
+static int create_platform_handle_read(utils::wstring_view filename, bool allow_write, int flags = 0)
+{
+    XR_UNREFERENCED_PARAMETER(allow_write);
+    return ::open(linux_normalized_filename(filename), O_RDONLY | O_CLOEXEC | flags);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool initialize_async_io(memory::base_allocator& alloc, const async_io_desc& desc)
+{
+    return initialize_io_rings(alloc, desc);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void shutdown_async_io()
+{
+    shutdown_io_rings();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+uint32_t poll_async_io()
+{
+    return poll_io_rings();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool read_async(base_file_handle* handle, size_t offset, memory::buffer_ref ref, size_t size, async_read& operation)
+{
+    XR_DEBUG_ASSERTION_MSG(handle != nullptr, "Invalid file handle passed!");
+    return handle->read_async(offset, ref, size, operation);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+base_file_handle* open_read(memory::base_allocator& alloc, utils::wstring_view filename, bool allow_write)
+{
+    return open_read(alloc, filename, allow_write, buffered_read_desc {});
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  File systems without direct I/O refuse O_DIRECT on open, such files are read through page cache.
+ */
+base_file_handle* open_read(memory::base_allocator& alloc, utils::wstring_view filename, bool allow_write,
+    const buffered_read_desc& desc)
+{
+    int fd = create_platform_handle_read(filename, allow_write, desc.direct_io ? O_DIRECT : 0);
+    if(fd < 0 && desc.direct_io && errno == EINVAL)
+        fd = create_platform_handle_read(filename, allow_write);
+
+    if(fd >= 0)
+        return XR_ALLOCATE_OBJECT_T(alloc, async_buffered_file_handle, "open_read")(alloc, fd, desc);
+
+    return nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+base_file_handle* open_read_no_buffering(memory::base_allocator& alloc, utils::wstring_view filename, bool allow_write)
+{
+    int fd = create_platform_handle_read(filename, allow_write);
+    if(fd >= 0)
+        return XR_ALLOCATE_OBJECT_T(alloc, async_file_handle, "open_read_no_buffering")(alloc, fd);
+
+    return nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+base_file_handle* open_read_mapped(memory::base_allocator& alloc, utils::wstring_view filename)
+{
+    int fd = create_platform_handle_read(filename, false);
+    if(fd < 0)
+        return nullptr;
+
+    mapped_file_handle* h = XR_ALLOCATE_OBJECT_T(alloc, mapped_file_handle, "open_read_mapped")(alloc, fd);
+    if(h && !h->is_valid())
+    {
+        XR_DEALLOCATE_MEMORY_T(alloc, h);
+        return nullptr;
+    }
+
+    return h;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+memory::buffer_range acquire_view(base_file_handle* handle, size_t offset, size_t size)
+{
+    XR_DEBUG_ASSERTION_MSG(handle != nullptr, "Invalid file handle passed!");
+    return handle->acquire_view(offset, size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void release_view(base_file_handle* handle, memory::buffer_range view)
+{
+    XR_DEBUG_ASSERTION_MSG(handle != nullptr, "Invalid file handle passed!");
+    if(view.is_valid())
+        handle->release_view(view);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool advise(base_file_handle* handle, size_t offset, size_t size, access_advice advice)
+{
+    XR_DEBUG_ASSERTION_MSG(handle != nullptr, "Invalid file handle passed!");
+    return handle->advise(offset, size, advice);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+base_file_handle* open_write(memory::base_allocator& alloc, utils::wstring_view filename, bool append, bool allow_read)
+{
+    int flags = (allow_read ? O_RDWR : O_WRONLY) | O_CREAT | O_CLOEXEC | (append ? 0 : O_TRUNC);
+    int fd = ::open(linux_normalized_filename(filename), flags, 0644);
+
+    if(fd >= 0)
+    {
+        async_file_handle* h = XR_ALLOCATE_OBJECT_T(alloc, async_file_handle, "open_write")(alloc, fd);
+        if(h) h->seek_from_end(0);
+        return h;
+    }
+
+    return nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void close_file_handle(base_file_handle* handle)
+{
+    XR_DEBUG_ASSERTION_MSG(handle != nullptr, "Invalid file handle passed!");
+    memory::base_allocator& allocator = handle->allocator();
+    XR_DEALLOCATE_MEMORY_T(allocator, handle);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool directory_exists(utils::wstring_view path)
+{
+    // empty path means relative position, relative path always exists
+    if(path.empty()) return true;
+
+    struct stat info;
+    return stat(linux_normalized_filename(path), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool create_directory(utils::wstring_view path)
+{
+    return mkdir(linux_normalized_filename(path), 0755) == 0 || errno == EEXIST;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool delete_directory(utils::wstring_view path)
+{
+    rmdir(linux_normalized_filename(path));
+
+    int last_error = errno;
+    bool const succeeded = !directory_exists(path);
+
+    if(!succeeded)
+        errno = last_error;
+
+    return succeeded;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool move(utils::wstring_view from, utils::wstring_view to)
+{
+    return rename(linux_normalized_filename(from), linux_normalized_filename(to)) == 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool set_read_only_status(utils::wstring_view path, bool const new_read_only_status)
+{
+    char const* filename = linux_normalized_filename(path);
+
+    struct stat info;
+    if(stat(filename, &info) != 0)
+        return false;
+
+    mode_t const write_bits = S_IWUSR | S_IWGRP | S_IWOTH;
+    mode_t const mode = new_read_only_status ? (info.st_mode & ~write_bits) : (info.st_mode | S_IWUSR);
+    return chmod(filename, mode & 07777) == 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool is_read_only(utils::wstring_view path)
+{
+    struct stat info;
+    if(stat(linux_normalized_filename(path), &info) == 0)
+        return !(info.st_mode & (S_IWUSR | S_IWGRP | S_IWOTH));
+
+    return false;
+}
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
@@ -40,6 +40,39 @@ static HANDLE create_platform_handle_read(utils::wstring_view filename, bool all
     return CreateFileW(windows_normalized_filename(filename), access, flags, nullptr, create, attributes, nullptr);
 }
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Overlapped reads need no queues on Windows.
+ */
+bool initialize_async_io(memory::base_allocator& alloc, const async_io_desc& desc)
+{
+    XR_UNREFERENCED_PARAMETER(alloc, desc);
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void shutdown_async_io()
+{}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+uint32_t poll_async_io()
+{
+    return 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool read_async(base_file_handle* handle, size_t offset, memory::buffer_ref ref, size_t size, async_read& operation)
+{
+    XR_DEBUG_ASSERTION_MSG(handle != nullptr, "Invalid file handle passed!");
+    return handle->read_async(offset, ref, size, operation);
+}
+
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
@@ -52,6 +85,17 @@ base_file_handle* open_read(memory::base_allocator& alloc, utils::wstring_view f
     return nullptr;
 }
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Buffered reader of Windows has fixed buffers yet.
+ */
+base_file_handle* open_read(memory::base_allocator& alloc, utils::wstring_view filename, bool allow_write,
+    const buffered_read_desc& desc)
+{
+    XR_UNREFERENCED_PARAMETER(desc);
+    return open_read(alloc, filename, allow_write);
+}
+
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
@@ -64,6 +108,44 @@ base_file_handle* open_read_no_buffering(memory::base_allocator& alloc, utils::w
     return nullptr;
 }
 
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  File mappings are not supported on Windows yet, callers read through buffered handles.
+ */
+base_file_handle* open_read_mapped(memory::base_allocator& alloc, utils::wstring_view filename)
+{
+    XR_UNREFERENCED_PARAMETER(alloc, filename);
+    return nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+memory::buffer_range acquire_view(base_file_handle* handle, size_t offset, size_t size)
+{
+    XR_DEBUG_ASSERTION_MSG(handle != nullptr, "Invalid file handle passed!");
+    return handle->acquire_view(offset, size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void release_view(base_file_handle* handle, memory::buffer_range view)
+{
+    XR_DEBUG_ASSERTION_MSG(handle != nullptr, "Invalid file handle passed!");
+    if(view.is_valid())
+        handle->release_view(view);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool advise(base_file_handle* handle, size_t offset, size_t size, access_advice advice)
+{
+    XR_DEBUG_ASSERTION_MSG(handle != nullptr, "Invalid file handle passed!");
+    return handle->advise(offset, size, advice);
+}
+
 //-----------------------------------------------------------------------------------------------------------
 /**
  */
@@ -0,0 +1,210 @@
+// This file is a part of xray-ng engine
+//
+
+#include "pch.h"
+#include "engine/io/archive.h"
+#include "base_file_handle.h"
+#include "corlib/memory/allocator_macro.h"
+#include "corlib/memory/memory_functions.h"
+#include "corlib/utils/aligning.h"
+#include "EASTL/sort.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+XR_CONSTEXPR_CPP14_OR_STATIC_CONST size_t the_copy_buffer_size = XR_MEGABYTES_TO_BYTES(1);
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+//-----------------------------------------------------------------------------------------------------------
+// Memory pack_archive works with, released in one place whatever step fails
+struct pack_state
+{
+    explicit pack_state(memory::base_allocator& alloc)
+        : allocator { alloc }
+    {}
+
+    ~pack_state()
+    {
+        if(archive) close_file_handle(archive);
+        if(entries) XR_DEALLOCATE_MEMORY(allocator, entries);
+        if(order) XR_DEALLOCATE_MEMORY(allocator, order);
+        if(buffer) XR_DEALLOCATE_MEMORY(allocator, buffer);
+    }
+
+    memory::base_allocator& allocator;
+    base_file_handle* archive { nullptr };
+    archive_entry* entries { nullptr }; //!< Entry of every source, in order of sources
+    uint32_t* order { nullptr }; //!< Indices of sources sorted by path hash
+    uint8_t* buffer { nullptr }; //!< Data is copied through it
+}; // struct pack_state
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool get_source_size(memory::base_allocator& alloc, utils::wstring_view filename, uint64_t& size)
+{
+    base_file_handle* handle = open_read_no_buffering(alloc, filename, false);
+    if(!handle)
+        return false;
+
+    size = handle->size();
+    close_file_handle(handle);
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool write_zeros(base_file_handle* archive, uint8_t* buffer, uint64_t size)
+{
+    while(size)
+    {
+        size_t const chunk = size_t(eastl::min(size, uint64_t(the_copy_buffer_size)));
+        memory::zero(buffer, chunk);
+        if(!archive->write(memory::buffer_ref { buffer, chunk }, chunk))
+            return false;
+
+        size -= chunk;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Source must still have the size it had when directory was built.
+ */
+bool copy_source(memory::base_allocator& alloc, utils::wstring_view filename, uint64_t size,
+    base_file_handle* archive, uint8_t* buffer)
+{
+    base_file_handle* source = open_read_no_buffering(alloc, filename, false);
+    if(!source)
+        return false;
+
+    bool succeeded = source->size() == size;
+    while(succeeded && size)
+    {
+        size_t const chunk = size_t(eastl::min(size, uint64_t(the_copy_buffer_size)));
+        succeeded = source->read(memory::buffer_ref { buffer, chunk }, chunk) &&
+            archive->write(memory::buffer_ref { buffer, chunk }, chunk);
+
+        size -= chunk;
+    }
+
+    close_file_handle(source);
+    return succeeded;
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Header is written last, archive that failed to be packed doesn't pass the magic check.
+ */
+bool pack_archive(memory::base_allocator& alloc, utils::wstring_view archive_filename, const archive_source* sources,
+    uint32_t sources_count, uint32_t alignment)
+{
+    XR_DEBUG_ASSERTION_MSG(sources || !sources_count, "Invalid sources passed!");
+    XR_DEBUG_ASSERTION_MSG(utils::is_power_of_2(alignment), "alignment must be power of two");
+
+    pack_state state { alloc };
+    size_t const count = eastl::max(sources_count, 1U);
+    state.entries = XR_ALLOCATE_OBJECT_ARRAY_T(alloc, archive_entry, count, "archive_directory");
+    state.order = XR_ALLOCATE_OBJECT_ARRAY_T(alloc, uint32_t, count, "archive_order");
+    state.buffer = XR_ALLOCATE_OBJECT_ARRAY_T(alloc, uint8_t, the_copy_buffer_size, "archive_copy_buffer");
+    if(!state.entries || !state.order || !state.buffer)
+        return false;
+
+    uint64_t names_size = 0;
+    for(uint32_t i = 0; i < sources_count; ++i)
+    {
+        archive_entry& entry = state.entries[i];
+        entry.path_hash = archive_path_hash(sources[i].path);
+        entry.name_offset = uint32_t(names_size);
+        entry.name_size = uint32_t(sources[i].path.size());
+        state.order[i] = i;
+
+        names_size += sources[i].path.size();
+        if(names_size > UINT32_MAX || !get_source_size(alloc, sources[i].filename, entry.size))
+            return false;
+    }
+
+    const archive_entry* entries = state.entries;
+    eastl::sort(state.order, state.order + sources_count, [entries](uint32_t left, uint32_t right)
+    {
+        return entries[left].path_hash < entries[right].path_hash;
+    });
+
+    // colliding hashes are fine, lookup compares paths, the same path twice is not
+    for(uint32_t i = 1; i < sources_count; ++i)
+    {
+        for(uint32_t j = i; j-- && entries[state.order[j]].path_hash == entries[state.order[i]].path_hash;)
+        {
+            if(sources[state.order[j]].path == sources[state.order[i]].path)
+                return false;
+        }
+    }
+
+    archive_header header {};
+    header.magic = archive_header::the_magic;
+    header.version = archive_header::the_version;
+    header.entries_count = sources_count;
+    header.alignment = alignment;
+    header.directory_offset = sizeof(archive_header);
+    header.names_offset = header.directory_offset + uint64_t(sources_count) * sizeof(archive_entry);
+    header.names_size = names_size;
+
+    uint64_t offset = header.names_offset + names_size;
+    for(uint32_t i = 0; i < sources_count; ++i)
+    {
+        archive_entry& entry = state.entries[state.order[i]];
+        entry.offset = utils::align_up(offset, alignment);
+        offset = entry.offset + entry.size;
+    }
+
+    state.archive = open_write(alloc, archive_filename, false, false);
+    if(!state.archive)
+        return false;
+
+    archive_header placeholder {};
+    if(!state.archive->write(memory::buffer_ref { &placeholder, sizeof(placeholder) }, sizeof(placeholder)))
+        return false;
+
+    for(uint32_t i = 0; i < sources_count; ++i)
+    {
+        archive_entry& entry = state.entries[state.order[i]];
+        if(!state.archive->write(memory::buffer_ref { &entry, sizeof(entry) }, sizeof(entry)))
+            return false;
+    }
+
+    for(uint32_t i = 0; i < sources_count; ++i)
+    {
+        utils::string_view const path = sources[i].path;
+        if(!path.empty() && !state.archive->write(memory::buffer_ref { path.data(), path.size() }, path.size()))
+            return false;
+    }
+
+    offset = header.names_offset + names_size;
+    for(uint32_t i = 0; i < sources_count; ++i)
+    {
+        uint32_t const source = state.order[i];
+        const archive_entry& entry = state.entries[source];
+
+        if(!write_zeros(state.archive, state.buffer, entry.offset - offset) ||
+            !copy_source(alloc, sources[source].filename, entry.size, state.archive, state.buffer))
+            return false;
+
+        offset = entry.offset + entry.size;
+    }
+
+    return state.archive->seek(0) &&
+        state.archive->write(memory::buffer_ref { &header, sizeof(header) }, sizeof(header)) &&
+        state.archive->flush();
+}
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
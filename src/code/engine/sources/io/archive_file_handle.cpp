@@ -0,0 +1,132 @@
+// This file is a part of xray-ng engine
+//
+
+#include "pch.h"
+#include "archive_file_handle.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+archive_file_handle::archive_file_handle(memory::base_allocator& alloc, mounted_archive& archive,
+    const archive_entry& entry)
+    : base_file_handle { alloc }
+    , m_archive { archive }
+    , m_offset { entry.offset }
+    , m_file_size { size_t(entry.size) }
+    , m_file_pos { 0 }
+{
+    m_archive.add_reader();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+archive_file_handle::~archive_file_handle()
+{
+    m_archive.remove_reader();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t archive_file_handle::tell()
+{
+    return m_file_pos;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool archive_file_handle::seek(ssize_t const pos)
+{
+    XR_DEBUG_ASSERTION(pos >= 0 && size_t(pos) <= m_file_size);
+
+    m_file_pos = size_t(pos);
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool archive_file_handle::seek_from_end(ssize_t const pos_relative_to_end)
+{
+    XR_DEBUG_ASSERTION(pos_relative_to_end <= 0);
+    return seek(ssize_t(m_file_size) + pos_relative_to_end);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool archive_file_handle::read(memory::buffer_ref ref, size_t bytes_to_read)
+{
+    if(!bytes_to_read || !contains(m_file_pos, bytes_to_read))
+        return false;
+
+    if(!m_archive.read(m_offset + m_file_pos, ref, bytes_to_read))
+        return false;
+
+    m_file_pos += bytes_to_read;
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t archive_file_handle::size()
+{
+    return m_file_size;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool archive_file_handle::read_async(size_t offset, memory::buffer_ref ref, size_t size, async_read& operation)
+{
+    if(!contains(offset, size))
+    {
+        operation.result = -1;
+        operation.complete();
+        return false;
+    }
+
+    return m_archive.read_async(m_offset + offset, ref, size, operation);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Views exist only in mapped archives.
+ */
+memory::buffer_range archive_file_handle::acquire_view(size_t offset, size_t size)
+{
+    if(!size || !contains(offset, size))
+        return memory::buffer_range {};
+
+    return m_archive.acquire_view(m_offset + offset, size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void archive_file_handle::release_view(memory::buffer_range view)
+{
+    m_archive.release_view(view);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Zero size means up to the end of the entry, not of the archive.
+ */
+bool archive_file_handle::advise(size_t offset, size_t size, access_advice advice)
+{
+    if(!contains(offset, size))
+        return false;
+
+    size_t const length = size ? size : m_file_size - offset;
+    return !length || m_archive.advise(m_offset + offset, length, advice);
+}
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
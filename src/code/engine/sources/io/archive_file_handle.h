@@ -0,0 +1,48 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "base_file_handle.h"
+#include "mounted_archive.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+// Read-only entry of mounted archive, offsets and size are those of the entry. Keeps archive mounted
+// until it is closed.
+class XR_NON_VIRTUAL archive_file_handle : public base_file_handle
+{
+public:
+    XR_IO_API archive_file_handle(memory::base_allocator& alloc, mounted_archive& archive, const archive_entry& entry);
+    virtual XR_IO_API ~archive_file_handle();
+    virtual XR_IO_API size_t tell() override;
+    virtual XR_IO_API bool seek(ssize_t const pos) override;
+    virtual XR_IO_API bool seek_from_end(ssize_t const pos_relative_to_end) override;
+    virtual XR_IO_API bool read(memory::buffer_ref ref, size_t bytes_to_read) override;
+    virtual XR_IO_API size_t size() override;
+    virtual XR_IO_API bool read_async(size_t offset, memory::buffer_ref ref, size_t size, async_read& operation) override;
+    virtual XR_IO_API memory::buffer_range acquire_view(size_t offset, size_t size) override;
+    virtual XR_IO_API void release_view(memory::buffer_range view) override;
+    virtual XR_IO_API bool advise(size_t offset, size_t size, access_advice advice) override;
+
+private:
+    bool contains(size_t offset, size_t size) const;
+
+    mounted_archive& m_archive; //!< Archive the entry belongs to
+    uint64_t m_offset; //!< Offset of the entry in archive
+    size_t m_file_size; //!< The size of the entry
+    size_t m_file_pos; //!< Position of next read relative to the entry
+}; // class archive_file_handle
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline bool archive_file_handle::contains(size_t offset, size_t size) const
+{
+    return offset <= m_file_size && size <= m_file_size - offset;
+}
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,416 @@
+// This file is a part of xray-ng engine
+//
+
+#if !defined(XRAY_PLATFORM_LINUX)
+#   error "This code is supported by Linux platform!"
+#endif // !defined(XRAY_PLATFORM_LINUX)
+
+#include "pch.h"
+#include "corlib/memory/memory_functions.h"
+#include "corlib/memory/memory_paging.h"
+#include "corlib/utils/aligning.h"
+#include "async_buffered_file_handler_linux.h"
+#include "EASTL/algorithm.h"
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+async_buffered_file_handle::async_buffered_file_handle(memory::base_allocator& alloc, int fd,
+    const buffered_read_desc& desc)
+    : base_file_handle{ alloc }
+    , m_ring { nullptr }
+    , m_fd { fd }
+    , m_file_size { 0 }
+    , m_file_pos { 0 }
+    , m_buffer_size { ssize_t(utils::align_up(eastl::max(desc.buffer_size, size_t(1)), memory::system_page_size())) }
+    , m_buffers_count { eastl::clamp<uint32_t>(desc.buffer_count, 2, uint32_t(max_buffers_count)) }
+    , m_read_ahead { 1 }
+    , m_last_block { -1 }
+    , m_pages { nullptr }
+    , m_pages_size { 0 }
+    , m_buffers {}
+{
+    open();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+async_buffered_file_handle::~async_buffered_file_handle()
+{
+    close();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t async_buffered_file_handle::tell()
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    return m_file_pos;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Only moves position, buffers are refilled by the next read if the position left them.
+ */
+bool async_buffered_file_handle::seek(ssize_t const pos)
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    XR_DEBUG_ASSERTION(pos >= 0 && pos <= m_file_size);
+
+    m_file_pos = pos;
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool async_buffered_file_handle::seek_from_end(ssize_t const pos_relative_to_end)
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    XR_DEBUG_ASSERTION(pos_relative_to_end <= 0);
+    return seek(m_file_size + pos_relative_to_end);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool async_buffered_file_handle::read(memory::buffer_ref ref, size_t bytes_to_read)
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    // if zero were requested, quit (some calls like to do zero sized reads).
+    if(!bytes_to_read) return false;
+
+    if(m_file_pos + ssize_t(bytes_to_read) > m_file_size)
+        return false;
+
+    XR_DEBUG_ASSERTION(ref.is_valid());
+    uint8_t* ptr = ref.as_pointer<uint8_t*>();
+    size_t ptr_size = ref.length();
+
+    // while there is data to copy
+    while(bytes_to_read > 0)
+    {
+        ssize_t const block = m_file_pos / m_buffer_size;
+        if(!fill_buffer(block))
+            return false;
+
+        read_buffer const& buffer = get_buffer(block);
+        size_t const available = size_t(buffer.offset + buffer.length - m_file_pos);
+        size_t const num_to_copy = eastl::min(bytes_to_read, available);
+
+        memory::copy(ptr, ptr_size, buffer.data + (m_file_pos - buffer.offset), num_to_copy);
+
+        m_file_pos += num_to_copy;
+        XR_DEBUG_ASSERTION(m_file_pos <= m_file_size);
+
+        bytes_to_read -= num_to_copy;
+        ptr += num_to_copy;
+        ptr_size -= num_to_copy;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool async_buffered_file_handle::write(memory::buffer_ref ref, size_t bytes_to_write)
+{
+    XR_UNREFERENCED_PARAMETER(ref, bytes_to_write);
+    XR_DEBUG_ASSERTION_MSG(false, "this is an async reader only and doesn't support writing");
+    return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool async_buffered_file_handle::flush(bool const full_flush)
+{
+    // reader only, so don't need to support flushing
+
+    XR_UNREFERENCED_PARAMETER(full_flush);
+    return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool async_buffered_file_handle::truncate(size_t new_size)
+{
+    // reader only, so don't need to support truncation
+
+    XR_UNREFERENCED_PARAMETER(new_size);
+    return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t async_buffered_file_handle::size()
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    return m_file_size;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Goes around read ahead buffers, they serve sequential reads only.
+ */
+bool async_buffered_file_handle::read_async(size_t offset, memory::buffer_ref ref, size_t size, async_read& operation)
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    return submit_async_read(m_fd, offset, ref, size, operation);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void async_buffered_file_handle::open()
+{
+    struct stat info;
+    m_file_size = (fstat(m_fd, &info) == 0) ? ssize_t(info.st_size) : 0;
+
+    m_ring = current_io_ring();
+    allocate_buffers();
+
+    // kick off the first async read
+    if(m_file_size && start_async_read(get_buffer(0), 0, true) && m_ring)
+        m_ring->submit();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void async_buffered_file_handle::close()
+{
+    // can't free the buffers or close the file while reads are outstanding
+    for(uint32_t i = 0; i < m_buffers_count; ++i)
+        wait_for_async_read(m_buffers[i]);
+
+    if(is_valid())
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+
+    free_buffers();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Registered buffers of the ring are taken first, kernel doesn't map their pages for every read.
+ *  The rest are carved from one page aligned reservation, so they are usable for direct I/O as well.
+ */
+void async_buffered_file_handle::allocate_buffers()
+{
+    uint32_t unregistered_count = 0;
+    for(uint32_t i = 0; i < m_buffers_count; ++i)
+    {
+        read_buffer& buffer = m_buffers[i];
+        buffer.data = nullptr;
+        buffer.offset = -1;
+        buffer.length = 0;
+        buffer.in_flight = false;
+        buffer.registered_index = m_ring ?
+            m_ring->acquire_registered_buffer(size_t(m_buffer_size)) : io_ring::invalid_buffer_index;
+
+        if(buffer.registered_index != io_ring::invalid_buffer_index)
+            buffer.data = reinterpret_cast<uint8_t*>(m_ring->get_registered_buffer(buffer.registered_index));
+        else
+            ++unregistered_count;
+    }
+
+    if(unregistered_count)
+    {
+        m_pages_size = size_t(m_buffer_size) * unregistered_count;
+        m_pages = reinterpret_cast<uint8_t*>(memory::reserve_pages(m_pages_size, memory::page_kind::normal));
+        if(m_pages && !memory::commit_pages(m_pages, m_pages_size))
+        {
+            memory::release_pages(m_pages, m_pages_size);
+            m_pages = nullptr;
+        }
+
+        uint8_t* next = m_pages;
+        for(uint32_t i = 0; next && i < m_buffers_count; ++i)
+        {
+            read_buffer& buffer = m_buffers[i];
+            if(buffer.registered_index == io_ring::invalid_buffer_index)
+            {
+                buffer.data = next;
+                next += m_buffer_size;
+            }
+        }
+    }
+
+    XR_DEBUG_ASSERTION_MSG(!unregistered_count || m_pages != nullptr, "failed to allocate read buffers");
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void async_buffered_file_handle::free_buffers()
+{
+    for(uint32_t i = 0; i < m_buffers_count; ++i)
+    {
+        read_buffer& buffer = m_buffers[i];
+        if(buffer.registered_index != io_ring::invalid_buffer_index)
+            m_ring->release_registered_buffer(buffer.registered_index);
+
+        buffer.data = nullptr;
+        buffer.registered_index = io_ring::invalid_buffer_index;
+    }
+
+    if(m_pages)
+    {
+        memory::release_pages(m_pages, m_pages_size);
+        m_pages = nullptr;
+        m_pages_size = 0;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Makes buffer of the block hold its data. Read-ahead is doubled every time reading moves on to the next
+ *  block and halved when it jumps elsewhere, so seeks don't keep the device busy with data nobody reads.
+ */
+bool async_buffered_file_handle::fill_buffer(ssize_t block)
+{
+    read_buffer& buffer = get_buffer(block);
+    ssize_t const offset = block * m_buffer_size;
+
+    bool const moved = block != m_last_block;
+    if(moved)
+    {
+        if(block == m_last_block + 1)
+            m_read_ahead = eastl::min(m_read_ahead * 2, m_buffers_count - 1);
+        else
+            m_read_ahead = eastl::max(m_read_ahead / 2, 1U);
+
+        m_last_block = block;
+    }
+
+    // first read after a seek or retry of failed read, buffer may still be busy with a block nobody needs now
+    if(buffer.offset != offset)
+    {
+        wait_for_async_read(buffer);
+        if(!start_async_read(buffer, offset, true))
+            return false;
+    }
+
+    if(moved)
+        read_ahead(block);
+
+    return wait_for_async_read(buffer) && m_file_pos < buffer.offset + buffer.length;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Blocks following the served one are sent to the device with one submit. Buffers still busy with
+ *  stale reads are skipped, waiting for them would stall the reader.
+ */
+void async_buffered_file_handle::read_ahead(ssize_t block)
+{
+    // without ring read-ahead would block the reader
+    if(!m_ring)
+        return;
+
+    bool queued = false;
+    for(uint32_t i = 1; i <= m_read_ahead; ++i)
+    {
+        ssize_t const offset = (block + i) * m_buffer_size;
+        if(offset >= m_file_size)
+            break;
+
+        read_buffer& buffer = get_buffer(block + i);
+        if(buffer.offset == offset || buffer.in_flight)
+            continue;
+
+        if(!start_async_read(buffer, offset, false))
+            break;
+
+        queued = true;
+    }
+
+    if(queued)
+        m_ring->submit();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Returns false if buffer holds nothing, failed read leaves it empty so the next read retries.
+ */
+bool async_buffered_file_handle::wait_for_async_read(read_buffer& buffer)
+{
+    if(buffer.in_flight)
+    {
+        m_ring->wait(buffer.request);
+        buffer.in_flight = false;
+
+        buffer.length = eastl::max(buffer.request.result, 0);
+        if(buffer.request.result < 0)
+            buffer.offset = -1;
+    }
+
+    return buffer.offset >= 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Whole buffer is always requested, kernel returns less at the end of file. Offsets and sizes stay
+ *  multiples of the page size, as direct I/O requires. Returns false if read could not be started
+ *  without blocking, or failed.
+ */
+bool async_buffered_file_handle::start_async_read(read_buffer& buffer, ssize_t offset, bool can_block)
+{
+    XR_DEBUG_ASSERTION(!buffer.in_flight);
+
+    buffer.offset = offset;
+    buffer.length = 0;
+
+    uint32_t const num_bytes_to_read = uint32_t(m_buffer_size);
+
+    if(m_ring)
+    {
+        bool const prepared = (buffer.registered_index != io_ring::invalid_buffer_index) ?
+            m_ring->prepare_read_fixed(m_fd, buffer.registered_index, num_bytes_to_read, uint64_t(offset), buffer.request) :
+            m_ring->prepare_read(m_fd, buffer.data, num_bytes_to_read, uint64_t(offset), buffer.request);
+
+        if(prepared)
+        {
+            // waiting for the request submits it, read-ahead submits its batch by itself
+            buffer.in_flight = true;
+            return true;
+        }
+    }
+
+    if(!can_block)
+    {
+        buffer.offset = -1;
+        return false;
+    }
+
+    // no ring or ring is full, read completes right away
+    ssize_t num_read = 0;
+    do
+    {
+        num_read = pread(m_fd, buffer.data, num_bytes_to_read, offset);
+    }
+    while(num_read < 0 && errno == EINTR);
+
+    buffer.length = eastl::max(num_read, ssize_t(0));
+    if(num_read < 0)
+        buffer.offset = -1;
+
+    return num_read >= 0;
+}
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
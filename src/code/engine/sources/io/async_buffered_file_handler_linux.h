@@ -0,0 +1,98 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "base_file_handle.h"
+#include "io_ring_linux.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+// Sequential reader, one buffer is served while the following ones are read ahead by the io ring of the
+// thread that opened the file. Read-ahead grows while reads are sequential and shrinks on seeks.
+// Handle must be closed before asynchronous I/O is shut down.
+class XR_NON_VIRTUAL async_buffered_file_handle : public base_file_handle
+{
+public:
+    XR_IO_API async_buffered_file_handle(memory::base_allocator& alloc, int fd, const buffered_read_desc& desc);
+    virtual XR_IO_API ~async_buffered_file_handle();
+    virtual XR_IO_API size_t tell() override;
+    virtual XR_IO_API bool seek(ssize_t const pos) override;
+    virtual XR_IO_API bool seek_from_end(ssize_t const pos_relative_to_end) override;
+    virtual XR_IO_API bool read(memory::buffer_ref ref, size_t bytes_to_read) override;
+    virtual XR_IO_API bool write(memory::buffer_ref ref, size_t bytes_to_write) override;
+    virtual XR_IO_API bool flush(bool const full_flush = false) override;
+    virtual XR_IO_API bool truncate(size_t new_size) override;
+    virtual XR_IO_API size_t size() override;
+    virtual XR_IO_API bool read_async(size_t offset, memory::buffer_ref ref, size_t size, async_read& operation) override;
+
+    // How many buffers are read ahead of the one being served now
+    uint32_t get_read_ahead() const;
+
+private:
+    static XR_CONSTEXPR_CPP14_OR_CONST uint32_t max_buffers_count = 32;
+
+    struct read_buffer
+    {
+        uint8_t* data; //!< Memory of the buffer
+        ssize_t offset; //!< File offset of the first byte in the buffer, -1 if buffer holds nothing
+        ssize_t length; //!< Bytes read into the buffer
+        io_request request; //!< Read of the buffer
+        uint16_t registered_index; //!< Index of ring registered buffer or invalid_buffer_index
+        bool in_flight; //!< Whether request is not reaped yet
+    }; // struct read_buffer
+
+    void open();
+    void close();
+    bool is_valid() const;
+
+    void allocate_buffers();
+    void free_buffers();
+
+    read_buffer& get_buffer(ssize_t block);
+    bool fill_buffer(ssize_t block);
+    void read_ahead(ssize_t block);
+    bool wait_for_async_read(read_buffer& buffer);
+    bool start_async_read(read_buffer& buffer, ssize_t offset, bool can_block);
+
+    io_ring* m_ring; //!< Ring reads are submitted to, nullptr if reads are blocking
+    int m_fd; //!< The file descriptor to operate on
+    ssize_t m_file_size; //!< The size of the file that is being read
+    ssize_t m_file_pos; //!< Overall position in the file and buffers combined
+    ssize_t m_buffer_size; //!< The size of the buffers in bytes, multiple of the page size
+    uint32_t m_buffers_count; //!< Number of buffers, block N is always kept in buffer N % count
+    uint32_t m_read_ahead; //!< Number of blocks read ahead of the served one
+    ssize_t m_last_block; //!< Block served by the previous read, -1 before the first read
+    uint8_t* m_pages; //!< Page aligned memory of buffers that didn't get registered ones
+    size_t m_pages_size; //!< Size of the reservation
+    read_buffer m_buffers[max_buffers_count]; //!< Ring of buffers
+}; // class async_buffered_file_handle
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline bool async_buffered_file_handle::is_valid() const
+{
+    return m_fd >= 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline uint32_t async_buffered_file_handle::get_read_ahead() const
+{
+    return m_read_ahead;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline async_buffered_file_handle::read_buffer& async_buffered_file_handle::get_buffer(ssize_t block)
+{
+    return m_buffers[size_t(block) % m_buffers_count];
+}
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,260 @@
+// This file is a part of xray-ng engine
+//
+
+#if !defined(XRAY_PLATFORM_LINUX)
+#   error "This code is supported by Linux platform!"
+#endif // !defined(XRAY_PLATFORM_LINUX)
+
+#include "pch.h"
+#include "async_file_handler_linux.h"
+#include "io_ring_linux.h"
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+XR_CONSTEXPR_CPP14_OR_STATIC_CONST size_t the_default_read_size = XR_MEGABYTES_TO_BYTES(1);
+XR_CONSTEXPR_CPP14_OR_STATIC_CONST uint32_t the_max_chunks_in_flight = 32;
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Fallback when thread has no io ring, returns number of bytes transferred.
+ */
+size_t transfer_blocking(int fd, uint8_t* ptr, size_t bytes, off_t offset, bool is_write)
+{
+    size_t done = 0;
+    while(done < bytes)
+    {
+        ssize_t result = is_write ?
+            pwrite(fd, ptr + done, bytes - done, offset + done) :
+            pread(fd, ptr + done, bytes - done, offset + done);
+
+        if(result < 0 && errno == EINTR)
+            continue;
+
+        if(result <= 0)
+            break;
+
+        done += size_t(result);
+    }
+
+    return done;
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+async_file_handle::async_file_handle(memory::base_allocator& alloc, int fd)
+    : base_file_handle { alloc }
+    , m_fd { fd }
+    , m_file_size { 0 }
+    , m_file_pos { 0 }
+{
+    if(is_valid()) update_file_size();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+async_file_handle::~async_file_handle()
+{
+    close();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t async_file_handle::tell()
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    return m_file_pos;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool async_file_handle::seek(ssize_t const pos)
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    XR_DEBUG_ASSERTION(pos >= 0);
+
+    m_file_pos = pos;
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool async_file_handle::seek_from_end(ssize_t const pos_relative_to_end)
+{
+    XR_DEBUG_ASSERTION(pos_relative_to_end <= 0);
+    // position is negative so this is actually subtracting
+    return seek(m_file_size + pos_relative_to_end);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool async_file_handle::read(memory::buffer_ref ref, size_t bytes_to_read)
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    return transfer(ref.as_pointer<uint8_t*>(), bytes_to_read, false);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool async_file_handle::write(memory::buffer_ref ref, size_t bytes_to_write)
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    bool succeeded = transfer(ref.as_pointer<uint8_t*>(), bytes_to_write, true);
+    m_file_size = eastl::max(m_file_size, m_file_pos);
+    return succeeded;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool async_file_handle::flush(bool const full_flush)
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    return (full_flush ? fsync(m_fd) : fdatasync(m_fd)) == 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool async_file_handle::truncate(size_t new_size)
+{
+    XR_DEBUG_ASSERTION(is_valid());
+
+    if(seek(new_size) && ftruncate(m_fd, off_t(new_size)) == 0)
+    {
+        update_file_size();
+        return true;
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t async_file_handle::size()
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    return m_file_size;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool async_file_handle::read_async(size_t offset, memory::buffer_ref ref, size_t size, async_read& operation)
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    return submit_async_read(m_fd, offset, ref, size, operation);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void async_file_handle::close()
+{
+    if(is_valid())
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void async_file_handle::update_file_size()
+{
+    struct stat info;
+    m_file_size = (fstat(m_fd, &info) == 0) ? ssize_t(info.st_size) : 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Chunks of one batch go to kernel with one submit, so device sees all of them at once.
+ *  Position moves by the bytes transferred before the first short chunk.
+ */
+bool async_file_handle::transfer(uint8_t* ptr, size_t bytes, bool is_write)
+{
+    io_ring* ring = current_io_ring();
+    if(!ring)
+    {
+        size_t done = transfer_blocking(m_fd, ptr, bytes, off_t(m_file_pos), is_write);
+        m_file_pos += done;
+        return done == bytes;
+    }
+
+    io_request requests[the_max_chunks_in_flight];
+    uint32_t chunk_sizes[the_max_chunks_in_flight];
+
+    size_t done = 0;
+    bool succeeded = true;
+
+    while(done < bytes && succeeded)
+    {
+        uint32_t count = 0;
+        size_t queued = 0;
+
+        for(; count < the_max_chunks_in_flight && done + queued < bytes; ++count)
+        {
+            uint32_t chunk = uint32_t(eastl::min(bytes - done - queued, the_default_read_size));
+            uint8_t* chunk_ptr = ptr + done + queued;
+            uint64_t offset = uint64_t(m_file_pos) + done + queued;
+
+            bool prepared = is_write ?
+                ring->prepare_write(m_fd, chunk_ptr, chunk, offset, requests[count]) :
+                ring->prepare_read(m_fd, chunk_ptr, chunk, offset, requests[count]);
+
+            // ring is busy with requests of other files, send what we have
+            if(!prepared)
+                break;
+
+            chunk_sizes[count] = chunk;
+            queued += chunk;
+        }
+
+        if(!count)
+        {
+            ring->submit();
+            ring->poll();
+            continue;
+        }
+
+        ring->submit();
+
+        // every request must be waited for, they live on this stack
+        for(uint32_t i = 0; i < count; ++i)
+        {
+            ring->wait(requests[i]);
+
+            int32_t const result = requests[i].result;
+            if(!succeeded)
+                continue;
+
+            done += size_t(eastl::max(result, 0));
+            succeeded = (result == int32_t(chunk_sizes[i]));
+        }
+    }
+
+    m_file_pos += done;
+    return succeeded && done == bytes;
+}
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,59 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "base_file_handle.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+// Unbuffered file, large reads and writes are split into chunks that are all in flight at once
+class XR_NON_VIRTUAL async_file_handle : public base_file_handle
+{
+public:
+    XR_IO_API async_file_handle(memory::base_allocator& alloc, int fd);
+    virtual XR_IO_API ~async_file_handle();
+    virtual XR_IO_API size_t tell() override;
+    virtual XR_IO_API bool seek(ssize_t const pos) override;
+    virtual XR_IO_API bool seek_from_end(ssize_t const pos_relative_to_end) override;
+    virtual XR_IO_API bool read(memory::buffer_ref ref, size_t bytes_to_read) override;
+    virtual XR_IO_API bool write(memory::buffer_ref ref, size_t bytes_to_write) override;
+    virtual XR_IO_API bool flush(bool const full_flush = false) override;
+    virtual XR_IO_API bool truncate(size_t new_size) override;
+    virtual XR_IO_API size_t size() override;
+    virtual XR_IO_API bool read_async(size_t offset, memory::buffer_ref ref, size_t size, async_read& operation) override;
+
+    int get_descriptor() const;
+
+private:
+    void close();
+    bool is_valid() const;
+    void update_file_size();
+
+    bool transfer(uint8_t* ptr, size_t bytes, bool is_write);
+
+    int m_fd; //!< The file descriptor to operate on
+    ssize_t m_file_size; //!< The size of the file
+    ssize_t m_file_pos; //!< Position of next read or write
+}; // class async_file_handle
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline bool async_file_handle::is_valid() const
+{
+    return m_fd >= 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline int async_file_handle::get_descriptor() const
+{
+    return m_fd;
+}
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
@@ -93,5 +93,48 @@ size_t base_file_handle::size()
     return 0;
 }
 
-XR_NAMESPACE_END(xr, filesystem)
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Handles without asynchronous requests read right away.
+ */
+bool base_file_handle::read_async(size_t offset, memory::buffer_ref ref, size_t size, async_read& operation)
+{
+    size_t const position = tell();
+    bool const succeeded = seek(ssize_t(offset)) && read(ref, size);
+    seek(ssize_t(position));
+
+    operation.result = succeeded ? int32_t(size) : -1;
+    operation.complete();
+    return succeeded;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Only mapped files have views.
+ */
+memory::buffer_range base_file_handle::acquire_view(size_t offset, size_t size)
+{
+    XR_UNREFERENCED_PARAMETER(offset, size);
+    return memory::buffer_range {};
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void base_file_handle::release_view(memory::buffer_range view)
+{
+    XR_UNREFERENCED_PARAMETER(view);
+    XR_DEBUG_ASSERTION_MSG(false, "file has no views");
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool base_file_handle::advise(size_t offset, size_t size, access_advice advice)
+{
+    XR_UNREFERENCED_PARAMETER(offset, size, advice);
+    return false;
+}
+
+XR_NAMESPACE_END(xr, engine, io)
 //-----------------------------------------------------------------------------------------------------------
\ No newline at end of file
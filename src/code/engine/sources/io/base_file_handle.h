@@ -4,6 +4,7 @@
 #pragma once
 
 #include "engine/linkage.h"
+#include "engine/io/api.h"
 #include "corlib/memory/memory_allocator_base.h"
 #include "corlib/memory/buffer_ref.h"
 #include "corlib/threading/interlocked.h"
@@ -25,6 +26,10 @@ public:
     virtual XR_IO_API bool flush(bool const full_flush = false);
     virtual XR_IO_API bool truncate(size_t new_size);
     virtual XR_IO_API size_t size();
+    virtual XR_IO_API bool read_async(size_t offset, memory::buffer_ref ref, size_t size, async_read& operation);
+    virtual XR_IO_API memory::buffer_range acquire_view(size_t offset, size_t size);
+    virtual XR_IO_API void release_view(memory::buffer_range view);
+    virtual XR_IO_API bool advise(size_t offset, size_t size, access_advice advice);
 
     memory::base_allocator& allocator();
 
@@ -63,7 +68,7 @@ inline void base_file_handle::add_user_reference()
     }
 #endif
 
-    (void)threading::atomic_fetch_add<Order>(m_user_references, 1);
+    (void)threading::atomic_fetch_add<Order>(m_user_references, 1U);
 }
 
 //-----------------------------------------------------------------------------------------------------------
@@ -79,7 +84,7 @@ inline void base_file_handle::remove_user_reference()
     }
 #endif
 
-    (void)threading::atomic_fetch_sub<Order>(m_user_references, 1);
+    (void)threading::atomic_fetch_sub<Order>(m_user_references, 1U);
 }
 
 XR_NAMESPACE_END(xr, engine, io)
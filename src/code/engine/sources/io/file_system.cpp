@@ -0,0 +1,208 @@
+// This file is a part of xray-ng engine
+//
+
+#include "pch.h"
+#include "engine/io/file_system.h"
+#include "archive_file_handle.h"
+#include "mounted_archive.h"
+#include "corlib/memory/allocator_macro.h"
+#include "corlib/memory/memory_functions.h"
+#include "corlib/utils/aligning.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+XR_CONSTEXPR_CPP14_OR_STATIC_CONST size_t the_min_index_size = 64;
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+file_system::file_system(memory::base_allocator& alloc)
+    : m_allocator { alloc }
+    , m_archives { nullptr }
+    , m_index { nullptr }
+    , m_index_mask { 0 }
+{}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+file_system::~file_system()
+{
+    while(m_archives)
+        unmount(m_archives);
+
+    if(m_index)
+    {
+        XR_DEALLOCATE_MEMORY(m_allocator, m_index);
+        m_index = nullptr;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+mounted_archive* file_system::mount(utils::wstring_view archive_filename, int32_t priority)
+{
+    mounted_archive* archive = XR_ALLOCATE_OBJECT_T(m_allocator, mounted_archive, "mounted_archive")(
+        m_allocator, priority);
+
+    if(!archive)
+        return nullptr;
+
+    if(!archive->open(archive_filename))
+    {
+        XR_DEALLOCATE_MEMORY_T(m_allocator, archive);
+        return nullptr;
+    }
+
+    // archive goes in front of those with the same priority, so it hides them
+    mounted_archive** link = &m_archives;
+    while(*link && (*link)->get_priority() > priority)
+        link = &(*link)->next;
+
+    archive->next = *link;
+    *link = archive;
+
+    if(!rebuild_index())
+    {
+        *link = archive->next;
+        XR_DEALLOCATE_MEMORY_T(m_allocator, archive);
+        rebuild_index();
+        return nullptr;
+    }
+
+    return archive;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void file_system::unmount(mounted_archive* archive)
+{
+    XR_DEBUG_ASSERTION_MSG(archive != nullptr, "Invalid archive passed!");
+
+    mounted_archive** link = &m_archives;
+    while(*link && *link != archive)
+        link = &(*link)->next;
+
+    XR_DEBUG_ASSERTION_MSG(*link, "archive is not mounted to this file system");
+    if(!*link)
+        return;
+
+    *link = archive->next;
+    XR_DEALLOCATE_MEMORY_T(m_allocator, archive);
+
+    // smaller index may still fail to allocate, entries of unmounted archive must not stay visible anyway
+    if(!rebuild_index() && m_index)
+    {
+        XR_DEALLOCATE_MEMORY(m_allocator, m_index);
+        m_index = nullptr;
+        m_index_mask = 0;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool file_system::exists(utils::string_view path) const
+{
+    return find(path) != nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool file_system::get_file_size(utils::string_view path, size_t& size) const
+{
+    const index_slot* slot = find(path);
+    if(!slot)
+        return false;
+
+    size = size_t(slot->archive->get_entry(slot->entry).size);
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+base_file_handle* file_system::open_read(utils::string_view path) const
+{
+    const index_slot* slot = find(path);
+    if(!slot)
+        return nullptr;
+
+    return XR_ALLOCATE_OBJECT_T(m_allocator, archive_file_handle, "open_read")(
+        m_allocator, *slot->archive, slot->archive->get_entry(slot->entry));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Linear probing, index is at most half full. Paths are compared only when hashes match.
+ */
+const file_system::index_slot* file_system::find(utils::string_view path) const
+{
+    if(!m_index)
+        return nullptr;
+
+    uint64_t const path_hash = archive_path_hash(path);
+    for(uint32_t i = uint32_t(path_hash) & m_index_mask;; i = (i + 1) & m_index_mask)
+    {
+        const index_slot& slot = m_index[i];
+        if(!slot.archive)
+            return nullptr;
+
+        if(slot.path_hash == path_hash && slot.archive->get_entry_path(slot.entry) == path)
+            return &slot;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Archives are walked from the highest priority, path which is already in the index is hidden.
+ */
+bool file_system::rebuild_index()
+{
+    size_t entries_count = 0;
+    for(mounted_archive* archive = m_archives; archive; archive = archive->next)
+        entries_count += archive->get_entries_count();
+
+    size_t const index_size = eastl::max(utils::next_highest_power_of_two(entries_count * 2), the_min_index_size);
+    index_slot* index = XR_ALLOCATE_OBJECT_ARRAY_T(m_allocator, index_slot, index_size, "file_system_index");
+    if(!index)
+        return false;
+
+    memory::zero(index, sizeof(index_slot) * index_size);
+    uint32_t const index_mask = uint32_t(index_size - 1);
+
+    for(mounted_archive* archive = m_archives; archive; archive = archive->next)
+    {
+        for(uint32_t entry = 0, count = archive->get_entries_count(); entry < count; ++entry)
+        {
+            const archive_entry& desc = archive->get_entry(entry);
+            utils::string_view const path = archive->get_entry_path(entry);
+
+            uint32_t i = uint32_t(desc.path_hash) & index_mask;
+            for(; index[i].archive; i = (i + 1) & index_mask)
+            {
+                const index_slot& slot = index[i];
+                if(slot.path_hash == desc.path_hash && slot.archive->get_entry_path(slot.entry) == path)
+                    break;
+            }
+
+            if(!index[i].archive)
+                index[i] = index_slot { desc.path_hash, archive, entry };
+        }
+    }
+
+    if(m_index)
+        XR_DEALLOCATE_MEMORY(m_allocator, m_index);
+
+    m_index = index;
+    m_index_mask = index_mask;
+    return true;
+}
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,732 @@
+// This file is a part of xray-ng engine
+//
+
+#if !defined(XRAY_PLATFORM_LINUX)
+#   error "This code is supported by Linux platform!"
+#endif // !defined(XRAY_PLATFORM_LINUX)
+
+#include "pch.h"
+#include "io_ring_linux.h"
+#include "corlib/memory/allocator_helper.h"
+#include "corlib/memory/allocator_macro.h"
+#include "corlib/memory/memory_functions.h"
+#include "corlib/memory/memory_paging.h"
+#include "corlib/tasks/task_system.h"
+#include "corlib/threading/interlocked.h"
+#include "corlib/threading/scoped_lock.h"
+#include "corlib/utils/aligning.h"
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+//! waiting for completion wakes up this often, completion may be reaped by another thread meanwhile
+XR_CONSTEXPR_CPP14_OR_CONST long io_wait_timeout_ns = 1000000;
+
+//! threads beyond this count share rings
+XR_CONSTEXPR_CPP14_OR_CONST uint32_t max_io_rings = 64;
+
+//! free registered buffers are tracked by bits of one mask
+XR_CONSTEXPR_CPP14_OR_CONST uint32_t max_registered_buffers = 64;
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline int sys_io_uring_setup(uint32_t entries, io_uring_params* params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline int sys_io_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags,
+    pcvoid arg, size_t arg_size)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline int sys_io_uring_register(int fd, uint32_t opcode, pcvoid arg, uint32_t count)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline pvoid map_ring(size_t size, int fd, off_t offset)
+{
+    pvoid memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    return (memory != MAP_FAILED) ? memory : nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+template<typename T>
+inline T* ring_field(pvoid ring, uint32_t offset)
+{
+    return reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(ring) + offset);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// Rings of all threads, generation is odd while asynchronous I/O is initialized
+struct io_ring_registry
+{
+    memory::base_allocator* allocator { nullptr };
+    async_io_desc desc {};
+    io_ring* rings[max_io_rings] {};
+    threading::atomic_uint32 rings_count { 0 };
+    threading::atomic_uint32 generation { 0 };
+    //! next ring given to thread when every ring is taken
+    uint32_t next_shared_ring { 0 };
+    threading::spin_wait_fairness lock;
+}; // struct io_ring_registry
+
+io_ring_registry the_io_rings;
+
+thread_local io_ring* the_thread_ring = nullptr;
+thread_local uint32_t the_thread_ring_generation = 0;
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Workers of the scheduler reap completions while tasks wait for reads.
+ */
+uint32_t poll_io_rings_for_tasks(pvoid user_data)
+{
+    XR_UNREFERENCED_PARAMETER(user_data);
+    return poll_io_rings();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void complete_async_read(io_request& request)
+{
+    async_read& operation = *static_cast<async_read*>(request.user_data);
+    operation.result = request.result;
+
+    // waiting task may drop operation together with request right after this
+    operation.complete();
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+io_ring::io_ring()
+    : m_allocator { nullptr }
+    , m_fd { -1 }
+    , m_features { 0 }
+    , m_sq_memory { nullptr }
+    , m_sq_memory_size { 0 }
+    , m_sq_head { nullptr }
+    , m_sq_tail { nullptr }
+    , m_sq_array { nullptr }
+    , m_sqes { nullptr }
+    , m_sq_mask { 0 }
+    , m_sq_entries { 0 }
+    , m_sq_local_tail { 0 }
+    , m_cq_memory { nullptr }
+    , m_cq_memory_size { 0 }
+    , m_cq_head { nullptr }
+    , m_cq_tail { nullptr }
+    , m_cqes { nullptr }
+    , m_cq_mask { 0 }
+    , m_cq_entries { 0 }
+    , m_in_flight { 0 }
+    , m_completed_head { nullptr }
+    , m_completed_tail { nullptr }
+    , m_registered_memory { nullptr }
+    , m_registered_buffer_size { 0 }
+    , m_registered_buffers_count { 0 }
+    , m_free_registered_buffers { 0 }
+{}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+io_ring::~io_ring()
+{
+    destroy();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool io_ring::create(memory::base_allocator& alloc, uint32_t entries,
+    uint32_t registered_buffers_count, size_t registered_buffer_size)
+{
+    XR_DEBUG_ASSERTION_MSG(!is_valid(), "io ring already created");
+    m_allocator = &alloc;
+
+    io_uring_params params;
+    memory::zero_struct(&params);
+    params.flags = IORING_SETUP_CLAMP;
+
+    m_fd = sys_io_uring_setup(entries, &params);
+    if(m_fd < 0)
+    {
+        // kernel without io_uring or sandbox that forbids it
+        m_fd = -1;
+        return false;
+    }
+
+    m_features = params.features;
+    m_sq_memory_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    m_cq_memory_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    bool const single_mapping = (m_features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if(single_mapping)
+    {
+        m_sq_memory_size = eastl::max(m_sq_memory_size, m_cq_memory_size);
+        m_cq_memory_size = m_sq_memory_size;
+    }
+
+    m_sq_memory = map_ring(m_sq_memory_size, m_fd, IORING_OFF_SQ_RING);
+    m_cq_memory = single_mapping ? m_sq_memory : map_ring(m_cq_memory_size, m_fd, IORING_OFF_CQ_RING);
+    m_sqes = reinterpret_cast<io_uring_sqe*>(map_ring(params.sq_entries * sizeof(io_uring_sqe), m_fd, IORING_OFF_SQES));
+
+    if(!m_sq_memory || !m_cq_memory || !m_sqes)
+    {
+        destroy();
+        return false;
+    }
+
+    m_sq_head = ring_field<threading::atomic_uint32>(m_sq_memory, params.sq_off.head);
+    m_sq_tail = ring_field<threading::atomic_uint32>(m_sq_memory, params.sq_off.tail);
+    m_sq_array = ring_field<uint32_t>(m_sq_memory, params.sq_off.array);
+    m_sq_mask = *ring_field<uint32_t>(m_sq_memory, params.sq_off.ring_mask);
+    m_sq_entries = params.sq_entries;
+    m_sq_local_tail = threading::atomic_fetch_acq(*m_sq_tail);
+
+    m_cq_head = ring_field<threading::atomic_uint32>(m_cq_memory, params.cq_off.head);
+    m_cq_tail = ring_field<threading::atomic_uint32>(m_cq_memory, params.cq_off.tail);
+    m_cqes = ring_field<io_uring_cqe>(m_cq_memory, params.cq_off.cqes);
+    m_cq_mask = *ring_field<uint32_t>(m_cq_memory, params.cq_off.ring_mask);
+    m_cq_entries = params.cq_entries;
+
+    // locked memory limit may be too low for registered buffers, ring works without them
+    if(registered_buffers_count && registered_buffer_size)
+        register_buffers(registered_buffers_count, registered_buffer_size);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void io_ring::destroy()
+{
+    XR_DEBUG_ASSERTION_MSG(!m_in_flight, "io ring destroyed with requests in flight");
+    XR_DEBUG_ASSERTION_MSG(!m_completed_head, "io ring destroyed before requests were completed");
+
+    if(m_sqes)
+        munmap(m_sqes, m_sq_entries * sizeof(io_uring_sqe));
+
+    if(m_cq_memory && m_cq_memory != m_sq_memory)
+        munmap(m_cq_memory, m_cq_memory_size);
+
+    if(m_sq_memory)
+        munmap(m_sq_memory, m_sq_memory_size);
+
+    if(m_fd >= 0)
+        close(m_fd);
+
+    if(m_registered_memory)
+        memory::release_pages(m_registered_memory, m_registered_buffer_size * m_registered_buffers_count);
+
+    m_fd = -1;
+    m_sq_memory = nullptr;
+    m_cq_memory = nullptr;
+    m_sqes = nullptr;
+    m_in_flight = 0;
+    m_completed_head = nullptr;
+    m_completed_tail = nullptr;
+    m_registered_memory = nullptr;
+    m_registered_buffers_count = 0;
+    m_free_registered_buffers = 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool io_ring::prepare_read(int fd, pvoid buffer, uint32_t size, uint64_t offset, io_request& request)
+{
+    threading::scoped_lock lock { m_lock };
+    io_uring_sqe* sqe = get_sqe(request);
+    if(!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = size;
+    sqe->off = offset;
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool io_ring::prepare_write(int fd, pcvoid buffer, uint32_t size, uint64_t offset, io_request& request)
+{
+    threading::scoped_lock lock { m_lock };
+    io_uring_sqe* sqe = get_sqe(request);
+    if(!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = size;
+    sqe->off = offset;
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool io_ring::prepare_read_fixed(int fd, uint16_t buffer_index, uint32_t size, uint64_t offset, io_request& request)
+{
+    XR_DEBUG_ASSERTION_MSG(buffer_index < m_registered_buffers_count, "invalid registered buffer");
+    XR_DEBUG_ASSERTION_MSG(size <= m_registered_buffer_size, "read doesn't fit registered buffer");
+
+    threading::scoped_lock lock { m_lock };
+    io_uring_sqe* sqe = get_sqe(request);
+    if(!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(get_registered_buffer(buffer_index));
+    sqe->len = size;
+    sqe->off = offset;
+    sqe->buf_index = buffer_index;
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool io_ring::submit()
+{
+    threading::scoped_lock lock { m_lock };
+    return submit_locked();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+uint32_t io_ring::poll()
+{
+    io_request* completed = nullptr;
+    uint32_t count = 0;
+    {
+        threading::scoped_lock lock { m_lock };
+        count = poll_locked();
+        completed = m_completed_head;
+        m_completed_head = m_completed_tail = nullptr;
+    }
+
+    run_completed(completed);
+    return count;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Thread that holds the lock is reaping or submitting, there is no need to wait for it.
+ */
+uint32_t io_ring::try_poll()
+{
+    if(!m_lock.try_lock())
+        return 0;
+
+    uint32_t const count = poll_locked();
+    io_request* completed = m_completed_head;
+    m_completed_head = m_completed_tail = nullptr;
+    m_lock.unlock();
+
+    run_completed(completed);
+    return count;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void io_ring::wait(io_request& request)
+{
+    XR_DEBUG_ASSERTION_MSG(request.ring == this, "request was submitted to another ring");
+
+    {
+        threading::scoped_lock lock { m_lock };
+        submit_locked();
+    }
+
+    while(!threading::atomic_fetch_acq(request.completed))
+    {
+        if(!poll())
+            wait_cqe();
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+uint16_t io_ring::acquire_registered_buffer(size_t size)
+{
+    if(size > m_registered_buffer_size)
+        return invalid_buffer_index;
+
+    threading::scoped_lock lock { m_lock };
+    for(uint32_t i = 0; i < m_registered_buffers_count; ++i)
+    {
+        uint64_t const mask = uint64_t(1) << i;
+        if(m_free_registered_buffers & mask)
+        {
+            m_free_registered_buffers &= ~mask;
+            return static_cast<uint16_t>(i);
+        }
+    }
+
+    return invalid_buffer_index;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void io_ring::release_registered_buffer(uint16_t buffer_index)
+{
+    XR_DEBUG_ASSERTION_MSG(buffer_index < m_registered_buffers_count, "invalid registered buffer");
+
+    threading::scoped_lock lock { m_lock };
+    m_free_registered_buffers |= uint64_t(1) << buffer_index;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+pvoid io_ring::get_registered_buffer(uint16_t buffer_index) const
+{
+    XR_DEBUG_ASSERTION_MSG(buffer_index < m_registered_buffers_count, "invalid registered buffer");
+    return m_registered_memory + buffer_index * m_registered_buffer_size;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Full submission ring is sent to kernel, full completion ring is reaped, so request fails only
+ *  when both are busy.
+ */
+io_uring_sqe* io_ring::get_sqe(io_request& request)
+{
+    if(m_in_flight >= m_cq_entries)
+        poll_locked();
+
+    if(m_sq_local_tail - threading::atomic_fetch_acq(*m_sq_head) >= m_sq_entries)
+        submit_locked();
+
+    if(m_in_flight >= m_cq_entries ||
+        m_sq_local_tail - threading::atomic_fetch_acq(*m_sq_head) >= m_sq_entries)
+        return nullptr;
+
+    uint32_t const index = m_sq_local_tail & m_sq_mask;
+    io_uring_sqe* sqe = m_sqes + index;
+    memory::zero(sqe, sizeof(io_uring_sqe));
+    sqe->user_data = reinterpret_cast<uint64_t>(&request);
+    m_sq_array[index] = index;
+
+    request.result = 0;
+    request.completed = 0;
+    request.ring = this;
+
+    ++m_sq_local_tail;
+    ++m_in_flight;
+    return sqe;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool io_ring::submit_locked()
+{
+    threading::atomic_store_rel(*m_sq_tail, m_sq_local_tail);
+
+    uint32_t const to_submit = m_sq_local_tail - threading::atomic_fetch_acq(*m_sq_head);
+    if(!to_submit)
+        return true;
+
+    int result = sys_io_uring_enter(m_fd, to_submit, 0, 0, nullptr, 0);
+    if(result >= 0)
+        return true;
+
+    // requests stay in ring and go with next submit
+    return errno == EINTR || errno == EAGAIN || errno == EBUSY;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Requests with on_completed are only collected here, they are completed by the poll that releases
+ *  the lock. Those reaped by get_sqe to make room wait for the next poll.
+ */
+uint32_t io_ring::poll_locked()
+{
+    uint32_t head = threading::atomic_fetch_relax(*m_cq_head);
+    uint32_t const tail = threading::atomic_fetch_acq(*m_cq_tail);
+
+    uint32_t count = 0;
+    for(; head != tail; ++head, ++count)
+    {
+        io_uring_cqe const& cqe = m_cqes[head & m_cq_mask];
+        io_request* request = reinterpret_cast<io_request*>(cqe.user_data);
+
+        // waiter may drop request right after it is marked completed
+        request->result = cqe.res;
+        if(!request->on_completed)
+        {
+            threading::atomic_store_rel(request->completed, 1U);
+            continue;
+        }
+
+        request->next_completed = nullptr;
+        if(m_completed_tail)
+            m_completed_tail->next_completed = request;
+        else
+            m_completed_head = request;
+
+        m_completed_tail = request;
+    }
+
+    threading::atomic_store_rel(*m_cq_head, head);
+    m_in_flight -= count;
+    return count;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void io_ring::run_completed(io_request* completed)
+{
+    while(completed)
+    {
+        // request may be gone once its callback returns
+        io_request* request = completed;
+        completed = request->next_completed;
+        request->on_completed(*request);
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool io_ring::register_buffers(uint32_t count, size_t size)
+{
+    count = eastl::min(count, max_registered_buffers);
+    size = utils::align_up(size, memory::system_page_size());
+
+    uint8_t* buffers = reinterpret_cast<uint8_t*>(memory::reserve_pages(size * count, memory::page_kind::normal));
+    if(!buffers)
+        return false;
+
+    if(!memory::commit_pages(buffers, size * count))
+    {
+        memory::release_pages(buffers, size * count);
+        return false;
+    }
+
+    iovec vectors[max_registered_buffers];
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        vectors[i].iov_base = buffers + i * size;
+        vectors[i].iov_len = size;
+    }
+
+    if(sys_io_uring_register(m_fd, IORING_REGISTER_BUFFERS, vectors, count) < 0)
+    {
+        memory::release_pages(buffers, size * count);
+        return false;
+    }
+
+    m_registered_memory = buffers;
+    m_registered_buffer_size = size;
+    m_registered_buffers_count = count;
+    m_free_registered_buffers = (count == max_registered_buffers) ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void io_ring::wait_cqe()
+{
+    if(!(m_features & IORING_FEAT_EXT_ARG))
+    {
+        sched_yield();
+        return;
+    }
+
+    __kernel_timespec timeout {};
+    timeout.tv_nsec = io_wait_timeout_ns;
+
+    io_uring_getevents_arg arg {};
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = reinterpret_cast<uint64_t>(&timeout);
+
+    sys_io_uring_enter(m_fd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+io_ring* current_io_ring()
+{
+    uint32_t const generation = threading::atomic_fetch_acq(the_io_rings.generation);
+    if(the_thread_ring_generation == generation)
+        return the_thread_ring;
+
+    the_thread_ring = nullptr;
+    the_thread_ring_generation = generation;
+    if(!(generation & 1))
+        return nullptr;
+
+    threading::scoped_lock lock { the_io_rings.lock };
+    uint32_t const rings_count = threading::atomic_fetch_acq(the_io_rings.rings_count);
+    if(rings_count == max_io_rings)
+    {
+        the_thread_ring = the_io_rings.rings[the_io_rings.next_shared_ring++ % max_io_rings];
+        return the_thread_ring;
+    }
+
+    memory::base_allocator& alloc = *the_io_rings.allocator;
+    io_ring* ring = XR_ALLOCATE_OBJECT_T(alloc, io_ring, "io ring") {};
+
+    async_io_desc const& desc = the_io_rings.desc;
+    if(!ring->create(alloc, desc.queue_depth, desc.registered_buffers_count, desc.registered_buffer_size))
+    {
+        XR_DEALLOCATE_MEMORY_T(alloc, ring);
+        return nullptr;
+    }
+
+    the_io_rings.rings[rings_count] = ring;
+    threading::atomic_store_rel(the_io_rings.rings_count, rings_count + 1);
+    the_thread_ring = ring;
+    return ring;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool initialize_io_rings(memory::base_allocator& alloc, const async_io_desc& desc)
+{
+    XR_DEBUG_ASSERTION_MSG(desc.queue_depth, "invalid queue depth");
+
+    threading::scoped_lock lock { the_io_rings.lock };
+    if(threading::atomic_fetch_acq(the_io_rings.generation) & 1)
+        return true;
+
+    // probe once, so callers know up front whether reads are going to block
+    io_ring probe;
+    if(!probe.create(alloc, 1, 0, 0))
+        return false;
+
+    the_io_rings.allocator = &alloc;
+    the_io_rings.desc = desc;
+    the_io_rings.next_shared_ring = 0;
+    threading::atomic_inc_fetch_seq(the_io_rings.generation);
+
+    if(desc.scheduler)
+        desc.scheduler->add_completion_poller(poll_io_rings_for_tasks, nullptr);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void shutdown_io_rings()
+{
+    threading::scoped_lock lock { the_io_rings.lock };
+    if(!(threading::atomic_fetch_acq(the_io_rings.generation) & 1))
+        return;
+
+    // workers don't touch rings once poller is removed
+    if(the_io_rings.desc.scheduler)
+        the_io_rings.desc.scheduler->remove_completion_poller(poll_io_rings_for_tasks, nullptr);
+
+    threading::atomic_inc_fetch_seq(the_io_rings.generation);
+
+    uint32_t const rings_count = threading::atomic_fetch_acq(the_io_rings.rings_count);
+    for(uint32_t i = 0; i < rings_count; ++i)
+    {
+        XR_DEALLOCATE_MEMORY_T(*the_io_rings.allocator, the_io_rings.rings[i]);
+        the_io_rings.rings[i] = nullptr;
+    }
+
+    threading::atomic_store_rel(the_io_rings.rings_count, 0U);
+    the_io_rings.allocator = nullptr;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+uint32_t poll_io_rings()
+{
+    uint32_t completed = 0;
+    uint32_t const rings_count = threading::atomic_fetch_acq(the_io_rings.rings_count);
+    for(uint32_t i = 0; i < rings_count; ++i)
+        completed += the_io_rings.rings[i]->try_poll();
+
+    return completed;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool submit_async_read(int fd, size_t offset, memory::buffer_ref ref, size_t size, async_read& operation)
+{
+    static_assert(sizeof(io_request) <= sizeof(operation.platform_request), "platform request doesn't fit");
+    XR_DEBUG_ASSERTION_MSG(ref.length() >= size, "buffer is too small");
+    XR_DEBUG_ASSERTION_MSG(size <= size_t(INT32_MAX), "read is too big for one request");
+
+    io_ring* ring = current_io_ring();
+    if(ring)
+    {
+        io_request* request = reinterpret_cast<io_request*>(operation.platform_request);
+        memory::call_emplace_construct(request);
+        request->on_completed = complete_async_read;
+        request->user_data = &operation;
+
+        if(ring->prepare_read(fd, ref.as_pointer<pvoid>(), uint32_t(size), uint64_t(offset), *request))
+        {
+            ring->submit();
+            return true;
+        }
+    }
+
+    // no ring or no room in it, read completes right away
+    ssize_t num_read = 0;
+    do
+    {
+        num_read = pread(fd, ref.as_pointer<pvoid>(), size, off_t(offset));
+    }
+    while(num_read < 0 && errno == EINTR);
+
+    operation.result = (num_read >= 0) ? int32_t(num_read) : -errno;
+    operation.complete();
+    return num_read >= 0;
+}
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,156 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "engine/io/api.h"
+#include "corlib/threading/atomic_types.h"
+#include "corlib/threading/spin_wait.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct iovec;
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+class io_ring;
+struct io_request;
+
+//-----------------------------------------------------------------------------------------------------------
+// Runs after the ring lock is released, so it may queue new requests to the ring
+typedef void (*io_completion_function)(io_request& request);
+
+//-----------------------------------------------------------------------------------------------------------
+// One read or write in flight. Request must stay alive until it is completed.
+struct io_request
+{
+    //! bytes transferred or negative errno, valid once completed
+    int32_t result { 0 };
+    threading::atomic_uint32 completed { 0 };
+    //! ring request was submitted to
+    io_ring* ring { nullptr };
+    //! called instead of marking request completed, request may be gone when it returns
+    io_completion_function on_completed { nullptr };
+    pvoid user_data { nullptr };
+    //! next reaped request whose on_completed is not called yet
+    io_request* next_completed { nullptr };
+}; // struct io_request
+
+//-----------------------------------------------------------------------------------------------------------
+// io_uring instance, talks to kernel through system calls directly. Requests are queued by prepare_*
+// and sent to kernel in one batch by submit(). Completions are reaped by poll() from any thread.
+//
+// Ring may be shared by threads, submission and reaping are serialized by a lock, waiting is not.
+class io_ring
+{
+public:
+    static XR_CONSTEXPR_CPP14_OR_CONST uint16_t invalid_buffer_index = UINT16_MAX;
+
+    io_ring();
+    ~io_ring();
+
+    XR_DECLARE_DELETE_COPY_ASSIGNMENT(io_ring);
+
+    bool create(memory::base_allocator& alloc, uint32_t entries,
+        uint32_t registered_buffers_count, size_t registered_buffer_size);
+    void destroy();
+    bool is_valid() const;
+
+    // Queues request, returns false if ring has no room for it until some requests complete
+    bool prepare_read(int fd, pvoid buffer, uint32_t size, uint64_t offset, io_request& request);
+    bool prepare_write(int fd, pcvoid buffer, uint32_t size, uint64_t offset, io_request& request);
+
+    // Read into registered buffer, kernel doesn't pin its pages for every request
+    bool prepare_read_fixed(int fd, uint16_t buffer_index, uint32_t size, uint64_t offset, io_request& request);
+
+    // Sends every queued request with one system call, returns false on error
+    bool submit();
+
+    // Completes finished requests without blocking, returns their count
+    uint32_t poll();
+
+    // Same as poll, but returns right away if another thread is using the ring
+    uint32_t try_poll();
+
+    // Submits queued requests and blocks until request is completed
+    void wait(io_request& request);
+
+    // Registered buffers are page aligned, invalid_buffer_index is returned when all of them are taken
+    uint16_t acquire_registered_buffer(size_t size);
+    void release_registered_buffer(uint16_t buffer_index);
+    pvoid get_registered_buffer(uint16_t buffer_index) const;
+
+private:
+    io_uring_sqe* get_sqe(io_request& request);
+    bool submit_locked();
+    uint32_t poll_locked();
+    void run_completed(io_request* completed);
+    bool register_buffers(uint32_t count, size_t size);
+    void wait_cqe();
+
+    memory::base_allocator* m_allocator;
+    int m_fd;
+    uint32_t m_features;
+    threading::spin_wait_fairness m_lock;
+
+    //! submission ring shared with kernel
+    pvoid m_sq_memory;
+    size_t m_sq_memory_size;
+    threading::atomic_uint32* m_sq_head;
+    threading::atomic_uint32* m_sq_tail;
+    uint32_t* m_sq_array;
+    io_uring_sqe* m_sqes;
+    uint32_t m_sq_mask;
+    uint32_t m_sq_entries;
+    //! tail of requests queued but not yet published to kernel
+    uint32_t m_sq_local_tail;
+
+    //! completion ring shared with kernel, may be the same mapping as submission ring
+    pvoid m_cq_memory;
+    size_t m_cq_memory_size;
+    threading::atomic_uint32* m_cq_head;
+    threading::atomic_uint32* m_cq_tail;
+    io_uring_cqe* m_cqes;
+    uint32_t m_cq_mask;
+    uint32_t m_cq_entries;
+
+    //! requests queued or in kernel, never more than completion ring holds
+    uint32_t m_in_flight;
+    //! reaped requests with on_completed, callbacks are run by poll once the lock is released
+    io_request* m_completed_head;
+    io_request* m_completed_tail;
+
+    uint8_t* m_registered_memory;
+    size_t m_registered_buffer_size;
+    uint32_t m_registered_buffers_count;
+    uint64_t m_free_registered_buffers;
+}; // class io_ring
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline bool io_ring::is_valid() const
+{
+    return m_fd >= 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Returns ring of calling thread, it is created on first use. Returns nullptr if asynchronous I/O
+ *  was not initialized or kernel has no io_uring, callers fall back to blocking calls then.
+ */
+io_ring* current_io_ring();
+
+bool initialize_io_rings(memory::base_allocator& alloc, const async_io_desc& desc);
+void shutdown_io_rings();
+uint32_t poll_io_rings();
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Ring of calling thread completes the operation, read is done right away if there is no room in it.
+ */
+bool submit_async_read(int fd, size_t offset, memory::buffer_ref ref, size_t size, async_read& operation);
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,240 @@
+// This file is a part of xray-ng engine
+//
+
+#if !defined(XRAY_PLATFORM_LINUX)
+#   error "This code is supported by Linux platform!"
+#endif // !defined(XRAY_PLATFORM_LINUX)
+
+#include "pch.h"
+#include "mapped_file_handle_linux.h"
+#include "corlib/memory/memory_functions.h"
+#include "corlib/memory/memory_paging.h"
+#include "corlib/utils/aligning.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+int to_madvise_advice(access_advice advice)
+{
+    switch(advice)
+    {
+    case access_advice::sequential:
+        return MADV_SEQUENTIAL;
+    case access_advice::random:
+        return MADV_RANDOM;
+    case access_advice::will_need:
+        return MADV_WILLNEED;
+    case access_advice::dont_need:
+        return MADV_DONTNEED;
+    default:
+        return MADV_NORMAL;
+    }
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Mapping keeps the file open by itself, descriptor is closed right away.
+ */
+mapped_file_handle::mapped_file_handle(memory::base_allocator& alloc, int fd)
+    : base_file_handle { alloc }
+    , m_data { nullptr }
+    , m_file_size { 0 }
+    , m_file_pos { 0 }
+    , m_is_mapped { false }
+{
+    struct stat info;
+    if(fstat(fd, &info) == 0)
+    {
+        m_file_size = size_t(info.st_size);
+        if(m_file_size)
+        {
+            pvoid memory = mmap(nullptr, m_file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            m_data = (memory != MAP_FAILED) ? reinterpret_cast<uint8_t*>(memory) : nullptr;
+        }
+
+        m_is_mapped = (m_data != nullptr) || !m_file_size;
+    }
+
+    ::close(fd);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+mapped_file_handle::~mapped_file_handle()
+{
+    close();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t mapped_file_handle::tell()
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    return m_file_pos;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool mapped_file_handle::seek(ssize_t const pos)
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    XR_DEBUG_ASSERTION(pos >= 0 && size_t(pos) <= m_file_size);
+
+    m_file_pos = size_t(pos);
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool mapped_file_handle::seek_from_end(ssize_t const pos_relative_to_end)
+{
+    XR_DEBUG_ASSERTION(pos_relative_to_end <= 0);
+    return seek(ssize_t(m_file_size) + pos_relative_to_end);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool mapped_file_handle::read(memory::buffer_ref ref, size_t bytes_to_read)
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    if(!bytes_to_read || !contains(m_file_pos, bytes_to_read))
+        return false;
+
+    XR_DEBUG_ASSERTION(ref.is_valid());
+    memory::copy(ref.as_pointer<pvoid>(), ref.length(), m_data + m_file_pos, bytes_to_read);
+    m_file_pos += bytes_to_read;
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool mapped_file_handle::write(memory::buffer_ref ref, size_t bytes_to_write)
+{
+    XR_UNREFERENCED_PARAMETER(ref, bytes_to_write);
+    XR_DEBUG_ASSERTION_MSG(false, "mapped file is read only");
+    return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool mapped_file_handle::flush(bool const full_flush)
+{
+    // read only, so don't need to support flushing
+
+    XR_UNREFERENCED_PARAMETER(full_flush);
+    return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool mapped_file_handle::truncate(size_t new_size)
+{
+    // read only, so don't need to support truncation
+
+    XR_UNREFERENCED_PARAMETER(new_size);
+    return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+size_t mapped_file_handle::size()
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    return m_file_size;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Page faults of the copy are taken by calling thread, ask for will_need first to avoid them.
+ */
+bool mapped_file_handle::read_async(size_t offset, memory::buffer_ref ref, size_t size, async_read& operation)
+{
+    XR_DEBUG_ASSERTION(is_valid());
+
+    bool const succeeded = contains(offset, size);
+    if(succeeded && size)
+        memory::copy(ref.as_pointer<pvoid>(), ref.length(), m_data + offset, size);
+
+    operation.result = succeeded ? int32_t(size) : -1;
+    operation.complete();
+    return succeeded;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+memory::buffer_range mapped_file_handle::acquire_view(size_t offset, size_t size)
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    if(!m_data || !size || !contains(offset, size))
+        return memory::buffer_range {};
+
+    add_user_reference<threading::memory_order::sequential>();
+    return memory::buffer_range { m_data + offset, m_data + offset + size };
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void mapped_file_handle::release_view(memory::buffer_range view)
+{
+    XR_DEBUG_ASSERTION_MSG(view.cbegin() >= m_data && view.cend() <= m_data + m_file_size,
+        "view doesn't belong to this file");
+
+    remove_user_reference<threading::memory_order::release>();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Kernel takes page aligned ranges, range is widened to the pages it touches.
+ */
+bool mapped_file_handle::advise(size_t offset, size_t size, access_advice advice)
+{
+    XR_DEBUG_ASSERTION(is_valid());
+    if(!m_data || !contains(offset, size))
+        return false;
+
+    size_t const page_size = memory::system_page_size();
+    size_t const begin = utils::align_down(offset, page_size);
+    size_t const end = size ? offset + size : m_file_size;
+
+    return madvise(m_data + begin, end - begin, to_madvise_advice(advice)) == 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void mapped_file_handle::close()
+{
+    if(m_data)
+    {
+        munmap(m_data, m_file_size);
+        m_data = nullptr;
+    }
+
+    m_is_mapped = false;
+}
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,61 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "base_file_handle.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+// Read-only file mapped into memory as a whole. Views point right into the mapping, reads copy from it
+// without staging buffers. Every view holds user reference of the handle until it is released.
+class XR_NON_VIRTUAL mapped_file_handle : public base_file_handle
+{
+public:
+    XR_IO_API mapped_file_handle(memory::base_allocator& alloc, int fd);
+    virtual XR_IO_API ~mapped_file_handle();
+    virtual XR_IO_API size_t tell() override;
+    virtual XR_IO_API bool seek(ssize_t const pos) override;
+    virtual XR_IO_API bool seek_from_end(ssize_t const pos_relative_to_end) override;
+    virtual XR_IO_API bool read(memory::buffer_ref ref, size_t bytes_to_read) override;
+    virtual XR_IO_API bool write(memory::buffer_ref ref, size_t bytes_to_write) override;
+    virtual XR_IO_API bool flush(bool const full_flush = false) override;
+    virtual XR_IO_API bool truncate(size_t new_size) override;
+    virtual XR_IO_API size_t size() override;
+    virtual XR_IO_API bool read_async(size_t offset, memory::buffer_ref ref, size_t size, async_read& operation) override;
+    virtual XR_IO_API memory::buffer_range acquire_view(size_t offset, size_t size) override;
+    virtual XR_IO_API void release_view(memory::buffer_range view) override;
+    virtual XR_IO_API bool advise(size_t offset, size_t size, access_advice advice) override;
+
+    bool is_valid() const;
+
+private:
+    void close();
+    bool contains(size_t offset, size_t size) const;
+
+    uint8_t* m_data; //!< First byte of the mapping, nullptr for empty file
+    size_t m_file_size; //!< The size of the file and the mapping
+    size_t m_file_pos; //!< Position of next read
+    bool m_is_mapped; //!< Whether file was mapped, empty files are valid without mapping
+}; // class mapped_file_handle
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline bool mapped_file_handle::is_valid() const
+{
+    return m_is_mapped;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline bool mapped_file_handle::contains(size_t offset, size_t size) const
+{
+    return offset <= m_file_size && size <= m_file_size - offset;
+}
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
@@ -0,0 +1,212 @@
+// This file is a part of xray-ng engine
+//
+
+#include "pch.h"
+#include "mounted_archive.h"
+#include "corlib/memory/allocator_macro.h"
+#include "corlib/memory/memory_functions.h"
+#include "corlib/threading/scoped_lock.h"
+#include "corlib/utils/aligning.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+namespace
+{
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool range_fits(uint64_t offset, uint64_t size, uint64_t total)
+{
+    return offset <= total && size <= total - offset;
+}
+
+} // anonymous namespace
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+mounted_archive::mounted_archive(memory::base_allocator& alloc, int32_t priority)
+    : next { nullptr }
+    , m_allocator { alloc }
+    , m_handle { nullptr }
+    , m_data { nullptr }
+    , m_view {}
+    , m_header {}
+    , m_entries { nullptr }
+    , m_names { nullptr }
+    , m_priority { priority }
+{}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+mounted_archive::~mounted_archive()
+{
+    close();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Everything directory points to must lie inside of the archive, entries are not checked again on reads.
+ */
+bool mounted_archive::open(utils::wstring_view filename)
+{
+    XR_DEBUG_ASSERTION_MSG(!m_handle, "archive is already opened");
+
+    m_handle = open_read_mapped(m_allocator, filename);
+    if(m_handle)
+    {
+        m_view = m_handle->acquire_view(0, m_handle->size());
+        m_data = reinterpret_cast<const uint8_t*>(m_view.cbegin());
+    }
+    else
+    {
+        m_handle = open_read_no_buffering(m_allocator, filename, false);
+    }
+
+    if(!m_handle)
+        return false;
+
+    uint64_t const archive_size = m_handle->size();
+    if(!read(0, memory::buffer_ref { &m_header, sizeof(m_header) }, sizeof(m_header)) ||
+        m_header.magic != archive_header::the_magic || m_header.version != archive_header::the_version ||
+        !utils::is_power_of_2(m_header.alignment))
+    {
+        close();
+        return false;
+    }
+
+    uint64_t const directory_size = uint64_t(m_header.entries_count) * sizeof(archive_entry);
+    if(!range_fits(m_header.directory_offset, directory_size, archive_size) ||
+        !range_fits(m_header.names_offset, m_header.names_size, archive_size) ||
+        m_header.names_size > UINT32_MAX)
+    {
+        close();
+        return false;
+    }
+
+    m_entries = XR_ALLOCATE_OBJECT_ARRAY_T(m_allocator, archive_entry, eastl::max(m_header.entries_count, 1U),
+        "archive_directory");
+    m_names = XR_ALLOCATE_OBJECT_ARRAY_T(m_allocator, char, eastl::max(m_header.names_size, uint64_t(1)),
+        "archive_names");
+
+    bool succeeded = m_entries && m_names &&
+        read(m_header.directory_offset, memory::buffer_ref { m_entries, size_t(directory_size) },
+            size_t(directory_size)) &&
+        read(m_header.names_offset, memory::buffer_ref { m_names, size_t(m_header.names_size) },
+            size_t(m_header.names_size));
+
+    for(uint32_t i = 0; succeeded && i < m_header.entries_count; ++i)
+    {
+        const archive_entry& entry = m_entries[i];
+        succeeded = range_fits(entry.offset, entry.size, archive_size) &&
+            range_fits(entry.name_offset, entry.name_size, m_header.names_size) &&
+            (!i || m_entries[i - 1].path_hash <= entry.path_hash);
+    }
+
+    if(!succeeded)
+        close();
+
+    return succeeded;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool mounted_archive::read(uint64_t offset, memory::buffer_ref ref, size_t size)
+{
+    XR_DEBUG_ASSERTION(m_handle);
+    if(!range_fits(offset, size, m_handle->size()))
+        return false;
+
+    if(!size)
+        return true;
+
+    XR_DEBUG_ASSERTION(ref.is_valid());
+    if(m_data)
+    {
+        memory::copy(ref.as_pointer<pvoid>(), ref.length(), m_data + offset, size);
+        return true;
+    }
+
+    threading::scoped_lock lock { m_lock };
+    return m_handle->seek(ssize_t(offset)) && m_handle->read(ref, size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ *  Handles without asynchronous requests read through their position, which entries of one archive share.
+ */
+bool mounted_archive::read_async(uint64_t offset, memory::buffer_ref ref, size_t size, async_read& operation)
+{
+    XR_DEBUG_ASSERTION(m_handle);
+    if(m_data)
+        return m_handle->read_async(size_t(offset), ref, size, operation);
+
+    threading::scoped_lock lock { m_lock };
+    return m_handle->read_async(size_t(offset), ref, size, operation);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+memory::buffer_range mounted_archive::acquire_view(uint64_t offset, size_t size)
+{
+    XR_DEBUG_ASSERTION(m_handle);
+    return m_handle->acquire_view(size_t(offset), size);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void mounted_archive::release_view(memory::buffer_range view)
+{
+    XR_DEBUG_ASSERTION(m_handle);
+    m_handle->release_view(view);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+bool mounted_archive::advise(uint64_t offset, size_t size, access_advice advice)
+{
+    XR_DEBUG_ASSERTION(m_handle);
+    return m_handle->advise(size_t(offset), size, advice);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+void mounted_archive::close()
+{
+    if(m_entries)
+    {
+        XR_DEALLOCATE_MEMORY(m_allocator, m_entries);
+        m_entries = nullptr;
+    }
+
+    if(m_names)
+    {
+        XR_DEALLOCATE_MEMORY(m_allocator, m_names);
+        m_names = nullptr;
+    }
+
+    if(m_handle)
+    {
+        if(m_view.is_valid())
+            m_handle->release_view(m_view);
+
+        close_file_handle(m_handle);
+        m_handle = nullptr;
+    }
+
+    m_data = nullptr;
+    m_view = memory::buffer_range {};
+    m_header = archive_header {};
+}
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
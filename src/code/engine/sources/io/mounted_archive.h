@@ -0,0 +1,111 @@
+// This file is a part of xray-ng engine
+//
+
+#pragma once
+
+#include "base_file_handle.h"
+#include "engine/io/archive.h"
+#include "corlib/threading/spin_wait.h"
+
+//-----------------------------------------------------------------------------------------------------------
+XR_NAMESPACE_BEGIN(xr, engine, io)
+
+//-----------------------------------------------------------------------------------------------------------
+// Archive opened by file system, directory and names are kept in memory. Archive is mapped where platform
+// allows it, entries are copied or viewed right from the mapping then. Otherwise reads of all entries share
+// one file handle and are serialized.
+class mounted_archive
+{
+public:
+    mounted_archive(memory::base_allocator& alloc, int32_t priority);
+    ~mounted_archive();
+
+    XR_DECLARE_DELETE_COPY_ASSIGNMENT(mounted_archive);
+
+    // Reads and checks header and directory
+    bool open(utils::wstring_view filename);
+
+    int32_t get_priority() const;
+    uint32_t get_entries_count() const;
+    const archive_entry& get_entry(uint32_t index) const;
+    utils::string_view get_entry_path(uint32_t index) const;
+
+    // Offsets are relative to the start of archive, reads may run on any thread
+    bool read(uint64_t offset, memory::buffer_ref ref, size_t size);
+    bool read_async(uint64_t offset, memory::buffer_ref ref, size_t size, async_read& operation);
+    memory::buffer_range acquire_view(uint64_t offset, size_t size);
+    void release_view(memory::buffer_range view);
+    bool advise(uint64_t offset, size_t size, access_advice advice);
+
+    // Open entries keep archive mounted
+    void add_reader();
+    void remove_reader();
+
+    mounted_archive* next; //!< Archive of the same or lower priority
+
+private:
+    void close();
+
+    memory::base_allocator& m_allocator;
+    base_file_handle* m_handle; //!< Handle of the whole archive
+    const uint8_t* m_data; //!< View of the whole mapped archive, nullptr if archive is not mapped
+    memory::buffer_range m_view; //!< View m_data comes from
+    archive_header m_header; //!< Header read on open
+    archive_entry* m_entries; //!< Directory sorted by path hash
+    char* m_names; //!< Paths of all entries
+    int32_t m_priority; //!< Mount priority
+    threading::spin_wait_fairness m_lock; //!< Serializes reads of not mapped archive
+}; // class mounted_archive
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline int32_t mounted_archive::get_priority() const
+{
+    return m_priority;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline uint32_t mounted_archive::get_entries_count() const
+{
+    return m_header.entries_count;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline const archive_entry& mounted_archive::get_entry(uint32_t index) const
+{
+    XR_DEBUG_ASSERTION(index < m_header.entries_count);
+    return m_entries[index];
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline utils::string_view mounted_archive::get_entry_path(uint32_t index) const
+{
+    const archive_entry& entry = get_entry(index);
+    return utils::string_view { m_names + entry.name_offset, entry.name_size };
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void mounted_archive::add_reader()
+{
+    m_handle->add_user_reference<threading::memory_order::sequential>();
+}
+
+//-----------------------------------------------------------------------------------------------------------
+/**
+ */
+inline void mounted_archive::remove_reader()
+{
+    m_handle->remove_user_reference<threading::memory_order::release>();
+}
+
+XR_NAMESPACE_END(xr, engine, io)
+//-----------------------------------------------------------------------------------------------------------
@@ -1,7 +1,10 @@
 // This file is a part of xray-ng engine
 //
 
+#if defined(XRAY_PLATFORM_WINDOWS)
 #include <Windows.h>
 #include <VersionHelpers.h>
-#include <cassert>
-#include <intrin.h>
\ No newline at end of file
+#include <intrin.h>
+#endif // defined(XRAY_PLATFORM_WINDOWS)
+
+#include <cassert>
\ No newline at end of file
@@ -0,0 +1,201 @@
+// This file is a part of xray-ng engine
+//
+
+#include "catch/catch.hpp"
+#include "engine/io/api.h"
+#include "../../sources/io/base_file_handle.h"
+#include "corlib/memory/allocator_macro.h"
+#include "corlib/memory/memory_crt_allocator.h"
+#include "corlib/memory/memory_paging.h"
+#include "corlib/sys/chrono.h"
+#include "corlib/utils/aligning.h"
+#include "EASTL/algorithm.h"
+#include <stdio.h>
+
+using namespace xr;
+
+static memory::crt_allocator io_allocator {};
+
+static const wchar_t* const async_test_filename = L"async_read_test.bin";
+static const char* const async_test_filename_narrow = "async_read_test.bin";
+
+constexpr uint32_t max_queue_depth = 64;
+constexpr size_t async_block_size = XR_KILOBYTES_TO_BYTES(64);
+
+//-----------------------------------------------------------------------------------------------------------
+static uint8_t async_test_byte(size_t offset)
+{
+    return uint8_t(offset * 7 + offset / XR_KILOBYTES_TO_BYTES(4));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+static bool write_async_test_file(size_t file_size)
+{
+    engine::io::base_file_handle* handle = engine::io::open_write(io_allocator, async_test_filename, false, false);
+    if(!handle)
+        return false;
+
+    static uint8_t block[async_block_size];
+    bool written = true;
+    for(size_t offset = 0; written && offset < file_size; offset += sizeof(block))
+    {
+        size_t const block_size = eastl::min(sizeof(block), file_size - offset);
+        for(size_t i = 0; i < block_size; ++i)
+            block[i] = async_test_byte(offset + i);
+
+        written = handle->write(memory::buffer_ref(block, sizeof(block)), block_size);
+    }
+
+    engine::io::close_file_handle(handle);
+    return written;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// Page aligned blocks, so they can be read from files opened for direct I/O
+struct async_read_blocks
+{
+    async_read_blocks()
+    {
+        size_t const page_size = memory::system_page_size();
+        m_memory = reinterpret_cast<uint8_t*>(XR_ALLOCATE_MEMORY(io_allocator,
+            async_block_size * max_queue_depth + page_size, "async read blocks"));
+        m_blocks = reinterpret_cast<uint8_t*>(utils::align_up(reinterpret_cast<uintptr_t>(m_memory), page_size));
+    }
+
+    ~async_read_blocks()
+    {
+        XR_DEALLOCATE_MEMORY(io_allocator, m_memory);
+    }
+
+    uint8_t* get(uint32_t index) const
+    {
+        return m_blocks + index * async_block_size;
+    }
+
+private:
+    uint8_t* m_memory;
+    uint8_t* m_blocks;
+}; // struct async_read_blocks
+
+//-----------------------------------------------------------------------------------------------------------
+// Keeps queue_depth reads of random blocks in flight until reads_count of them were done, returns
+// bytes read or 0 if any read failed or had wrong data
+static size_t read_async_blocks(engine::io::base_file_handle* handle, size_t file_size, uint32_t queue_depth,
+    uint32_t reads_count)
+{
+    engine::io::async_read reads[max_queue_depth];
+    size_t offsets[max_queue_depth];
+    eastl::fill_n(offsets, max_queue_depth, SIZE_MAX);
+    async_read_blocks blocks {};
+
+    size_t const blocks_count = file_size / async_block_size;
+    uint64_t random_state = 0x9E3779B97F4A7C15ull;
+    auto next_offset = [&random_state, blocks_count]()
+    {
+        random_state = random_state * 6364136223846793005ull + 1442695040888963407ull;
+        return size_t((random_state >> 33) % blocks_count) * async_block_size;
+    };
+
+    uint32_t started_count = 0;
+    uint32_t done_count = 0;
+    auto start_read = [&](uint32_t slot)
+    {
+        reads[slot].reset();
+        offsets[slot] = next_offset();
+        ++started_count;
+        return engine::io::read_async(handle, offsets[slot], memory::buffer_ref(blocks.get(slot), async_block_size),
+            async_block_size, reads[slot]);
+    };
+
+    bool valid = true;
+    for(uint32_t slot = 0; slot < queue_depth && started_count < reads_count; ++slot)
+        valid &= start_read(slot);
+
+    while(valid && done_count < started_count)
+    {
+        engine::io::poll_async_io();
+        for(uint32_t slot = 0; slot < queue_depth; ++slot)
+        {
+            if(!reads[slot].is_ready() || offsets[slot] == SIZE_MAX)
+                continue;
+
+            uint8_t const* block = blocks.get(slot);
+            valid &= (reads[slot].result == int32_t(async_block_size));
+            valid &= (block[0] == async_test_byte(offsets[slot]));
+            valid &= (block[async_block_size - 1] == async_test_byte(offsets[slot] + async_block_size - 1));
+            offsets[slot] = SIZE_MAX;
+            ++done_count;
+
+            if(valid && started_count < reads_count)
+                valid &= start_read(slot);
+        }
+    }
+
+    // reads still in flight must not outlive their blocks
+    while(done_count < started_count)
+    {
+        engine::io::poll_async_io();
+        for(uint32_t slot = 0; slot < queue_depth; ++slot)
+        {
+            if(reads[slot].is_ready() && offsets[slot] != SIZE_MAX)
+            {
+                offsets[slot] = SIZE_MAX;
+                ++done_count;
+            }
+        }
+    }
+
+    return valid ? size_t(done_count) * async_block_size : 0;
+}
+
+TEST_CASE("async read: random blocks in flight match file", "[io]")
+{
+    constexpr size_t file_size = XR_MEGABYTES_TO_BYTES(4);
+    REQUIRE(write_async_test_file(file_size));
+    REQUIRE(engine::io::initialize_async_io(io_allocator, engine::io::async_io_desc {}));
+
+    engine::io::base_file_handle* handle = engine::io::open_read_no_buffering(io_allocator, async_test_filename, false);
+    REQUIRE(handle != nullptr);
+
+    for(uint32_t queue_depth : { 1u, 8u, max_queue_depth })
+        REQUIRE(read_async_blocks(handle, file_size, queue_depth, 256) == 256 * async_block_size);
+
+    engine::io::close_file_handle(handle);
+    engine::io::shutdown_async_io();
+    remove(async_test_filename_narrow);
+}
+
+TEST_CASE("Async Read Queue Depth", "[.benchmark]")
+{
+    // without direct I/O blocks come from page cache and only submission overhead is measured
+    constexpr size_t file_size = XR_MEGABYTES_TO_BYTES(256);
+    constexpr uint32_t reads_count = 4096;
+
+    REQUIRE(write_async_test_file(file_size));
+    REQUIRE(engine::io::initialize_async_io(io_allocator, engine::io::async_io_desc {}));
+
+    for(bool direct_io : { false, true })
+    {
+        engine::io::buffered_read_desc desc {};
+        desc.direct_io = direct_io;
+
+        engine::io::base_file_handle* handle = engine::io::open_read(io_allocator, async_test_filename, false, desc);
+        REQUIRE(handle != nullptr);
+
+        for(uint32_t queue_depth = 1; queue_depth <= max_queue_depth; queue_depth *= 2)
+        {
+            sys::tick const start_us = sys::now_microseconds();
+            size_t const total = read_async_blocks(handle, file_size, queue_depth, reads_count);
+            sys::tick const elapsed_us = eastl::max<sys::tick>(sys::now_microseconds() - start_us, 1);
+            REQUIRE(total != 0);
+
+            printf("%-6s queue depth %2u, %zu KB random reads: %8.0f MB/s\n", direct_io ? "direct" : "cached",
+                queue_depth, async_block_size >> 10, double(total) / double(elapsed_us));
+        }
+
+        engine::io::close_file_handle(handle);
+    }
+
+    engine::io::shutdown_async_io();
+    remove(async_test_filename_narrow);
+}
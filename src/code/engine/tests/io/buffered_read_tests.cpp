@@ -0,0 +1,137 @@
+// This file is a part of xray-ng engine
+//
+
+#include "catch/catch.hpp"
+#include "engine/io/api.h"
+#include "../../sources/io/base_file_handle.h"
+#include "corlib/memory/memory_crt_allocator.h"
+#include "corlib/sys/chrono.h"
+#include "EASTL/algorithm.h"
+#include <stdio.h>
+
+using namespace xr;
+
+static memory::crt_allocator io_allocator {};
+
+static const wchar_t* const read_test_filename = L"buffered_read_test.bin";
+static const char* const read_test_filename_narrow = "buffered_read_test.bin";
+
+//-----------------------------------------------------------------------------------------------------------
+static uint8_t read_test_byte(size_t offset)
+{
+    return uint8_t(offset * 31 + offset / XR_KILOBYTES_TO_BYTES(4));
+}
+
+//-----------------------------------------------------------------------------------------------------------
+static bool write_read_test_file(size_t file_size)
+{
+    engine::io::base_file_handle* handle = engine::io::open_write(io_allocator, read_test_filename, false, false);
+    if(!handle)
+        return false;
+
+    static uint8_t block[XR_KILOBYTES_TO_BYTES(64)];
+    bool written = true;
+    for(size_t offset = 0; written && offset < file_size; offset += sizeof(block))
+    {
+        size_t const block_size = eastl::min(sizeof(block), file_size - offset);
+        for(size_t i = 0; i < block_size; ++i)
+            block[i] = read_test_byte(offset + i);
+
+        written = handle->write(memory::buffer_ref(block, sizeof(block)), block_size);
+    }
+
+    engine::io::close_file_handle(handle);
+    return written;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// Reads pieces that start every stride bytes, returns bytes read or 0 if any piece had wrong data
+static size_t read_test_file(const engine::io::buffered_read_desc& desc, size_t file_size, size_t piece_size,
+    size_t stride)
+{
+    engine::io::base_file_handle* handle = engine::io::open_read(io_allocator, read_test_filename, false, desc);
+    if(!handle)
+        return 0;
+
+    static uint8_t piece[XR_KILOBYTES_TO_BYTES(256)];
+    XR_DEBUG_ASSERTION(piece_size <= sizeof(piece));
+
+    size_t total = 0;
+    for(size_t offset = 0; offset + piece_size <= file_size; offset += stride)
+    {
+        bool valid = handle->seek(ssize_t(offset)) && handle->read(memory::buffer_ref(piece, sizeof(piece)), piece_size);
+        for(size_t i = 0; valid && i < piece_size; i += XR_KILOBYTES_TO_BYTES(1))
+            valid = (piece[i] == read_test_byte(offset + i));
+
+        if(!valid)
+        {
+            total = 0;
+            break;
+        }
+
+        total += piece_size;
+    }
+
+    engine::io::close_file_handle(handle);
+    return total;
+}
+
+TEST_CASE("buffered read: sequential and strided pieces match file", "[io]")
+{
+    constexpr size_t file_size = XR_MEGABYTES_TO_BYTES(4) + 123;
+    REQUIRE(write_read_test_file(file_size));
+    REQUIRE(engine::io::initialize_async_io(io_allocator, engine::io::async_io_desc {}));
+
+    engine::io::buffered_read_desc desc {};
+    for(uint32_t buffer_count : { 1u, 2u, 8u })
+    {
+        desc.buffer_count = buffer_count;
+        desc.buffer_size = XR_KILOBYTES_TO_BYTES(64);
+
+        // pieces cross buffer borders and strides skip whole buffers
+        REQUIRE(read_test_file(desc, file_size, 5000, 5000) != 0);
+        REQUIRE(read_test_file(desc, file_size, 5000, XR_KILOBYTES_TO_BYTES(200)) != 0);
+    }
+
+    engine::io::shutdown_async_io();
+    remove(read_test_filename_narrow);
+}
+
+TEST_CASE("Buffered Read Throughput", "[.benchmark]")
+{
+    // file is written right before reading, so without direct I/O it is read from page cache
+    constexpr size_t file_size = XR_MEGABYTES_TO_BYTES(256);
+    constexpr size_t piece_size = XR_KILOBYTES_TO_BYTES(64);
+
+    REQUIRE(write_read_test_file(file_size));
+    REQUIRE(engine::io::initialize_async_io(io_allocator, engine::io::async_io_desc {}));
+
+    for(bool direct_io : { false, true })
+    {
+        for(size_t buffer_size : { XR_KILOBYTES_TO_BYTES(64), XR_KILOBYTES_TO_BYTES(256), XR_MEGABYTES_TO_BYTES(1) })
+        {
+            for(uint32_t buffer_count : { 2u, 4u, 8u, 16u })
+            {
+                engine::io::buffered_read_desc desc {};
+                desc.buffer_size = buffer_size;
+                desc.buffer_count = buffer_count;
+                desc.direct_io = direct_io;
+
+                // strided reads take every fourth piece, each one is a seek forward
+                for(size_t stride : { piece_size, piece_size * 4 })
+                {
+                    sys::tick const start_us = sys::now_microseconds();
+                    size_t const total = read_test_file(desc, file_size, piece_size, stride);
+                    sys::tick const elapsed_us = eastl::max<sys::tick>(sys::now_microseconds() - start_us, 1);
+                    REQUIRE(total != 0);
+
+                    printf("%-10s %-6s %5zu KB x %2u buffers: %8.0f MB/s\n", (stride == piece_size) ? "sequential" : "strided",
+                        direct_io ? "direct" : "cached", buffer_size >> 10, buffer_count, double(total) / double(elapsed_us));
+                }
+            }
+        }
+    }
+
+    engine::io::shutdown_async_io();
+    remove(read_test_filename_narrow);
+}
@@ -0,0 +1,286 @@
+// This file is a part of xray-ng engine
+//
+
+#include "catch/catch.hpp"
+#include "engine/io/file_system.h"
+#include "../../sources/io/base_file_handle.h"
+#include "corlib/memory/memory_crt_allocator.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace xr;
+
+static memory::crt_allocator io_allocator {};
+
+//-----------------------------------------------------------------------------------------------------------
+// Allocator index can't be taken from, allocations fail while fail_allocations is set
+class failing_allocator final : public memory::base_allocator
+{
+public:
+    bool can_allocate_block(size_t const size) const XR_NOEXCEPT override
+    {
+        XR_UNREFERENCED_PARAMETER(size);
+        return !fail_allocations;
+    }
+
+    size_t allocated_size() const XR_NOEXCEPT override
+    {
+        return 0;
+    }
+
+    size_t total_size() const XR_NOEXCEPT override
+    {
+        return 0;
+    }
+
+    bool fail_allocations { false };
+
+protected:
+    pvoid call_malloc(size_t size
+        XR_DEBUG_PARAMETERS_DESCRIPTION_DECLARATION
+        XR_DEBUG_PARAMETERS_DECLARATION) override
+    {
+        XR_DEBUG_PARAMETERS_UNREFERENCED_GUARD;
+        return fail_allocations ? nullptr : malloc(size);
+    }
+
+    pvoid call_realloc(pvoid pointer, size_t new_size
+        XR_DEBUG_PARAMETERS_DESCRIPTION_DECLARATION
+        XR_DEBUG_PARAMETERS_DECLARATION) override
+    {
+        XR_DEBUG_PARAMETERS_UNREFERENCED_GUARD;
+        return fail_allocations ? nullptr : realloc(pointer, new_size);
+    }
+
+    void call_free(pvoid pointer
+        XR_DEBUG_PARAMETERS_DECLARATION) override
+    {
+        XR_DEBUG_PARAMETERS_UNREFERENCED_GUARD;
+        free(pointer);
+    }
+}; // class failing_allocator
+
+//-----------------------------------------------------------------------------------------------------------
+struct test_file
+{
+    const wchar_t* filename;
+    size_t size;
+    uint8_t seed;
+}; // struct test_file
+
+#define FILE_SYSTEM_TEST_DIRECTORY L"file_system_test"
+
+static const test_file base_texture { FILE_SYSTEM_TEST_DIRECTORY L"/a.bin", 10000, 1 };
+static const test_file base_sound { FILE_SYSTEM_TEST_DIRECTORY L"/b.bin", 5000, 2 };
+static const test_file patch_sound { FILE_SYSTEM_TEST_DIRECTORY L"/b2.bin", 7000, 3 };
+static const test_file patch_level { FILE_SYSTEM_TEST_DIRECTORY L"/d.bin", 4096, 4 };
+
+static const wchar_t* const base_archive = FILE_SYSTEM_TEST_DIRECTORY L"/base.pak";
+static const wchar_t* const patch_archive = FILE_SYSTEM_TEST_DIRECTORY L"/patch.pak";
+static const wchar_t* const damaged_archive = FILE_SYSTEM_TEST_DIRECTORY L"/damaged.pak";
+
+//-----------------------------------------------------------------------------------------------------------
+static uint8_t test_file_byte(const test_file& file, size_t offset)
+{
+    return uint8_t(offset * file.seed + file.seed);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+static bool write_test_file(const test_file& file)
+{
+    engine::io::base_file_handle* handle = engine::io::open_write(io_allocator, file.filename, false, false);
+    if(!handle)
+        return false;
+
+    static uint8_t data[XR_KILOBYTES_TO_BYTES(16)];
+    XR_DEBUG_ASSERTION(file.size <= sizeof(data));
+    for(size_t i = 0; i < file.size; ++i)
+        data[i] = test_file_byte(file, i);
+
+    bool const written = handle->write(memory::buffer_ref(data, sizeof(data)), file.size);
+    engine::io::close_file_handle(handle);
+    return written;
+}
+
+//-----------------------------------------------------------------------------------------------------------
+static void remove_test_file(const wchar_t* filename)
+{
+    char narrow_filename[128];
+    if(wcstombs(narrow_filename, filename, sizeof(narrow_filename)) < sizeof(narrow_filename))
+        remove(narrow_filename);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// Base archive has a texture and a sound, patch replaces the sound and adds a level
+static bool pack_test_archives()
+{
+    if(!engine::io::create_directory(FILE_SYSTEM_TEST_DIRECTORY))
+        return false;
+
+    for(const test_file* file : { &base_texture, &base_sound, &patch_sound, &patch_level })
+    {
+        if(!write_test_file(*file))
+            return false;
+    }
+
+    engine::io::archive_source const base_sources[] =
+    {
+        { "textures/a.dds", base_texture.filename },
+        { "sounds/b.ogg", base_sound.filename }
+    };
+
+    engine::io::archive_source const patch_sources[] =
+    {
+        { "sounds/b.ogg", patch_sound.filename },
+        { "levels/d.lvl", patch_level.filename }
+    };
+
+    return engine::io::pack_archive(io_allocator, base_archive, base_sources, 2) &&
+        engine::io::pack_archive(io_allocator, patch_archive, patch_sources, 2, 64);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+static void remove_test_archives()
+{
+    for(const test_file* file : { &base_texture, &base_sound, &patch_sound, &patch_level })
+        remove_test_file(file->filename);
+
+    for(const wchar_t* filename : { base_archive, patch_archive, damaged_archive })
+        remove_test_file(filename);
+
+    engine::io::delete_directory(FILE_SYSTEM_TEST_DIRECTORY);
+}
+
+//-----------------------------------------------------------------------------------------------------------
+// Whether path is visible and reads data of the file
+static bool is_entry_of(const engine::io::file_system& fs, utils::string_view path, const test_file& file)
+{
+    size_t size = 0;
+    if(!fs.get_file_size(path, size) || size != file.size)
+        return false;
+
+    engine::io::base_file_handle* handle = fs.open_read(path);
+    if(!handle)
+        return false;
+
+    static uint8_t data[XR_KILOBYTES_TO_BYTES(16)];
+    bool valid = handle->read(memory::buffer_ref(data, sizeof(data)), size);
+    for(size_t i = 0; valid && i < size; ++i)
+        valid = (data[i] == test_file_byte(file, i));
+
+    engine::io::close_file_handle(handle);
+    return valid;
+}
+
+TEST_CASE("file system: higher priority archive hides entries of lower one", "[io]")
+{
+    REQUIRE(pack_test_archives());
+    {
+        engine::io::file_system fs { io_allocator };
+        REQUIRE(fs.mount(base_archive) != nullptr);
+        REQUIRE(is_entry_of(fs, "sounds/b.ogg", base_sound));
+        REQUIRE_FALSE(fs.exists("levels/d.lvl"));
+
+        REQUIRE(fs.mount(patch_archive, 10) != nullptr);
+        REQUIRE(is_entry_of(fs, "sounds/b.ogg", patch_sound));
+        REQUIRE(is_entry_of(fs, "textures/a.dds", base_texture));
+        REQUIRE(is_entry_of(fs, "levels/d.lvl", patch_level));
+
+        // lower priority mounted later stays below
+        REQUIRE(fs.mount(base_archive, 5) != nullptr);
+        REQUIRE(is_entry_of(fs, "sounds/b.ogg", patch_sound));
+    }
+    remove_test_archives();
+}
+
+TEST_CASE("file system: later mount wins with equal priority", "[io]")
+{
+    REQUIRE(pack_test_archives());
+    {
+        engine::io::file_system fs { io_allocator };
+        REQUIRE(fs.mount(base_archive, 3) != nullptr);
+        REQUIRE(fs.mount(patch_archive, 3) != nullptr);
+        REQUIRE(is_entry_of(fs, "sounds/b.ogg", patch_sound));
+
+        REQUIRE(fs.mount(base_archive, 3) != nullptr);
+        REQUIRE(is_entry_of(fs, "sounds/b.ogg", base_sound));
+        REQUIRE(is_entry_of(fs, "levels/d.lvl", patch_level));
+    }
+    remove_test_archives();
+}
+
+TEST_CASE("file system: unmount makes hidden entries visible again", "[io]")
+{
+    REQUIRE(pack_test_archives());
+    {
+        engine::io::file_system fs { io_allocator };
+        engine::io::mounted_archive* base = fs.mount(base_archive);
+        engine::io::mounted_archive* patch = fs.mount(patch_archive, 10);
+        REQUIRE(base != nullptr);
+        REQUIRE(patch != nullptr);
+
+        fs.unmount(patch);
+        REQUIRE(is_entry_of(fs, "sounds/b.ogg", base_sound));
+        REQUIRE(is_entry_of(fs, "textures/a.dds", base_texture));
+        REQUIRE_FALSE(fs.exists("levels/d.lvl"));
+
+        fs.unmount(base);
+        REQUIRE_FALSE(fs.exists("sounds/b.ogg"));
+        REQUIRE_FALSE(fs.exists("textures/a.dds"));
+    }
+    remove_test_archives();
+}
+
+TEST_CASE("file system: damaged archive is not mounted", "[io]")
+{
+    REQUIRE(pack_test_archives());
+    {
+        engine::io::file_system fs { io_allocator };
+        REQUIRE(fs.mount(base_archive) != nullptr);
+
+        // loose file and missing file are no archives
+        REQUIRE(fs.mount(base_texture.filename, 10) == nullptr);
+        REQUIRE(fs.mount(FILE_SYSTEM_TEST_DIRECTORY L"/missing.pak", 10) == nullptr);
+
+        // directory that points past the end of archive
+        engine::io::archive_source const sources[] = { { "sounds/b.ogg", patch_sound.filename } };
+        REQUIRE(engine::io::pack_archive(io_allocator, damaged_archive, sources, 1));
+
+        engine::io::base_file_handle* handle = engine::io::open_write(io_allocator, damaged_archive, true, true);
+        REQUIRE(handle != nullptr);
+        uint64_t const directory_offset = uint64_t(1) << 40;
+        REQUIRE(handle->seek(offsetof(engine::io::archive_header, directory_offset)));
+        REQUIRE(handle->write(memory::buffer_ref(&directory_offset, sizeof(directory_offset)), sizeof(directory_offset)));
+        engine::io::close_file_handle(handle);
+
+        REQUIRE(fs.mount(damaged_archive, 10) == nullptr);
+        REQUIRE(is_entry_of(fs, "sounds/b.ogg", base_sound));
+    }
+    remove_test_archives();
+}
+
+TEST_CASE("file system: unmount drops whole index when new one can't be allocated", "[io]")
+{
+    REQUIRE(pack_test_archives());
+    {
+        failing_allocator alloc {};
+        engine::io::file_system fs { alloc };
+        REQUIRE(fs.mount(base_archive) != nullptr);
+        engine::io::mounted_archive* patch = fs.mount(patch_archive, 10);
+        REQUIRE(patch != nullptr);
+
+        // entries of unmounted archive must not stay visible, entries of others go with them
+        alloc.fail_allocations = true;
+        fs.unmount(patch);
+        REQUIRE_FALSE(fs.exists("levels/d.lvl"));
+        REQUIRE_FALSE(fs.exists("sounds/b.ogg"));
+
+        // next mount indexes every archive again
+        alloc.fail_allocations = false;
+        REQUIRE(fs.mount(patch_archive, 10) != nullptr);
+        REQUIRE(is_entry_of(fs, "textures/a.dds", base_texture));
+        REQUIRE(is_entry_of(fs, "sounds/b.ogg", patch_sound));
+    }
+    remove_test_archives();
+}
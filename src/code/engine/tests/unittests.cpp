@@ -0,0 +1,5 @@
+// This file is a part of xray-ng engine
+//
+
+#define CATCH_CONFIG_MAIN
+#include "catch/catch.hpp"
\ No newline at end of file